@@ -0,0 +1,196 @@
+// AesCfbSpeedTest.cpp
+
+// Implements the main app entrypoint
+
+/*
+This program compares the throughput of the AES-NI CFB8 functions used by cAesCfb128Encryptor and cAesCfb128Decryptor
+(AesNiCfb8.h) against mbedTLS, which the classes use on CPUs without AES-NI.
+
+Both encryption and decryption are measured, each over large pieces of data, such as chunk packets,
+and over small ones, such as entity movement packets, where the per-call overhead matters more.
+Both implementations produce the same bytes, which is checked before measuring.
+*/
+
+#include "Globals.h"
+#include "mbedTLS++/AesNiCfb8.h"
+#include "mbedtls/aes.h"
+
+#include <random>
+
+
+
+
+
+namespace
+{
+	/** The data to process, and its encryption key and IV. */
+	struct sData
+	{
+		Byte m_Key[16];
+		Byte m_IV[16];
+		ContiguousByteBuffer m_Data;
+
+		sData(size_t a_Size) :
+			m_Data(a_Size, std::byte(0))
+		{
+			std::minstd_rand Random(1);
+			for (auto & Value : m_Key)
+			{
+				Value = static_cast<Byte>(Random() % 256);
+			}
+			for (auto & Value : m_IV)
+			{
+				Value = static_cast<Byte>(Random() % 256);
+			}
+			for (auto & Value : m_Data)
+			{
+				Value = static_cast<std::byte>(Random() % 256);
+			}
+		}
+	};
+}
+
+
+
+
+
+/** Processes the data in pieces of the specified length using mbedTLS. */
+static void ProcessMbedTls(const sData & a_Data, const int a_Mode, const size_t a_PieceLength, ContiguousByteBuffer & a_Out)
+{
+	mbedtls_aes_context Aes;
+	mbedtls_aes_init(&Aes);
+	mbedtls_aes_setkey_enc(&Aes, a_Data.m_Key, 128);
+	Byte IV[16];
+	std::copy_n(a_Data.m_IV, 16, IV);
+
+	auto Data = reinterpret_cast<unsigned char *>(a_Out.data());
+	for (size_t i = 0; i < a_Out.size(); i += a_PieceLength)
+	{
+		mbedtls_aes_crypt_cfb8(&Aes, a_Mode, std::min(a_PieceLength, a_Out.size() - i), IV, Data + i, Data + i);
+	}
+	mbedtls_aes_free(&Aes);
+}
+
+
+
+
+
+/** Processes the data in pieces of the specified length using AES-NI. */
+static void ProcessAesNi(const sData & a_Data, const int a_Mode, const size_t a_PieceLength, ContiguousByteBuffer & a_Out)
+{
+	AesNiCfb8::sKey Key;
+	AesNiCfb8::ExpandKey(a_Data.m_Key, Key);
+	Byte IV[16];
+	std::copy_n(a_Data.m_IV, 16, IV);
+
+	for (size_t i = 0; i < a_Out.size(); i += a_PieceLength)
+	{
+		const auto Length = std::min(a_PieceLength, a_Out.size() - i);
+		if (a_Mode == MBEDTLS_AES_ENCRYPT)
+		{
+			AesNiCfb8::Encrypt(Key, IV, a_Out.data() + i, Length);
+		}
+		else
+		{
+			AesNiCfb8::Decrypt(Key, IV, a_Out.data() + i, Length);
+		}
+	}
+}
+
+
+
+
+
+/** Returns the throughput of the processing function over the data, in MiB / sec. */
+template <typename Func>
+static double MeasureThroughput(const sData & a_Data, const int a_NumIterations, Func a_Process)
+{
+	auto Data = a_Data.m_Data;
+	size_t Total = 0;  // Do not let the optimizer optimize the whole calculation away
+	const auto TimeStart = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < a_NumIterations; i++)
+	{
+		a_Process(Data);
+		Total += std::to_integer<size_t>(Data[static_cast<size_t>(i) % Data.size()]);
+	}
+	const auto Seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - TimeStart).count();
+	if (Total == 0)
+	{
+		printf(" ");  // Practically never happens, but the compiler doesn't know that
+	}
+	return static_cast<double>(a_NumIterations) * static_cast<double>(Data.size()) / Seconds / (1024 * 1024);
+}
+
+
+
+
+
+/** Measures both implementations in the specified mode, after checking that they produce the same data. */
+static void Measure(const char * a_Name, const sData & a_Data, const int a_Mode, const size_t a_PieceLength, const int a_NumIterations)
+{
+	auto MbedTls = a_Data.m_Data, AesNi = a_Data.m_Data;
+	ProcessMbedTls(a_Data, a_Mode, a_PieceLength, MbedTls);
+	ProcessAesNi(a_Data, a_Mode, a_PieceLength, AesNi);
+	if (MbedTls != AesNi)
+	{
+		printf("%s: AES-NI produces different data than mbedTLS!\n", a_Name);
+		return;
+	}
+
+	const auto MiBMbedTls = MeasureThroughput(a_Data, a_NumIterations, [&](ContiguousByteBuffer & a_Out)
+		{
+			ProcessMbedTls(a_Data, a_Mode, a_PieceLength, a_Out);
+		}
+	);
+	const auto MiBAesNi = MeasureThroughput(a_Data, a_NumIterations, [&](ContiguousByteBuffer & a_Out)
+		{
+			ProcessAesNi(a_Data, a_Mode, a_PieceLength, a_Out);
+		}
+	);
+	printf("%s: mbedTLS %.1f MiB / sec, AES-NI %.1f MiB / sec, speedup %.1fx\n",
+		a_Name, MiBMbedTls, MiBAesNi, MiBAesNi / MiBMbedTls
+	);
+}
+
+
+
+
+
+int main(int argc, char ** argv)
+{
+	if (!AesNiCfb8::IsSupported())
+	{
+		printf("This CPU doesn't support AES-NI, there's nothing to compare.\n");
+		return 1;
+	}
+
+	int NumIterations = 1000;
+	if (argc > 1)
+	{
+		NumIterations = std::atoi(argv[1]);
+		if (NumIterations < 10)
+		{
+			printf("Invalid number of iterations, using 1000 instead\n");
+			NumIterations = 1000;
+		}
+	}
+
+	const sData Data(64 KiB);
+
+	// Perform each test twice, to account for cache-warmup:
+	Measure("Encrypt, 64 KiB pieces", Data, MBEDTLS_AES_ENCRYPT, 64 KiB, NumIterations);
+	Measure("Encrypt, 64 KiB pieces", Data, MBEDTLS_AES_ENCRYPT, 64 KiB, NumIterations);
+	Measure("Encrypt, 32 B pieces", Data, MBEDTLS_AES_ENCRYPT, 32, NumIterations);
+	Measure("Encrypt, 32 B pieces", Data, MBEDTLS_AES_ENCRYPT, 32, NumIterations);
+	Measure("Decrypt, 64 KiB pieces", Data, MBEDTLS_AES_DECRYPT, 64 KiB, NumIterations);
+	Measure("Decrypt, 64 KiB pieces", Data, MBEDTLS_AES_DECRYPT, 64 KiB, NumIterations);
+	Measure("Decrypt, 32 B pieces", Data, MBEDTLS_AES_DECRYPT, 32, NumIterations);
+	Measure("Decrypt, 32 B pieces", Data, MBEDTLS_AES_DECRYPT, 32, NumIterations);
+
+	// If build on Windows using MSVC, wait for a keypress before ending:
+	#ifdef _MSC_VER
+		getchar();
+	#endif
+
+	return 0;
+}
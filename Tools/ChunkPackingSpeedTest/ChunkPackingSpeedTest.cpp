@@ -0,0 +1,258 @@
+// ChunkPackingSpeedTest.cpp
+
+// Implements the main app entrypoint
+
+/*
+This program compares the performance of the chunk section packing kernels used by cChunkDataSerializer
+(ChunkDataPacking.h) against the per-block code that they replaced.
+
+The per-block code expands each block's meta nibble, runs the block through the palette functions
+and composes the bit-packed longs one value at a time, writing each long out separately.
+The kernels build the block keys for the whole section at once (vectorized where available),
+map them through a precomputed palette table, and pack the whole section into a single buffer.
+Both produce the same bytes, which is checked before measuring.
+
+The section data is random, so that neither approach benefits from repetitive data.
+*/
+
+#include "Globals.h"
+#include "Protocol/ChunkDataPacking.h"
+#include "Protocol/Palettes/Upgrade.h"
+#include "Protocol/Palettes/Palette_1_14.h"
+
+#include <random>
+
+
+
+
+
+using namespace ChunkDataPacking;
+
+
+
+
+
+namespace
+{
+	UInt32 PaletteLegacy(const BLOCKTYPE a_BlockType, const NIBBLETYPE a_Meta)
+	{
+		return static_cast<UInt32>((a_BlockType << 4) | a_Meta);
+	}
+
+	UInt32 Palette477(const BLOCKTYPE a_BlockType, const NIBBLETYPE a_Meta)
+	{
+		return Palette_1_14::From(PaletteUpgrade::FromBlock(a_BlockType, a_Meta));
+	}
+
+	/** A random section of blocks and metas. The block types are limited to the ones the palettes know about. */
+	struct sSection
+	{
+		std::vector<BLOCKTYPE> m_Blocks;
+		std::vector<NIBBLETYPE> m_Metas;
+
+		sSection(unsigned a_Seed) :
+			m_Blocks(SectionBlockCount),
+			m_Metas(SectionBlockCount / 2)
+		{
+			std::minstd_rand Random(a_Seed);
+			for (auto & Block : m_Blocks)
+			{
+				Block = static_cast<BLOCKTYPE>(Random() % 200);
+			}
+			for (auto & Meta : m_Metas)
+			{
+				Meta = static_cast<NIBBLETYPE>(Random() % 256);
+			}
+		}
+	};
+}
+
+
+
+
+
+/** Packs the section one block at a time, the way cChunkDataSerializer::WriteBlockSectionSeamless() used to. */
+template <UInt32 Palette(BLOCKTYPE, NIBBLETYPE)>
+static void PackPerBlock(const sSection & a_Section, const UInt8 a_BitsPerEntry, std::vector<std::byte> & a_Out)
+{
+	UInt64 Buffer = 0;
+	unsigned char BitIndex = 0;
+	for (size_t Index = 0; Index != SectionBlockCount; Index++)
+	{
+		const BLOCKTYPE BlockType = a_Section.m_Blocks[Index];
+		const NIBBLETYPE BlockMeta = cChunkDef::ExpandNibble(a_Section.m_Metas.data(), Index);
+		const auto Value = Palette(BlockType, BlockMeta);
+
+		Buffer |= static_cast<UInt64>(Value) << BitIndex;
+		const auto Remaining = static_cast<char>(a_BitsPerEntry - (64 - BitIndex));
+		if (Remaining >= 0)
+		{
+			// Write the long out, big-endian, one byte at a time (like cByteBuffer::WriteBEUInt64 did):
+			for (int Byte = 7; Byte >= 0; Byte--)
+			{
+				a_Out.push_back(static_cast<std::byte>(Buffer >> (Byte * 8)));
+			}
+			Buffer = static_cast<UInt64>(Value >> (a_BitsPerEntry - Remaining));
+			BitIndex = static_cast<unsigned char>(Remaining);
+		}
+		else
+		{
+			BitIndex += a_BitsPerEntry;
+		}
+	}
+}
+
+
+
+
+
+/** Packs the section using the kernels, the way cChunkDataSerializer::WriteBlockSectionSeamless() does now. */
+static void PackKernels(const sSection & a_Section, const std::vector<UInt32> & a_Table, const UInt8 a_BitsPerEntry, std::vector<std::byte> & a_Out)
+{
+	std::array<UInt16, SectionBlockCount> Keys;
+	MakeBlockKeys(a_Section.m_Blocks.data(), a_Section.m_Metas.data(), Keys.data());
+
+	std::array<UInt32, SectionBlockCount> Values;
+	MapBlockKeys(Keys.data(), a_Table.data(), Values.data());
+
+	const auto Size = a_Out.size();
+	a_Out.resize(Size + GetPackedSize(a_BitsPerEntry));
+	PackBits(Values.data(), a_BitsPerEntry, a_Out.data() + Size);
+}
+
+
+
+
+
+/** Measures both approaches over the sections, after checking that they produce the same data. */
+template <UInt32 Palette(BLOCKTYPE, NIBBLETYPE)>
+static void Measure(const char * a_Name, const std::vector<sSection> & a_Sections, const UInt8 a_BitsPerEntry, const int a_NumIterations)
+{
+	std::vector<UInt32> Table(NumBlockKeys);
+	for (size_t Key = 0; Key < NumBlockKeys; Key++)
+	{
+		Table[Key] = Palette(static_cast<BLOCKTYPE>(Key >> 4), static_cast<NIBBLETYPE>(Key & 0x0f));
+	}
+
+	std::vector<std::byte> PerBlock, Kernels;
+	for (const auto & Section : a_Sections)
+	{
+		PackPerBlock<Palette>(Section, a_BitsPerEntry, PerBlock);
+		PackKernels(Section, Table, a_BitsPerEntry, Kernels);
+	}
+	if (PerBlock != Kernels)
+	{
+		printf("%s: the kernels produce different data than the per-block code!\n", a_Name);
+		return;
+	}
+
+	size_t Total = 0;  // Do not let the optimizer optimize the whole calculation away
+	auto TimeStart = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < a_NumIterations; i++)
+	{
+		PerBlock.clear();
+		for (const auto & Section : a_Sections)
+		{
+			PackPerBlock<Palette>(Section, a_BitsPerEntry, PerBlock);
+		}
+		Total += PerBlock.size();
+	}
+	auto TimePerBlock = std::chrono::high_resolution_clock::now() - TimeStart;
+
+	TimeStart = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < a_NumIterations; i++)
+	{
+		Kernels.clear();
+		for (const auto & Section : a_Sections)
+		{
+			PackKernels(Section, Table, a_BitsPerEntry, Kernels);
+		}
+		Total += Kernels.size();
+	}
+	auto TimeKernels = std::chrono::high_resolution_clock::now() - TimeStart;
+
+	const auto NumSections = static_cast<double>(a_NumIterations) * static_cast<double>(a_Sections.size());
+	const auto UsPerBlock = std::chrono::duration<double, std::micro>(TimePerBlock).count() / NumSections;
+	const auto UsKernels = std::chrono::duration<double, std::micro>(TimeKernels).count() / NumSections;
+	printf("%s: per-block %.2f us / section, kernels %.2f us / section, speedup %.1fx (total %zu)\n",
+		a_Name, UsPerBlock, UsKernels, UsPerBlock / UsKernels, Total
+	);
+}
+
+
+
+
+
+/** Measures the block key kernel alone, against its scalar version. */
+static void MeasureBlockKeys(const std::vector<sSection> & a_Sections, const int a_NumIterations)
+{
+	std::array<UInt16, SectionBlockCount> Keys;
+	size_t Total = 0;
+	auto TimeStart = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < a_NumIterations; i++)
+	{
+		for (const auto & Section : a_Sections)
+		{
+			MakeBlockKeysScalar(Section.m_Blocks.data(), Section.m_Metas.data(), Keys.data());
+			Total += Keys[static_cast<size_t>(i) % SectionBlockCount];
+		}
+	}
+	auto TimeScalar = std::chrono::high_resolution_clock::now() - TimeStart;
+
+	TimeStart = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < a_NumIterations; i++)
+	{
+		for (const auto & Section : a_Sections)
+		{
+			MakeBlockKeys(Section.m_Blocks.data(), Section.m_Metas.data(), Keys.data());
+			Total += Keys[static_cast<size_t>(i) % SectionBlockCount];
+		}
+	}
+	auto TimeVector = std::chrono::high_resolution_clock::now() - TimeStart;
+
+	const auto NumSections = static_cast<double>(a_NumIterations) * static_cast<double>(a_Sections.size());
+	const auto UsScalar = std::chrono::duration<double, std::micro>(TimeScalar).count() / NumSections;
+	const auto UsVector = std::chrono::duration<double, std::micro>(TimeVector).count() / NumSections;
+	printf("Block keys: scalar %.3f us / section, vectorized %.3f us / section, speedup %.1fx (total %zu)\n",
+		UsScalar, UsVector, UsScalar / UsVector, Total
+	);
+}
+
+
+
+
+
+int main(int argc, char ** argv)
+{
+	int NumIterations = 1000;
+	if (argc > 1)
+	{
+		NumIterations = std::atoi(argv[1]);
+		if (NumIterations < 10)
+		{
+			printf("Invalid number of iterations, using 1000 instead\n");
+			NumIterations = 1000;
+		}
+	}
+
+	std::vector<sSection> Sections;
+	for (unsigned Seed = 1; Seed <= 16; Seed++)
+	{
+		Sections.emplace_back(Seed);
+	}
+
+	// Perform each test twice, to account for cache-warmup:
+	MeasureBlockKeys(Sections, NumIterations);
+	MeasureBlockKeys(Sections, NumIterations);
+	Measure<&PaletteLegacy>("Legacy palette, 13 bits", Sections, 13, NumIterations);
+	Measure<&PaletteLegacy>("Legacy palette, 13 bits", Sections, 13, NumIterations);
+	Measure<&Palette477>("1.14 palette, 14 bits", Sections, 14, NumIterations);
+	Measure<&Palette477>("1.14 palette, 14 bits", Sections, 14, NumIterations);
+
+	// If build on Windows using MSVC, wait for a keypress before ending:
+	#ifdef _MSC_VER
+		getchar();
+	#endif
+
+	return 0;
+}
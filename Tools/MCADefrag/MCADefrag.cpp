@@ -8,6 +8,7 @@
 #include "Logger.h"
 #include "LoggerSimple.h"
 #include "LoggerListeners.h"
+#include "WorldStorage/MCAChunkOrder.h"
 
 
 
@@ -206,9 +207,10 @@ void cMCADefrag::cThread::ProcessFile(const AString & a_FileName)
 		return;
 	}
 
-	// Process each chunk:
-	for (size_t i = 0; i < 1024; i++)
+	// Process each chunk, in the Z-order:
+	for (size_t Order = 0; Order < 1024; Order++)
 	{
+		size_t i = MCAChunkOrder::GetZOrderChunkIndex(Order);
 		size_t idx = i * 4;
 		if (
 			(Locations[idx] == 0) &&
@@ -242,10 +244,12 @@ void cMCADefrag::cThread::ProcessFile(const AString & a_FileName)
 	}
 
 	// Close the files, delete orig, rename new:
+	const auto OrigSize = In.GetSize();
 	In.Close();
 	Out.Close();
 	cFile::Delete(a_FileName);
 	cFile::Rename(OutFileName, a_FileName);
+	LOGINFO("%s: %ld KiB -> %d KiB", a_FileName.c_str(), OrigSize / 1024, m_CurrentSectorOut * 4);
 }
 
 
@@ -93,7 +93,8 @@ protected:
 		Compression::Extractor m_Extractor;
 
 
-		/** Processes the specified file. */
+		/** Processes the specified file.
+		The chunks are written in the Z-order of their coords, so that the chunks near each other in the world end up near each other in the file. */
 		void ProcessFile(const AString & a_FileName);
 
 		/** Reads the chunk data into m_CompressedChunkData.
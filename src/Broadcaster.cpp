@@ -100,6 +100,70 @@ namespace
 			ForClientsWithChunk({ a_Entity.GetChunkX(), a_Entity.GetChunkZ() }, a_World, a_Exclude, std::move(a_Func));
 		}
 	}
+
+	/** Wraps the function object a_SendFunc, that sends a packet to a single client, so that the packet is serialized and compressed
+	only once per protocol version among the clients that the wrapper is called for; all the clients of that version are then sent
+	the same shared data, which only gets copied when each client encrypts its outgoing data.
+	Only usable for the packets whose contents don't depend on the recipient, other than on its protocol version. */
+	template <typename Func>
+	auto SerializeOnce(Func a_SendFunc)
+	{
+		using cSerialized = std::vector<std::pair<UInt32, std::shared_ptr<const ContiguousByteBuffer>>>;
+		return [SendFunc = std::move(a_SendFunc), Serialized = cSerialized()](cClientHandle & a_Client) mutable
+		{
+			const auto ProtocolVersion = a_Client.GetProtocolVersion();
+			auto Itr = std::find_if(Serialized.begin(), Serialized.end(), [ProtocolVersion](const auto & a_Entry)
+				{
+					return (a_Entry.first == ProtocolVersion);
+				}
+			);
+			if (Itr == Serialized.end())
+			{
+				// First recipient with this protocol version, serialize the packet:
+				Serialized.emplace_back(ProtocolVersion, std::make_shared<const ContiguousByteBuffer>(a_Client.CaptureSentData([&]
+					{
+						SendFunc(a_Client);
+					}
+				)));
+				Itr = std::prev(Serialized.end());
+			}
+			a_Client.SendData(Itr->second);
+		};
+	}
+
+	/** Wraps the function object a_SendFunc, so that a_EachFunc is called for each client before it.
+	SerializeOnce() calls a_SendFunc only for the first client of each protocol version, so the per-client bookkeeping
+	and checks that go along with a packet must be done in a_EachFunc instead. */
+	template <typename EachFunc, typename Func>
+	auto ForEachRecipient(EachFunc a_EachFunc, Func a_SendFunc)
+	{
+		return [Each = std::move(a_EachFunc), SendFunc = std::move(a_SendFunc)](cClientHandle & a_Client) mutable
+		{
+			Each(a_Client);
+			SendFunc(a_Client);
+		};
+	}
+
+	/** Wraps the function object a_SendFunc, that sends a low-priority movement update of a_Entity, so that congested clients skip it.
+	The client remembers the skipped entity, to resynchronise it with absolute packets once the congestion clears.
+	For the position updates (a_IsPosition), that is done here instead of the update, so that the following relative moves stay exact. */
+	template <typename Func>
+	auto SendMovement(const cEntity & a_Entity, const bool a_IsPosition, Func a_SendFunc)
+	{
+		return [&a_Entity, a_IsPosition, SendFunc = std::move(a_SendFunc)](cClientHandle & a_Client) mutable
+		{
+			if (a_Client.IsCongested())
+			{
+				a_Client.DeferEntityMovement(a_Entity);
+				return;
+			}
+			if (a_IsPosition && a_Client.ResyncEntityMovement(a_Entity))
+			{
+				return;
+			}
+			SendFunc(a_Client);
+		};
+	}
 }  // namespace (anonymous)
 
 
@@ -121,11 +185,11 @@ void cWorld::BroadcastAttachEntity(const cEntity & a_Entity, const cEntity & a_V
 
 void cWorld::BroadcastBlockAction(Vector3i a_BlockPos, Byte a_Byte1, Byte a_Byte2, BLOCKTYPE a_BlockType, const cClientHandle * a_Exclude)
 {
-	ForClientsWithChunkAtPos(a_BlockPos, *this, a_Exclude, [&](cClientHandle & a_Client)
+	ForClientsWithChunkAtPos(a_BlockPos, *this, a_Exclude, SerializeOnce([&](cClientHandle & a_Client)
 		{
 			a_Client.SendBlockAction(a_BlockPos.x, a_BlockPos.y, a_BlockPos.z, static_cast<char>(a_Byte1), static_cast<char>(a_Byte2), a_BlockType);
 		}
-	);
+	));
 }
 
 
@@ -134,11 +198,11 @@ void cWorld::BroadcastBlockAction(Vector3i a_BlockPos, Byte a_Byte1, Byte a_Byte
 
 void cWorld::BroadcastBlockBreakAnimation(UInt32 a_EntityID, Vector3i a_BlockPos, Int8 a_Stage, const cClientHandle * a_Exclude)
 {
-	ForClientsWithChunkAtPos(a_BlockPos, *this, a_Exclude, [&](cClientHandle & a_Client)
+	ForClientsWithChunkAtPos(a_BlockPos, *this, a_Exclude, SerializeOnce([&](cClientHandle & a_Client)
 		{
 			a_Client.SendBlockBreakAnim(a_EntityID, a_BlockPos.x, a_BlockPos.y, a_BlockPos.z, a_Stage);
 		}
-	);
+	));
 }
 
 
@@ -217,11 +281,11 @@ void cWorld::BroadcastChat(const cCompositeChat & a_Message, const cClientHandle
 
 void cWorld::BroadcastCollectEntity(const cEntity & a_Collected, const cEntity & a_Collector, unsigned a_Count, const cClientHandle * a_Exclude)
 {
-	ForClientsWithEntity(a_Collected, *this, a_Exclude, [&](cClientHandle & a_Client)
+	ForClientsWithEntity(a_Collected, *this, a_Exclude, SerializeOnce([&](cClientHandle & a_Client)
 		{
 			a_Client.SendCollectEntity(a_Collected, a_Collector, a_Count);
 		}
-	);
+	));
 }
 
 
@@ -230,11 +294,15 @@ void cWorld::BroadcastCollectEntity(const cEntity & a_Collected, const cEntity &
 
 void cWorld::BroadcastDestroyEntity(const cEntity & a_Entity, const cClientHandle * a_Exclude)
 {
-	ForClientsWithEntity(a_Entity, *this, a_Exclude, [&](cClientHandle & a_Client)
+	const auto Forget = [&](cClientHandle & a_Client)
+	{
+		a_Client.ForgetEntityMovement(a_Entity);
+	};
+	ForClientsWithEntity(a_Entity, *this, a_Exclude, ForEachRecipient(Forget, SerializeOnce([&](cClientHandle & a_Client)
 		{
 			a_Client.SendDestroyEntity(a_Entity);
 		}
-	);
+	)));
 }
 
 
@@ -269,11 +337,11 @@ void cWorld::BroadcastDisplayObjective(const AString & a_Objective, cScoreboard:
 
 void cWorld::BroadcastEntityEffect(const cEntity & a_Entity, int a_EffectID, int a_Amplifier, int a_Duration, const cClientHandle * a_Exclude)
 {
-	ForClientsWithEntity(a_Entity, *this, a_Exclude, [&](cClientHandle & a_Client)
+	ForClientsWithEntity(a_Entity, *this, a_Exclude, SerializeOnce([&](cClientHandle & a_Client)
 		{
 			a_Client.SendEntityEffect(a_Entity, a_EffectID, a_Amplifier, a_Duration);
 		}
-	);
+	));
 }
 
 
@@ -282,11 +350,11 @@ void cWorld::BroadcastEntityEffect(const cEntity & a_Entity, int a_EffectID, int
 
 void cWorld::BroadcastEntityEquipment(const cEntity & a_Entity, short a_SlotNum, const cItem & a_Item, const cClientHandle * a_Exclude)
 {
-	ForClientsWithEntity(a_Entity, *this, a_Exclude, [&](cClientHandle & a_Client)
+	ForClientsWithEntity(a_Entity, *this, a_Exclude, SerializeOnce([&](cClientHandle & a_Client)
 		{
 			a_Client.SendEntityEquipment(a_Entity, a_SlotNum, a_Item);
 		}
-	);
+	));
 }
 
 
@@ -295,11 +363,16 @@ void cWorld::BroadcastEntityEquipment(const cEntity & a_Entity, short a_SlotNum,
 
 void cWorld::BroadcastEntityHeadLook(const cEntity & a_Entity, const cClientHandle * a_Exclude)
 {
-	ForClientsWithEntity(a_Entity, *this, a_Exclude, [&](cClientHandle & a_Client)
+	const auto AssertNotSelf = [&](cClientHandle & a_Client)
+	{
+		ASSERT(a_Entity.GetUniqueID() != a_Client.GetPlayer()->GetUniqueID());  // Must not send for self
+		UNUSED(a_Client);
+	};
+	ForClientsWithEntity(a_Entity, *this, a_Exclude, SendMovement(a_Entity, false, ForEachRecipient(AssertNotSelf, SerializeOnce([&](cClientHandle & a_Client)
 		{
 			a_Client.SendEntityHeadLook(a_Entity);
 		}
-	);
+	))));
 }
 
 
@@ -308,11 +381,16 @@ void cWorld::BroadcastEntityHeadLook(const cEntity & a_Entity, const cClientHand
 
 void cWorld::BroadcastEntityLook(const cEntity & a_Entity, const cClientHandle * a_Exclude)
 {
-	ForClientsWithEntity(a_Entity, *this, a_Exclude, [&](cClientHandle & a_Client)
+	const auto AssertNotSelf = [&](cClientHandle & a_Client)
+	{
+		ASSERT(a_Entity.GetUniqueID() != a_Client.GetPlayer()->GetUniqueID());  // Must not send for self
+		UNUSED(a_Client);
+	};
+	ForClientsWithEntity(a_Entity, *this, a_Exclude, SendMovement(a_Entity, false, ForEachRecipient(AssertNotSelf, SerializeOnce([&](cClientHandle & a_Client)
 		{
 			a_Client.SendEntityLook(a_Entity);
 		}
-	);
+	))));
 }
 
 
@@ -321,11 +399,11 @@ void cWorld::BroadcastEntityLook(const cEntity & a_Entity, const cClientHandle *
 
 void cWorld::BroadcastEntityMetadata(const cEntity & a_Entity, const cClientHandle * a_Exclude)
 {
-	ForClientsWithEntity(a_Entity, *this, a_Exclude, [&](cClientHandle & a_Client)
+	ForClientsWithEntity(a_Entity, *this, a_Exclude, SerializeOnce([&](cClientHandle & a_Client)
 		{
 			a_Client.SendEntityMetadata(a_Entity);
 		}
-	);
+	));
 }
 
 
@@ -334,11 +412,11 @@ void cWorld::BroadcastEntityMetadata(const cEntity & a_Entity, const cClientHand
 
 void cWorld::BroadcastEntityPosition(const cEntity & a_Entity, const cClientHandle * a_Exclude)
 {
-	ForClientsWithEntity(a_Entity, *this, a_Exclude, [&](cClientHandle & a_Client)
+	ForClientsWithEntity(a_Entity, *this, a_Exclude, SendMovement(a_Entity, true, SerializeOnce([&](cClientHandle & a_Client)
 		{
 			a_Client.SendEntityPosition(a_Entity);
 		}
-	);
+	)));
 }
 
 
@@ -347,11 +425,11 @@ void cWorld::BroadcastEntityPosition(const cEntity & a_Entity, const cClientHand
 
 void cWorld::BroadcastEntityProperties(const cEntity & a_Entity)
 {
-	ForClientsWithEntity(a_Entity, *this, nullptr, [&](cClientHandle & a_Client)
+	ForClientsWithEntity(a_Entity, *this, nullptr, SerializeOnce([&](cClientHandle & a_Client)
 		{
 			a_Client.SendEntityProperties(a_Entity);
 		}
-	);
+	));
 }
 
 
@@ -360,11 +438,11 @@ void cWorld::BroadcastEntityProperties(const cEntity & a_Entity)
 
 void cWorld::BroadcastEntityVelocity(const cEntity & a_Entity, const cClientHandle * a_Exclude)
 {
-	ForClientsWithEntity(a_Entity, *this, a_Exclude, [&](cClientHandle & a_Client)
+	ForClientsWithEntity(a_Entity, *this, a_Exclude, SendMovement(a_Entity, false, SerializeOnce([&](cClientHandle & a_Client)
 		{
 			a_Client.SendEntityVelocity(a_Entity);
 		}
-	);
+	)));
 }
 
 
@@ -373,11 +451,11 @@ void cWorld::BroadcastEntityVelocity(const cEntity & a_Entity, const cClientHand
 
 void cWorld::BroadcastEntityAnimation(const cEntity & a_Entity, EntityAnimation a_Animation, const cClientHandle * a_Exclude)
 {
-	ForClientsWithEntity(a_Entity, *this, a_Exclude, [&](cClientHandle & a_Client)
+	ForClientsWithEntity(a_Entity, *this, a_Exclude, SerializeOnce([&](cClientHandle & a_Client)
 		{
 			a_Client.SendEntityAnimation(a_Entity, a_Animation);
 		}
-	);
+	));
 }
 
 
@@ -399,11 +477,11 @@ void cWorld::BroadcastLeashEntity(const cEntity & a_Entity, const cEntity & a_En
 
 void cWorld::BroadcastParticleEffect(const AString & a_ParticleName, const Vector3f a_Src, const Vector3f a_Offset, float a_ParticleData, int a_ParticleAmount, const cClientHandle * a_Exclude)
 {
-	ForClientsWithChunkAtPos(a_Src, *this, a_Exclude, [&](cClientHandle & a_Client)
+	ForClientsWithChunkAtPos(a_Src, *this, a_Exclude, SerializeOnce([&](cClientHandle & a_Client)
 		{
 			a_Client.SendParticleEffect(a_ParticleName, a_Src.x, a_Src.y, a_Src.z, a_Offset.x, a_Offset.y, a_Offset.z, a_ParticleData, a_ParticleAmount);
 		}
-	);
+	));
 }
 
 
@@ -412,11 +490,11 @@ void cWorld::BroadcastParticleEffect(const AString & a_ParticleName, const Vecto
 
 void cWorld::BroadcastParticleEffect(const AString & a_ParticleName, const Vector3f a_Src, const Vector3f a_Offset, float a_ParticleData, int a_ParticleAmount, std::array<int, 2> a_Data, const cClientHandle * a_Exclude)
 {
-	ForClientsWithChunkAtPos(a_Src, *this, a_Exclude, [&](cClientHandle & a_Client)
+	ForClientsWithChunkAtPos(a_Src, *this, a_Exclude, SerializeOnce([&](cClientHandle & a_Client)
 		{
 			a_Client.SendParticleEffect(a_ParticleName, a_Src, a_Offset, a_ParticleData, a_ParticleAmount, a_Data);
 		}
-	);
+	));
 }
 
 
@@ -503,11 +581,11 @@ void cWorld::BroadcastPlayerListUpdatePing()
 
 void cWorld::BroadcastRemoveEntityEffect(const cEntity & a_Entity, int a_EffectID, const cClientHandle * a_Exclude)
 {
-	ForClientsWithEntity(a_Entity, *this, a_Exclude, [&](cClientHandle & a_Client)
+	ForClientsWithEntity(a_Entity, *this, a_Exclude, SerializeOnce([&](cClientHandle & a_Client)
 		{
 			a_Client.SendRemoveEntityEffect(a_Entity, a_EffectID);
 		}
-	);
+	));
 }
 
 
@@ -542,11 +620,11 @@ void cWorld::BroadcastScoreUpdate(const AString & a_Objective, const AString & a
 
 void cWorld::BroadcastSoundEffect(const AString & a_SoundName, Vector3d a_Position, float a_Volume, float a_Pitch, const cClientHandle * a_Exclude)
 {
-	ForClientsWithChunkAtPos(a_Position, *this, a_Exclude, [&](cClientHandle & a_Client)
+	ForClientsWithChunkAtPos(a_Position, *this, a_Exclude, SerializeOnce([&](cClientHandle & a_Client)
 		{
 			a_Client.SendSoundEffect(a_SoundName, a_Position, a_Volume, a_Pitch);
 		}
-	);
+	));
 }
 
 
@@ -555,11 +633,11 @@ void cWorld::BroadcastSoundEffect(const AString & a_SoundName, Vector3d a_Positi
 
 void cWorld::BroadcastSoundParticleEffect(const EffectID a_EffectID, Vector3i a_SrcPos, int a_Data, const cClientHandle * a_Exclude)
 {
-	ForClientsWithChunkAtPos(a_SrcPos, *this, a_Exclude, [&](cClientHandle & a_Client)
+	ForClientsWithChunkAtPos(a_SrcPos, *this, a_Exclude, SerializeOnce([&](cClientHandle & a_Client)
 		{
 			a_Client.SendSoundParticleEffect(a_EffectID, a_SrcPos.x, a_SrcPos.y, a_SrcPos.z, a_Data);
 		}
-	);
+	));
 }
 
 
@@ -581,11 +659,11 @@ void cWorld::BroadcastSpawnEntity(cEntity & a_Entity, const cClientHandle * a_Ex
 
 void cWorld::BroadcastThunderbolt(Vector3i a_BlockPos, const cClientHandle * a_Exclude)
 {
-	ForClientsWithChunkAtPos(a_BlockPos, *this, a_Exclude, [&](cClientHandle & a_Client)
+	ForClientsWithChunkAtPos(a_BlockPos, *this, a_Exclude, SerializeOnce([&](cClientHandle & a_Client)
 		{
 			a_Client.SendThunderbolt(a_BlockPos.x, a_BlockPos.y, a_BlockPos.z);
 		}
-	);
+	));
 }
 
 
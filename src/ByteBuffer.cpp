@@ -934,6 +934,23 @@ bool cByteBuffer::SkipRead(size_t a_Count)
 
 
 
+bool cByteBuffer::ReadView(ContiguousByteBufferView & a_View, size_t a_Count)
+{
+	CHECK_THREAD
+	CheckValid();
+	if (!CanReadBytes(a_Count) || (m_BufferSize - m_ReadPos < a_Count))
+	{
+		return false;
+	}
+	a_View = { m_Buffer + m_ReadPos, a_Count };
+	AdvanceReadPos(a_Count);
+	return true;
+}
+
+
+
+
+
 void cByteBuffer::ReadAll(ContiguousByteBuffer & a_Data)
 {
 	CHECK_THREAD
@@ -975,6 +992,13 @@ void cByteBuffer::CommitRead(void)
 	CHECK_THREAD
 	CheckValid();
 	m_DataStart = m_ReadPos;
+	if (m_DataStart == m_WritePos)
+	{
+		// Empty, restart at the beginning so that the next data is contiguous:
+		m_DataStart = 0;
+		m_ReadPos = 0;
+		m_WritePos = 0;
+	}
 }
 
 
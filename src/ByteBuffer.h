@@ -119,6 +119,11 @@ public:
 	/** Reads a_Count bytes into a_String; returns true if successful */
 	bool ReadSome(ContiguousByteBuffer & a_String, size_t a_Count);
 
+	/** Sets a_View to the next a_Count bytes in place, without copying them, and advances the read pos.
+	Returns false, without reading anything, if the bytes aren't available or aren't stored contiguously (wrap around the ringbuffer end).
+	The view stays valid until the ringbuffer is written to again. */
+	bool ReadView(ContiguousByteBufferView & a_View, size_t a_Count);
+
 	/** Skips reading by a_Count bytes; returns false if not enough bytes in the ringbuffer */
 	bool SkipRead(size_t a_Count);
 
@@ -128,7 +133,8 @@ public:
 	/** Reads the specified number of bytes and writes it into the destinatio bytebuffer. Returns true on success. */
 	bool ReadToByteBuffer(cByteBuffer & a_Dst, size_t a_NumBytes);
 
-	/** Removes the bytes that have been read from the ringbuffer */
+	/** Removes the bytes that have been read from the ringbuffer.
+	If no data remains, the next write starts at the beginning again, so that buffers drained after each use never wrap. */
 	void CommitRead(void);
 
 	/** Restarts next reading operation at the start of the ringbuffer */
@@ -8,6 +8,7 @@
 
 #include "Chunk.h"
 #include "BlockInfo.h"
+#include "IncrementalLighting.h"
 #include "World.h"
 #include "ClientHandle.h"
 #include "Server.h"
@@ -28,6 +29,7 @@
 #include "SetChunkData.h"
 #include "BoundingBox.h"
 #include "Blocks/ChunkInterface.h"
+#include "Protocol/ChunkDataSerializer.h"
 
 #include "json/json.h"
 
@@ -35,9 +37,112 @@
 
 
 
+/** The number of entities in a chunk from which their positions are gridded, see cChunk::UpdateEntityGrid().
+The grid is dropped once the number falls below half of this, fewer entities are faster to check one by one. */
+static const size_t ENTITY_GRID_MIN_ENTITIES = 32;
+
+/** The size of the entity grid's cells, in blocks. */
+static const double ENTITY_GRID_CELL_SIZE = 4;
+
+
+
+
+
+namespace
+{
+	/** Gives cIncrementalLighting the blocks and the light of a chunk and of its loaded and lit neighbors.
+	Remembers the neighbors whose light has changed, so that they're saved along with the chunk. */
+	class cChunkLightAccess :
+		public cIncrementalLighting::cBlockAccess
+	{
+		using eChannel = cIncrementalLighting::eChannel;
+
+	public:
+
+		cChunkLightAccess(cChunk & a_Chunk) :
+			m_Chunk(a_Chunk)
+		{
+		}
+
+		virtual bool GetBlock(Vector3i a_RelPos, eChannel a_Channel, BLOCKTYPE & a_BlockType, NIBBLETYPE & a_Light) override
+		{
+			const auto Chunk = GetChunk(a_RelPos);
+			if (Chunk == nullptr)
+			{
+				return false;
+			}
+			a_BlockType = Chunk->GetBlock(a_RelPos);
+			a_Light = (a_Channel == eChannel::BlockLight) ? Chunk->GetBlockLight(a_RelPos) : Chunk->GetSkyLight(a_RelPos);
+			return true;
+		}
+
+		virtual void SetLight(Vector3i a_RelPos, eChannel a_Channel, NIBBLETYPE a_Light) override
+		{
+			const auto Chunk = GetChunk(a_RelPos);
+			ASSERT(Chunk != nullptr);
+			if (a_Channel == eChannel::BlockLight)
+			{
+				Chunk->SetBlockLight(a_RelPos, a_Light);
+			}
+			else
+			{
+				Chunk->SetSkyLight(a_RelPos, a_Light);
+			}
+			if ((Chunk != &m_Chunk) && (std::find(m_TouchedChunks.begin(), m_TouchedChunks.end(), Chunk) == m_TouchedChunks.end()))
+			{
+				m_TouchedChunks.push_back(Chunk);
+			}
+		}
+
+		/** Marks the chunk, and each neighbor whose light has changed, dirty. */
+		void MarkDirty(void)
+		{
+			m_Chunk.MarkDirty();
+			for (const auto Chunk : m_TouchedChunks)
+			{
+				Chunk->MarkDirty();
+			}
+		}
+
+	private:
+
+		/** The chunk in which the change happened; all the positions are relative to it. */
+		cChunk & m_Chunk;
+
+		/** The neighbor chunks whose light has been changed. */
+		std::vector<cChunk *> m_TouchedChunks;
+
+		/** Returns the chunk containing the position, and adjusts the position to be relative to that chunk.
+		Returns nullptr if the position is outside of the world height, or its chunk isn't loaded or doesn't have valid lighting. */
+		cChunk * GetChunk(Vector3i & a_RelPos) const
+		{
+			if (!cChunkDef::IsValidHeight(a_RelPos.y))
+			{
+				return nullptr;
+			}
+			const auto Chunk = m_Chunk.GetRelNeighborChunkAdjustCoords(a_RelPos);
+			if ((Chunk == nullptr) || !Chunk->IsValid() || !Chunk->IsLightValid())
+			{
+				return nullptr;
+			}
+			return Chunk;
+		}
+	} ;
+}  // namespace (anonymous)
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // cChunk:
 
+std::atomic<UInt64> cChunk::ms_NextDataVersion { 1 };
+
+
+
+
+
 cChunk::cChunk(
 	int a_ChunkX, int a_ChunkZ,
 	cChunkMap * a_ChunkMap, cWorld * a_World
@@ -46,6 +151,7 @@ cChunk::cChunk(
 	m_IsLightValid(false),
 	m_IsDirty(false),
 	m_IsSaving(false),
+	m_DataVersion(ms_NextDataVersion.fetch_add(1, std::memory_order_relaxed)),
 	m_StayCount(0),
 	m_PosX(a_ChunkX),
 	m_PosZ(a_ChunkZ),
@@ -56,26 +162,23 @@ cChunk::cChunk(
 	m_RedstoneSimulatorData(a_World->GetRedstoneSimulator()->CreateChunkData()),
 	m_AlwaysTicked(0)
 {
-	m_NeighborXM = a_ChunkMap->FindChunk(a_ChunkX - 1, a_ChunkZ);
-	m_NeighborXP = a_ChunkMap->FindChunk(a_ChunkX + 1, a_ChunkZ);
-	m_NeighborZM = a_ChunkMap->FindChunk(a_ChunkX, a_ChunkZ - 1);
-	m_NeighborZP = a_ChunkMap->FindChunk(a_ChunkX, a_ChunkZ + 1);
-
-	if (m_NeighborXM != nullptr)
+	// Link with the neighbors that are already present:
+	for (int OffsetZ = -1; OffsetZ <= 1; OffsetZ++)
 	{
-		m_NeighborXM->m_NeighborXP = this;
-	}
-	if (m_NeighborXP != nullptr)
-	{
-		m_NeighborXP->m_NeighborXM = this;
-	}
-	if (m_NeighborZM != nullptr)
-	{
-		m_NeighborZM->m_NeighborZP = this;
-	}
-	if (m_NeighborZP != nullptr)
-	{
-		m_NeighborZP->m_NeighborZM = this;
+		for (int OffsetX = -1; OffsetX <= 1; OffsetX++)
+		{
+			const auto Idx = GetNeighborIndex(OffsetX, OffsetZ);
+			if ((OffsetX == 0) && (OffsetZ == 0))
+			{
+				m_Neighbors[Idx] = this;
+				continue;
+			}
+			m_Neighbors[Idx] = a_ChunkMap->FindChunk(a_ChunkX + OffsetX, a_ChunkZ + OffsetZ);
+			if (m_Neighbors[Idx] != nullptr)
+			{
+				m_Neighbors[Idx]->m_Neighbors[8 - Idx] = this;
+			}
+		}
 	}
 }
 
@@ -88,21 +191,12 @@ cChunk::~cChunk()
 	// LOGINFO("### delete cChunk() (%i, %i) from %p, thread 0x%x ###", m_PosX, m_PosZ, this, GetCurrentThreadId());
 
 	// Inform our neighbours that we're no longer valid:
-	if (m_NeighborXM != nullptr)
+	for (size_t Idx = 0; Idx < m_Neighbors.size(); Idx++)
 	{
-		m_NeighborXM->m_NeighborXP = nullptr;
-	}
-	if (m_NeighborXP != nullptr)
-	{
-		m_NeighborXP->m_NeighborXM = nullptr;
-	}
-	if (m_NeighborZM != nullptr)
-	{
-		m_NeighborZM->m_NeighborZP = nullptr;
-	}
-	if (m_NeighborZP != nullptr)
-	{
-		m_NeighborZP->m_NeighborZM = nullptr;
+		if ((m_Neighbors[Idx] != nullptr) && (m_Neighbors[Idx] != this))
+		{
+			m_Neighbors[Idx]->m_Neighbors[8 - Idx] = nullptr;
+		}
 	}
 
 	delete m_WaterSimulatorData;
@@ -117,43 +211,69 @@ cChunk::~cChunk()
 
 
 
-void cChunk::BroadcastPendingChanges(void)
+void cChunk::BroadcastPendingChanges(cChunkDataSerializer & a_SectionSerializer)
 {
-	if (const auto PendingBlocksCount = m_PendingSendBlocks.size(); PendingBlocksCount >= 10240)
+	if (const auto SectionMask = m_PendingSends.GetSectionMask(); SectionMask != 0)
 	{
-		// Resend the full chunk:
-		for (const auto ClientHandle : m_LoadedByClient)
+		BroadcastPendingSections(a_SectionSerializer, SectionMask);
+	}
+
+	// Send block and block entity changes:
+	const auto & PendingBlocks = m_PendingSends.GetBlocks();
+	for (const auto ClientHandle : m_LoadedByClient)
+	{
+		if (!PendingBlocks.empty())
 		{
-			m_World->ForceSendChunkTo(m_PosX, m_PosZ, cChunkSender::Priority::Medium, ClientHandle);
+			ClientHandle->SendBlockChanges(m_PosX, m_PosZ, PendingBlocks);
+		}
+
+		for (const auto BlockEntity : m_PendingSendBlockEntities)
+		{
+			BlockEntity->SendTo(*ClientHandle);
 		}
 	}
-	else if (PendingBlocksCount == 0)
+
+	m_PendingSends.Clear();
+	m_PendingSendBlockEntities.clear();
+}
+
+
+
+
+
+void cChunk::BroadcastPendingSections(cChunkDataSerializer & a_Serializer, const UInt16 a_SectionMask)
+{
+	if (!m_IsLightValid)
 	{
-		// Only send block entity changes:
+		// The light data is outdated, e.g. after WriteBlockArea(); the chunk sender relights the chunk before sending it whole:
 		for (const auto ClientHandle : m_LoadedByClient)
 		{
-			for (const auto BlockEntity : m_PendingSendBlockEntities)
-			{
-				BlockEntity->SendTo(*ClientHandle);
-			}
+			m_World->ForceSendChunkTo(m_PosX, m_PosZ, cChunkSender::Priority::Medium, ClientHandle);
 		}
+		return;
 	}
-	else
+
+	// Serialize the sections once for each version that the clients use, and share the data between them:
+	std::array<std::shared_ptr<const ContiguousByteBuffer>, cChunkDataSerializer::NumCacheVersions> Serialized;
+	for (const auto ClientHandle : m_LoadedByClient)
 	{
-		// Send block and block entity changes:
-		for (const auto ClientHandle : m_LoadedByClient)
+		const auto Version = cChunkDataSerializer::GetCacheVersion(ClientHandle->GetProtocolVersion());
+		auto & Data = Serialized[static_cast<size_t>(Version)];
+		if (Data == nullptr)
 		{
-			ClientHandle->SendBlockChanges(m_PosX, m_PosZ, m_PendingSendBlocks);
-
-			for (const auto BlockEntity : m_PendingSendBlockEntities)
-			{
-				BlockEntity->SendTo(*ClientHandle);
-			}
+			Data = std::make_shared<const ContiguousByteBuffer>(a_Serializer.SerializeSections(Version, m_PosX, m_PosZ, a_SectionMask, m_BlockData, m_LightData));
 		}
+		ClientHandle->SendChunkSections(m_PosX, m_PosZ, Data);
 	}
+}
 
-	m_PendingSendBlocks.clear();
-	m_PendingSendBlockEntities.clear();
+
+
+
+
+void cChunk::QueueSendBlock(const int a_RelX, const int a_RelY, const int a_RelZ, const BLOCKTYPE a_BlockType, const NIBBLETYPE a_BlockMeta)
+{
+	m_PendingSends.Add(m_PosX, m_PosZ, a_RelX, a_RelY, a_RelZ, a_BlockType, a_BlockMeta, m_ChunkMap->GetSectionResendThreshold());
 }
 
 
@@ -309,9 +429,12 @@ void cChunk::GetAllData(cChunkDataCallback & a_Callback) const
 	ASSERT(m_Presence == cpPresent);
 
 	a_Callback.LightIsValid(m_IsLightValid);
-	a_Callback.ChunkData(m_BlockData, m_LightData);
-	a_Callback.HeightMap(m_HeightMap);
-	a_Callback.BiomeMap(m_BiomeMap);
+	if (a_Callback.DataVersion(m_DataVersion))
+	{
+		a_Callback.ChunkData(m_BlockData, m_LightData);
+		a_Callback.HeightMap(m_HeightMap);
+		a_Callback.BiomeMap(m_BiomeMap);
+	}
 
 	for (const auto & Entity : m_Entities)
 	{
@@ -336,8 +459,9 @@ void cChunk::SetAllData(SetChunkData && a_SetChunkData)
 	m_BlockData = std::move(a_SetChunkData.BlockData);
 	m_LightData = std::move(a_SetChunkData.LightData);
 	m_IsLightValid = a_SetChunkData.IsLightValid;
+	InvalidateDataVersion();
 
-	m_PendingSendBlocks.clear();
+	m_PendingSends.Clear();
 	m_PendingSendBlockEntities.clear();
 
 	// Entities need some extra steps to destroy, so here we're keeping the old ones.
@@ -351,6 +475,10 @@ void cChunk::SetAllData(SetChunkData && a_SetChunkData)
 	// Store the augmented result:
 	m_Entities = std::move(a_SetChunkData.Entities);
 
+	// Grid the new set of entities anew on the next tick:
+	m_EntityGrid.reset();
+	m_EntityGridPlayers.clear();
+
 	// Set all the entity variables again:
 	for (const auto & Entity : m_Entities)
 	{
@@ -410,6 +538,7 @@ void cChunk::SetLight(
 	m_LightData.SetAll(a_BlockLight, a_SkyLight);
 
 	MarkDirty();
+	InvalidateDataVersion();
 	m_IsLightValid = true;
 }
 
@@ -441,6 +570,9 @@ void cChunk::WriteBlockArea(cBlockArea & a_Area, int a_MinBlockX, int a_MinBlock
 	int BaseX = BlockStartX - a_MinBlockX;  // Offset within the area where the union starts
 	int BaseZ = BlockStartZ - a_MinBlockZ;
 
+	// Updating the light around each of the written blocks would be slower than relighting the whole chunk once it's needed:
+	m_IsLightValid = false;
+
 	// Copy blocktype and blockmeta:
 	BLOCKTYPE *  AreaBlockTypes = a_Area.GetBlockTypes();
 	NIBBLETYPE * AreaBlockMetas = a_Area.GetBlockMetas();
@@ -686,16 +818,17 @@ void cChunk::Tick(std::chrono::milliseconds a_Dt)
 {
 	const auto ShouldTick = ShouldBeTicked();
 
+	// While ticking in parallel, the players are ticked serially afterwards, see TickPlayers():
+	const auto ShouldTickPlayers = !cChunkMap::IsTickWorker();
+
 	// If we are not valid, tick players and bailout
 	if (!ShouldTick)
 	{
-		for (const auto & Entity : m_Entities)
+		if (ShouldTickPlayers)
 		{
-			if (Entity->IsPlayer())
-			{
-				Entity->Tick(a_Dt, *this);
-			}
+			TickPlayers(a_Dt);
 		}
+		UpdateEntityGrid();
 		return;
 	}
 
@@ -716,6 +849,12 @@ void cChunk::Tick(std::chrono::milliseconds a_Dt)
 			continue;
 		}
 
+		if ((*itr)->IsPlayer() && !ShouldTickPlayers)
+		{
+			++itr;
+			continue;
+		}
+
 		if (!((*itr)->IsMob()))  // Mobs are ticked inside cWorld::TickMobs() (as we don't have to tick them if they are far away from players)
 		{
 			// Tick all entities in this chunk (except mobs):
@@ -732,37 +871,87 @@ void cChunk::Tick(std::chrono::milliseconds a_Dt)
 			continue;
 		}
 
-		if (
-			((*itr)->GetChunkX() != m_PosX) ||
-			((*itr)->GetChunkZ() != m_PosZ)
-		)
+		itr = MoveEntityIfOutside(itr);
+	}  // for itr - m_Entitites[]
+
+	UpdateEntityGrid();
+
+	ApplyWeatherToTop();
+
+	// Tick simulators:
+	m_World->GetSimulatorManager()->SimulateChunk(a_Dt, m_PosX, m_PosZ, this);
+
+	// Check blocks after everything else to apply at least one round of queued ticks (i.e. cBlockHandler::Check) this tick:
+	CheckBlocks();
+}
+
+
+
+
+
+void cChunk::TickPlayers(std::chrono::milliseconds a_Dt)
+{
+	// If we are not valid, only tick the players, they stay in this chunk until it becomes valid:
+	if (!ShouldBeTicked())
+	{
+		for (const auto & Entity : m_Entities)
 		{
-			// Mark as dirty if it was a server-generated entity:
-			if (!(*itr)->IsPlayer())
+			if (Entity->IsPlayer())
 			{
-				MarkDirty();
+				Entity->Tick(a_Dt, *this);
 			}
+		}
+		return;
+	}
 
-			// This block is very similar to RemoveEntity, except it uses an iterator to avoid scanning the whole m_Entities
-			// The entity moved out of the chunk, move it to the neighbor
-			(*itr)->SetParentChunk(nullptr);
-			MoveEntityToNewChunk(std::move(*itr));
-
-			itr = m_Entities.erase(itr);
+	for (auto itr = m_Entities.begin(); itr != m_Entities.end();)
+	{
+		if (!(*itr)->IsPlayer() || !(*itr)->IsTicking())
+		{
+			++itr;
+			continue;
 		}
-		else
+
+		ASSERT((*itr)->GetParentChunk() == this);
+		(*itr)->Tick(a_Dt, *this);
+		ASSERT((*itr)->GetParentChunk() == this);
+
+		if (!(*itr)->IsTicking())
 		{
 			++itr;
+			continue;
 		}
-	}  // for itr - m_Entitites[]
+		itr = MoveEntityIfOutside(itr);
+	}
+}
 
-	ApplyWeatherToTop();
 
-	// Tick simulators:
-	m_World->GetSimulatorManager()->SimulateChunk(a_Dt, m_PosX, m_PosZ, this);
 
-	// Check blocks after everything else to apply at least one round of queued ticks (i.e. cBlockHandler::Check) this tick:
-	CheckBlocks();
+
+
+std::vector<OwnedEntity>::iterator cChunk::MoveEntityIfOutside(std::vector<OwnedEntity>::iterator a_Itr)
+{
+	if (
+		((*a_Itr)->GetChunkX() == m_PosX) &&
+		((*a_Itr)->GetChunkZ() == m_PosZ)
+	)
+	{
+		return a_Itr + 1;
+	}
+
+	// Mark as dirty if it was a server-generated entity:
+	if (!(*a_Itr)->IsPlayer())
+	{
+		MarkDirty();
+	}
+
+	// This block is very similar to RemoveEntity, except it uses an iterator to avoid scanning the whole m_Entities
+	// The entity moved out of the chunk, move it to the neighbor
+	RemoveFromEntityGrid(**a_Itr);
+	(*a_Itr)->SetParentChunk(nullptr);
+	m_ChunkMap->MoveEntityFromChunk(*this, std::move(*a_Itr));
+
+	return m_Entities.erase(a_Itr);
 }
 
 
@@ -863,8 +1052,8 @@ void cChunk::TickBlocks(void)
 	// http://minecraft.fandom.com/wiki/Tick#Random_tick
 	for (size_t Y = 0; Y < cChunkDef::NumSections; ++Y)
 	{
-		const auto Section = m_BlockData.GetSection(Y);
-		if (Section == nullptr)
+		const auto & Section = m_BlockData.GetPalettedSection(Y);
+		if (!Section.IsPresent())
 		{
 			continue;
 		}
@@ -874,7 +1063,7 @@ void cChunk::TickBlocks(void)
 			const auto Index = Random.RandInt<size_t>(ChunkBlockData::SectionBlockCount - 1);
 			const auto Position = cChunkDef::IndexToCoordinate(Y * ChunkBlockData::SectionBlockCount + Index);
 
-			cBlockHandler::For((*Section)[Index]).OnUpdate(ChunkInterface, *m_World, PluginInterface, *this, Position);
+			cBlockHandler::For(Section.Get(Index)).OnUpdate(ChunkInterface, *m_World, PluginInterface, *this, Position);
 		}
 	}
 }
@@ -1251,9 +1440,10 @@ void cChunk::WakeUpSimulators(void)
 	auto * LavaSimulator  = m_World->GetLavaSimulator();
 	auto * RedstoneSimulator = m_World->GetRedstoneSimulator();
 
+	ChunkBlockData::BlockArray Scratch;
 	for (size_t SectionIdx = 0; SectionIdx != cChunkDef::NumSections; ++SectionIdx)
 	{
-		const auto * Section = m_BlockData.GetSection(SectionIdx);
+		const auto * Section = m_BlockData.GetSection(SectionIdx, Scratch);
 		if (Section == nullptr)
 		{
 			continue;
@@ -1333,6 +1523,7 @@ void cChunk::FastSetBlock(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_BlockT
 	}
 
 	m_BlockData.SetBlock({ a_RelX, a_RelY, a_RelZ }, a_BlockType);
+	InvalidateDataVersion();
 
 	// Queue block to be sent only if ...
 	if (
@@ -1345,19 +1536,26 @@ void cChunk::FastSetBlock(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_BlockT
 		)
 	)
 	{
-		m_PendingSendBlocks.emplace_back(m_PosX, m_PosZ, a_RelX, a_RelY, a_RelZ, a_BlockType, a_BlockMeta);
+		QueueSendBlock(a_RelX, a_RelY, a_RelZ, a_BlockType, a_BlockMeta);
 	}
 
 	m_BlockData.SetMeta({ a_RelX, a_RelY, a_RelZ }, a_BlockMeta);
 
 	// ONLY recalculate lighting if it's necessary!
+	// The lit chunks are updated in place around the changed block, the unlit ones get all their light once they're lit:
 	if (
-		(cBlockInfo::GetLightValue        (OldBlockType) != cBlockInfo::GetLightValue        (a_BlockType)) ||
-		(cBlockInfo::GetSpreadLightFalloff(OldBlockType) != cBlockInfo::GetSpreadLightFalloff(a_BlockType)) ||
-		(cBlockInfo::IsTransparent        (OldBlockType) != cBlockInfo::IsTransparent        (a_BlockType))
+		m_IsLightValid &&
+		(
+			(cBlockInfo::GetLightValue        (OldBlockType) != cBlockInfo::GetLightValue        (a_BlockType)) ||
+			(cBlockInfo::GetSpreadLightFalloff(OldBlockType) != cBlockInfo::GetSpreadLightFalloff(a_BlockType)) ||
+			(cBlockInfo::IsTransparent        (OldBlockType) != cBlockInfo::IsTransparent        (a_BlockType)) ||
+			(cBlockInfo::IsSkylightDispersant (OldBlockType) != cBlockInfo::IsSkylightDispersant (a_BlockType))
+		)
 	)
 	{
-		m_IsLightValid = false;
+		cChunkLightAccess LightAccess(*this);
+		cIncrementalLighting::BlockChanged(LightAccess, { a_RelX, a_RelY, a_RelZ });
+		LightAccess.MarkDirty();
 	}
 
 	// Update heightmap, if needed:
@@ -1392,7 +1590,7 @@ void cChunk::SendBlockTo(int a_RelX, int a_RelY, int a_RelZ, cClientHandle * a_C
 	if (a_Client == nullptr)
 	{
 		// Queue the block (entity) for all clients in the chunk (will be sent in BroadcastPendingBlockChanges()):
-		m_PendingSendBlocks.emplace_back(m_PosX, m_PosZ, a_RelX, a_RelY, a_RelZ, GetBlock(a_RelX, a_RelY, a_RelZ), GetMeta(a_RelX, a_RelY, a_RelZ));
+		QueueSendBlock(a_RelX, a_RelY, a_RelZ, GetBlock(a_RelX, a_RelY, a_RelZ), GetMeta(a_RelX, a_RelY, a_RelZ));
 		if (BlockEntity != nullptr)
 		{
 			m_PendingSendBlockEntities.push_back(BlockEntity);
@@ -1504,6 +1702,7 @@ void cChunk::SetBiomeAt(int a_RelX, int a_RelZ, EMCSBiome a_Biome)
 {
 	cChunkDef::SetBiome(m_BiomeMap, a_RelX, a_RelZ, a_Biome);
 	MarkDirty();
+	InvalidateDataVersion();
 }
 
 
@@ -1520,6 +1719,7 @@ void cChunk::SetAreaBiome(int a_MinRelX, int a_MaxRelX, int a_MinRelZ, int a_Max
 		}
 	}
 	MarkDirty();
+	InvalidateDataVersion();
 
 	// Re-send the chunk to all clients:
 	for (auto ClientHandle : m_LoadedByClient)
@@ -1606,6 +1806,11 @@ void cChunk::AddEntity(OwnedEntity a_Entity)
 	ASSERT(std::find(m_Entities.begin(), m_Entities.end(), a_Entity) == m_Entities.end());  // Not there already
 	m_Entities.emplace_back(std::move(a_Entity));
 
+	if (m_EntityGrid != nullptr)
+	{
+		AddToEntityGrid(*EntityPtr);
+	}
+
 	ASSERT(EntityPtr->GetParentChunk() == nullptr);
 	EntityPtr->SetParentChunk(this);
 }
@@ -1626,6 +1831,8 @@ OwnedEntity cChunk::RemoveEntity(cEntity & a_Entity)
 		MarkDirty();
 	}
 
+	RemoveFromEntityGrid(a_Entity);
+
 	OwnedEntity Removed;
 	m_Entities.erase(
 		std::remove_if(
@@ -1688,6 +1895,29 @@ bool cChunk::ForEachEntity(cEntityCallback a_Callback) const
 
 bool cChunk::ForEachEntityInBox(const cBoundingBox & a_Box, cEntityCallback a_Callback) const
 {
+	if (m_EntityGrid != nullptr)
+	{
+		auto CheckEntity = [&a_Box, &a_Callback](cEntity * a_Entity)
+		{
+			return a_Entity->IsTicking() && a_Entity->GetBoundingBox().DoesIntersect(a_Box) && a_Callback(*a_Entity);
+		};
+
+		for (const auto Player : m_EntityGridPlayers)
+		{
+			if (CheckEntity(Player))
+			{
+				return false;
+			}
+		}
+
+		// The grid has the entities' positions, at their feet, allow for their size:
+		return m_EntityGrid->ForEachInBox(
+			{ a_Box.GetMinX() - m_EntityGridReachXZ, a_Box.GetMinY() - m_EntityGridReachDown, a_Box.GetMinZ() - m_EntityGridReachXZ },
+			{ a_Box.GetMaxX() + m_EntityGridReachXZ, a_Box.GetMaxY(),                          a_Box.GetMaxZ() + m_EntityGridReachXZ },
+			CheckEntity
+		);
+	}
+
 	// The entity list is locked by the parent chunkmap's CS
 	for (const auto & Entity : m_Entities)
 	{
@@ -1712,6 +1942,113 @@ bool cChunk::ForEachEntityInBox(const cBoundingBox & a_Box, cEntityCallback a_Ca
 
 
 
+void cChunk::UpdateEntityGrid(void)
+{
+	if (m_Entities.size() < ENTITY_GRID_MIN_ENTITIES / 2)
+	{
+		m_EntityGrid.reset();
+		m_EntityGridPlayers.clear();
+		return;
+	}
+
+	if (m_EntityGrid == nullptr)
+	{
+		if (m_Entities.size() < ENTITY_GRID_MIN_ENTITIES)
+		{
+			return;
+		}
+
+		m_EntityGrid = std::make_unique<cSpatialGrid<cEntity *>>(ENTITY_GRID_CELL_SIZE);
+		m_EntityGridReachXZ = 0;
+		m_EntityGridReachDown = 0;
+		for (const auto & Entity : m_Entities)
+		{
+			AddToEntityGrid(*Entity);
+		}
+		return;
+	}
+
+	// The positions are kept up to date by the entities themselves, recalculate the reach so that it shrinks once the large entities leave:
+	m_EntityGridReachXZ = 0;
+	m_EntityGridReachDown = 0;
+	for (const auto & Entity : m_Entities)
+	{
+		if (!Entity->IsPlayer())
+		{
+			ExtendEntityGridReach(*Entity);
+		}
+	}
+}
+
+
+
+
+
+void cChunk::UpdateEntityInGrid(cEntity & a_Entity)
+{
+	ASSERT(a_Entity.GetParentChunk() == this);
+
+	if ((m_EntityGrid == nullptr) || a_Entity.IsPlayer())
+	{
+		return;
+	}
+
+	m_EntityGrid->Move(&a_Entity, a_Entity.GetPosition());
+	ExtendEntityGridReach(a_Entity);
+}
+
+
+
+
+
+void cChunk::AddToEntityGrid(cEntity & a_Entity)
+{
+	ASSERT(m_EntityGrid != nullptr);
+
+	if (a_Entity.IsPlayer())
+	{
+		m_EntityGridPlayers.push_back(&a_Entity);
+		return;
+	}
+
+	m_EntityGrid->Add(&a_Entity, a_Entity.GetPosition());
+	ExtendEntityGridReach(a_Entity);
+}
+
+
+
+
+
+void cChunk::RemoveFromEntityGrid(cEntity & a_Entity)
+{
+	if (m_EntityGrid == nullptr)
+	{
+		return;
+	}
+
+	if (a_Entity.IsPlayer())
+	{
+		m_EntityGridPlayers.erase(std::remove(m_EntityGridPlayers.begin(), m_EntityGridPlayers.end(), &a_Entity), m_EntityGridPlayers.end());
+		return;
+	}
+
+	m_EntityGrid->Remove(&a_Entity);
+}
+
+
+
+
+
+void cChunk::ExtendEntityGridReach(const cEntity & a_Entity)
+{
+	m_EntityGridReachXZ = std::max(m_EntityGridReachXZ, static_cast<double>(a_Entity.GetWidth()) / 2);
+	m_EntityGridReachDown = std::max(m_EntityGridReachDown, static_cast<double>(a_Entity.GetHeight()));
+}
+
+
+
+
+
 bool cChunk::DoWithEntityByID(UInt32 a_EntityID, cEntityCallback a_Callback, bool & a_CallbackResult) const
 {
 	// The entity list is locked by the parent chunkmap's CS
@@ -1832,65 +2169,24 @@ cChunk * cChunk::GetNeighborChunk(int a_BlockX, int a_BlockZ)
 
 cChunk * cChunk::GetRelNeighborChunk(int a_RelX, int a_RelZ)
 {
-	// If the relative coords are too far away, use the parent's chunk lookup instead:
-	if ((a_RelX < -128) || (a_RelX > 128) || (a_RelZ < -128) || (a_RelZ > 128))
-	{
-		int BlockX = m_PosX * cChunkDef::Width + a_RelX;
-		int BlockZ = m_PosZ * cChunkDef::Width + a_RelZ;
-		int ChunkX, ChunkZ;
-		cChunkDef::BlockToChunk(BlockX, BlockZ, ChunkX, ChunkZ);
-		return m_ChunkMap->FindChunk(ChunkX, ChunkZ);
-	}
-
-	// Walk the neighbors:
-	bool ReturnThis = true;
-	if (a_RelX < 0)
-	{
-		if (m_NeighborXM != nullptr)
-		{
-			cChunk * Candidate = m_NeighborXM->GetRelNeighborChunk(a_RelX + cChunkDef::Width, a_RelZ);
-			if (Candidate != nullptr)
-			{
-				return Candidate;
-			}
-		}
-		// Going X first failed, but if the request is crossing Z as well, let's try the Z first later on.
-		ReturnThis = false;
-	}
-	else if (a_RelX >= cChunkDef::Width)
-	{
-		if (m_NeighborXP != nullptr)
-		{
-			cChunk * Candidate = m_NeighborXP->GetRelNeighborChunk(a_RelX - cChunkDef::Width, a_RelZ);
-			if (Candidate != nullptr)
-			{
-				return Candidate;
-			}
-		}
-		// Going X first failed, but if the request is crossing Z as well, let's try the Z first later on.
-		ReturnThis = false;
-	}
-
-	if (a_RelZ < 0)
-	{
-		if (m_NeighborZM != nullptr)
-		{
-			return m_NeighborZM->GetRelNeighborChunk(a_RelX, a_RelZ + cChunkDef::Width);
-			// For requests crossing both X and Z, the X-first way has been already tried
-		}
-		return nullptr;
-	}
-	else if (a_RelZ >= cChunkDef::Width)
+	// The directly surrounding chunks are cached:
+	if (
+		(a_RelX >= -cChunkDef::Width) && (a_RelX < 2 * cChunkDef::Width) &&
+		(a_RelZ >= -cChunkDef::Width) && (a_RelZ < 2 * cChunkDef::Width)
+	)
 	{
-		if (m_NeighborZP != nullptr)
-		{
-			return m_NeighborZP->GetRelNeighborChunk(a_RelX, a_RelZ - cChunkDef::Width);
-			// For requests crossing both X and Z, the X-first way has been already tried
-		}
-		return nullptr;
+		return m_Neighbors[GetNeighborIndex(
+			(a_RelX < 0) ? -1 : ((a_RelX >= cChunkDef::Width) ? 1 : 0),
+			(a_RelZ < 0) ? -1 : ((a_RelZ >= cChunkDef::Width) ? 1 : 0)
+		)];
 	}
 
-	return (ReturnThis ? this : nullptr);
+	// The relative coords are too far away, use the parent's chunk lookup instead:
+	int BlockX = m_PosX * cChunkDef::Width + a_RelX;
+	int BlockZ = m_PosZ * cChunkDef::Width + a_RelZ;
+	int ChunkX, ChunkZ;
+	cChunkDef::BlockToChunk(BlockX, BlockZ, ChunkX, ChunkZ);
+	return m_ChunkMap->FindChunk(ChunkX, ChunkZ);
 }
 
 
@@ -1910,37 +2206,21 @@ cChunk * cChunk::GetRelNeighborChunkAdjustCoords(Vector3i & a_RelPos) const
 		return ToReturn;
 	}
 
-	// Request for a different chunk, calculate chunk offset:
-	int RelX = a_RelPos.x;  // Make a local copy of the coords (faster access)
-	int RelZ = a_RelPos.z;
-	while ((RelX >= cChunkDef::Width) && (ToReturn != nullptr))
-	{
-		RelX -= cChunkDef::Width;
-		ToReturn = ToReturn->m_NeighborXP;
-	}
-	while ((RelX < 0) && (ToReturn != nullptr))
-	{
-		RelX += cChunkDef::Width;
-		ToReturn = ToReturn->m_NeighborXM;
-	}
-	while ((RelZ >= cChunkDef::Width) && (ToReturn != nullptr))
-	{
-		RelZ -= cChunkDef::Width;
-		ToReturn = ToReturn->m_NeighborZP;
-	}
-	while ((RelZ < 0) && (ToReturn != nullptr))
-	{
-		RelZ += cChunkDef::Width;
-		ToReturn = ToReturn->m_NeighborZM;
-	}
-	if (ToReturn != nullptr)
+	// Request for a directly surrounding chunk, use the cached neighbors:
+	if (
+		(a_RelPos.x >= -cChunkDef::Width) && (a_RelPos.x < 2 * cChunkDef::Width) &&
+		(a_RelPos.z >= -cChunkDef::Width) && (a_RelPos.z < 2 * cChunkDef::Width)
+	)
 	{
-		a_RelPos.x = RelX;
-		a_RelPos.z = RelZ;
+		const int OffsetX = (a_RelPos.x < 0) ? -1 : ((a_RelPos.x >= cChunkDef::Width) ? 1 : 0);
+		const int OffsetZ = (a_RelPos.z < 0) ? -1 : ((a_RelPos.z >= cChunkDef::Width) ? 1 : 0);
+		ToReturn = m_Neighbors[GetNeighborIndex(OffsetX, OffsetZ)];
+		a_RelPos.x -= OffsetX * cChunkDef::Width;
+		a_RelPos.z -= OffsetZ * cChunkDef::Width;
 		return ToReturn;
 	}
 
-	// The chunk cannot be walked through neighbors, find it through the chunkmap:
+	// The chunk is farther away, find it through the chunkmap:
 	int AbsX = a_RelPos.x + m_PosX * cChunkDef::Width;
 	int AbsZ = a_RelPos.z + m_PosZ * cChunkDef::Width;
 	int DstChunkX, DstChunkZ;
@@ -8,6 +8,8 @@
 #include "Simulator/SandSimulator.h"
 
 #include "ChunkMap.h"
+#include "PendingBlockSends.h"
+#include "SpatialGrid.h"
 
 
 
@@ -19,6 +21,7 @@ class cPlayer;
 class cChunkMap;
 class cBoundingBox;
 class cChunkDataCallback;
+class cChunkDataSerializer;
 class cBlockArea;
 class cBlockArea;
 class cFluidSimulatorData;
@@ -51,8 +54,10 @@ public:
 	cChunk(const cChunk & Other) = delete;
 	~cChunk();
 
-	/** Flushes the pending block (entity) queue, and clients' outgoing data buffers. */
-	void BroadcastPendingChanges(void);
+	/** Flushes the pending block (entity) queue, and clients' outgoing data buffers.
+	The sections with too many changed blocks are resent whole, serialized by a_SectionSerializer once for each protocol version;
+	the changes in the other sections are sent as block changes. */
+	void BroadcastPendingChanges(cChunkDataSerializer & a_SectionSerializer);
 
 	/** Returns true iff the chunk block data is valid (loaded / generated) */
 	bool IsValid(void) const {return (m_Presence == cpPresent); }
@@ -82,6 +87,11 @@ public:
 
 	bool IsLightValid(void) const {return m_IsLightValid; }
 
+	/** Returns the version of the chunk's block, light and biome data.
+	A new version is assigned whenever any of that data changes. The versions are never reused, not even by other chunks or
+	by the same chunk after it is reloaded, so a copy made of the data, such as a serialized chunk packet, is current for as long as its version is. */
+	UInt64 GetDataVersion(void) const { return m_DataVersion; }
+
 	/*
 	To save a chunk, the WSSchema must:
 	1. Mark the chunk as being saved (MarkSaving())
@@ -123,8 +133,18 @@ public:
 	/** Try to Spawn Monsters inside chunk */
 	void SpawnMobs(cMobSpawner & a_MobSpawner);
 
+	/** Ticks the chunk's blocks, block entities, entities and simulators.
+	While the chunkmap ticks in parallel, the players are left out, to be ticked by TickPlayers() afterwards. */
 	void Tick(std::chrono::milliseconds a_Dt);
 
+	/** Ticks the players in the chunk and moves those that left it into their new chunk.
+	Called serially after the parallel chunk tick, because the players' client handles stream and unload chunks anywhere in the world. */
+	void TickPlayers(std::chrono::milliseconds a_Dt);
+
+	/** Updates the entity's position in the entity grid, and the grid's reach for its size, if the chunk grids its entities.
+	Called by the entity whenever its position or size changes, so that the box queries stay exact. */
+	void UpdateEntityInGrid(cEntity & a_Entity);
+
 	/** Ticks a single block. Used by cWorld::TickQueuedBlocks() to tick the queued blocks */
 	void TickBlock(const Vector3i a_RelPos);
 
@@ -174,18 +194,19 @@ public:
 	The vector will not be modified if the function returns false. */
 	bool GetChunkAndRelByAbsolute(const Vector3i & a_Position, cChunk ** a_Chunk, Vector3i & a_Rel);
 
-	/** Returns the chunk into which the specified block belongs, by walking the neighbors.
-	Will return self if appropriate. Returns nullptr if not reachable through neighbors. */
+	/** Returns the chunk into which the specified block belongs.
+	Will return self if appropriate. Returns nullptr if the chunk is not present in the chunkmap. */
 	cChunk * GetNeighborChunk(int a_BlockX, int a_BlockZ);
 
-	/** Returns the chunk into which the relatively-specified block belongs, by walking the neighbors.
-	Will return self if appropriate. Returns nullptr if not reachable through neighbors. */
+	/** Returns the chunk into which the relatively-specified block belongs.
+	Uses the cached neighbors for the directly surrounding chunks, queries the chunkmap for the ones farther away.
+	Will return self if appropriate. Returns nullptr if the chunk is not present in the chunkmap. */
 	cChunk * GetRelNeighborChunk(int a_RelX, int a_RelZ);
 
 	/** Returns the chunk into which the relatively-specified block belongs.
 	Also modifies the relative coords from this-relative to return-relative.
 	Will return self if appropriate.
-	Will try walking the neighbors first; if that fails, will query the chunkmap. */
+	Uses the cached neighbors for the directly surrounding chunks, queries the chunkmap for the ones farther away. */
 	cChunk * GetRelNeighborChunkAdjustCoords(Vector3i & a_RelPos) const;
 
 	EMCSBiome GetBiomeAt(int a_RelX, int a_RelZ) const {return cChunkDef::GetBiome(m_BiomeMap, a_RelX, a_RelZ); }
@@ -268,6 +289,12 @@ public:
 		m_IsSaving = false;
 	}
 
+	/** Assigns a new version to the chunk's data; to be called whenever the block, light or biome data changes. */
+	inline void InvalidateDataVersion(void)
+	{
+		m_DataVersion = ms_NextDataVersion.fetch_add(1, std::memory_order_relaxed);
+	}
+
 	/** Causes the specified block to be ticked on the next Tick() call.
 	Plugins can use this via the cWorld:SetNextBlockToTick() API.
 	Only one block coord per chunk may be set, a second call overwrites the first call */
@@ -292,7 +319,8 @@ public:
 	{
 		m_BlockData.SetMeta(a_RelPos, a_Meta);
 		MarkDirty();
-		m_PendingSendBlocks.emplace_back(m_PosX, m_PosZ, a_RelPos.x, a_RelPos.y, a_RelPos.z, GetBlock(a_RelPos), a_Meta);
+		InvalidateDataVersion();
+		QueueSendBlock(a_RelPos.x, a_RelPos.y, a_RelPos.z, GetBlock(a_RelPos), a_Meta);
 	}
 
 	/** Light alterations based on time */
@@ -306,6 +334,10 @@ public:
 	inline NIBBLETYPE GetSkyLight(Vector3i a_RelPos) const { return m_LightData.GetSkyLight(a_RelPos); }
 	inline NIBBLETYPE GetSkyLight(int a_RelX, int a_RelY, int a_RelZ) const { return m_LightData.GetSkyLight({ a_RelX, a_RelY, a_RelZ }); }
 
+	/** Set the level of artificial light / sky light of a single block. Used by the incremental light updates, doesn't mark the chunk dirty. */
+	inline void SetBlockLight(Vector3i a_RelPos, NIBBLETYPE a_Light) { m_LightData.SetBlockLight(a_RelPos, a_Light); InvalidateDataVersion(); }
+	inline void SetSkyLight(Vector3i a_RelPos, NIBBLETYPE a_Light) { m_LightData.SetSkyLight(a_RelPos, a_Light); InvalidateDataVersion(); }
+
 	/** Get the level of sky light illuminating the block (0 - 15), taking daytime into a account. */
 	inline NIBBLETYPE GetSkyLightAltered(Vector3i a_RelPos) const { return GetTimeAlteredLight(m_LightData.GetSkyLight(a_RelPos)); }
 	inline NIBBLETYPE GetSkyLightAltered(int a_RelX, int a_RelY, int a_RelZ) const { return GetSkyLightAltered({ a_RelX, a_RelY, a_RelZ }); }
@@ -481,10 +513,16 @@ private:
 	bool m_IsDirty;        // True if the chunk has changed since it was last saved
 	bool m_IsSaving;       // True if the chunk is being saved
 
-	/** Blocks that have changed and need to be sent to all clients.
+	/** The version of the block, light and biome data, see GetDataVersion(). */
+	UInt64 m_DataVersion;
+
+	/** The next data version to be assigned, shared by all the chunks. */
+	static std::atomic<UInt64> ms_NextDataVersion;
+
+	/** Blocks that have changed and need to be sent to all clients, and the sections to be resent whole instead.
 	The protocol has a provision for coalescing block changes, and this is the buffer.
-	It will collect the block changes that occur in a tick, before being flushed in BroadcastPendingSendBlocks. */
-	sSetBlockVector m_PendingSendBlocks;
+	It will collect the block changes that occur in a tick, before being flushed in BroadcastPendingChanges(). */
+	cPendingBlockSends m_PendingSends;
 
 	/** Block entities that have been touched and need to be sent to all clients.
 	Because block changes are buffered and we need to happen after them, this buffer exists too.
@@ -500,6 +538,18 @@ private:
 	std::vector<OwnedEntity> m_Entities;
 	cBlockEntities m_BlockEntities;
 
+	/** The positions of the entities, other than players, for finding those within a box without checking each of them.
+	Only kept while the chunk has many entities, nullptr otherwise. The entities update their positions whenever they move, see UpdateEntityInGrid(). */
+	std::unique_ptr<cSpatialGrid<cEntity *>> m_EntityGrid;
+
+	/** The players in the chunk while m_EntityGrid is kept. They're checked one by one, their moves come from the clients at any time. */
+	std::vector<cEntity *> m_EntityGridPlayers;
+
+	/** How far outside a box the gridded positions of the entities intersecting the box may be, allowing for the entities' size:
+	sideways and downwards (the position is at the entity's feet). */
+	double m_EntityGridReachXZ = 0;
+	double m_EntityGridReachDown = 0;
+
 	/** Number of times the chunk has been requested to stay (by various cChunkStay objects); if zero, the chunk can be unloaded */
 	unsigned m_StayCount;
 
@@ -517,10 +567,10 @@ private:
 	Plugins can use this to force a tick in a specific block, using cWorld:SetNextBlockToTick() API. */
 	Vector3i m_BlockToTick;
 
-	cChunk * m_NeighborXM;  // Neighbor at [X - 1, Z]
-	cChunk * m_NeighborXP;  // Neighbor at [X + 1, Z]
-	cChunk * m_NeighborZM;  // Neighbor at [X,     Z - 1]
-	cChunk * m_NeighborZP;  // Neighbor at [X,     Z + 1]
+	/** The chunks surrounding this one, including the diagonal ones, indexed by GetNeighborIndex().
+	The center item points to this chunk; items for neighbors not present in the chunkmap are nullptr.
+	Maintained by the constructors and destructors of the neighbors. */
+	std::array<cChunk *, 9> m_Neighbors;
 
 	// Per-chunk simulator data:
 	cFireSimulatorChunkData m_FireSimulatorData;
@@ -544,6 +594,14 @@ private:
 	/** Wakes up each simulator for its specific blocks; through all the blocks in the chunk */
 	void WakeUpSimulators(void);
 
+	/** Queues the block change to be sent to all clients in BroadcastPendingChanges().
+	Once a section has more changes than cChunkMap::GetSectionResendThreshold() in a tick, it's marked to be resent whole instead. */
+	void QueueSendBlock(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta);
+
+	/** Resends the sections in the mask whole to all clients, serialized once for each protocol version.
+	If the chunk's light isn't valid, the whole chunk is resent instead, the chunk sender relights it first. */
+	void BroadcastPendingSections(cChunkDataSerializer & a_Serializer, UInt16 a_SectionMask);
+
 	/** Checks the block scheduled for checking in m_ToTickBlocks[] */
 	void CheckBlocks();
 
@@ -562,9 +620,33 @@ private:
 	Returns the number of stages the plant has grown, 0 if not a plant. */
 	int GrowPlantAt(Vector3i a_RelPos, int a_NumStages = 1);
 
+	/** If the entity has moved out of this chunk, removes it from m_Entities and moves it into its new chunk.
+	Returns the iterator to the entity following it in m_Entities. */
+	std::vector<OwnedEntity>::iterator MoveEntityIfOutside(std::vector<OwnedEntity>::iterator a_Itr);
+
 	/** Called by Tick() when an entity moves out of this chunk into a neighbor; moves the entity and sends spawn / despawn packet to clients */
 	void MoveEntityToNewChunk(OwnedEntity a_Entity);
 
 	/** Check m_Entities for cPlayer objects. */
 	bool HasPlayerEntities() const;
+
+	/** Starts or stops gridding the entities' positions, based on their number, and recalculates the reach of the grid's queries. Called once per tick. */
+	void UpdateEntityGrid(void);
+
+	/** Adds the entity to m_EntityGrid, or to m_EntityGridPlayers. The grid must exist. */
+	void AddToEntityGrid(cEntity & a_Entity);
+
+	/** Removes the entity from m_EntityGrid, or m_EntityGridPlayers, if the grid exists. */
+	void RemoveFromEntityGrid(cEntity & a_Entity);
+
+	/** Widens the reach of the entity grid's queries for the entity's size. */
+	void ExtendEntityGridReach(const cEntity & a_Entity);
+
+	/** Returns the index into m_Neighbors of the chunk at the specified offset, each in the range [-1, 1].
+	Note that the opposite offset always has the index (8 - index). */
+	static size_t GetNeighborIndex(int a_OffsetX, int a_OffsetZ)
+	{
+		ASSERT((a_OffsetX >= -1) && (a_OffsetX <= 1) && (a_OffsetZ >= -1) && (a_OffsetZ <= 1));
+		return static_cast<size_t>((a_OffsetX + 1) + 3 * (a_OffsetZ + 1));
+	}
 };
@@ -60,7 +60,8 @@ void ChunkDataStore<ElementType, ElementCount, DefaultValue>::Assign(const Chunk
 
 		if (const auto & Other = a_Other.Store[Y]; Other != nullptr)
 		{
-			Store[Y] = std::make_unique<Type>(*Other);
+			Store[Y] = MakePooledForOverwrite<Type>();
+			*Store[Y] = *Other;
 		}
 	}
 }
@@ -117,7 +118,7 @@ void ChunkDataStore<ElementType, ElementCount, DefaultValue>::Set(const Vector3i
 			return;
 		}
 
-		Section = cpp20::make_unique_for_overwrite<Type>();
+		Section = MakePooledForOverwrite<Type>();
 		std::fill(Section->begin(), Section->end(), DefaultValue);
 	}
 
@@ -147,7 +148,7 @@ void ChunkDataStore<ElementType, ElementCount, DefaultValue>::SetSection(const E
 	}
 	else if (std::any_of(a_Source, SourceEnd, [](const auto Value) { return Value != DefaultValue; }))
 	{
-		Section = cpp20::make_unique_for_overwrite<Type>();
+		Section = MakePooledForOverwrite<Type>();
 		std::copy(a_Source, SourceEnd, Section->begin());
 	}
 }
@@ -169,6 +170,393 @@ void ChunkDataStore<ElementType, ElementCount, DefaultValue>::SetAll(const Eleme
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+// PalettedBlockSection:
+
+PalettedBlockSection::PalettedBlockSection():
+	m_PaletteSize(0),
+	m_BitsPerEntry(0)
+{
+}
+
+
+
+
+
+PalettedBlockSection::PalettedBlockSection(const PalettedBlockSection & a_Other):
+	PalettedBlockSection()
+{
+	*this = a_Other;
+}
+
+
+
+
+
+PalettedBlockSection & PalettedBlockSection::operator = (const PalettedBlockSection & a_Other)
+{
+	if (this == &a_Other)
+	{
+		return *this;
+	}
+
+	m_Palette = a_Other.m_Palette;
+	m_UseCounts = a_Other.m_UseCounts;
+	m_PaletteSize = a_Other.m_PaletteSize;
+	m_BitsPerEntry = a_Other.m_BitsPerEntry;
+	m_Indices.reset();
+	m_Direct.reset();
+
+	if (a_Other.m_Indices != nullptr)
+	{
+		const auto Size = GetIndicesSize(m_BitsPerEntry);
+		m_Indices = MakePooledArrayForOverwrite(Size);
+		std::copy_n(a_Other.m_Indices.get(), Size, m_Indices.get());
+	}
+	if (a_Other.m_Direct != nullptr)
+	{
+		m_Direct = MakePooledForOverwrite<BlockArray>();
+		*m_Direct = *a_Other.m_Direct;
+	}
+	return *this;
+}
+
+
+
+
+
+BLOCKTYPE PalettedBlockSection::Get(const size_t a_Index) const
+{
+	ASSERT(IsPresent());
+	ASSERT(a_Index < BlockCount);
+
+	switch (m_BitsPerEntry)
+	{
+		case 0: return m_Palette[0];
+		case 8: return (*m_Direct)[a_Index];
+	}
+
+	const size_t BitIndex = a_Index * m_BitsPerEntry;
+	const auto PaletteIndex = (m_Indices[BitIndex / 8] >> (BitIndex % 8)) & ((1 << m_BitsPerEntry) - 1);
+	return m_Palette[PaletteIndex];
+}
+
+
+
+
+
+void PalettedBlockSection::Set(const size_t a_Index, const BLOCKTYPE a_Value)
+{
+	ASSERT(IsPresent());
+	ASSERT(a_Index < BlockCount);
+
+	if (m_BitsPerEntry == 8)
+	{
+		(*m_Direct)[a_Index] = a_Value;
+		return;
+	}
+
+	const size_t BitIndex = a_Index * m_BitsPerEntry;
+	const auto OldPaletteIndex = (m_BitsPerEntry == 0) ? 0 : static_cast<size_t>((m_Indices[BitIndex / 8] >> (BitIndex % 8)) & ((1 << m_BitsPerEntry) - 1));
+	if (m_Palette[OldPaletteIndex] == a_Value)
+	{
+		return;
+	}
+	m_UseCounts[OldPaletteIndex]--;
+
+	// Find the block type in the palette, otherwise put it into an entry that no block uses anymore (possibly the one just vacated),
+	// or append it if there's room. This way a block toggling between types doesn't need the section rebuilt:
+	const auto PaletteEnd = m_Palette.begin() + m_PaletteSize;
+	auto PaletteIndex = static_cast<size_t>(std::find(m_Palette.begin(), PaletteEnd, a_Value) - m_Palette.begin());
+	if (PaletteIndex == m_PaletteSize)
+	{
+		PaletteIndex = static_cast<size_t>(std::find(m_UseCounts.begin(), m_UseCounts.begin() + m_PaletteSize, 0) - m_UseCounts.begin());
+		if (PaletteIndex == m_PaletteSize)
+		{
+			if (m_PaletteSize >= (1U << m_BitsPerEntry))
+			{
+				// All the entries are in use, rebuild with the new block, which upgrades to a wider representation:
+				BlockArray Blocks;
+				CopyTo(Blocks.data());
+				Blocks[a_Index] = a_Value;
+				Rebuild(Blocks.data(), m_BitsPerEntry);
+				return;
+			}
+			m_PaletteSize++;
+		}
+		m_Palette[PaletteIndex] = a_Value;
+	}
+	m_UseCounts[PaletteIndex]++;
+
+	const auto Mask = static_cast<UInt8>(((1 << m_BitsPerEntry) - 1) << (BitIndex % 8));
+	auto & Byte = m_Indices[BitIndex / 8];
+	Byte = static_cast<UInt8>((Byte & ~Mask) | ((PaletteIndex << (BitIndex % 8)) & Mask));
+}
+
+
+
+
+
+void PalettedBlockSection::Fill(const BLOCKTYPE a_Value)
+{
+	Reset();
+	m_Palette[0] = a_Value;
+	m_UseCounts.fill(0);
+	m_UseCounts[0] = BlockCount;
+	m_PaletteSize = 1;
+}
+
+
+
+
+
+void PalettedBlockSection::SetAll(const BLOCKTYPE * a_Source)
+{
+	Rebuild(a_Source, 0);
+}
+
+
+
+
+
+void PalettedBlockSection::CopyTo(BLOCKTYPE * a_Dest) const
+{
+	ASSERT(IsPresent());
+
+	switch (m_BitsPerEntry)
+	{
+		case 0:
+		{
+			std::fill_n(a_Dest, BlockCount, m_Palette[0]);
+			return;
+		}
+		case 8:
+		{
+			std::copy(m_Direct->begin(), m_Direct->end(), a_Dest);
+			return;
+		}
+	}
+
+	// Unpack the indices byte by byte:
+	const size_t EntriesPerByte = 8 / m_BitsPerEntry;
+	const auto Mask = (1 << m_BitsPerEntry) - 1;
+	const auto IndicesSize = GetIndicesSize(m_BitsPerEntry);
+	for (size_t ByteIdx = 0; ByteIdx != IndicesSize; ++ByteIdx)
+	{
+		auto Byte = m_Indices[ByteIdx];
+		for (size_t Entry = 0; Entry != EntriesPerByte; ++Entry)
+		{
+			*a_Dest++ = m_Palette[Byte & Mask];
+			Byte = static_cast<UInt8>(Byte >> m_BitsPerEntry);
+		}
+	}
+}
+
+
+
+
+
+void PalettedBlockSection::Reset()
+{
+	m_PaletteSize = 0;
+	m_BitsPerEntry = 0;
+	m_Indices.reset();
+	m_Direct.reset();
+}
+
+
+
+
+
+size_t PalettedBlockSection::GetMemoryUsage() const
+{
+	if (m_Direct != nullptr)
+	{
+		return sizeof(BlockArray);
+	}
+	return (m_Indices != nullptr) ? GetIndicesSize(m_BitsPerEntry) : 0;
+}
+
+
+
+
+
+void PalettedBlockSection::Rebuild(const BLOCKTYPE * a_Source, const UInt8 a_MinBitsPerEntry)
+{
+	// Collect the palette, bail out to direct storage once it grows too large:
+	std::array<UInt8, 256> PaletteIndices;
+	PaletteIndices.fill(0xff);
+	std::array<BLOCKTYPE, MaxPaletteSize> Palette;
+	size_t PaletteSize = 0;
+	for (size_t Idx = 0; Idx != BlockCount; ++Idx)
+	{
+		const auto Block = a_Source[Idx];
+		if (PaletteIndices[Block] != 0xff)
+		{
+			continue;
+		}
+		if (PaletteSize == MaxPaletteSize)
+		{
+			PaletteSize = MaxPaletteSize + 1;
+			break;
+		}
+		PaletteIndices[Block] = static_cast<UInt8>(PaletteSize);
+		Palette[PaletteSize++] = Block;
+	}
+
+	// Choose the smallest representation fitting the palette:
+	UInt8 BitsPerEntry = 0;
+	while ((1U << BitsPerEntry) < PaletteSize)
+	{
+		BitsPerEntry = (BitsPerEntry == 0) ? 1 : static_cast<UInt8>(BitsPerEntry * 2);
+	}
+	BitsPerEntry = std::max(BitsPerEntry, a_MinBitsPerEntry);
+
+	Reset();
+	if (BitsPerEntry > 4)
+	{
+		m_BitsPerEntry = 8;
+		m_Direct = MakePooledForOverwrite<BlockArray>();
+		std::copy_n(a_Source, BlockCount, m_Direct->begin());
+		return;
+	}
+
+	m_Palette = Palette;
+	m_PaletteSize = static_cast<UInt8>(PaletteSize);
+	m_BitsPerEntry = BitsPerEntry;
+	m_UseCounts.fill(0);
+	if (BitsPerEntry == 0)
+	{
+		m_UseCounts[0] = BlockCount;
+		return;
+	}
+
+	// Pack the indices:
+	const size_t EntriesPerByte = 8 / BitsPerEntry;
+	const auto IndicesSize = GetIndicesSize(BitsPerEntry);
+	m_Indices = MakePooledArrayForOverwrite(IndicesSize);
+	for (size_t ByteIdx = 0; ByteIdx != IndicesSize; ++ByteIdx)
+	{
+		unsigned Byte = 0;
+		for (size_t Entry = 0; Entry != EntriesPerByte; ++Entry)
+		{
+			const auto PaletteIndex = PaletteIndices[*a_Source++];
+			m_UseCounts[PaletteIndex]++;
+			Byte |= static_cast<unsigned>(PaletteIndex) << (Entry * BitsPerEntry);
+		}
+		m_Indices[ByteIdx] = static_cast<UInt8>(Byte);
+	}
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// PalettedBlockStore:
+
+void PalettedBlockStore::Assign(const PalettedBlockStore & a_Other)
+{
+	for (size_t Y = 0; Y != cChunkDef::NumSections; Y++)
+	{
+		Store[Y] = a_Other.Store[Y];
+	}
+}
+
+
+
+
+
+BLOCKTYPE PalettedBlockStore::Get(const Vector3i a_Position) const
+{
+	const auto Indices = IndicesFromRelPos(a_Position);
+	const auto & Section = Store[Indices.Section];
+
+	if (Section.IsPresent())
+	{
+		return Section.Get(Indices.Index);
+	}
+
+	return ChunkBlockData::DefaultValue;
+}
+
+
+
+
+
+const PalettedBlockStore::BlockArray * PalettedBlockStore::GetSection(const size_t a_Y, BlockArray & a_Scratch) const
+{
+	const auto & Section = Store[a_Y];
+	if (!Section.IsPresent())
+	{
+		return nullptr;
+	}
+
+	if (const auto Direct = Section.GetDirect(); Direct != nullptr)
+	{
+		return Direct;
+	}
+
+	Section.CopyTo(a_Scratch.data());
+	return &a_Scratch;
+}
+
+
+
+
+
+void PalettedBlockStore::Set(const Vector3i a_Position, const BLOCKTYPE a_Value)
+{
+	const auto Indices = IndicesFromRelPos(a_Position);
+	auto & Section = Store[Indices.Section];
+
+	if (!Section.IsPresent())
+	{
+		if (a_Value == ChunkBlockData::DefaultValue)
+		{
+			return;
+		}
+
+		Section.Fill(ChunkBlockData::DefaultValue);
+	}
+
+	Section.Set(Indices.Index, a_Value);
+}
+
+
+
+
+
+void PalettedBlockStore::SetSection(const BLOCKTYPE (& a_Source)[PalettedBlockSection::BlockCount], const size_t a_Y)
+{
+	auto & Section = Store[a_Y];
+	const auto SourceEnd = std::end(a_Source);
+
+	if (
+		Section.IsPresent() ||
+		std::any_of(a_Source, SourceEnd, [](const auto Value) { return Value != ChunkBlockData::DefaultValue; })
+	)
+	{
+		Section.SetAll(a_Source);
+	}
+}
+
+
+
+
+
+void PalettedBlockStore::SetAll(const BLOCKTYPE (& a_Source)[cChunkDef::NumSections * PalettedBlockSection::BlockCount])
+{
+	for (size_t Y = 0; Y != cChunkDef::NumSections; Y++)
+	{
+		SetSection(*reinterpret_cast<const BLOCKTYPE (*)[PalettedBlockSection::BlockCount]>(a_Source + Y * PalettedBlockSection::BlockCount), Y);
+	}
+}
+
+
+
+
+
 void ChunkBlockData::Assign(const ChunkBlockData & a_Other)
 {
 	m_Blocks.Assign(a_Other.m_Blocks);
@@ -229,6 +617,5 @@ void ChunkLightData::SetSection(const SectionType & a_BlockLightSource, const Se
 
 
 
-template struct ChunkDataStore<BLOCKTYPE, ChunkBlockData::SectionBlockCount, ChunkBlockData::DefaultValue>;
 template struct ChunkDataStore<NIBBLETYPE, ChunkBlockData::SectionMetaCount, ChunkLightData::DefaultBlockLightValue>;
 template struct ChunkDataStore<NIBBLETYPE, ChunkLightData::SectionLightCount, ChunkLightData::DefaultSkyLightValue>;
@@ -11,6 +11,7 @@
 
 #include "FunctionRef.h"
 #include "ChunkDef.h"
+#include "ChunkSectionPool.h"
 
 
 
@@ -44,8 +45,141 @@ struct ChunkDataStore
 	Allocates sections that are needed for the operation. */
 	void SetAll(const ElementType (& a_Source)[cChunkDef::NumSections * ElementCount]);
 
-	/** Contains all the sections this ChunkDataStore manages. */
-	std::unique_ptr<Type> Store[cChunkDef::NumSections];
+	/** Contains all the sections this ChunkDataStore manages. The sections are allocated from the cChunkSectionPool. */
+	cPooledPtr<Type> Store[cChunkDef::NumSections];
+};
+
+
+
+
+
+/** Block type storage for a single chunk section, as a palette of the distinct block types plus bit-packed palette indices.
+A section of a single block type stores no index array at all. Up to 16 distinct block types are stored with 1, 2 or 4 bits
+per block, depending on the palette size; past that, the block types are stored directly, one byte per block.
+The representation is upgraded as new block types are set, and shrunk back to the smallest one fitting the data
+whenever the whole section is rebuilt. The palette entries count their uses, so that a new block type can take over
+an entry no longer used by any block instead of rebuilding the section. */
+class PalettedBlockSection
+{
+public:
+
+	static constexpr size_t BlockCount = cChunkDef::SectionHeight * cChunkDef::Width * cChunkDef::Width;
+
+	/** The largest palette size before switching to direct storage. */
+	static constexpr size_t MaxPaletteSize = 16;
+
+	using BlockArray = std::array<BLOCKTYPE, BlockCount>;
+
+	/** Creates a section that is not present. */
+	PalettedBlockSection();
+
+	PalettedBlockSection(const PalettedBlockSection & a_Other);
+	PalettedBlockSection & operator = (const PalettedBlockSection & a_Other);
+
+	/** Returns true if the section holds any data. */
+	bool IsPresent() const { return (m_PaletteSize != 0) || (m_Direct != nullptr); }
+
+	/** Returns the block type at the specified index. The section must be present. */
+	BLOCKTYPE Get(size_t a_Index) const;
+
+	/** Sets the block type at the specified index. The section must be present.
+	If the block type isn't in the palette, it takes over an unused palette entry, or is appended if there's room;
+	only if all the palette entries are in use, the section is rebuilt with a wider representation. */
+	void Set(size_t a_Index, BLOCKTYPE a_Value);
+
+	/** Makes the section present and filled with the specified block type. */
+	void Fill(BLOCKTYPE a_Value);
+
+	/** Replaces the whole contents of the section with the specified block types, using the smallest representation that fits them. */
+	void SetAll(const BLOCKTYPE * a_Source);
+
+	/** Writes the block types of the whole section into a_Dest. The section must be present. */
+	void CopyTo(BLOCKTYPE * a_Dest) const;
+
+	/** Returns the array of block types, if the section stores them directly; nullptr otherwise. */
+	const BlockArray * GetDirect() const { return m_Direct.get(); }
+
+	/** Makes the section not present, releasing its memory. */
+	void Reset();
+
+	/** Returns the number of bits used per block: 0 for a single-value section, 1, 2 or 4 for paletted sections, 8 for direct storage. */
+	UInt8 GetBitsPerEntry() const { return m_BitsPerEntry; }
+
+	/** Returns the palette. Only valid for sections that don't use direct storage.
+	The palette may contain entries that no block uses anymore. */
+	const BLOCKTYPE * GetPalette() const { return m_Palette.data(); }
+
+	/** Returns the number of entries in the palette. Zero for sections that use direct storage or aren't present. */
+	size_t GetPaletteSize() const { return m_PaletteSize; }
+
+	/** Returns the number of bytes of heap memory used by the section. */
+	size_t GetMemoryUsage() const;
+
+private:
+
+	/** The distinct block types in the section, the first m_PaletteSize entries are valid. */
+	std::array<BLOCKTYPE, MaxPaletteSize> m_Palette;
+
+	/** The number of blocks using each entry of m_Palette. An entry with a zero count may be reused for another block type. */
+	std::array<UInt16, MaxPaletteSize> m_UseCounts;
+
+	/** The number of valid entries in m_Palette. */
+	UInt8 m_PaletteSize;
+
+	/** The number of bits per block in m_Indices; 0 if a single-value section, 8 if using direct storage. */
+	UInt8 m_BitsPerEntry;
+
+	/** The bit-packed palette indices for paletted sections, nullptr otherwise.
+	Entries never straddle bytes, the first entry of each byte is in its lowest bits. */
+	cPooledArrayPtr m_Indices;
+
+	/** The block types of sections using direct storage, nullptr otherwise. */
+	cPooledPtr<BlockArray> m_Direct;
+
+
+	/** Rebuilds the section from the specified block types.
+	Uses at least a_MinBitsPerEntry bits per block, so that a section that has just been upgraded isn't immediately downgraded again. */
+	void Rebuild(const BLOCKTYPE * a_Source, UInt8 a_MinBitsPerEntry);
+
+	/** Returns the number of bytes needed for the packed indices of the specified width. */
+	static size_t GetIndicesSize(UInt8 a_BitsPerEntry) { return BlockCount * a_BitsPerEntry / 8; }
+};
+
+
+
+
+
+/** Stores the block types of all sections of a chunk as PalettedBlockSections.
+Mirrors the ChunkDataStore interface, except that sections can't be accessed as raw arrays directly. */
+struct PalettedBlockStore
+{
+	using BlockArray = PalettedBlockSection::BlockArray;
+
+	/** Copy assign from another PalettedBlockStore. */
+	void Assign(const PalettedBlockStore & a_Other);
+
+	/** Gets one block type at the given position.
+	Returns the default value if the section is not present. */
+	BLOCKTYPE Get(Vector3i a_Position) const;
+
+	/** Returns the block types of the specified section as an array, or nullptr if the section is not present.
+	The returned pointer points either to the section's own storage or to a_Scratch, into which the section is unpacked. */
+	const BlockArray * GetSection(size_t a_Y, BlockArray & a_Scratch) const;
+
+	/** Sets one block type at the given position.
+	Makes the section present if needed for the operation. */
+	void Set(Vector3i a_Position, BLOCKTYPE a_Value);
+
+	/** Copies the data from the specified flat section array into the internal representation.
+	Makes the section present if needed for the operation. */
+	void SetSection(const BLOCKTYPE (& a_Source)[PalettedBlockSection::BlockCount], size_t a_Y);
+
+	/** Copies the data from the specified flat array into the internal representation.
+	Makes the sections present that are needed for the operation. */
+	void SetAll(const BLOCKTYPE (& a_Source)[cChunkDef::NumSections * PalettedBlockSection::BlockCount]);
+
+	/** Contains all the sections this PalettedBlockStore manages. */
+	PalettedBlockSection Store[cChunkDef::NumSections];
 };
 
 
@@ -67,12 +201,12 @@ public:
 
 private:
 
-	ChunkDataStore<BLOCKTYPE, SectionBlockCount, DefaultValue> m_Blocks;
+	PalettedBlockStore m_Blocks;
 	ChunkDataStore<NIBBLETYPE, SectionMetaCount, DefaultMetaValue> m_Metas;
 
 public:
 
-	using BlockArray = decltype(m_Blocks)::Type;
+	using BlockArray = PalettedBlockStore::BlockArray;
 	using MetaArray = decltype(m_Metas)::Type;
 
 	void Assign(const ChunkBlockData & a_Other);
@@ -80,9 +214,17 @@ public:
 	BLOCKTYPE GetBlock(Vector3i a_Position) const { return m_Blocks.Get(a_Position); }
 	NIBBLETYPE GetMeta(Vector3i a_Position) const { return m_Metas.Get(a_Position); }
 
-	BlockArray * GetSection(size_t a_Y) const { return m_Blocks.GetSection(a_Y); }
+	/** Returns the block types of the specified section, or nullptr if there are none stored.
+	The blocks are stored paletted, so the returned pointer may point into a_Scratch, into which the section was unpacked. */
+	const BlockArray * GetSection(size_t a_Y, BlockArray & a_Scratch) const { return m_Blocks.GetSection(a_Y, a_Scratch); }
 	MetaArray * GetMetaSection(size_t a_Y) const { return m_Metas.GetSection(a_Y); }
 
+	/** Returns true if any block types are stored for the specified section. */
+	bool HasSection(size_t a_Y) const { return m_Blocks.Store[a_Y].IsPresent(); }
+
+	/** Returns the paletted storage of the specified section, for consumers that can use the palette directly. */
+	const PalettedBlockSection & GetPalettedSection(size_t a_Y) const { return m_Blocks.Store[a_Y]; }
+
 	void SetBlock(Vector3i a_Position, BLOCKTYPE a_Block) { m_Blocks.Set(a_Position, a_Block); }
 	void SetMeta(Vector3i a_Position, NIBBLETYPE a_Meta) { m_Metas.Set(a_Position, a_Meta); }
 
@@ -122,6 +264,9 @@ public:
 	LightArray * GetBlockLightSection(size_t a_Y) const { return m_BlockLights.GetSection(a_Y); }
 	LightArray * GetSkyLightSection(size_t a_Y) const { return m_SkyLights.GetSection(a_Y); }
 
+	void SetBlockLight(Vector3i a_Position, NIBBLETYPE a_Value) { m_BlockLights.Set(a_Position, a_Value); }
+	void SetSkyLight(Vector3i a_Position, NIBBLETYPE a_Value) { m_SkyLights.Set(a_Position, a_Value); }
+
 	void SetAll(const cChunkDef::BlockNibbles & a_BlockLightSource, const cChunkDef::BlockNibbles & a_SkyLightSource);
 	void SetSection(const SectionType & a_BlockLightSource, const SectionType & a_SkyLightSource, size_t a_Y);
 };
@@ -131,14 +276,15 @@ public:
 
 
 /** Invokes the callback functor for every chunk section containing at least one present block or light section data.
-This is used to collect all data for all sections.
+This is used to collect all data for all sections. The block types of paletted sections are unpacked into a local scratch array.
 In macro form to work around a Visual Studio 2017 ICE bug. */
 #define ChunkDef_ForEachSection(BlockData, LightData, Callback) \
 	do \
 	{ \
+		ChunkBlockData::BlockArray BlocksScratch; \
 		for (size_t Y = 0; Y < cChunkDef::NumSections; ++Y) \
 		{ \
-			const auto Blocks = BlockData.GetSection(Y); \
+			const auto Blocks = BlockData.GetSection(Y, BlocksScratch); \
 			const auto Metas = BlockData.GetMetaSection(Y); \
 			const auto BlockLights = LightData.GetBlockLightSection(Y); \
 			const auto SkyLights = LightData.GetSkyLightSection(Y); \
@@ -153,6 +299,5 @@ In macro form to work around a Visual Studio 2017 ICE bug. */
 
 
 
-extern template struct ChunkDataStore<BLOCKTYPE, ChunkBlockData::SectionBlockCount, ChunkBlockData::DefaultValue>;
 extern template struct ChunkDataStore<NIBBLETYPE, ChunkBlockData::SectionMetaCount, ChunkLightData::DefaultBlockLightValue>;
 extern template struct ChunkDataStore<NIBBLETYPE, ChunkLightData::SectionLightCount, ChunkLightData::DefaultSkyLightValue>;
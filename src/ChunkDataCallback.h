@@ -32,6 +32,10 @@ public:
 	/** Called once to let know if the chunk lighting is valid. Return value is ignored */
 	virtual void LightIsValid(bool a_IsLightValid) { UNUSED(a_IsLightValid); }
 
+	/** Called once to inform of the version of the chunk's block, light and biome data, see cChunk::GetDataVersion().
+	If false is returned, the ChunkData(), HeightMap() and BiomeMap() callbacks are skipped, such as when the data of that version is already known. */
+	virtual bool DataVersion(UInt64 a_DataVersion) { UNUSED(a_DataVersion); return true; }
+
 	/** Called once to export block data. */
 	virtual void ChunkData(const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData) { UNUSED(a_BlockData); UNUSED(a_LightData); }
 
@@ -0,0 +1,177 @@
+// ChunkIndex.h
+
+// Declares the cChunkIndex class template, a flat open-addressing hash table from chunk coords to objects stored elsewhere
+
+#pragma once
+
+#include "ChunkDef.h"
+
+
+
+
+
+/** A flat hash table mapping chunk coords to pointers to objects that are owned elsewhere.
+Uses open addressing with linear probing and backward-shift deletion over a single power-of-two-sized array,
+so that a lookup usually touches a single cache line, as opposed to walking the nodes of a tree.
+The table never owns the pointed-to objects; the owner must keep their addresses stable while they are indexed. */
+template <typename T>
+class cChunkIndex
+{
+public:
+
+	cChunkIndex():
+		m_Size(0)
+	{
+	}
+
+	/** Returns the object stored for the specified coords, or nullptr if there's none. */
+	T * Find(cChunkCoords a_Coords) const
+	{
+		if (m_Slots.empty())
+		{
+			return nullptr;
+		}
+		const size_t Mask = m_Slots.size() - 1;
+		for (size_t Idx = Hash(a_Coords) & Mask;; Idx = (Idx + 1) & Mask)
+		{
+			const auto & Slot = m_Slots[Idx];
+			if (Slot.m_Value == nullptr)
+			{
+				return nullptr;
+			}
+			if (Slot.m_Coords == a_Coords)
+			{
+				return Slot.m_Value;
+			}
+		}
+	}
+
+	/** Stores the object for the specified coords. The coords must not be present in the index yet. */
+	void Insert(cChunkCoords a_Coords, T * a_Value)
+	{
+		ASSERT(a_Value != nullptr);
+		ASSERT(Find(a_Coords) == nullptr);
+
+		// Keep the load factor at most 1/2, so that the probe sequences stay short:
+		if (2 * (m_Size + 1) > m_Slots.size())
+		{
+			Rehash(std::max<size_t>(MIN_CAPACITY, 2 * m_Slots.size()));
+		}
+		InsertNoGrow(a_Coords, a_Value);
+		m_Size += 1;
+	}
+
+	/** Removes the specified coords from the index. Returns true if they were present. */
+	bool Erase(cChunkCoords a_Coords)
+	{
+		if (m_Slots.empty())
+		{
+			return false;
+		}
+		const size_t Mask = m_Slots.size() - 1;
+		size_t Idx = Hash(a_Coords) & Mask;
+		while (m_Slots[Idx].m_Coords != a_Coords)
+		{
+			if (m_Slots[Idx].m_Value == nullptr)
+			{
+				return false;
+			}
+			Idx = (Idx + 1) & Mask;
+		}
+		if (m_Slots[Idx].m_Value == nullptr)
+		{
+			return false;
+		}
+
+		// Shift the following entries of the probe sequence back, so that no tombstones are needed:
+		for (size_t Next = (Idx + 1) & Mask; m_Slots[Next].m_Value != nullptr; Next = (Next + 1) & Mask)
+		{
+			const size_t Home = Hash(m_Slots[Next].m_Coords) & Mask;
+
+			// Move the entry into the hole only if its home slot isn't cyclically within (Idx, Next]:
+			if (((Next - Home) & Mask) >= ((Next - Idx) & Mask))
+			{
+				m_Slots[Idx] = m_Slots[Next];
+				Idx = Next;
+			}
+		}
+		m_Slots[Idx] = sSlot();
+		m_Size -= 1;
+		return true;
+	}
+
+	/** Removes all entries, keeping the allocated capacity. */
+	void Clear()
+	{
+		std::fill(m_Slots.begin(), m_Slots.end(), sSlot());
+		m_Size = 0;
+	}
+
+	/** Returns the number of entries in the index. */
+	size_t GetSize() const { return m_Size; }
+
+	/** Returns the number of slots currently allocated. */
+	size_t GetCapacity() const { return m_Slots.size(); }
+
+private:
+
+	/** The smallest number of slots allocated once anything is inserted. Must be a power of two. */
+	static constexpr size_t MIN_CAPACITY = 64;
+
+	struct sSlot
+	{
+		cChunkCoords m_Coords { 0, 0 };
+
+		/** The stored object; nullptr marks an empty slot. */
+		T * m_Value = nullptr;
+	};
+
+	/** The slots, the number of slots is always either zero or a power of two. */
+	std::vector<sSlot> m_Slots;
+
+	/** The number of occupied slots. */
+	size_t m_Size;
+
+
+	/** Mixes both coords into a well-distributed hash, so that the neighboring chunks don't cluster in the table. */
+	static size_t Hash(cChunkCoords a_Coords)
+	{
+		UInt64 Key = (static_cast<UInt64>(static_cast<UInt32>(a_Coords.m_ChunkX)) << 32) | static_cast<UInt32>(a_Coords.m_ChunkZ);
+		Key ^= Key >> 33;
+		Key *= 0xff51afd7ed558ccdULL;
+		Key ^= Key >> 33;
+		return static_cast<size_t>(Key);
+	}
+
+	/** Stores the entry into the first free slot of its probe sequence. There must be a free slot. */
+	void InsertNoGrow(cChunkCoords a_Coords, T * a_Value)
+	{
+		const size_t Mask = m_Slots.size() - 1;
+		size_t Idx = Hash(a_Coords) & Mask;
+		while (m_Slots[Idx].m_Value != nullptr)
+		{
+			Idx = (Idx + 1) & Mask;
+		}
+		m_Slots[Idx].m_Coords = a_Coords;
+		m_Slots[Idx].m_Value = a_Value;
+	}
+
+	/** Reallocates the slots to the specified capacity and re-inserts all the entries. */
+	void Rehash(size_t a_NewCapacity)
+	{
+		ASSERT((a_NewCapacity & (a_NewCapacity - 1)) == 0);  // Must be a power of two
+		std::vector<sSlot> OldSlots(a_NewCapacity);
+		std::swap(OldSlots, m_Slots);
+		for (const auto & Slot : OldSlots)
+		{
+			if (Slot.m_Value != nullptr)
+			{
+				InsertNoGrow(Slot.m_Coords, Slot.m_Value);
+			}
+		}
+	}
+};
+
+
+
+
@@ -18,7 +18,29 @@
 #include "SetChunkData.h"
 #include "Blocks/ChunkInterface.h"
 #include "Entities/Pickup.h"
+#include "Protocol/ChunkDataSerializer.h"
 #include "DeadlockDetect.h"
+#include "TBBWrapper.h"
+
+
+
+
+
+namespace
+{
+	/** Returns the coord of the tick region that contains the specified chunk coord. */
+	int ChunkToTickRegion(int a_ChunkCoord, int a_RegionSize)
+	{
+		return (a_ChunkCoord >= 0) ? (a_ChunkCoord / a_RegionSize) : ((a_ChunkCoord + 1) / a_RegionSize - 1);
+	}
+
+	/** Returns the phase in which the specified tick region is ticked.
+	Regions of the same phase are at least one whole region apart from each other in both directions. */
+	int GetTickRegionPhase(cChunkCoords a_Region)
+	{
+		return (a_Region.m_ChunkX & 1) + 2 * (a_Region.m_ChunkZ & 1);
+	}
+}
 
 
 
@@ -27,8 +49,17 @@
 ////////////////////////////////////////////////////////////////////////////////
 // cChunkMap:
 
+thread_local cChunkMap::sTickWorker * cChunkMap::ms_TickWorker = nullptr;
+
+
+
+
+
 cChunkMap::cChunkMap(cWorld * a_World) :
-	m_World(a_World)
+	m_World(a_World),
+	m_PrefetchCache(0),
+	m_ParallelTicking(false),
+	m_SectionResendThreshold(1024)
 {
 }
 
@@ -36,13 +67,30 @@ cChunkMap::cChunkMap(cWorld * a_World) :
 
 
 
+cChunkMap::~cChunkMap() = default;
+
+
+
+
+
 cChunk & cChunkMap::ConstructChunk(int a_ChunkX, int a_ChunkZ)
 {
-	// If not exists insert. Then, return the chunk at these coordinates:
-	return m_Chunks.try_emplace(
-		{ a_ChunkX, a_ChunkZ },
+	const cChunkCoords Coords(a_ChunkX, a_ChunkZ);
+	if (const auto Chunk = m_ChunkIndex.Find(Coords); Chunk != nullptr)
+	{
+		return *Chunk;
+	}
+
+	// Inserting chunks while other regions are being ticked in parallel would invalidate their lookups:
+	VERIFY(ms_TickWorker == nullptr);
+
+	// Not present yet, insert:
+	auto & Chunk = m_Chunks.try_emplace(
+		Coords,
 		a_ChunkX, a_ChunkZ, this, m_World
 	).first->second;
+	m_ChunkIndex.Insert(Coords, &Chunk);
+	return Chunk;
 }
 
 
@@ -70,8 +118,7 @@ cChunk * cChunkMap::FindChunk(int a_ChunkX, int a_ChunkZ)
 {
 	ASSERT(m_CSChunks.IsLockedByCurrentThread());
 
-	const auto Chunk = m_Chunks.find({ a_ChunkX, a_ChunkZ });
-	return (Chunk == m_Chunks.end()) ? nullptr : &Chunk->second;
+	return m_ChunkIndex.Find({ a_ChunkX, a_ChunkZ });
 }
 
 
@@ -82,8 +129,7 @@ const cChunk * cChunkMap::FindChunk(int a_ChunkX, int a_ChunkZ) const
 {
 	ASSERT(m_CSChunks.IsLockedByCurrentThread());
 
-	const auto Chunk = m_Chunks.find({ a_ChunkX, a_ChunkZ });
-	return (Chunk == m_Chunks.end()) ? nullptr : &Chunk->second;
+	return m_ChunkIndex.Find({ a_ChunkX, a_ChunkZ });
 }
 
 
@@ -127,6 +173,8 @@ bool cChunkMap::UseBlockEntity(cPlayer * a_Player, int a_BlockX, int a_BlockY, i
 
 bool cChunkMap::DoWithChunk(int a_ChunkX, int a_ChunkZ, cChunkCallback a_Callback)
 {
+	VerifyWritableByTickWorker({ a_ChunkX, a_ChunkZ });
+
 	cCSLock Lock(m_CSChunks);
 	const auto Chunk = FindChunk(a_ChunkX, a_ChunkZ);
 	if ((Chunk == nullptr) || !Chunk->IsValid())
@@ -424,6 +472,11 @@ bool cChunkMap::TryGetHeight(int a_BlockX, int a_BlockZ, int & a_Height)
 
 void cChunkMap::FastSetBlock(Vector3i a_BlockPos, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta)
 {
+	if (DeferBlockChange(sDeferredChange::eKind::FastSetBlock, a_BlockPos, a_BlockType, a_BlockMeta))
+	{
+		return;
+	}
+
 	auto chunkPos = cChunkDef::BlockToChunk(a_BlockPos);
 	auto relPos = cChunkDef::AbsoluteToRelative(a_BlockPos, chunkPos);
 
@@ -550,6 +603,11 @@ NIBBLETYPE cChunkMap::GetBlockBlockLight(Vector3i a_BlockPos) const
 
 void cChunkMap::SetBlockMeta(Vector3i a_BlockPos, NIBBLETYPE a_BlockMeta)
 {
+	if (DeferBlockChange(sDeferredChange::eKind::SetMeta, a_BlockPos, E_BLOCK_AIR, a_BlockMeta))
+	{
+		return;
+	}
+
 	auto chunkPos = cChunkDef::BlockToChunk(a_BlockPos);
 	auto relPos = cChunkDef::AbsoluteToRelative(a_BlockPos, chunkPos);
 
@@ -568,6 +626,11 @@ void cChunkMap::SetBlockMeta(Vector3i a_BlockPos, NIBBLETYPE a_BlockMeta)
 
 void cChunkMap::SetBlock(Vector3i a_BlockPos, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta)
 {
+	if (DeferBlockChange(sDeferredChange::eKind::SetBlock, a_BlockPos, a_BlockType, a_BlockMeta))
+	{
+		return;
+	}
+
 	auto chunkPos = cChunkDef::BlockToChunk(a_BlockPos);
 	auto relPos = cChunkDef::AbsoluteToRelative(a_BlockPos, chunkPos);
 
@@ -624,6 +687,22 @@ bool cChunkMap::GetBlockInfo(Vector3i a_BlockPos, BLOCKTYPE & a_BlockType, NIBBL
 
 void cChunkMap::ReplaceTreeBlocks(const sSetBlockVector & a_Blocks)
 {
+	if ((ms_TickWorker != nullptr) && !a_Blocks.empty())
+	{
+		cChunkCoords MinChunk(a_Blocks.front().m_ChunkX, a_Blocks.front().m_ChunkZ), MaxChunk(MinChunk);
+		for (const auto & Block : a_Blocks)
+		{
+			MinChunk.m_ChunkX = std::min(MinChunk.m_ChunkX, Block.m_ChunkX);
+			MinChunk.m_ChunkZ = std::min(MinChunk.m_ChunkZ, Block.m_ChunkZ);
+			MaxChunk.m_ChunkX = std::max(MaxChunk.m_ChunkX, Block.m_ChunkX);
+			MaxChunk.m_ChunkZ = std::max(MaxChunk.m_ChunkZ, Block.m_ChunkZ);
+		}
+		if (DeferOperation(MinChunk, MaxChunk, [this, a_Blocks]() { ReplaceTreeBlocks(a_Blocks); }))
+		{
+			return;
+		}
+	}
+
 	cCSLock Lock(m_CSChunks);
 	for (sSetBlockVector::const_iterator itr = a_Blocks.begin(); itr != a_Blocks.end(); ++itr)
 	{
@@ -680,6 +759,11 @@ bool cChunkMap::SetBiomeAt(int a_BlockX, int a_BlockZ, EMCSBiome a_Biome)
 	int ChunkX, ChunkZ, X = a_BlockX, Y = 0, Z = a_BlockZ;
 	cChunkDef::AbsoluteToRelative(X, Y, Z, ChunkX, ChunkZ);
 
+	if (DeferOperation({ ChunkX, ChunkZ }, { ChunkX, ChunkZ }, [this, a_BlockX, a_BlockZ, a_Biome]() { SetBiomeAt(a_BlockX, a_BlockZ, a_Biome); }))
+	{
+		return true;
+	}
+
 	cCSLock Lock(m_CSChunks);
 	const auto Chunk = FindChunk(ChunkX, ChunkZ);
 	if ((Chunk != nullptr) && Chunk->IsValid())
@@ -703,6 +787,14 @@ bool cChunkMap::SetAreaBiome(int a_MinX, int a_MaxX, int a_MinZ, int a_MaxZ, EMC
 	cChunkDef::AbsoluteToRelative(MinX, Y, MinZ, MinChunkX, MinChunkZ);
 	cChunkDef::AbsoluteToRelative(MaxX, Y, MaxZ, MaxChunkX, MaxChunkZ);
 
+	if (DeferOperation(
+		{ MinChunkX, MinChunkZ }, { MaxChunkX, MaxChunkZ },
+		[this, a_MinX, a_MaxX, a_MinZ, a_MaxZ, a_Biome]() { SetAreaBiome(a_MinX, a_MaxX, a_MinZ, a_MaxZ, a_Biome); }
+	))
+	{
+		return true;
+	}
+
 	// Go through all chunks, set:
 	bool res = true;
 	cCSLock Lock(m_CSChunks);
@@ -767,6 +859,11 @@ bool cChunkMap::DigBlock(Vector3i a_BlockPos)
 	auto chunkCoords = cChunkDef::BlockToChunk(a_BlockPos);
 	auto relPos = cChunkDef::AbsoluteToRelative(a_BlockPos, chunkCoords);
 
+	if (DeferOperation(chunkCoords, chunkCoords, [this, a_BlockPos]() { DigBlock(a_BlockPos); }))
+	{
+		return true;
+	}
+
 	{
 		cCSLock Lock(m_CSChunks);
 		const auto Chunk = FindChunk(chunkCoords.m_ChunkX, chunkCoords.m_ChunkZ);
@@ -873,7 +970,23 @@ void cChunkMap::CompareChunkClients(cChunk * a_Chunk1, cChunk * a_Chunk2, cClien
 bool cChunkMap::AddChunkClient(int a_ChunkX, int a_ChunkZ, cClientHandle * a_Client)
 {
 	cCSLock Lock(m_CSChunks);
-	return GetChunk(a_ChunkX, a_ChunkZ).AddClient(a_Client);
+	auto & Chunk = GetChunk(a_ChunkX, a_ChunkZ);
+	if (!Chunk.AddClient(a_Client))
+	{
+		return false;
+	}
+
+	// A prefetched chunk is now kept by the client. The cache is shared by all the tick workers, so they leave it to the merge step:
+	const cChunkCoords Coords(a_ChunkX, a_ChunkZ);
+	if (ms_TickWorker != nullptr)
+	{
+		ms_TickWorker->m_Changes.push_back({ sDeferredChange::eKind::Operation, {}, E_BLOCK_AIR, 0, [this, Coords]() { ReleaseUsedPrefetchedChunk(Coords); } });
+	}
+	else
+	{
+		ReleaseUsedPrefetchedChunk(Coords);
+	}
+	return true;
 }
 
 
@@ -908,6 +1021,20 @@ void cChunkMap::RemoveClientFromChunks(cClientHandle * a_Client)
 void cChunkMap::AddEntity(OwnedEntity a_Entity)
 {
 	cCSLock Lock(m_CSChunks);
+
+	// While ticking in parallel, the entity may only go directly into an existing chunk that the worker may write to:
+	if (ms_TickWorker != nullptr)
+	{
+		const cChunkCoords Coords(a_Entity->GetChunkX(), a_Entity->GetChunkZ());
+		if (!ms_TickWorker->IsWritable(Coords) || (FindChunk(Coords.m_ChunkX, Coords.m_ChunkZ) == nullptr))
+		{
+			// std::function needs a copyable functor, share the ownership until the merge step:
+			auto Entity = std::make_shared<OwnedEntity>(std::move(a_Entity));
+			ms_TickWorker->m_Changes.push_back({ sDeferredChange::eKind::Operation, {}, E_BLOCK_AIR, 0, [this, Entity]() { AddEntity(std::move(*Entity)); } });
+			return;
+		}
+	}
+
 	if (FindChunk(a_Entity->GetChunkX(), a_Entity->GetChunkZ()) == nullptr)
 	{
 		LOGWARNING("%s: Entity at %p (%s, ID %d) spawning in a non-existent chunk.",
@@ -1080,6 +1207,8 @@ bool cChunkMap::DoWithBlockEntityAt(const Vector3i a_Position, cBlockEntityCallb
 {
 	const auto ChunkPosition = cChunkDef::BlockToChunk(a_Position);
 	const auto Relative = cChunkDef::AbsoluteToRelative(a_Position, ChunkPosition);
+	VerifyWritableByTickWorker(ChunkPosition);
+
 	cCSLock Lock(m_CSChunks);
 	const auto Chunk = FindChunk(ChunkPosition.m_ChunkX, ChunkPosition.m_ChunkZ);
 	if ((Chunk == nullptr) || !Chunk->IsValid())
@@ -1116,6 +1245,43 @@ void cChunkMap::PrepareChunk(int a_ChunkX, int a_ChunkZ, std::unique_ptr<cChunkC
 
 
 
+void cChunkMap::PrefetchChunks(const cChunkCoordsVector & a_Chunks)
+{
+	cCSLock Lock(m_CSChunks);
+	cChunkCoordsVector Evicted;
+	for (const auto & Coords : a_Chunks)
+	{
+		// The chunks already used by a client don't need prefetching:
+		const auto Chunk = FindChunk(Coords.m_ChunkX, Coords.m_ChunkZ);
+		if ((Chunk != nullptr) && Chunk->HasAnyClients())
+		{
+			continue;
+		}
+
+		if (m_PrefetchCache.Add(Coords, Evicted))
+		{
+			GetChunk(Coords.m_ChunkX, Coords.m_ChunkZ).Stay(true);  // Touches the chunk, loading or generating it
+		}
+	}
+	ReleasePrefetchedChunks(Evicted);
+}
+
+
+
+
+
+void cChunkMap::SetMaxPrefetchedChunks(const size_t a_MaxChunks)
+{
+	cCSLock Lock(m_CSChunks);
+	cChunkCoordsVector Evicted;
+	m_PrefetchCache.SetMaxChunks(a_MaxChunks, Evicted);
+	ReleasePrefetchedChunks(Evicted);
+}
+
+
+
+
+
 void cChunkMap::GenerateChunk(int a_ChunkX, int a_ChunkZ)
 {
 	cCSLock Lock(m_CSChunks);
@@ -1227,6 +1393,20 @@ bool cChunkMap::WriteBlockArea(cBlockArea & a_Area, int a_MinBlockX, int a_MinBl
 	cChunkDef::AbsoluteToRelative(MinBlockX, MinBlockY, MinBlockZ, MinChunkX, MinChunkZ);
 	cChunkDef::AbsoluteToRelative(MaxBlockX, MaxBlockY, MaxBlockZ, MaxChunkX, MaxChunkZ);
 
+	if (ms_TickWorker != nullptr)
+	{
+		// The caller may reuse the area right after we return, write a copy of it in the merge step:
+		auto Area = std::make_shared<cBlockArea>();
+		Area->CopyFrom(a_Area);
+		if (DeferOperation(
+			{ MinChunkX, MinChunkZ }, { MaxChunkX, MaxChunkZ },
+			[this, Area, a_MinBlockX, a_MinBlockY, a_MinBlockZ, a_DataTypes]() { WriteBlockArea(*Area, a_MinBlockX, a_MinBlockY, a_MinBlockZ, a_DataTypes); }
+		))
+		{
+			return true;
+		}
+	}
+
 	// Iterate over chunks, write data into each:
 	bool Result = true;
 	cCSLock Lock(m_CSChunks);
@@ -1270,10 +1450,24 @@ void cChunkMap::GetChunkStats(int & a_NumChunksValid, int & a_NumChunksDirty) co
 
 
 
+void cChunkMap::GetPrefetchStats(size_t & a_NumChunks, size_t & a_NumUsed, size_t & a_NumEvicted) const
+{
+	cCSLock Lock(m_CSChunks);
+	a_NumChunks = m_PrefetchCache.GetNumChunks();
+	a_NumUsed = m_PrefetchCache.GetNumUsed();
+	a_NumEvicted = m_PrefetchCache.GetNumEvicted();
+}
+
+
+
+
+
 int cChunkMap::GrowPlantAt(Vector3i a_BlockPos, int a_NumStages)
 {
 	auto chunkPos = cChunkDef::BlockToChunk(a_BlockPos);
 	auto relPos = cChunkDef::AbsoluteToRelative(a_BlockPos, chunkPos);
+	VerifyWritableByTickWorker(chunkPos);
+
 	cCSLock lock(m_CSChunks);
 	const auto Chunk = FindChunk(chunkPos.m_ChunkX, chunkPos.m_ChunkZ);
 	if ((Chunk == nullptr) || !Chunk->IsValid())
@@ -1345,15 +1539,26 @@ void cChunkMap::Tick(std::chrono::milliseconds a_Dt)
 	cCSLock Lock(m_CSChunks);
 
 	// Do the magic of updating the world:
-	for (auto & Chunk : m_Chunks)
+	if (m_ParallelTicking)
+	{
+		TickParallel(a_Dt);
+	}
+	else
 	{
-		Chunk.second.Tick(a_Dt);
+		for (auto & Chunk : m_Chunks)
+		{
+			Chunk.second.Tick(a_Dt);
+		}
 	}
 
 	// Finally, only after all chunks are ticked, tell the client about all aggregated changes:
+	if (m_SectionSerializer == nullptr)
+	{
+		m_SectionSerializer = std::make_unique<cChunkDataSerializer>(m_World->GetDimension());
+	}
 	for (auto & Chunk : m_Chunks)
 	{
-		Chunk.second.BroadcastPendingChanges();
+		Chunk.second.BroadcastPendingChanges(*m_SectionSerializer);
 	}
 }
 
@@ -1395,6 +1600,7 @@ void cChunkMap::UnloadUnusedChunks(void)
 			itr->second.OnUnload();
 
 			// Kill the chunk:
+			m_ChunkIndex.Erase(itr->first);
 			itr = m_Chunks.erase(itr);
 		}
 		else
@@ -1552,3 +1758,236 @@ void cChunkMap::DelChunkStay(cChunkStay & a_ChunkStay)
 	}  // for itr - Chunks[]
 	a_ChunkStay.OnDisabled();
 }
+
+
+
+
+
+void cChunkMap::ReleaseUsedPrefetchedChunk(cChunkCoords a_Coords)
+{
+	ASSERT(m_CSChunks.IsLockedByCurrentThread());
+	ASSERT(ms_TickWorker == nullptr);
+
+	if (m_PrefetchCache.Remove(a_Coords))
+	{
+		const auto Chunk = FindChunk(a_Coords.m_ChunkX, a_Coords.m_ChunkZ);
+		ASSERT(Chunk != nullptr);  // Stayed chunks cannot unload
+		Chunk->Stay(false);
+	}
+}
+
+
+
+
+
+void cChunkMap::ReleasePrefetchedChunks(const cChunkCoordsVector & a_Chunks)
+{
+	ASSERT(m_CSChunks.IsLockedByCurrentThread());
+
+	// Only release the stay, the regular unloading takes care of the chunks if nobody uses them:
+	for (const auto & Coords : a_Chunks)
+	{
+		const auto Chunk = FindChunk(Coords.m_ChunkX, Coords.m_ChunkZ);
+		ASSERT(Chunk != nullptr);  // Stayed chunks cannot unload
+		Chunk->Stay(false);
+	}
+}
+
+
+
+
+
+void cChunkMap::TickParallel(std::chrono::milliseconds a_Dt)
+{
+	ASSERT(m_CSChunks.IsLockedByCurrentThread());
+
+	// Sort the chunks by their tick phase and region; chunk order within a region stays the same as in m_Chunks:
+	struct sItem
+	{
+		int m_Phase;
+		cChunkCoords m_Region;
+		cChunk * m_Chunk;
+	};
+	std::vector<sItem> Items;
+	Items.reserve(m_Chunks.size());
+	for (auto & Chunk : m_Chunks)
+	{
+		const cChunkCoords Region(
+			ChunkToTickRegion(Chunk.first.m_ChunkX, TICK_REGION_SIZE),
+			ChunkToTickRegion(Chunk.first.m_ChunkZ, TICK_REGION_SIZE)
+		);
+		Items.push_back({ GetTickRegionPhase(Region), Region, &Chunk.second });
+	}
+	std::stable_sort(Items.begin(), Items.end(), [](const sItem & a_Lhs, const sItem & a_Rhs)
+	{
+		if (a_Lhs.m_Phase != a_Rhs.m_Phase)
+		{
+			return (a_Lhs.m_Phase < a_Rhs.m_Phase);
+		}
+		return (a_Lhs.m_Region < a_Rhs.m_Region);
+	});
+
+	// Split the sorted chunks into regions, noting where each phase starts:
+	std::array<size_t, 5> PhaseStart;
+	PhaseStart.fill(0);
+	m_TickOrder.clear();
+	m_TickRegions.clear();
+	for (const auto & Item : Items)
+	{
+		if (m_TickRegions.empty() || (m_TickRegions.back().m_Region != Item.m_Region))
+		{
+			m_TickRegions.push_back({ Item.m_Region, m_TickOrder.size(), m_TickOrder.size() });
+			PhaseStart[static_cast<size_t>(Item.m_Phase) + 1] = m_TickRegions.size();
+		}
+		m_TickOrder.push_back(Item.m_Chunk);
+		m_TickRegions.back().m_End = m_TickOrder.size();
+	}
+	for (size_t Phase = 1; Phase < PhaseStart.size(); Phase++)
+	{
+		// Phases without any regions start where the previous one ended:
+		PhaseStart[Phase] = std::max(PhaseStart[Phase], PhaseStart[Phase - 1]);
+	}
+
+	// Tick each phase's regions in parallel, then merge the deferred changes serially:
+	tbb::enumerable_thread_specific<sTickWorker> Workers;
+	for (size_t Phase = 0; Phase + 1 < PhaseStart.size(); Phase++)
+	{
+		// Isolated, so that the tick thread doesn't pick up unrelated tasks (lighting, storage, chunk sending) while waiting;
+		// these would lock m_CSChunks, which this thread owns, and access the chunks that the workers are ticking:
+		tbb::this_task_arena::isolate([this, &Workers, &PhaseStart, Phase, a_Dt]()
+			{
+				tbb::parallel_for(
+					tbb::blocked_range<size_t>(PhaseStart[Phase], PhaseStart[Phase + 1]),
+					[this, &Workers, a_Dt](const tbb::blocked_range<size_t> & a_Range)
+					{
+						auto & Worker = Workers.local();
+						for (size_t Idx = a_Range.begin(); Idx != a_Range.end(); ++Idx)
+						{
+							TickRegion(m_TickRegions[Idx], Worker, a_Dt);
+						}
+					}
+				);
+			}
+		);
+
+		for (auto & Worker : Workers)
+		{
+			MergeTickWorker(Worker);
+		}
+	}
+
+	// The players' client handles stream and unload chunks anywhere in the world, so tick them serially:
+	for (auto & Chunk : m_Chunks)
+	{
+		Chunk.second.TickPlayers(a_Dt);
+	}
+}
+
+
+
+
+
+void cChunkMap::TickRegion(const sTickRegion & a_Region, sTickWorker & a_Worker, std::chrono::milliseconds a_Dt)
+{
+	// The region's chunks and their direct neighbors are writable:
+	a_Worker.m_MinChunkX = a_Region.m_Region.m_ChunkX * TICK_REGION_SIZE - 1;
+	a_Worker.m_MaxChunkX = a_Region.m_Region.m_ChunkX * TICK_REGION_SIZE + TICK_REGION_SIZE;
+	a_Worker.m_MinChunkZ = a_Region.m_Region.m_ChunkZ * TICK_REGION_SIZE - 1;
+	a_Worker.m_MaxChunkZ = a_Region.m_Region.m_ChunkZ * TICK_REGION_SIZE + TICK_REGION_SIZE;
+
+	// The tick thread holds m_CSChunks for us for the entire duration of the parallel tick:
+	cCSBorrow Borrow(m_CSChunks);
+
+	// Tasks may be nested if a tick itself waits for the thread pool, restore the outer worker afterwards:
+	const auto PreviousWorker = ms_TickWorker;
+	ms_TickWorker = &a_Worker;
+	for (size_t Idx = a_Region.m_Begin; Idx != a_Region.m_End; ++Idx)
+	{
+		m_TickOrder[Idx]->Tick(a_Dt);
+	}
+	ms_TickWorker = PreviousWorker;
+}
+
+
+
+
+
+void cChunkMap::MergeTickWorker(sTickWorker & a_Worker)
+{
+	ASSERT(ms_TickWorker == nullptr);
+
+	for (const auto & Change : a_Worker.m_Changes)
+	{
+		switch (Change.m_Kind)
+		{
+			case sDeferredChange::eKind::SetBlock:     SetBlock    (Change.m_Position, Change.m_BlockType, Change.m_BlockMeta); break;
+			case sDeferredChange::eKind::FastSetBlock: FastSetBlock(Change.m_Position, Change.m_BlockType, Change.m_BlockMeta); break;
+			case sDeferredChange::eKind::SetMeta:      SetBlockMeta(Change.m_Position, Change.m_BlockMeta); break;
+			case sDeferredChange::eKind::Operation:    Change.m_Operation(); break;
+		}
+	}
+	a_Worker.m_Changes.clear();
+
+	for (auto & Move : a_Worker.m_EntityMoves)
+	{
+		Move.first->MoveEntityToNewChunk(std::move(Move.second));
+	}
+	a_Worker.m_EntityMoves.clear();
+}
+
+
+
+
+
+bool cChunkMap::DeferBlockChange(sDeferredChange::eKind a_Kind, Vector3i a_BlockPos, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta)
+{
+	const auto Worker = ms_TickWorker;
+	if ((Worker == nullptr) || Worker->IsWritable(cChunkDef::BlockToChunk(a_BlockPos)))
+	{
+		return false;
+	}
+
+	Worker->m_Changes.push_back({ a_Kind, a_BlockPos, a_BlockType, a_BlockMeta, {} });
+	return true;
+}
+
+
+
+
+
+bool cChunkMap::DeferOperation(cChunkCoords a_MinChunk, cChunkCoords a_MaxChunk, std::function<void()> a_Operation)
+{
+	const auto Worker = ms_TickWorker;
+	if ((Worker == nullptr) || Worker->IsWritable(a_MinChunk, a_MaxChunk))
+	{
+		return false;
+	}
+
+	Worker->m_Changes.push_back({ sDeferredChange::eKind::Operation, {}, E_BLOCK_AIR, 0, std::move(a_Operation) });
+	return true;
+}
+
+
+
+
+
+void cChunkMap::VerifyWritableByTickWorker(cChunkCoords a_Coords)
+{
+	const auto Worker = ms_TickWorker;
+	VERIFY((Worker == nullptr) || Worker->IsWritable(a_Coords));
+}
+
+
+
+
+
+void cChunkMap::MoveEntityFromChunk(cChunk & a_Chunk, OwnedEntity a_Entity)
+{
+	if (ms_TickWorker != nullptr)
+	{
+		ms_TickWorker->m_EntityMoves.emplace_back(&a_Chunk, std::move(a_Entity));
+		return;
+	}
+
+	a_Chunk.MoveEntityToNewChunk(std::move(a_Entity));
+}
@@ -5,7 +5,11 @@
 
 #pragma once
 
+#include <functional>
+
 #include "ChunkDataCallback.h"
+#include "ChunkIndex.h"
+#include "ChunkPrefetchCache.h"
 #include "EffectID.h"
 #include "FunctionRef.h"
 
@@ -17,6 +21,7 @@ class cItem;
 class cItems;
 class cChunkStay;
 class cChunk;
+class cChunkDataSerializer;
 class cPlayer;
 class cBlockArea;
 class cMobCensus;
@@ -39,6 +44,7 @@ class cChunkMap
 public:
 
 	cChunkMap(cWorld * a_World);
+	~cChunkMap();
 
 	/** Sends the block entity, if it is at the coords specified, to a_Client */
 	void SendBlockEntity(int a_BlockX, int a_BlockY, int a_BlockZ, cClientHandle & a_Client);
@@ -125,11 +131,13 @@ public:
 	EMCSBiome GetBiomeAt(int a_BlockX, int a_BlockZ) const;
 
 	/** Sets the biome at the specified coords. Returns true if successful, false if not (chunk not loaded).
-	Doesn't resend the chunk to clients. */
+	Doesn't resend the chunk to clients.
+	If deferred by the parallel chunk tick, see Tick(), returns true. */
 	bool SetBiomeAt(int a_BlockX, int a_BlockZ, EMCSBiome a_Biome);
 
 	/** Sets the biome at the area. Returns true if successful, false if any subarea failed (chunk not loaded).
-	(Re)sends the chunks to their relevant clients if successful. */
+	(Re)sends the chunks to their relevant clients if successful.
+	If deferred by the parallel chunk tick, see Tick(), returns true. */
 	bool SetAreaBiome(int a_MinX, int a_MaxX, int a_MinZ, int a_MaxZ, EMCSBiome a_Biome);
 
 	/** Retrieves block types and metas of the specified blocks.
@@ -139,7 +147,7 @@ public:
 
 	/** Removes the block at the specified coords and wakes up simulators.
 	Returns false if the chunk is not loaded (and the block is not dug).
-	Returns true if successful. */
+	Returns true if successful, or if deferred by the parallel chunk tick, see Tick(). */
 	bool DigBlock(Vector3i a_BlockPos);
 
 	/** Returns all the pickups that would result if the a_Digger dug up the block at a_BlockPos using a_Tool.
@@ -211,6 +219,13 @@ public:
 	It is legal to call without the callback. */
 	void PrepareChunk(int a_ChunkX, int a_ChunkZ, std::unique_ptr<cChunkCoordCallback> a_CallAfter = {});  // Lua-accessible
 
+	/** Loads or generates the specified chunks ahead of the clients needing them, and keeps them loaded for a while, see cChunkPrefetchCache.
+	The chunks already loaded are only marked as recently requested. Does nothing if prefetching is disabled. */
+	void PrefetchChunks(const cChunkCoordsVector & a_Chunks);
+
+	/** Sets the maximum number of prefetched chunks kept loaded without any client, zero disables prefetching. */
+	void SetMaxPrefetchedChunks(size_t a_MaxChunks);
+
 	/** Queues the chunk for generating.
 	First attempts to load the chunk from the storage. If that fails, queues the chunk for generating. */
 	void GenerateChunk(int a_ChunkX, int a_ChunkZ);  // Lua-accessible
@@ -229,12 +244,17 @@ public:
 	/** Calls the callback for each loaded chunk. Returns true if all chunks have been processed successfully */
 	bool ForEachLoadedChunk(cFunctionRef<bool(int, int)> a_Callback) const;
 
-	/** Writes the block area into the specified coords. Returns true if all chunks have been processed. Prefer cBlockArea::Write() instead. */
+	/** Writes the block area into the specified coords. Returns true if all chunks have been processed. Prefer cBlockArea::Write() instead.
+	If deferred by the parallel chunk tick, see Tick(), a copy of the area is written later and true is returned. */
 	bool WriteBlockArea(cBlockArea & a_Area, int a_MinBlockX, int a_MinBlockY, int a_MinBlockZ, int a_DataTypes);
 
 	/** Returns the number of valid chunks and the number of dirty chunks */
 	void GetChunkStats(int & a_NumChunksValid, int & a_NumChunksDirty) const;
 
+	/** Returns the stats of the prefetched chunks: the number waiting for a client, the number used by a client,
+	and the number evicted without having been used. */
+	void GetPrefetchStats(size_t & a_NumChunks, size_t & a_NumUsed, size_t & a_NumEvicted) const;
+
 	/** Grows the plant at the specified position by at most a_NumStages.
 	The block's Grow handler is invoked.
 	Returns the number of stages the plant has grown, 0 if not a plant. */
@@ -251,8 +271,24 @@ public:
 	/** Try to Spawn Monsters inside all Chunks */
 	void SpawnMobs(cMobSpawner & a_MobSpawner);
 
+	/** Ticks all the chunks, then broadcasts their pending changes to the clients.
+	If parallel ticking is enabled, the chunks are grouped into regions of TICK_REGION_SIZE x TICK_REGION_SIZE chunks,
+	and the regions are ticked in four phases, so that within a single phase no two regions are closer than
+	a whole region apart; the regions of one phase are then ticked in parallel on the thread pool.
+	Entities moving between chunks or spawning, and changes requested through the chunkmap beyond the direct
+	neighbors of the region being ticked, are deferred to a serial merge step at the end of each phase.
+	The operations that need to return their result immediately (callbacks, growing plants) abort if used that way. */
 	void Tick(std::chrono::milliseconds a_Dt);
 
+	/** Enables or disables ticking the chunks in parallel on the thread pool, see Tick(). */
+	void SetParallelTicking(bool a_ParallelTicking) { m_ParallelTicking = a_ParallelTicking; }
+
+	/** Sets the number of block changes within a single section in a tick, above which the whole section is resent instead. */
+	void SetSectionResendThreshold(size_t a_Threshold) { m_SectionResendThreshold = a_Threshold; }
+
+	/** Returns the number of block changes within a single section in a tick, above which the whole section is resent instead. */
+	size_t GetSectionResendThreshold(void) const { return m_SectionResendThreshold; }
+
 	/** Ticks a single block. Used by cWorld::TickQueuedBlocks() to tick the queued blocks */
 	void TickBlock(const Vector3i a_BlockPos);
 
@@ -294,12 +330,81 @@ private:
 
 	typedef std::list<cChunkStay *> cChunkStays;
 
+	/** The size of a region of chunks ticked as a single task in the parallel tick, in chunks. */
+	static const int TICK_REGION_SIZE = 3;
+
+	/** A change requested while ticking in parallel, postponed until the merge step. */
+	struct sDeferredChange
+	{
+		enum class eKind
+		{
+			SetBlock,
+			FastSetBlock,
+			SetMeta,
+			Operation,
+		};
+
+		eKind m_Kind;
+		Vector3i m_Position;
+		BLOCKTYPE m_BlockType;
+		NIBBLETYPE m_BlockMeta;
+
+		/** For eKind::Operation, the whole chunkmap call to be repeated in the merge step. */
+		std::function<void()> m_Operation;
+	};
+
+	/** The state of a single thread participating in the parallel tick. */
+	struct sTickWorker
+	{
+		/** Bounds of the chunks that may be written to directly by the region being ticked, inclusive.
+		These are the region's chunks and their direct neighbors. */
+		int m_MinChunkX, m_MaxChunkX, m_MinChunkZ, m_MaxChunkZ;
+
+		/** Changes that fell outside of the bounds, to be applied in the merge step, in the order they were requested. */
+		std::vector<sDeferredChange> m_Changes;
+
+		/** Entities that left their chunk, along with the chunk they left, to be moved in the merge step. */
+		std::vector<std::pair<cChunk *, OwnedEntity>> m_EntityMoves;
+
+		/** Returns true if the specified chunk may be written to directly by the region being ticked. */
+		bool IsWritable(cChunkCoords a_Coords) const
+		{
+			return (
+				(a_Coords.m_ChunkX >= m_MinChunkX) && (a_Coords.m_ChunkX <= m_MaxChunkX) &&
+				(a_Coords.m_ChunkZ >= m_MinChunkZ) && (a_Coords.m_ChunkZ <= m_MaxChunkZ)
+			);
+		}
+
+		/** Returns true if all the chunks in the specified rectangle (inclusive) may be written to directly by the region being ticked. */
+		bool IsWritable(cChunkCoords a_MinCoords, cChunkCoords a_MaxCoords) const
+		{
+			return IsWritable(a_MinCoords) && IsWritable(a_MaxCoords);
+		}
+	};
+
+	/** A contiguous range of m_TickOrder that belongs to a single region. */
+	struct sTickRegion
+	{
+		cChunkCoords m_Region;
+		size_t m_Begin, m_End;
+	};
+
+	/** The tick worker state of the current thread, nullptr if the thread isn't ticking a region in parallel. */
+	static thread_local sTickWorker * ms_TickWorker;
+
+	/** Returns true if the current thread is ticking a region in parallel. */
+	static bool IsTickWorker(void) { return (ms_TickWorker != nullptr); }
+
 	mutable cCriticalSection m_CSChunks;
 
 	/** A map of chunk coordinates to chunks.
-	Uses a map (as opposed to unordered_map) because sorted maps are apparently faster. */
+	Owns the chunks, keeping their addresses stable, and provides the iteration order; lookups use m_ChunkIndex instead. */
 	std::map<cChunkCoords, cChunk> m_Chunks;
 
+	/** A flat hash index of all the chunks in m_Chunks, for fast lookups by coords.
+	Updated whenever a chunk is added to or removed from m_Chunks. */
+	cChunkIndex<cChunk> m_ChunkIndex;
+
 	cEvent m_evtChunkValid;  // Set whenever any chunk becomes valid, via ChunkValidated()
 
 	cWorld * m_World;
@@ -307,8 +412,29 @@ private:
 	/** The cChunkStay descendants that are currently enabled in this chunkmap */
 	cChunkStays m_ChunkStays;
 
+	/** The chunks loaded ahead of the moving players, each of them stayed until used by a client or evicted. */
+	cChunkPrefetchCache m_PrefetchCache;
+
+	/** If true, the chunks are ticked in parallel on the thread pool, see Tick(). */
+	bool m_ParallelTicking;
+
+	/** The number of block changes within a single section in a tick, above which the whole section is resent instead, see cChunk::BroadcastPendingChanges(). */
+	size_t m_SectionResendThreshold;
+
+	/** The serializer for the resent sections, created on first use. Only used within Tick(). */
+	std::unique_ptr<cChunkDataSerializer> m_SectionSerializer;
+
+	/** The chunks to be ticked in parallel, grouped by their region, with the regions grouped by their tick phase.
+	Only used within Tick(), kept as a member to avoid reallocating each tick. */
+	std::vector<cChunk *> m_TickOrder;
+
+	/** The regions to be ticked in parallel, sorted by their tick phase, indexing into m_TickOrder.
+	Only used within Tick(), kept as a member to avoid reallocating each tick. */
+	std::vector<sTickRegion> m_TickRegions;
+
 	/** Returns or creates and returns a chunk pointer corresponding to the given chunk coordinates.
-	Emplaces this chunk in the chunk map. */
+	Emplaces this chunk in the chunk map.
+	Creating a chunk while ticking in parallel would invalidate the other workers' lookups, so it aborts instead. */
 	cChunk & ConstructChunk(int a_ChunkX, int a_ChunkZ);
 
 	/** Constructs a chunk and queues it for loading / generating if not valid, returning it */
@@ -328,4 +454,38 @@ private:
 	To be used only by cChunkStay; others should use cChunkStay::Disable() instead */
 	void DelChunkStay(cChunkStay & a_ChunkStay);
 
+	/** If the chunk is in m_PrefetchCache, removes it and releases its stay, because a client started using it.
+	Must not be called by a tick worker, the cache isn't guarded against the other workers. */
+	void ReleaseUsedPrefetchedChunk(cChunkCoords a_Coords);
+
+	/** Releases the stay of the chunks evicted from m_PrefetchCache. */
+	void ReleasePrefetchedChunks(const cChunkCoordsVector & a_Chunks);
+
+	/** Ticks all chunks in parallel, region by region, see Tick().
+	The players are ticked serially afterwards, see cChunk::TickPlayers(). */
+	void TickParallel(std::chrono::milliseconds a_Dt);
+
+	/** Ticks the chunks of a single region, on the current thread, as part of TickParallel(). */
+	void TickRegion(const sTickRegion & a_Region, sTickWorker & a_Worker, std::chrono::milliseconds a_Dt);
+
+	/** Applies the block changes and entity moves deferred by a tick worker, then clears them. */
+	void MergeTickWorker(sTickWorker & a_Worker);
+
+	/** If the current thread is ticking a region in parallel and the block is outside of its writable area,
+	queues the change for the merge step and returns true. Otherwise returns false and the caller should apply the change. */
+	bool DeferBlockChange(sDeferredChange::eKind a_Kind, Vector3i a_BlockPos, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta);
+
+	/** If the current thread is ticking a region in parallel and any of the chunks in the specified rectangle (inclusive)
+	is outside of its writable area, queues a_Operation for the merge step and returns true.
+	Otherwise returns false and the caller should carry out the operation itself. */
+	bool DeferOperation(cChunkCoords a_MinChunk, cChunkCoords a_MaxChunk, std::function<void()> a_Operation);
+
+	/** Aborts if the current thread is ticking a region in parallel and the chunk is outside of its writable area.
+	Used by the operations that cannot be deferred to the merge step, because their caller needs the result immediately. */
+	static void VerifyWritableByTickWorker(cChunkCoords a_Coords);
+
+	/** Moves an entity that has left a_Chunk into its new chunk.
+	While ticking in parallel, the move is deferred to the merge step, because the new chunk may need to be created. */
+	void MoveEntityFromChunk(cChunk & a_Chunk, OwnedEntity a_Entity);
+
 };
@@ -0,0 +1,90 @@
+// ChunkPrefetchCache.cpp
+
+// Implements the cChunkPrefetchCache class that keeps track of the chunks loaded ahead of the moving players
+
+#include "Globals.h"
+#include "ChunkPrefetchCache.h"
+
+
+
+
+
+cChunkPrefetchCache::cChunkPrefetchCache(const size_t a_MaxChunks) :
+	m_MaxChunks(a_MaxChunks),
+	m_NumUsed(0),
+	m_NumEvicted(0)
+{
+}
+
+
+
+
+
+bool cChunkPrefetchCache::Add(const cChunkCoords a_Chunk, cChunkCoordsVector & a_Evicted)
+{
+	if (m_MaxChunks == 0)
+	{
+		return false;
+	}
+
+	const auto Itr = m_Index.find(a_Chunk);
+	if (Itr != m_Index.end())
+	{
+		// Mark as the most recently requested:
+		m_Chunks.splice(m_Chunks.begin(), m_Chunks, Itr->second);
+		return false;
+	}
+
+	m_Chunks.push_front(a_Chunk);
+	m_Index.emplace(a_Chunk, m_Chunks.begin());
+	EvictOverLimit(a_Evicted);
+	return true;
+}
+
+
+
+
+
+bool cChunkPrefetchCache::Remove(const cChunkCoords a_Chunk)
+{
+	const auto Itr = m_Index.find(a_Chunk);
+	if (Itr == m_Index.end())
+	{
+		return false;
+	}
+
+	m_Chunks.erase(Itr->second);
+	m_Index.erase(Itr);
+	m_NumUsed += 1;
+	return true;
+}
+
+
+
+
+
+void cChunkPrefetchCache::SetMaxChunks(const size_t a_MaxChunks, cChunkCoordsVector & a_Evicted)
+{
+	m_MaxChunks = a_MaxChunks;
+	EvictOverLimit(a_Evicted);
+}
+
+
+
+
+
+void cChunkPrefetchCache::EvictOverLimit(cChunkCoordsVector & a_Evicted)
+{
+	while (m_Chunks.size() > m_MaxChunks)
+	{
+		const auto Chunk = m_Chunks.back();
+		a_Evicted.push_back(Chunk);
+		m_Index.erase(Chunk);
+		m_Chunks.pop_back();
+		m_NumEvicted += 1;
+	}
+}
+
+
+
+
@@ -0,0 +1,83 @@
+// ChunkPrefetchCache.h
+
+// Declares the cChunkPrefetchCache class that keeps track of the chunks loaded ahead of the moving players
+
+/*
+A player travelling fast (rails, horses, elytra) reaches the edge of its view distance sooner than the chunks
+there can be loaded from the disk or generated, so the chunks are requested from the storage only once they're
+needed right away. The chunks along the player's predicted path, just beyond the view distance, are therefore
+prefetched: loaded (or generated) into the chunkmap before any client asks for them, and kept there by a stay.
+
+This class only does the bookkeeping, the chunkmap does the staying. It holds the prefetched chunks in the order
+of their last request, and up to a set number of them; once over, the least recently requested ones are evicted,
+which only releases their stay, so that the regular unloading takes care of them if nobody has used them meanwhile.
+Once a client starts using a prefetched chunk, the chunk is released from the cache, the client keeps it loaded.
+*/
+
+
+
+
+
+#pragma once
+
+#include "ChunkDef.h"
+
+
+
+
+
+class cChunkPrefetchCache
+{
+public:
+
+	/** Creates a cache that holds up to the specified number of prefetched chunks. */
+	cChunkPrefetchCache(size_t a_MaxChunks);
+
+	/** Adds the chunk as the most recently requested one.
+	Returns true if the chunk wasn't in the cache yet, so that the caller should start staying it;
+	returns false if it was already there. The chunks evicted to make room are appended to a_Evicted, their stay should be released. */
+	bool Add(cChunkCoords a_Chunk, cChunkCoordsVector & a_Evicted);
+
+	/** Removes the chunk, because a client started using it.
+	Returns true if the chunk was in the cache, so that the caller should release its stay. */
+	bool Remove(cChunkCoords a_Chunk);
+
+	/** Sets the maximum number of chunks to hold. The chunks evicted to fit are appended to a_Evicted, their stay should be released. */
+	void SetMaxChunks(size_t a_MaxChunks, cChunkCoordsVector & a_Evicted);
+
+	/** Returns the maximum number of chunks to hold. Zero means that prefetching is disabled. */
+	size_t GetMaxChunks(void) const { return m_MaxChunks; }
+
+	/** Returns the number of chunks in the cache. */
+	size_t GetNumChunks(void) const { return m_Chunks.size(); }
+
+	/** Returns the number of prefetched chunks that were used by a client. */
+	size_t GetNumUsed(void) const { return m_NumUsed; }
+
+	/** Returns the number of prefetched chunks that were evicted without having been used. */
+	size_t GetNumEvicted(void) const { return m_NumEvicted; }
+
+protected:
+
+	using cChunks = std::list<cChunkCoords>;
+
+	/** The maximum number of chunks to hold. */
+	size_t m_MaxChunks;
+
+	/** The prefetched chunks, from the most recently requested to the least recently requested. */
+	cChunks m_Chunks;
+
+	/** The prefetched chunks by their coords. */
+	std::unordered_map<cChunkCoords, cChunks::iterator, cChunkCoordsHash> m_Index;
+
+	size_t m_NumUsed;
+	size_t m_NumEvicted;
+
+
+	/** Evicts the least recently requested chunks until there are at most m_MaxChunks, appending them to a_Evicted. */
+	void EvictOverLimit(cChunkCoordsVector & a_Evicted);
+};
+
+
+
+
@@ -0,0 +1,326 @@
+// ChunkSectionPool.cpp
+
+// Implements the cChunkSectionPool class that provides pooled memory for the chunk section storage arrays
+
+#include "Globals.h"
+#include "ChunkSectionPool.h"
+
+
+
+
+
+namespace
+{
+	/** The size of a single slab from which the blocks are carved out, in bytes. */
+	constexpr size_t SlabSize = 256 * 1024;
+
+	/** The maximum number of free blocks a single thread keeps per size class. */
+	constexpr size_t ThreadCacheSize = 64;
+
+	/** The number of blocks moved between a thread cache and the shared free list at once. */
+	constexpr size_t BatchSize = ThreadCacheSize / 2;
+
+	/** A free block, linked into a free list through its own memory. */
+	struct sFreeBlock
+	{
+		sFreeBlock * m_Next;
+	};
+
+
+
+
+
+	/** A single slab, with the list of its blocks that are free in the shared state. */
+	struct sSlab
+	{
+		std::unique_ptr<std::byte[]> m_Memory;
+
+		/** The slab's free blocks, not counting those sitting in the per-thread caches. */
+		sFreeBlock * m_FreeList = nullptr;
+		size_t m_NumFree = 0;
+
+		/** The index of the slab in sSizeClass::m_PartialSlabs, if it is there. */
+		size_t m_PartialIndex = 0;
+	};
+
+
+
+
+
+	/** The shared state of a single size class. */
+	struct sSizeClass
+	{
+		cCriticalSection m_CS;
+
+		/** All the slabs from which the blocks have been carved out, by their starting address. Protected by m_CS. */
+		std::map<const std::byte *, sSlab> m_Slabs;
+
+		/** The slabs that have some, but not all, of their blocks free, the blocks are taken from these first. Protected by m_CS. */
+		std::vector<sSlab *> m_PartialSlabs;
+
+		/** A slab with all its blocks free, kept so that a size class hovering around a slab boundary doesn't keep
+		releasing and allocating slabs. Any other slab that becomes entirely free is released. Protected by m_CS. */
+		sSlab * m_SpareSlab = nullptr;
+
+		/** The total number of free blocks in the slabs, excluding the per-thread caches. Protected by m_CS. */
+		size_t m_NumFree = 0;
+
+		std::atomic<size_t> m_NumInUse { 0 };
+		std::atomic<size_t> m_NumAllocations { 0 };
+		std::atomic<size_t> m_NumSlabsReleased { 0 };
+
+
+		/** Moves up to a_Count blocks from the shared free blocks into a_List, carving a new slab if there are none.
+		Returns the number of blocks moved. */
+		size_t TakeBatch(size_t a_BlockSize, size_t a_Count, sFreeBlock *& a_List)
+		{
+			cCSLock Lock(m_CS);
+			size_t NumTaken = 0;
+			while (NumTaken < a_Count)
+			{
+				if (m_PartialSlabs.empty())
+				{
+					if (m_SpareSlab != nullptr)
+					{
+						AddPartialSlab(*m_SpareSlab);
+						m_SpareSlab = nullptr;
+					}
+					else if (NumTaken == 0)
+					{
+						AddPartialSlab(CarveSlab(a_BlockSize));
+					}
+					else
+					{
+						break;
+					}
+				}
+
+				auto & Slab = *m_PartialSlabs.back();
+				while ((NumTaken < a_Count) && (Slab.m_FreeList != nullptr))
+				{
+					auto Block = Slab.m_FreeList;
+					Slab.m_FreeList = Block->m_Next;
+					Slab.m_NumFree -= 1;
+					Block->m_Next = a_List;
+					a_List = Block;
+					NumTaken += 1;
+				}
+				if (Slab.m_FreeList == nullptr)
+				{
+					m_PartialSlabs.pop_back();
+				}
+			}
+			m_NumFree -= NumTaken;
+			return NumTaken;
+		}
+
+
+		/** Moves a_Count blocks from the front of a_List back to their slabs.
+		Releases the slabs that become entirely free, except for a single spare one. */
+		void GiveBatch(size_t a_BlockSize, size_t a_Count, sFreeBlock *& a_List)
+		{
+			const auto BlocksPerSlab = SlabSize / a_BlockSize;
+			cCSLock Lock(m_CS);
+			for (size_t i = 0; (i < a_Count) && (a_List != nullptr); i++)
+			{
+				auto Block = a_List;
+				a_List = Block->m_Next;
+
+				// Find the slab containing the block, the last one starting at or before the block:
+				auto SlabItr = std::prev(m_Slabs.upper_bound(reinterpret_cast<const std::byte *>(Block)));
+				auto & Slab = SlabItr->second;
+				Block->m_Next = Slab.m_FreeList;
+				Slab.m_FreeList = Block;
+				Slab.m_NumFree += 1;
+				m_NumFree += 1;
+
+				if (Slab.m_NumFree == 1)
+				{
+					AddPartialSlab(Slab);
+				}
+				if (Slab.m_NumFree == BlocksPerSlab)
+				{
+					RemovePartialSlab(Slab);
+					if (m_SpareSlab == nullptr)
+					{
+						m_SpareSlab = &Slab;
+					}
+					else
+					{
+						m_NumFree -= BlocksPerSlab;
+						m_Slabs.erase(SlabItr);
+						m_NumSlabsReleased.fetch_add(1, std::memory_order_relaxed);
+					}
+				}
+			}
+		}
+
+
+		/** Allocates a new slab and links all its blocks into its free list. */
+		sSlab & CarveSlab(size_t a_BlockSize)
+		{
+			auto Memory = std::make_unique<std::byte[]>(SlabSize);
+			const auto Start = Memory.get();
+			auto & Slab = m_Slabs[Start];
+			Slab.m_Memory = std::move(Memory);
+			for (size_t Offset = 0; Offset + a_BlockSize <= SlabSize; Offset += a_BlockSize)
+			{
+				auto Block = reinterpret_cast<sFreeBlock *>(Start + Offset);
+				Block->m_Next = Slab.m_FreeList;
+				Slab.m_FreeList = Block;
+				Slab.m_NumFree += 1;
+			}
+			m_NumFree += Slab.m_NumFree;
+			return Slab;
+		}
+
+
+		void AddPartialSlab(sSlab & a_Slab)
+		{
+			a_Slab.m_PartialIndex = m_PartialSlabs.size();
+			m_PartialSlabs.push_back(&a_Slab);
+		}
+
+
+		void RemovePartialSlab(sSlab & a_Slab)
+		{
+			ASSERT(m_PartialSlabs[a_Slab.m_PartialIndex] == &a_Slab);
+			auto & Last = m_PartialSlabs.back();
+			Last->m_PartialIndex = a_Slab.m_PartialIndex;
+			m_PartialSlabs[a_Slab.m_PartialIndex] = Last;
+			m_PartialSlabs.pop_back();
+		}
+	};
+
+
+
+
+
+	/** Returns the shared state of all the size classes. */
+	std::array<sSizeClass, cChunkSectionPool::NumSizeClasses> & GetSizeClasses()
+	{
+		static std::array<sSizeClass, cChunkSectionPool::NumSizeClasses> SizeClasses;
+		return SizeClasses;
+	}
+
+
+
+
+
+	/** The per-thread cache of free blocks, returned to the shared free lists when the thread exits. */
+	struct sThreadCache
+	{
+		std::array<sFreeBlock *, cChunkSectionPool::NumSizeClasses> m_Lists {};
+		std::array<size_t, cChunkSectionPool::NumSizeClasses> m_Counts {};
+
+		~sThreadCache()
+		{
+			auto & SizeClasses = GetSizeClasses();
+			for (size_t Class = 0; Class < cChunkSectionPool::NumSizeClasses; Class++)
+			{
+				SizeClasses[Class].GiveBatch(cChunkSectionPool::SizeClasses[Class], m_Counts[Class], m_Lists[Class]);
+			}
+		}
+	};
+
+	thread_local sThreadCache ThreadCache;
+}  // namespace (anonymous)
+
+
+
+
+
+void * cChunkSectionPool::Allocate(const size_t a_Size)
+{
+	const auto Class = GetSizeClass(a_Size);
+	auto & SizeClass = GetSizeClasses()[Class];
+	auto & Cache = ThreadCache;
+
+	if (Cache.m_Lists[Class] == nullptr)
+	{
+		Cache.m_Counts[Class] += SizeClass.TakeBatch(a_Size, BatchSize, Cache.m_Lists[Class]);
+	}
+
+	auto Block = Cache.m_Lists[Class];
+	Cache.m_Lists[Class] = Block->m_Next;
+	Cache.m_Counts[Class] -= 1;
+
+	SizeClass.m_NumInUse.fetch_add(1, std::memory_order_relaxed);
+	SizeClass.m_NumAllocations.fetch_add(1, std::memory_order_relaxed);
+	return Block;
+}
+
+
+
+
+
+void cChunkSectionPool::Free(void * a_Block, const size_t a_Size)
+{
+	if (a_Block == nullptr)
+	{
+		return;
+	}
+
+	const auto Class = GetSizeClass(a_Size);
+	auto & SizeClass = GetSizeClasses()[Class];
+	auto & Cache = ThreadCache;
+
+	auto Block = static_cast<sFreeBlock *>(a_Block);
+	Block->m_Next = Cache.m_Lists[Class];
+	Cache.m_Lists[Class] = Block;
+	Cache.m_Counts[Class] += 1;
+	SizeClass.m_NumInUse.fetch_sub(1, std::memory_order_relaxed);
+
+	// Keep the cache bounded, blocks freed by a different thread than the one that allocated them would pile up otherwise:
+	if (Cache.m_Counts[Class] > ThreadCacheSize)
+	{
+		SizeClass.GiveBatch(a_Size, BatchSize, Cache.m_Lists[Class]);
+		Cache.m_Counts[Class] -= BatchSize;
+	}
+}
+
+
+
+
+
+cChunkSectionPool::cStats cChunkSectionPool::GetStats()
+{
+	cStats Stats;
+	auto & Classes = GetSizeClasses();
+	for (size_t Class = 0; Class < NumSizeClasses; Class++)
+	{
+		auto & SizeClass = Classes[Class];
+		auto & ClassStats = Stats[Class];
+		ClassStats.m_BlockSize = SizeClasses[Class];
+		{
+			cCSLock Lock(SizeClass.m_CS);
+			ClassStats.m_NumBlocksTotal = SizeClass.m_Slabs.size() * (SlabSize / ClassStats.m_BlockSize);
+			ClassStats.m_NumBlocksSharedFree = SizeClass.m_NumFree;
+		}
+		ClassStats.m_NumBlocksInUse = SizeClass.m_NumInUse.load(std::memory_order_relaxed);
+		ClassStats.m_NumAllocations = SizeClass.m_NumAllocations.load(std::memory_order_relaxed);
+		ClassStats.m_NumSlabsReleased = SizeClass.m_NumSlabsReleased.load(std::memory_order_relaxed);
+	}
+	return Stats;
+}
+
+
+
+
+
+size_t cChunkSectionPool::GetSizeClass(const size_t a_Size)
+{
+	for (size_t Class = 0; Class < NumSizeClasses; Class++)
+	{
+		if (SizeClasses[Class] == a_Size)
+		{
+			return Class;
+		}
+	}
+	ASSERT(!"Unsupported chunk section size");
+	return NumSizeClasses - 1;
+}
+
+
+
+
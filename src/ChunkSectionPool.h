@@ -0,0 +1,124 @@
+// ChunkSectionPool.h
+
+// Declares the cChunkSectionPool class that provides pooled memory for the chunk section storage arrays
+
+
+
+
+
+#pragma once
+
+
+
+
+
+/** A process-wide pool of fixed-size memory blocks for the chunk section arrays (block types, metas, lighting, palette indices).
+The memory is carved out of large slabs per size class, and freed blocks are kept for reuse instead of being returned to the heap,
+so that the constant churn of chunks loading and unloading doesn't fragment the heap.
+Each thread keeps a small cache of free blocks per size class, so that most allocations and frees don't need to lock;
+the caches exchange blocks with the shared free lists in batches.
+New blocks are taken from the partially used slabs first. Once all the blocks of a slab are back in the shared free lists,
+the slab is released to the heap, except for a single spare slab per size class. */
+class cChunkSectionPool
+{
+public:
+
+	/** The sizes of the blocks that can be allocated, in bytes. */
+	static constexpr size_t SizeClasses[] = { 512, 1024, 2048, 4096 };
+	static constexpr size_t NumSizeClasses = std::size(SizeClasses);
+
+	/** Statistics of a single size class. */
+	struct sClassStats
+	{
+		/** The size of the blocks in this class, in bytes. */
+		size_t m_BlockSize = 0;
+
+		/** The number of blocks in the slabs currently held by the pool, used or free. */
+		size_t m_NumBlocksTotal = 0;
+
+		/** The number of blocks currently handed out. */
+		size_t m_NumBlocksInUse = 0;
+
+		/** The number of free blocks in the shared free list; the rest of the free blocks sit in the per-thread caches. */
+		size_t m_NumBlocksSharedFree = 0;
+
+		/** The number of allocations served so far. */
+		size_t m_NumAllocations = 0;
+
+		/** The number of slabs released back to the heap so far. */
+		size_t m_NumSlabsReleased = 0;
+	};
+
+	using cStats = std::array<sClassStats, NumSizeClasses>;
+
+	/** Returns a block of memory of the specified size, which must be one of SizeClasses. */
+	static void * Allocate(size_t a_Size);
+
+	/** Returns the block to the pool. a_Size must be the size it was allocated with. */
+	static void Free(void * a_Block, size_t a_Size);
+
+	/** Returns the current statistics of all the size classes. */
+	static cStats GetStats();
+
+	/** Allocates a pooled object of type T, leaving it uninitialized. T must be trivial. */
+	template <typename T>
+	static T * AllocateForOverwrite()
+	{
+		static_assert(std::is_trivial_v<T>, "Only trivial types may be allocated from the chunk section pool");
+		#pragma push_macro("new")
+		#undef new
+		return new (Allocate(sizeof(T))) T;
+		#pragma pop_macro("new")
+	}
+
+
+	/** A deleter for std::unique_ptr that returns the object's memory to the pool. */
+	template <typename T>
+	struct cDeleter
+	{
+		void operator () (T * a_Object) const
+		{
+			Free(a_Object, sizeof(T));
+		}
+	};
+
+	/** A deleter for std::unique_ptr of a pooled byte array, remembering the size it was allocated with. */
+	struct cArrayDeleter
+	{
+		size_t m_Size = 0;
+
+		void operator () (UInt8 * a_Array) const
+		{
+			Free(a_Array, m_Size);
+		}
+	};
+
+private:
+
+	/** Returns the index into SizeClasses for the specified size. */
+	static size_t GetSizeClass(size_t a_Size);
+};
+
+/** A std::unique_ptr owning a pooled object. */
+template <typename T>
+using cPooledPtr = std::unique_ptr<T, cChunkSectionPool::cDeleter<T>>;
+
+/** A std::unique_ptr owning a pooled byte array. */
+using cPooledArrayPtr = std::unique_ptr<UInt8[], cChunkSectionPool::cArrayDeleter>;
+
+/** Allocates an uninitialized pooled object of type T. */
+template <typename T>
+cPooledPtr<T> MakePooledForOverwrite()
+{
+	return cPooledPtr<T>(cChunkSectionPool::AllocateForOverwrite<T>());
+}
+
+/** Allocates an uninitialized pooled byte array of the specified size, which must be one of the pool's size classes. */
+inline cPooledArrayPtr MakePooledArrayForOverwrite(size_t a_Size)
+{
+	return cPooledArrayPtr(static_cast<UInt8 *>(cChunkSectionPool::Allocate(a_Size)), cChunkSectionPool::cArrayDeleter{ a_Size });
+}
+
+
+
+
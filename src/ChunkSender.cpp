@@ -18,6 +18,16 @@
 
 
 
+namespace
+{
+	/** The maximum amount of the serialized chunk data kept in the cache for resending, in bytes. */
+	constexpr size_t SerializedChunkCacheSize = 64 MiB;
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // cNotifyChunkSender:
 
@@ -61,7 +71,8 @@ public:
 cChunkSender::cChunkSender(cWorld & a_World) :
 	Super("Chunk Sender"),
 	m_World(a_World),
-	m_Serializer(m_World.GetDimension())
+	m_Serializers(m_World.GetDimension()),
+	m_Cache(SerializedChunkCacheSize)
 {
 }
 
@@ -142,40 +153,104 @@ void cChunkSender::QueueSendChunkTo(int a_ChunkX, int a_ChunkZ, Priority a_Prior
 
 
 
+void cChunkSender::GetCacheStats(size_t & a_NumHits, size_t & a_NumMisses, size_t & a_MemoryUsed) const
+{
+	a_NumHits = m_Cache.GetNumHits();
+	a_NumMisses = m_Cache.GetNumMisses();
+	a_MemoryUsed = m_Cache.GetMemoryUsed();
+}
+
+
+
+
+
 void cChunkSender::Execute(void)
 {
 	while (!m_ShouldTerminate)
 	{
 		m_evtQueue.Wait();
 
-		if (m_ShouldTerminate)
-		{
-			return;
-		}
-
-		sChunkQueue ChunkQueue{};
-		while (m_SendChunks.try_pop(ChunkQueue))  // Take one from the queue
+		bool IsQueueEmpty = false;
+		while (!IsQueueEmpty)
 		{
-			const auto & Chunk = ChunkQueue.m_Chunk;
+			if (m_ShouldTerminate)
+			{
+				return;
+			}
 
-			ChunkInfoMap::iterator itr;
+			// Take a batch of chunks from the queue, in the order of their priority, and query their data.
+			// The batch is kept small so that the chunks queued with a higher priority meanwhile don't wait for long:
+			const auto MaxBatchSize = static_cast<size_t>(tbb::this_task_arena::max_concurrency());
+			std::vector<std::unique_ptr<cChunkData>> Batch;
+			while (Batch.size() < MaxBatchSize)
 			{
-				std::shared_lock<std::shared_mutex> Lock{m_ChunkInfoSharedMutex};
-				itr = m_ChunkInfo.find(Chunk);
-				if (itr == m_ChunkInfo.end())
+				sChunkQueue ChunkQueue{};
+				if (!m_SendChunks.try_pop(ChunkQueue))  // Take one from the queue
+				{
+					IsQueueEmpty = true;
+					break;
+				}
+				const auto & Chunk = ChunkQueue.m_Chunk;
+
+				ChunkInfoMap::iterator itr;
 				{
-					continue;
+					std::shared_lock<std::shared_mutex> Lock{m_ChunkInfoSharedMutex};
+					itr = m_ChunkInfo.find(Chunk);
+					if (itr == m_ChunkInfo.end())
+					{
+						continue;
+					}
+				}
+
+				cChunkSender::WeakClients clients;
+				{
+					std::unique_lock<std::shared_mutex> Lock{m_ChunkInfoSharedMutex};
+					clients = std::move(itr->second.m_Clients);
+					m_ChunkInfo.unsafe_erase(itr);
+				}
+
+				auto Data = PrepareChunk(Chunk, clients);
+				if (Data != nullptr)
+				{
+					Batch.push_back(std::move(Data));
 				}
 			}
 
-			cChunkSender::WeakClients clients;
+			// Serialize and compress the chunks in parallel, once for each protocol version their clients use, unless cached:
+			std::vector<std::pair<cChunkData *, size_t>> ToSerialize;
+			for (const auto & Data : Batch)
+			{
+				for (size_t Version = 0; Version < cChunkDataSerializer::NumCacheVersions; Version++)
+				{
+					if (Data->m_IsVersionUsed[Version] && (Data->m_Serialized[Version] == nullptr))
+					{
+						ToSerialize.emplace_back(Data.get(), Version);
+					}
+				}
+			}
+			tbb::task_group Tasks;
+			for (const auto & [Data, Version] : ToSerialize)
 			{
-				std::unique_lock<std::shared_mutex> Lock{m_ChunkInfoSharedMutex};
-				clients = std::move(itr->second.m_Clients);
-				m_ChunkInfo.unsafe_erase(itr);
+				Tasks.run([this, &ChunkData = *Data, Version = Version]
+				{
+					ChunkData.m_Serialized[Version] = std::make_shared<const ContiguousByteBuffer>(m_Serializers.local().Serialize(
+						static_cast<cChunkDataSerializer::CacheVersion>(Version),
+						ChunkData.m_Chunk.m_ChunkX, ChunkData.m_Chunk.m_ChunkZ,
+						ChunkData.m_BlockData, ChunkData.m_LightData, ChunkData.m_BiomeMap
+					));
+				});
+			}
+			Tasks.wait();
+			for (const auto & [Data, Version] : ToSerialize)
+			{
+				m_Cache.Insert(Data->m_Chunk, Version, Data->m_DataVersion, Data->m_Serialized[Version]);
 			}
 
-			SendChunk(Chunk.m_ChunkX, Chunk.m_ChunkZ, clients);
+			// Send in the order the chunks were taken from the queue:
+			for (const auto & Data : Batch)
+			{
+				SendChunk(*Data);
+			}
 		}
 	}  // while (!m_ShouldTerminate)
 }
@@ -184,8 +259,11 @@ void cChunkSender::Execute(void)
 
 
 
-void cChunkSender::SendChunk(int a_ChunkX, int a_ChunkZ, const WeakClients & a_Clients)
+std::unique_ptr<cChunkSender::cChunkData> cChunkSender::PrepareChunk(const cChunkCoords a_Chunk, const WeakClients & a_Clients)
 {
+	const auto a_ChunkX = a_Chunk.m_ChunkX;
+	const auto a_ChunkZ = a_Chunk.m_ChunkZ;
+
 	// Contains strong pointers to clienthandles.
 	std::vector<std::shared_ptr<cClientHandle>> Clients;
 
@@ -202,47 +280,60 @@ void cChunkSender::SendChunk(int a_ChunkX, int a_ChunkZ, const WeakClients & a_C
 	// Bail early if every requester disconnected:
 	if (Clients.empty())
 	{
-		return;
+		return nullptr;
 	}
 
 	// If the chunk has no clients, no need to packetize it:
 	if (!m_World.HasChunkAnyClients(a_ChunkX, a_ChunkZ))
 	{
-		return;
+		return nullptr;
 	}
 
 	// If the chunk is not valid, do nothing - whoever needs it has queued it for loading / generating
 	if (!m_World.IsChunkValid(a_ChunkX, a_ChunkZ))
 	{
-		return;
+		return nullptr;
 	}
 
 	// If the chunk is not lighted, queue it for relighting and get notified when it's ready:
 	if (!m_World.IsChunkLighted(a_ChunkX, a_ChunkZ))
 	{
 		m_World.QueueLightChunk(a_ChunkX, a_ChunkZ, std::make_unique<cNotifyChunkSender>(*this, m_World));
-		return;
+		return nullptr;
 	}
 
 	// Query and prepare chunk data:
-	if (!m_World.GetChunkData({a_ChunkX, a_ChunkZ}, *this))
+	auto Data = std::make_unique<cChunkData>(a_Chunk, std::move(Clients), m_Cache);
+	if (!m_World.GetChunkData(a_Chunk, *Data))
 	{
-		return;
+		return nullptr;
 	}
+	return Data;
+}
 
-	// Send:
-	m_Serializer.SendToClients(a_ChunkX, a_ChunkZ, m_BlockData, m_LightData, m_BiomeMap, Clients);
 
-	for (const auto & Client : Clients)
+
+
+
+void cChunkSender::SendChunk(const cChunkData & a_Data)
+{
+	const auto a_ChunkX = a_Data.m_Chunk.m_ChunkX;
+	const auto a_ChunkZ = a_Data.m_Chunk.m_ChunkZ;
+
+	for (const auto & Client : a_Data.m_Clients)
 	{
+		// Send the chunk itself:
+		const auto Version = cChunkDataSerializer::GetCacheVersion(Client->GetProtocolVersion());
+		Client->SendChunkData(a_ChunkX, a_ChunkZ, a_Data.m_Serialized[static_cast<size_t>(Version)]);
+
 		// Send block-entity packets:
-		for (const auto & Pos : m_BlockEntities)
+		for (const auto & Pos : a_Data.m_BlockEntities)
 		{
 			m_World.SendBlockEntity(Pos.x, Pos.y, Pos.z, *Client);
 		}  // for itr - m_Packets[]
 
 		// Send entity packets:
-		for (const auto EntityID : m_EntityIDs)
+		for (const auto EntityID : a_Data.m_EntityIDs)
 		{
 			m_World.DoWithEntityByID(EntityID, [Client](cEntity & a_Entity)
 			{
@@ -269,16 +360,52 @@ void cChunkSender::SendChunk(int a_ChunkX, int a_ChunkZ, const WeakClients & a_C
 			});
 		}
 	}
+}
+
 
-	m_BlockEntities.clear();
-	m_EntityIDs.clear();
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cChunkSender::cChunkData:
+
+cChunkSender::cChunkData::cChunkData(const cChunkCoords a_Chunk, std::vector<std::shared_ptr<cClientHandle>> && a_Clients, cSerializedChunkCache & a_Cache) :
+	m_Chunk(a_Chunk),
+	m_Clients(std::move(a_Clients)),
+	m_Cache(a_Cache)
+{
+	for (const auto & Client : m_Clients)
+	{
+		m_IsVersionUsed[static_cast<size_t>(cChunkDataSerializer::GetCacheVersion(Client->GetProtocolVersion()))] = true;
+	}
+}
+
+
+
+
+
+bool cChunkSender::cChunkData::DataVersion(const UInt64 a_DataVersion)
+{
+	m_DataVersion = a_DataVersion;
+
+	// Take whatever has been serialized from this very data from the cache, the data is only needed for the rest:
+	bool IsAllCached = true;
+	for (size_t Version = 0; Version < cChunkDataSerializer::NumCacheVersions; Version++)
+	{
+		if (m_IsVersionUsed[Version])
+		{
+			m_Serialized[Version] = m_Cache.Find(m_Chunk, Version, a_DataVersion);
+			IsAllCached = IsAllCached && (m_Serialized[Version] != nullptr);
+		}
+	}
+	return !IsAllCached;
 }
 
 
 
 
 
-void cChunkSender::BlockEntity(cBlockEntity * a_Entity)
+void cChunkSender::cChunkData::BlockEntity(cBlockEntity * a_Entity)
 {
 	m_BlockEntities.push_back(a_Entity->GetPos());
 }
@@ -287,7 +414,7 @@ void cChunkSender::BlockEntity(cBlockEntity * a_Entity)
 
 
 
-void cChunkSender::Entity(cEntity * a_Entity)
+void cChunkSender::cChunkData::Entity(cEntity * a_Entity)
 {
 	m_EntityIDs.push_back(a_Entity->GetUniqueID());
 }
@@ -296,7 +423,7 @@ void cChunkSender::Entity(cEntity * a_Entity)
 
 
 
-void cChunkSender::BiomeMap(const cChunkDef::BiomeMap & a_BiomeMap)
+void cChunkSender::cChunkData::BiomeMap(const cChunkDef::BiomeMap & a_BiomeMap)
 {
 	for (size_t i = 0; i < ARRAYCOUNT(m_BiomeMap); i++)
 	{
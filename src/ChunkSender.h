@@ -12,10 +12,18 @@ And once they do, it requests the chunk data and sends it all away, either
 	broadcasting (ChunkReady), or
 	sends to a specific client (QueueSendChunkTo)
 Chunk data is queried using the cChunkDataCallback interface.
-It is cached inside the ChunkSender object during the query and then processed after the query ends.
+It is cached inside a cChunkData object during the query and then processed after the query ends.
 Note that the data needs to be compressed only after the query finishes,
 because the query callbacks run with ChunkMap's CS locked.
 
+The chunks are taken from the queue in batches, in the order of their priority. The data for the whole batch
+is queried on the sender thread, then the chunks are serialized and compressed in parallel on the TBB pool,
+one task per chunk and protocol version, each worker using its own serializer. Finally the sender thread
+sends the batch in the order in which it was taken from the queue, so that each client receives its chunks
+in the same order as if they were processed one by one.
+The serialized chunks are kept in a cSerializedChunkCache; a chunk that hasn't changed since it was last serialized
+for a protocol version is sent from the cache without even querying its block data.
+
 A client may remove itself from all direct requests(QueueSendChunkTo()) by calling RemoveClient();
 this ensures that the client's Send() won't be called anymore by ChunkSender.
 Note that it may be called by world's BroadcastToChunk() if the client is still in the chunk.
@@ -30,6 +38,7 @@ Note that it may be called by world's BroadcastToChunk() if the client is still
 #include "OSSupport/IsThread.h"
 #include "ChunkDataCallback.h"
 #include "Protocol/ChunkDataSerializer.h"
+#include "SerializedChunkCache.h"
 #include "TBBWrapper.h"
 
 
@@ -51,8 +60,7 @@ class cChunkSender;
 
 
 class cChunkSender final :
-	public cIsThread,
-	public cChunkDataCopyCollector
+	public cIsThread
 {
 	using Super = cIsThread;
 
@@ -77,6 +85,9 @@ public:
 	void QueueSendChunkTo(int a_ChunkX, int a_ChunkZ, Priority a_Priority, cClientHandle * a_Client);
 	void QueueSendChunkTo(int a_ChunkX, int a_ChunkZ, Priority a_Priority, const std::vector<cClientHandle *> & a_Clients);
 
+	/** Returns the stats of the cache of the serialized chunks: the number of hits and misses, and the amount of data held, in bytes. */
+	void GetCacheStats(size_t & a_NumHits, size_t & a_NumMisses, size_t & a_MemoryUsed) const;
+
 protected:
 
 	using WeakClients = std::set<std::weak_ptr<cClientHandle>, std::owner_less<std::weak_ptr<cClientHandle>>>;
@@ -107,35 +118,72 @@ protected:
 		}
 	};
 
+	/** The data of a single chunk being sent, queried from the world and serialized for the protocol versions of its clients. */
+	class cChunkData :
+		public cChunkDataCopyCollector
+	{
+	public:
+
+		cChunkData(cChunkCoords a_Chunk, std::vector<std::shared_ptr<cClientHandle>> && a_Clients, cSerializedChunkCache & a_Cache);
+
+		cChunkCoords m_Chunk;
+
+		/** The clients to which the chunk is sent. */
+		std::vector<std::shared_ptr<cClientHandle>> m_Clients;
+
+		/** Flags for the versions, indexed by cChunkDataSerializer::CacheVersion, that the clients use. */
+		std::array<bool, cChunkDataSerializer::NumCacheVersions> m_IsVersionUsed {};
+
+		/** The version of the chunk's data that has been queried. */
+		UInt64 m_DataVersion = 0;
+
+		// Data about the chunk being sent:
+		// NOTE that m_BlockData and m_LightData are inherited from the cChunkDataCopyCollector
+		unsigned char m_BiomeMap[cChunkDef::Width * cChunkDef::Width];
+		std::vector<Vector3i> m_BlockEntities;  // Coords of the block entities to send
+		std::vector<UInt32> m_EntityIDs;        // Entity-IDs of the entities to send
+
+		/** The serialized chunk for each version used by the clients, indexed by cChunkDataSerializer::CacheVersion.
+		Filled from the cache when querying the data, the rest when serializing. Empty for the versions that no client uses. */
+		std::array<cSerializedChunkCache::cData, cChunkDataSerializer::NumCacheVersions> m_Serialized;
+
+	protected:
+
+		/** The cache of the serialized chunks, consulted once the data version is known. */
+		cSerializedChunkCache & m_Cache;
+
+		// cChunkDataCollector overrides:
+		// (Note that they are called while the ChunkMap's CS is locked - don't do heavy calculations here!)
+		virtual bool DataVersion  (UInt64 a_DataVersion) override;
+		virtual void BiomeMap     (const cChunkDef::BiomeMap & a_BiomeMap) override;
+		virtual void Entity       (cEntity *      a_Entity) override;
+		virtual void BlockEntity  (cBlockEntity * a_Entity) override;
+	};
+
 	using ChunkInfoMap = tbb::concurrent_unordered_map<cChunkCoords, sSendChunk, cChunkCoordsHash>;
 
 	cWorld & m_World;
 
-	/** An instance of a chunk serializer, held to maintain its internal cache. */
-	cChunkDataSerializer m_Serializer;
+	/** The chunk serializers, one per thread that serializes chunks, each held to maintain its internal buffers. */
+	tbb::enumerable_thread_specific<cChunkDataSerializer> m_Serializers;
+
+	/** The recently serialized chunks. Only accessed from the sender thread. */
+	cSerializedChunkCache m_Cache;
 
 	mutable std::shared_mutex m_ChunkInfoSharedMutex;
 	tbb::concurrent_priority_queue<sChunkQueue> m_SendChunks;
 	ChunkInfoMap m_ChunkInfo;
 	cEvent m_evtQueue;  // Set when anything is added to m_ChunksReady
 
-	// Data about the chunk that is being sent:
-	// NOTE that m_BlockData[] is inherited from the cChunkDataCollector
-	unsigned char m_BiomeMap[cChunkDef::Width * cChunkDef::Width];
-	std::vector<Vector3i> m_BlockEntities;  // Coords of the block entities to send
-	std::vector<UInt32> m_EntityIDs;        // Entity-IDs of the entities to send
-
 	// cIsThread override:
 	virtual void Execute(void) override;
 
-	// cChunkDataCollector overrides:
-	// (Note that they are called while the ChunkMap's CS is locked - don't do heavy calculations here!)
-	virtual void BiomeMap     (const cChunkDef::BiomeMap & a_BiomeMap) override;
-	virtual void Entity       (cEntity *      a_Entity) override;
-	virtual void BlockEntity  (cBlockEntity * a_Entity) override;
+	/** Queries the data of the specified chunk to be sent to the specified clients.
+	Returns nullptr if the chunk is not to be sent (now). */
+	std::unique_ptr<cChunkData> PrepareChunk(cChunkCoords a_Chunk, const WeakClients & a_Clients);
 
-	/** Sends the specified chunk to all the specified clients */
-	void SendChunk(int a_ChunkX, int a_ChunkZ, const WeakClients & a_Clients);
+	/** Sends the serialized chunk to all its clients, followed by its block entities and entities. */
+	void SendChunk(const cChunkData & a_Data);
 } ;
 
 
@@ -0,0 +1,308 @@
+// ChunkStreamer.cpp
+
+// Implements the cChunkStreamer class that decides which chunks are streamed to a client next
+
+#include "Globals.h"
+#include "ChunkStreamer.h"
+
+
+
+
+
+/** How far ahead the player's movement is predicted, in seconds. */
+static const double PREDICTION_TIME = 3;
+
+/** The chunks around the predicted position are treated as this many chunks further away than around the actual one,
+so that the immediate surroundings still go first. */
+static const double PREDICTION_PENALTY = 1;
+
+/** The movement faster than this, in blocks per second, is considered a teleport rather than movement. */
+static const double MAX_TRAVEL_SPEED = 200;
+
+/** The time it takes the budget to fill up from empty, in seconds. */
+static const double BURST_TIME = 0.25;
+
+/** The speed above which the chunks along the player's path are prefetched, in blocks per second. Sprinting is about 5.6. */
+static const double PREFETCH_MIN_SPEED = 8;
+
+/** How far ahead of the player the chunks are prefetched, in seconds of travel. */
+static const double PREFETCH_TIME = 10;
+
+/** How far beyond the view distance the chunks are prefetched at most, in chunks. */
+static const int PREFETCH_DISTANCE = 6;
+
+/** The half-width of the band of chunks prefetched along the path, in chunks, to allow for turns. */
+static const int PREFETCH_RADIUS = 1;
+
+/** The chunk packet size assumed before any has been sent, in bytes. */
+static const size_t INITIAL_CHUNK_SIZE = 8 KiB;
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cChunkStreamer:
+
+std::atomic<size_t> cChunkStreamer::ms_BytesPerSecond { 4 MiB };
+
+
+
+
+
+cChunkStreamer::cChunkStreamer(void) :
+	m_Center(0, 0),
+	m_ViewDistance(-1),
+	m_LastPrefetchCenter(std::numeric_limits<int>::max(), std::numeric_limits<int>::max()),
+	m_HasPosition(false),
+	m_Budget(0),
+	m_AverageChunkSize(INITIAL_CHUNK_SIZE)
+{
+}
+
+
+
+
+
+void cChunkStreamer::SetBandwidth(const size_t a_BytesPerSecond)
+{
+	ms_BytesPerSecond = a_BytesPerSecond;
+}
+
+
+
+
+
+void cChunkStreamer::Tick(const std::chrono::milliseconds a_Dt, const Vector3d a_Position, const Vector3d a_LookVector)
+{
+	const auto Seconds = std::chrono::duration<double>(a_Dt).count();
+
+	// Update the velocity, ignoring the vertical movement, and teleports:
+	const Vector3d Position(a_Position.x, 0, a_Position.z);
+	if (m_HasPosition && (Seconds > 0))
+	{
+		const auto Velocity = (Position - m_Position) / Seconds;
+		if (Velocity.Length() > MAX_TRAVEL_SPEED)
+		{
+			m_Velocity = Vector3d();
+		}
+		else
+		{
+			m_Velocity = m_Velocity * 0.7 + Velocity * 0.3;
+		}
+	}
+	m_Position = Position;
+	m_HasPosition = true;
+
+	const Vector3d LookVector(a_LookVector.x, 0, a_LookVector.z);
+	m_LookVector = LookVector.HasNonZeroLength() ? LookVector.NormalizeCopy() : Vector3d();
+
+	m_Budget = std::min(m_Budget + static_cast<double>(ms_BytesPerSecond) * Seconds, GetBurstLimit());
+}
+
+
+
+
+
+void cChunkStreamer::UpdateFrontier(const cChunkCoords a_Center, const int a_ViewDistance, cFunctionRef<bool(cChunkCoords)> a_IsKnown)
+{
+	const auto IsInRange = [](const cChunkCoords a_Chunk, const cChunkCoords a_RangeCenter, const int a_Range)
+	{
+		return (
+			(std::abs(a_Chunk.m_ChunkX - a_RangeCenter.m_ChunkX) <= a_Range) &&
+			(std::abs(a_Chunk.m_ChunkZ - a_RangeCenter.m_ChunkZ) <= a_Range)
+		);
+	};
+
+	const bool IsRebuilding = (m_ViewDistance != a_ViewDistance);
+	if (!IsRebuilding && (a_Center == m_Center))
+	{
+		return;
+	}
+
+	if (IsRebuilding)
+	{
+		m_Frontier.clear();
+	}
+	else
+	{
+		m_Frontier.erase(
+			std::remove_if(m_Frontier.begin(), m_Frontier.end(), [&](const cChunkCoords a_Chunk)
+			{
+				return !IsInRange(a_Chunk, a_Center, a_ViewDistance);
+			}),
+			m_Frontier.end()
+		);
+	}
+
+	// Add the chunks that weren't in the previous range:
+	for (int z = a_Center.m_ChunkZ - a_ViewDistance; z <= a_Center.m_ChunkZ + a_ViewDistance; z++)
+	{
+		for (int x = a_Center.m_ChunkX - a_ViewDistance; x <= a_Center.m_ChunkX + a_ViewDistance; x++)
+		{
+			const cChunkCoords Chunk(x, z);
+			if (!IsRebuilding && IsInRange(Chunk, m_Center, m_ViewDistance))
+			{
+				continue;
+			}
+			if (!a_IsKnown(Chunk))
+			{
+				m_Frontier.push_back(Chunk);
+			}
+		}
+	}
+
+	m_Center = a_Center;
+	m_ViewDistance = a_ViewDistance;
+}
+
+
+
+
+
+void cChunkStreamer::Reset(void)
+{
+	m_Frontier.clear();
+	m_ViewDistance = -1;
+	m_LastPrefetchCenter = cChunkCoords(std::numeric_limits<int>::max(), std::numeric_limits<int>::max());
+}
+
+
+
+
+
+void cChunkStreamer::TakeNextChunks(std::vector<sChunk> & a_Chunks)
+{
+	const auto ChunkSize = static_cast<double>(m_AverageChunkSize.load());
+	const auto Count = std::min(static_cast<size_t>(m_Budget / ChunkSize), m_Frontier.size());
+	if (Count == 0)
+	{
+		return;
+	}
+
+	// Score the whole frontier, then pick the best ones:
+	std::vector<std::pair<double, sChunk>> Scored;
+	Scored.reserve(m_Frontier.size());
+	for (const auto & Chunk : m_Frontier)
+	{
+		sChunk Candidate { Chunk, 0, false };
+		const auto Priority = GetPriority(Candidate);
+		Scored.emplace_back(Priority, Candidate);
+	}
+	const auto IsSooner = [](const std::pair<double, sChunk> & a_Lhs, const std::pair<double, sChunk> & a_Rhs)
+	{
+		return (a_Lhs.first < a_Rhs.first);
+	};
+	std::partial_sort(Scored.begin(), Scored.begin() + static_cast<std::ptrdiff_t>(Count), Scored.end(), IsSooner);
+
+	// Move the rest back into the frontier:
+	m_Frontier.clear();
+	for (size_t i = 0; i < Scored.size(); i++)
+	{
+		if (i < Count)
+		{
+			a_Chunks.push_back(Scored[i].second);
+		}
+		else
+		{
+			m_Frontier.push_back(Scored[i].second.m_Chunk);
+		}
+	}
+
+	m_Budget -= static_cast<double>(Count) * ChunkSize;
+}
+
+
+
+
+
+void cChunkStreamer::GetPrefetchChunks(cChunkCoordsVector & a_Chunks)
+{
+	if ((m_ViewDistance < 0) || (m_Center == m_LastPrefetchCenter))
+	{
+		return;
+	}
+	m_LastPrefetchCenter = m_Center;
+
+	const auto Speed = m_Velocity.Length();
+	if (Speed < PREFETCH_MIN_SPEED)
+	{
+		return;
+	}
+
+	// Walk the path from the edge of the view distance, in half-chunk steps, and take the band of chunks around it that are out of range:
+	const auto Direction = m_Velocity / Speed;
+	const auto MaxTravel = std::min(Speed * PREFETCH_TIME, static_cast<double>((m_ViewDistance + PREFETCH_DISTANCE) * cChunkDef::Width));
+	const auto NumChunks = a_Chunks.size();
+	for (auto Travel = static_cast<double>(m_ViewDistance * cChunkDef::Width); Travel <= MaxTravel; Travel += cChunkDef::Width / 2)
+	{
+		const auto Point = m_Position + Direction * Travel;
+		const auto PointChunk = cChunkDef::BlockToChunk({ FloorC(Point.x), 0, FloorC(Point.z) });
+		for (int z = PointChunk.m_ChunkZ - PREFETCH_RADIUS; z <= PointChunk.m_ChunkZ + PREFETCH_RADIUS; z++)
+		{
+			for (int x = PointChunk.m_ChunkX - PREFETCH_RADIUS; x <= PointChunk.m_ChunkX + PREFETCH_RADIUS; x++)
+			{
+				if ((std::abs(x - m_Center.m_ChunkX) > m_ViewDistance) || (std::abs(z - m_Center.m_ChunkZ) > m_ViewDistance))
+				{
+					a_Chunks.emplace_back(x, z);
+				}
+			}
+		}
+	}
+
+	// The neighboring steps overlap:
+	const auto Begin = a_Chunks.begin() + static_cast<std::ptrdiff_t>(NumChunks);
+	std::sort(Begin, a_Chunks.end());
+	a_Chunks.erase(std::unique(Begin, a_Chunks.end()), a_Chunks.end());
+}
+
+
+
+
+
+void cChunkStreamer::ChunkSent(const size_t a_Size)
+{
+	// A running average over roughly the last 8 chunks; the races between threads only lose an update:
+	const auto Average = m_AverageChunkSize.load();
+	m_AverageChunkSize = std::max<size_t>((Average * 7 + a_Size) / 8, 1);
+}
+
+
+
+
+
+double cChunkStreamer::GetPriority(sChunk & a_Chunk) const
+{
+	const Vector3d ChunkCenter(
+		a_Chunk.m_Chunk.m_ChunkX * cChunkDef::Width + cChunkDef::Width / 2,
+		0,
+		a_Chunk.m_Chunk.m_ChunkZ * cChunkDef::Width + cChunkDef::Width / 2
+	);
+	const auto ToChunk = ChunkCenter - m_Position;
+	a_Chunk.m_Distance = ToChunk.Length() / cChunkDef::Width;
+
+	// The chunks around the predicted position, which is kept within the view distance:
+	auto Movement = m_Velocity * PREDICTION_TIME;
+	const auto MaxMovement = static_cast<double>(std::max(m_ViewDistance, 0) * cChunkDef::Width);
+	if (Movement.Length() > MaxMovement)
+	{
+		Movement = Movement.NormalizeCopy() * MaxMovement;
+	}
+	const auto PredictedDistance = (ChunkCenter - m_Position - Movement).Length() / cChunkDef::Width + PREDICTION_PENALTY;
+
+	// The chunks in the look direction get up to half the distance, the ones behind up to twice as much:
+	const auto Facing = (a_Chunk.m_Distance > 0) ? (ToChunk.Dot(m_LookVector) / ToChunk.Length()) : 1;
+	a_Chunk.m_IsAhead = ((Facing > 0.7) || (PredictedDistance < a_Chunk.m_Distance));
+
+	return std::min(a_Chunk.m_Distance, PredictedDistance) * (1.25 - 0.75 * Facing);
+}
+
+
+
+
+
+double cChunkStreamer::GetBurstLimit(void) const
+{
+	// Always allow at least one chunk, however low the bandwidth:
+	return std::max(static_cast<double>(ms_BytesPerSecond) * BURST_TIME, static_cast<double>(m_AverageChunkSize.load()));
+}
@@ -0,0 +1,132 @@
+// ChunkStreamer.h
+
+// Declares the cChunkStreamer class that decides which chunks are streamed to a client next
+
+/*
+Each client keeps a frontier: the chunks within its view distance that it doesn't have yet.
+The frontier is updated incrementally as the player moves between chunks; only the chunks newly entering
+the view distance are checked against the client's chunk lists, and the ones leaving it are dropped.
+
+The chunks are taken from the frontier by priority, rather than in a fixed scan order:
+- The closer a chunk is, the sooner it's sent.
+- The chunks in the look direction are preferred to the ones behind the player.
+- The chunks around the position predicted from the player's recent movement are treated as if the player was already there,
+so that fast travel (elytra, horses, minecarts) gets the chunks ahead of it before it arrives.
+
+How many chunks are taken each tick is limited by a bandwidth budget, rather than a fixed count.
+The budget refills at a set rate, up to a burst limit, and each chunk taken is charged the running average size
+of the chunk packets actually sent to the client. A stationary player with everything loaded doesn't use the budget at all,
+while a fast moving one gets as many chunks as the bandwidth allows.
+
+For the fast moving players, the chunks along the predicted path just beyond the view distance are also picked
+for prefetching, so that they are already loaded from the disk or generated by the time they enter the view distance.
+*/
+
+
+
+
+
+#pragma once
+
+#include "ChunkDef.h"
+#include "FunctionRef.h"
+
+
+
+
+
+class cChunkStreamer
+{
+public:
+
+	/** A chunk taken from the frontier to be streamed. */
+	struct sChunk
+	{
+		cChunkCoords m_Chunk;
+
+		/** The horizontal distance of the chunk from the player, in chunks. */
+		double m_Distance;
+
+		/** True if the chunk is ahead of the player, in the look direction or along its movement. */
+		bool m_IsAhead;
+	};
+
+	cChunkStreamer(void);
+
+	/** Sets the rate at which the budget of each client refills, in bytes per second. */
+	static void SetBandwidth(size_t a_BytesPerSecond);
+
+	/** Updates the player's movement, and refills the budget for the elapsed time. To be called each tick. */
+	void Tick(std::chrono::milliseconds a_Dt, Vector3d a_Position, Vector3d a_LookVector);
+
+	/** Moves the frontier to the view distance around the specified chunk.
+	The chunks newly in range are added to it unless a_IsKnown returns true for them, the ones out of range are dropped.
+	If the frontier has been reset, or the view distance has changed, all the chunks in range are checked. */
+	void UpdateFrontier(cChunkCoords a_Center, int a_ViewDistance, cFunctionRef<bool(cChunkCoords)> a_IsKnown);
+
+	/** Forgets the frontier, so that the next UpdateFrontier() rebuilds it from scratch.
+	To be used when the client's chunks are dropped or the view distance changes. */
+	void Reset(void);
+
+	/** Takes the highest priority chunks that fit into the budget from the frontier, appending them to a_Chunks, most urgent first.
+	Charges the budget for them. */
+	void TakeNextChunks(std::vector<sChunk> & a_Chunks);
+
+	/** Appends the chunks beyond the view distance along the player's predicted path, to be prefetched, to a_Chunks.
+	Only does so once the player has moved into another chunk since the last call, and if moving fast enough
+	for the chunks not to be loaded in time otherwise. Uses the frontier's center and view distance. */
+	void GetPrefetchChunks(cChunkCoordsVector & a_Chunks);
+
+	/** Updates the average chunk packet size with a packet actually sent. May be called from any thread. */
+	void ChunkSent(size_t a_Size);
+
+	/** Returns true if there are no chunks left to stream. */
+	bool IsFrontierEmpty(void) const { return m_Frontier.empty(); }
+
+	/** Returns the number of chunks left to stream. */
+	size_t GetFrontierSize(void) const { return m_Frontier.size(); }
+
+	/** Returns the player's horizontal velocity, as observed from its movement, in blocks per second. */
+	Vector3d GetVelocity(void) const { return m_Velocity; }
+
+protected:
+
+	/** The rate at which the budget of each client refills, in bytes per second. */
+	static std::atomic<size_t> ms_BytesPerSecond;
+
+	/** The chunks within the view distance that the client doesn't have yet. */
+	std::vector<cChunkCoords> m_Frontier;
+
+	/** The chunk around which m_Frontier is built. */
+	cChunkCoords m_Center;
+
+	/** The view distance for which m_Frontier is built, or -1 if it needs rebuilding. */
+	int m_ViewDistance;
+
+	/** The frontier's center at the last GetPrefetchChunks() that has checked the path. */
+	cChunkCoords m_LastPrefetchCenter;
+
+	/** The player's position at the last Tick(). */
+	Vector3d m_Position;
+
+	/** The player's horizontal look direction, normalized, or zero if looking straight up or down. */
+	Vector3d m_LookVector;
+
+	/** The player's horizontal velocity, smoothed over the recent ticks, in blocks per second. */
+	Vector3d m_Velocity;
+
+	/** True once m_Position holds an actual position, so that the velocity can be computed. */
+	bool m_HasPosition;
+
+	/** The bytes that can be streamed right now. */
+	double m_Budget;
+
+	/** The running average size of the chunk packets sent to the client, in bytes. */
+	std::atomic<size_t> m_AverageChunkSize;
+
+	/** Returns the priority of streaming the chunk, lower is sooner, and fills in its distance and whether it's ahead. */
+	double GetPriority(sChunk & a_Chunk) const;
+
+	/** Returns the maximum the budget can accumulate to, in bytes. */
+	double GetBurstLimit(void) const;
+};
@@ -7,18 +7,33 @@
 
 
 
+std::atomic<int> CircularBufferCompressor::ms_CompressionFactor(6);
+
+
+
+
+
 ContiguousByteBufferView CircularBufferCompressor::GetView() const
 {
-	return m_ContiguousIntermediate;
+	return m_View;
 }
 
 
 
 
 
-Compression::Result CircularBufferCompressor::Compress()
+size_t CircularBufferCompressor::CompressInto(std::byte * const a_Output, const size_t a_OutputSize) const
 {
-	return m_Compressor.CompressZLib(m_ContiguousIntermediate);
+	return Compression::GetThreadCompressor(ms_CompressionFactor).CompressZLibInto(m_View, a_Output, a_OutputSize);
+}
+
+
+
+
+
+size_t CircularBufferCompressor::GetCompressBound() const
+{
+	return Compression::GetThreadCompressor(ms_CompressionFactor).GetZLibBound(m_View.size());
 }
 
 
@@ -27,7 +42,7 @@ Compression::Result CircularBufferCompressor::Compress()
 
 void CircularBufferCompressor::ReadFrom(cByteBuffer & Buffer)
 {
-	Buffer.ReadAll(m_ContiguousIntermediate);
+	ReadFrom(Buffer, Buffer.GetReadableSpace());
 }
 
 
@@ -36,7 +51,23 @@ void CircularBufferCompressor::ReadFrom(cByteBuffer & Buffer)
 
 void CircularBufferCompressor::ReadFrom(cByteBuffer & Buffer, size_t Size)
 {
+	if (Buffer.ReadView(m_View, Size))
+	{
+		return;
+	}
+
+	// The data wraps around the ringbuffer end, copy it together:
 	Buffer.ReadSome(m_ContiguousIntermediate, Size);
+	m_View = m_ContiguousIntermediate;
+}
+
+
+
+
+
+void CircularBufferCompressor::SetCompressionFactor(const int a_CompressionFactor)
+{
+	ms_CompressionFactor = Clamp(a_CompressionFactor, 0, 12);
 }
 
 
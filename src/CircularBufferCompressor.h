@@ -1,4 +1,3 @@
-
 #pragma once
 
 #include "StringCompression.h"
@@ -17,15 +16,33 @@ class CircularBufferCompressor
 {
 public:
 
+	/** Returns the data read by the last ReadFrom(). */
 	ContiguousByteBufferView GetView() const;
 
-	Compression::Result Compress();
+	/** Compresses the data read by the last ReadFrom() directly into the caller's buffer of a_OutputSize bytes,
+	using the calling thread's compressor. Returns the compressed size, or 0 if it doesn't fit; GetCompressBound() bytes always fit. */
+	size_t CompressInto(std::byte * a_Output, size_t a_OutputSize) const;
+
+	/** Returns the maximum size of the compressed data read by the last ReadFrom(). */
+	size_t GetCompressBound() const;
+
+	/** Reads all the readable data from the buffer. Data stored contiguously is referenced in place rather than copied,
+	the view then stays valid until the buffer is written to again. */
 	void ReadFrom(cByteBuffer & Buffer);
 	void ReadFrom(cByteBuffer & Buffer, size_t Size);
 
+	/** Sets the compression factor [0-12] used for all the network data. */
+	static void SetCompressionFactor(int a_CompressionFactor);
+
 private:
 
-	Compression::Compressor m_Compressor;
+	/** The compression factor used for all the network data. */
+	static std::atomic<int> ms_CompressionFactor;
+
+	/** The data read by the last ReadFrom(), either in place or in m_ContiguousIntermediate. */
+	ContiguousByteBufferView m_View;
+
+	/** Holds a copy of the data read, if it wasn't stored contiguously. */
 	std::basic_string<std::byte> m_ContiguousIntermediate;
 };
 
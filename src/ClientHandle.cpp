@@ -49,8 +49,11 @@
 /** Maximum number of bytes that a chat message sent by a player may consist of. */
 #define MAX_CHAT_MSG_LENGTH 1024
 
-/** Maximum number of chunks to stream per tick. */
-#define MAX_CHUNKS_STREAMED_PER_TICK 4
+/** Maximum number of bytes queued in the link for sending, before the client is considered congested. */
+#define MAX_QUEUED_SEND_SIZE (512 KiB)
+
+/** Minimum size of the data shared between clients to be sent by reference; smaller data is cheaper to copy. */
+#define MIN_SHARED_SEND_SIZE (1 KiB)
 
 
 
@@ -61,6 +64,9 @@ int cClientHandle::s_ClientCount = 0;
 
 float cClientHandle::FASTBREAK_PERCENTAGE;
 
+thread_local const cClientHandle * cClientHandle::ms_CaptureClient = nullptr;
+thread_local ContiguousByteBuffer * cClientHandle::ms_CaptureBuffer = nullptr;
+
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -71,11 +77,10 @@ cClientHandle::cClientHandle(const AString & a_IPString, int a_ViewDistance) :
 	m_CurrentViewDistance(a_ViewDistance),
 	m_RequestedViewDistance(a_ViewDistance),
 	m_IPString(a_IPString),
+	m_IsCongested(false),
 	m_Player(nullptr),
 	m_CachedSentChunk(std::numeric_limits<decltype(m_CachedSentChunk.m_ChunkX)>::max(), std::numeric_limits<decltype(m_CachedSentChunk.m_ChunkZ)>::max()),
 	m_HasSentDC(false),
-	m_LastStreamedChunkX(std::numeric_limits<decltype(m_LastStreamedChunkX)>::max()),  // bogus chunk coords to force streaming upon login
-	m_LastStreamedChunkZ(std::numeric_limits<decltype(m_LastStreamedChunkZ)>::max()),
 	m_TicksSinceLastPacket(0),
 	m_Ping(1000),
 	m_PingID(1),
@@ -133,8 +138,7 @@ void cClientHandle::Destroy(void)
 
 	{
 		cCSLock Lock(m_CSOutgoingData);
-		m_Protocol.HandleOutgoingData(m_OutgoingData);  // Finalise any encryption.
-		m_Link->Send(m_OutgoingData.data(), m_OutgoingData.size());  // Flush remaining data.
+		SendOutgoingData(*m_Link, m_OutgoingData);  // Flush remaining data, finalising any encryption.
 		m_Link->Shutdown();  // Cleanly close the connection.
 		m_Link.reset();  // Release the strong reference cTCPLink holds to ourself.
 	}
@@ -249,13 +253,6 @@ void cClientHandle::ProcessProtocolOut()
 	decltype(m_OutgoingData) OutgoingData;
 	{
 		cCSLock Lock(m_CSOutgoingData);
-
-		// Bail out when there's nothing to send to avoid TCPLink::Send overhead:
-		if (m_OutgoingData.empty())
-		{
-			return;
-		}
-
 		std::swap(OutgoingData, m_OutgoingData);
 	}
 
@@ -264,8 +261,148 @@ void cClientHandle::ProcessProtocolOut()
 	// to prevent it being reset between the null check and the Send:
 	if (auto Link = m_Link; Link != nullptr)
 	{
-		m_Protocol.HandleOutgoingData(OutgoingData);
-		Link->Send(OutgoingData.data(), OutgoingData.size());
+		// Bail out when there's nothing to send to avoid TCPLink::Send overhead:
+		if (!OutgoingData.empty())
+		{
+			SendOutgoingData(*Link, OutgoingData);
+		}
+
+		// If the client doesn't keep up with the data, its send queue keeps on growing:
+		m_IsCongested = (Link->GetQueuedSendSize() > MAX_QUEUED_SEND_SIZE);
+	}
+}
+
+
+
+
+
+void cClientHandle::DeferEntityMovement(const cEntity & a_Entity)
+{
+	cCSLock Lock(m_CSOutgoingData);
+	m_DeferredEntityMovements[a_Entity.GetUniqueID()] = { a_Entity.GetChunkX(), a_Entity.GetChunkZ() };
+}
+
+
+
+
+
+void cClientHandle::ForgetEntityMovement(const cEntity & a_Entity)
+{
+	cCSLock Lock(m_CSOutgoingData);
+	m_DeferredEntityMovements.erase(a_Entity.GetUniqueID());
+}
+
+
+
+
+
+bool cClientHandle::ResyncEntityMovement(const cEntity & a_Entity)
+{
+	{
+		cCSLock Lock(m_CSOutgoingData);
+		if (m_DeferredEntityMovements.erase(a_Entity.GetUniqueID()) == 0)
+		{
+			return false;
+		}
+	}
+
+	// The held-back relative moves are superseded by the absolute position:
+	SendEntityTeleport(a_Entity);
+	SendEntityHeadLook(a_Entity);
+	SendEntityVelocity(a_Entity);
+	return true;
+}
+
+
+
+
+
+void cClientHandle::SendOutgoingData(cTCPLink & a_Link, std::vector<cOutgoingSegment> & a_Data)
+{
+	if (m_Protocol.IsOutgoingDataModified())
+	{
+		// The data is encrypted for this client, so it needs copying anyway; encrypt and send it all at once:
+		ContiguousByteBuffer Data;
+		for (const auto & Segment : a_Data)
+		{
+			std::visit([&Data](const auto & a_Segment)
+			{
+				using Segment = std::decay_t<decltype(a_Segment)>;
+
+				if constexpr (std::is_same_v<Segment, ContiguousByteBuffer>)
+				{
+					Data += a_Segment;
+				}
+				else
+				{
+					Data += *a_Segment;
+				}
+			}, Segment);
+		}
+		m_Protocol.HandleOutgoingData(Data);
+		a_Link.Send(Data.data(), Data.size());
+		return;
+	}
+
+	// Hand over the shared segments by reference, LibEvent then writes the whole chain with vectored writes:
+	for (auto & Segment : a_Data)
+	{
+		std::visit([&a_Link](auto & a_Segment)
+		{
+			using Segment = std::decay_t<decltype(a_Segment)>;
+
+			if constexpr (std::is_same_v<Segment, ContiguousByteBuffer>)
+			{
+				a_Link.Send(a_Segment.data(), a_Segment.size());
+			}
+			else
+			{
+				a_Link.Send(std::move(a_Segment));
+			}
+		}, Segment);
+	}
+}
+
+
+
+
+
+void cClientHandle::ResyncDeferredEntityMovements(void)
+{
+	if (m_IsCongested)
+	{
+		return;
+	}
+
+	std::vector<UInt32> EntityIDs;
+	{
+		cCSLock Lock(m_CSOutgoingData);
+		EntityIDs.reserve(m_DeferredEntityMovements.size());
+		for (const auto & Entry : m_DeferredEntityMovements)
+		{
+			EntityIDs.push_back(Entry.first);
+		}
+	}
+
+	for (const auto EntityID : EntityIDs)
+	{
+		const auto Found = m_Player->GetWorld()->DoWithEntityByID(EntityID, [this](cEntity & a_Entity)
+			{
+				// A moving entity's next position broadcast resynchronises it exactly, relative to the position it was last sent at:
+				if (a_Entity.GetPosition() == a_Entity.GetLastSentPosition())
+				{
+					ResyncEntityMovement(a_Entity);
+				}
+				return false;
+			}
+		);
+
+		if (!Found)
+		{
+			// The entity is gone, or in another world:
+			cCSLock Lock(m_CSOutgoingData);
+			m_DeferredEntityMovements.erase(EntityID);
+		}
 	}
 }
 
@@ -472,120 +609,42 @@ void cClientHandle::StreamNextChunks(void)
 {
 	ASSERT(m_Player != nullptr);
 
-	int ChunkPosX = m_Player->GetChunkX();
-	int ChunkPosZ = m_Player->GetChunkZ();
-
-	if ((m_LastStreamedChunkX == ChunkPosX) && (m_LastStreamedChunkZ == ChunkPosZ))
+	if (m_IsCongested)
 	{
-		// All chunks are already loaded and the player has not moved, work is done:
+		// The client doesn't keep up with the data already sent, don't pile more chunks on it:
 		return;
 	}
 
-	// Player moved chunks and / or loading is not finished, reset to bogus (GH #4531):
-	m_LastStreamedChunkX = std::numeric_limits<decltype(m_LastStreamedChunkX)>::max();
-	m_LastStreamedChunkZ = std::numeric_limits<decltype(m_LastStreamedChunkZ)>::max();
-
-	int StreamedChunks = 0;
-	Vector3d Position = m_Player->GetEyePosition();
-	Vector3d LookVector = m_Player->GetLookVector();
-
-	// Get the look vector and normalize it.
-	LookVector.Normalize();
-
-	// High priority: Load the chunks that are in the view-direction of the player (with a radius of 3)
-	for (int Range = 0; Range < m_CurrentViewDistance; Range++)
+	// Update the frontier with the chunks entering the view distance, and take the most urgent ones that fit into the budget:
+	std::vector<cChunkStreamer::sChunk> Chunks;
 	{
-		Vector3d Vector = Position + LookVector * cChunkDef::Width * Range;
-
-		// Get the chunk from the x / z coords.
-		int RangeX, RangeZ = 0;
-		cChunkDef::BlockToChunk(FloorC(Vector.x), FloorC(Vector.z), RangeX, RangeZ);
-
-		for (int X = 0; X < 7; X++)
+		cCSLock Lock(m_CSChunkLists);
+		m_ChunkStreamer.UpdateFrontier({ m_Player->GetChunkX(), m_Player->GetChunkZ() }, m_CurrentViewDistance, [this](const cChunkCoords a_Chunk)
 		{
-			for (int Z = 0; Z < 7; Z++)
-			{
-				int ChunkX = RangeX + ((X >= 4) ? (3 - X) : X);
-				int ChunkZ = RangeZ + ((Z >= 4) ? (3 - Z) : Z);
-				cChunkCoords Coords(ChunkX, ChunkZ);
-
-				// Checks if the chunk is in distance
-				if ((Diff(ChunkX, ChunkPosX) > m_CurrentViewDistance) || (Diff(ChunkZ, ChunkPosZ) > m_CurrentViewDistance))
-				{
-					continue;
-				}
-
-				// If the chunk already loading / loaded -> skip
-				{
-					cCSLock Lock(m_CSChunkLists);
-					if (
-						(m_ChunksToSend.find(Coords) != m_ChunksToSend.end()) ||
-						(m_LoadedChunks.find(Coords) != m_LoadedChunks.end())
-					)
-					{
-						continue;
-					}
-				}
-
-				// Unloaded chunk found -> Send it to the client.
-				StreamChunk(ChunkX, ChunkZ, ((Range <= 2) ? cChunkSender::Priority::Critical : cChunkSender::Priority::Medium));
-
-				if (++StreamedChunks == MAX_CHUNKS_STREAMED_PER_TICK)
-				{
-					return;
-				}
-			}
-		}
+			return (
+				(m_ChunksToSend.find(a_Chunk) != m_ChunksToSend.end()) ||
+				(m_LoadedChunks.find(a_Chunk) != m_LoadedChunks.end())
+			);
+		});
 	}
+	m_ChunkStreamer.TakeNextChunks(Chunks);
 
-	// Low priority: Add all chunks that are in range. (From the center out to the edge)
-	for (int d = 0; d <= m_CurrentViewDistance; ++d)  // cycle through (square) distance, from nearest to furthest
+	// Load the chunks further along the player's path before they enter the view distance:
+	cChunkCoordsVector Prefetch;
+	m_ChunkStreamer.GetPrefetchChunks(Prefetch);
+	if (!Prefetch.empty())
 	{
-		const auto StreamIfUnloaded = [this](const cChunkCoords Chunk)
-		{
-			// If the chunk already loading / loaded -> skip
-			{
-				cCSLock Lock(m_CSChunkLists);
-				if (
-					(m_ChunksToSend.find(Chunk) != m_ChunksToSend.end()) ||
-					(m_LoadedChunks.find(Chunk) != m_LoadedChunks.end())
-				)
-				{
-					return false;
-				}
-			}
-
-			// Unloaded chunk found -> Send it to the client.
-			StreamChunk(Chunk.m_ChunkX, Chunk.m_ChunkZ, cChunkSender::Priority::Low);
-			return true;
-		};
-
-		// For each distance, send the first unloaded chunk in a hollow square centered around current position:
-		for (int i = -d; i <= d; ++i)
-		{
-			if (StreamIfUnloaded({ ChunkPosX + d, ChunkPosZ + i }) || StreamIfUnloaded({ ChunkPosX - d, ChunkPosZ + i }))
-			{
-				if (++StreamedChunks == MAX_CHUNKS_STREAMED_PER_TICK)
-				{
-					return;
-				}
-			}
-		}
-		for (int i = -d + 1; i < d; ++i)
-		{
-			if (StreamIfUnloaded({ ChunkPosX + i, ChunkPosZ + d }) || StreamIfUnloaded({ ChunkPosX + i, ChunkPosZ - d }))
-			{
-				if (++StreamedChunks == MAX_CHUNKS_STREAMED_PER_TICK)
-				{
-					return;
-				}
-			}
-		}
+		m_Player->GetWorld()->PrefetchChunks(std::move(Prefetch));
 	}
 
-	// All chunks are loaded -> Sets the last loaded chunk coordinates to current coordinates
-	m_LastStreamedChunkX = ChunkPosX;
-	m_LastStreamedChunkZ = ChunkPosZ;
+	for (const auto & Chunk : Chunks)
+	{
+		const auto Priority =
+			(Chunk.m_Distance <= 2) ? cChunkSender::Priority::Critical :
+			Chunk.m_IsAhead ? cChunkSender::Priority::Medium :
+			cChunkSender::Priority::Low;
+		StreamChunk(Chunk.m_Chunk.m_ChunkX, Chunk.m_Chunk.m_ChunkZ, Priority);
+	}
 }
 
 
@@ -2007,6 +2066,13 @@ void cClientHandle::HandleTabCompletion(const AString & a_Text)
 
 void cClientHandle::SendData(const ContiguousByteBufferView a_Data)
 {
+	if (ms_CaptureClient == this)
+	{
+		// The data is being captured for a broadcast, it gets sent to the recipients (including this client) by the caller:
+		*ms_CaptureBuffer += a_Data;
+		return;
+	}
+
 	if (m_HasSentDC)
 	{
 		// This could crash the client, because they've already unloaded the world etc., and suddenly a wild packet appears (#31)
@@ -2014,7 +2080,50 @@ void cClientHandle::SendData(const ContiguousByteBufferView a_Data)
 	}
 
 	cCSLock Lock(m_CSOutgoingData);
-	m_OutgoingData += a_Data;
+	if (m_OutgoingData.empty() || !std::holds_alternative<ContiguousByteBuffer>(m_OutgoingData.back()))
+	{
+		m_OutgoingData.emplace_back(ContiguousByteBuffer());
+	}
+	std::get<ContiguousByteBuffer>(m_OutgoingData.back()) += a_Data;
+}
+
+
+
+
+
+void cClientHandle::SendData(std::shared_ptr<const ContiguousByteBuffer> a_Data)
+{
+	if ((ms_CaptureClient == this) || (a_Data->size() < MIN_SHARED_SEND_SIZE))
+	{
+		SendData(ContiguousByteBufferView(*a_Data));
+		return;
+	}
+
+	if (m_HasSentDC)
+	{
+		// This could crash the client, because they've already unloaded the world etc., and suddenly a wild packet appears (#31)
+		return;
+	}
+
+	cCSLock Lock(m_CSOutgoingData);
+	m_OutgoingData.emplace_back(std::move(a_Data));
+}
+
+
+
+
+
+ContiguousByteBuffer cClientHandle::CaptureSentData(cFunctionRef<void()> a_SendFunc)
+{
+	ASSERT(ms_CaptureClient == nullptr);  // Captures don't nest
+
+	ContiguousByteBuffer Data;
+	ms_CaptureClient = this;
+	ms_CaptureBuffer = &Data;
+	a_SendFunc();
+	ms_CaptureClient = nullptr;
+	ms_CaptureBuffer = nullptr;
+	return Data;
 }
 
 
@@ -2031,14 +2140,19 @@ void cClientHandle::RemoveFromWorld(void)
 		m_SentChunks.clear();
 	}
 
+	// The entities of the old world are forgotten by the client:
+	{
+		cCSLock Lock(m_CSOutgoingData);
+		m_DeferredEntityMovements.clear();
+	}
+
 	// Flush outgoing data:
 	ProcessProtocolOut();
 
 	// No need to send Unload Chunk packets, the client unloads automatically.
 
-	// Here, we set last streamed values to bogus ones so everything is resent:
-	m_LastStreamedChunkX = std::numeric_limits<decltype(m_LastStreamedChunkX)>::max();
-	m_LastStreamedChunkZ = std::numeric_limits<decltype(m_LastStreamedChunkZ)>::max();
+	// Rebuild the streaming frontier so everything is resent:
+	m_ChunkStreamer.Reset();
 
 	// Restart player unloaded chunk checking and freezing:
 	m_CachedSentChunk = cChunkCoords(std::numeric_limits<decltype(m_CachedSentChunk.m_ChunkX)>::max(), std::numeric_limits<decltype(m_CachedSentChunk.m_ChunkZ)>::max());
@@ -2155,7 +2269,11 @@ void cClientHandle::Tick(float a_Dt)
 		}
 	}
 
+	// Send the entity movements held back while the client was congested:
+	ResyncDeferredEntityMovements();
+
 	// Send a couple of chunks to the player:
+	m_ChunkStreamer.Tick(std::chrono::milliseconds(static_cast<int>(a_Dt)), m_Player->GetPosition(), m_Player->GetLookVector());
 	StreamNextChunks();
 
 	// Unload all chunks that are out of the view distance (every 5 seconds):
@@ -2468,7 +2586,7 @@ void cClientHandle::SendChatSystem(const cCompositeChat & a_Message)
 
 
 
-void cClientHandle::SendChunkData(int a_ChunkX, int a_ChunkZ, const ContiguousByteBufferView a_ChunkData)
+void cClientHandle::SendChunkData(int a_ChunkX, int a_ChunkZ, std::shared_ptr<const ContiguousByteBuffer> a_ChunkData)
 {
 	ASSERT(m_Player != nullptr);
 
@@ -2498,7 +2616,8 @@ void cClientHandle::SendChunkData(int a_ChunkX, int a_ChunkZ, const ContiguousBy
 		return;
 	}
 
-	m_Protocol->SendChunkData(a_ChunkData);
+	m_ChunkStreamer.ChunkSent(a_ChunkData->size());
+	m_Protocol->SendChunkData(std::move(a_ChunkData));
 
 	// Add the chunk to the list of chunks sent to the player:
 	{
@@ -2511,6 +2630,25 @@ void cClientHandle::SendChunkData(int a_ChunkX, int a_ChunkZ, const ContiguousBy
 
 
 
+void cClientHandle::SendChunkSections(int a_ChunkX, int a_ChunkZ, std::shared_ptr<const ContiguousByteBuffer> a_SectionData)
+{
+	// Do not send the sections of chunks that weren't sent to the client yet, the client would be left with a partial chunk.
+	// If the chunk is still queued for sending, it will contain the changes already:
+	{
+		cCSLock Lock(m_CSChunkLists);
+		if (std::find(m_SentChunks.begin(), m_SentChunks.end(), cChunkCoords(a_ChunkX, a_ChunkZ)) == m_SentChunks.end())
+		{
+			return;
+		}
+	}
+
+	m_Protocol->SendChunkData(std::move(a_SectionData));
+}
+
+
+
+
+
 void cClientHandle::SendCollectEntity(const cEntity & a_Collected, const cEntity & a_Collector, unsigned a_Count)
 {
 	m_Protocol->SendCollectEntity(a_Collected, a_Collector, a_Count);
@@ -2522,6 +2660,9 @@ void cClientHandle::SendCollectEntity(const cEntity & a_Collected, const cEntity
 
 void cClientHandle::SendDestroyEntity(const cEntity & a_Entity)
 {
+	// The client forgets the entity, there's nothing to resync any more:
+	ForgetEntityMovement(a_Entity);
+
 	m_Protocol->SendDestroyEntity(a_Entity);
 }
 
@@ -2628,6 +2769,15 @@ void cClientHandle::SendEntityProperties(const cEntity & a_Entity)
 
 
 
+void cClientHandle::SendEntityTeleport(const cEntity & a_Entity)
+{
+	m_Protocol->SendEntityTeleport(a_Entity);
+}
+
+
+
+
+
 void cClientHandle::SendEntityVelocity(const cEntity & a_Entity)
 {
 	m_Protocol->SendEntityVelocity(a_Entity);
@@ -3115,6 +3265,23 @@ void cClientHandle::SendUnloadChunk(int a_ChunkX, int a_ChunkZ)
 		m_SentChunks.remove(cChunkCoords(a_ChunkX, a_ChunkZ));
 	}
 
+	// The client forgets the entities in the chunk along with it:
+	{
+		cCSLock Lock(m_CSOutgoingData);
+		const cChunkCoords Chunk(a_ChunkX, a_ChunkZ);
+		for (auto itr = m_DeferredEntityMovements.begin(); itr != m_DeferredEntityMovements.end();)
+		{
+			if (itr->second == Chunk)
+			{
+				itr = m_DeferredEntityMovements.erase(itr);
+			}
+			else
+			{
+				++itr;
+			}
+		}
+	}
+
 	m_Protocol->SendUnloadChunk(a_ChunkX, a_ChunkZ);
 }
 
@@ -3261,8 +3428,7 @@ void cClientHandle::SetViewDistance(int a_ViewDistance)
 		m_CurrentViewDistance = Clamp(a_ViewDistance, cClientHandle::MIN_VIEW_DISTANCE, world->GetMaxViewDistance());
 
 		// Restart chunk streaming to respond to new view distance:
-		m_LastStreamedChunkX = std::numeric_limits<decltype(m_LastStreamedChunkX)>::max();
-		m_LastStreamedChunkZ = std::numeric_limits<decltype(m_LastStreamedChunkZ)>::max();
+		m_ChunkStreamer.Reset();
 	}
 }
 
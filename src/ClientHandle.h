@@ -15,7 +15,9 @@
 #include "UI/SlotArea.h"
 #include "json/json.h"
 #include "ChunkSender.h"
+#include "ChunkStreamer.h"
 #include "EffectID.h"
+#include "FunctionRef.h"
 #include "Protocol/ForgeHandshake.h"
 #include "Protocol/ProtocolRecognizer.h"
 #include "UUID.h"
@@ -108,6 +110,22 @@ public:  // tolua_export
 	/** Flushes all buffered outgoing data to the network. */
 	void ProcessProtocolOut();
 
+	/** Returns true if the client doesn't keep up with the data sent to it, as of the last ProcessProtocolOut().
+	Low-priority data, such as entity movement, is then held back. */
+	bool IsCongested(void) const { return m_IsCongested; }
+
+	/** Holds back a movement update of the entity because of congestion.
+	The entity is resynchronised with absolute packets, in ResyncEntityMovement(), once the congestion clears. */
+	void DeferEntityMovement(const cEntity & a_Entity);
+
+	/** If the entity's movement has been held back, sends its absolute position, head look and velocity and returns true.
+	Returns false if nothing has been held back. */
+	bool ResyncEntityMovement(const cEntity & a_Entity);
+
+	/** Drops the held-back movement of the entity, if any, because the client forgets the entity.
+	Called for each client that the entity is destroyed on, including those that are sent the destroy packet serialized for another client. */
+	void ForgetEntityMovement(const cEntity & a_Entity);
+
 	/** Formats the type of message with the proper color and prefix for sending to the client. */
 	static AString FormatMessageType(bool ShouldAppendChatPrefixes, eMessageType a_ChatPrefix, const AString & a_AdditionalData);
 
@@ -124,7 +142,7 @@ public:  // tolua_export
 	/** Authenticates the specified user, called by cAuthenticator */
 	void Authenticate(const AString & a_Name, const cUUID & a_UUID, const Json::Value & a_Properties);
 
-	/** Sends a set number of new chunks to the player on every invocation, until all chunks in the view distance have been sent. */
+	/** Streams the most urgent chunks that the player doesn't have yet, as many as the bandwidth budget allows, see cChunkStreamer. */
 	void StreamNextChunks();
 
 	/** Remove all loaded chunks that are no longer in range */
@@ -164,7 +182,8 @@ public:  // tolua_export
 	void SendChatAboveActionBar         (const cCompositeChat & a_Message);
 	void SendChatSystem                 (const AString & a_Message, eMessageType a_ChatPrefix, const AString & a_AdditionalData = "");
 	void SendChatSystem                 (const cCompositeChat & a_Message);
-	void SendChunkData                  (int a_ChunkX, int a_ChunkZ, ContiguousByteBufferView a_ChunkData);
+	void SendChunkData                  (int a_ChunkX, int a_ChunkZ, std::shared_ptr<const ContiguousByteBuffer> a_ChunkData);
+	void SendChunkSections              (int a_ChunkX, int a_ChunkZ, std::shared_ptr<const ContiguousByteBuffer> a_SectionData);  // Serialized by cChunkDataSerializer::SerializeSections(); skipped if the client doesn't have the chunk yet
 	void SendCollectEntity              (const cEntity & a_Collected, const cEntity & a_Collector, unsigned a_Count);
 	void SendDestroyEntity              (const cEntity & a_Entity);
 	void SendDetachEntity               (const cEntity & a_Entity, const cEntity & a_PreviousVehicle);
@@ -179,6 +198,7 @@ public:  // tolua_export
 	void SendEntityMetadata             (const cEntity & a_Entity);
 	void SendEntityPosition             (const cEntity & a_Entity);
 	void SendEntityProperties           (const cEntity & a_Entity);
+	void SendEntityTeleport             (const cEntity & a_Entity);
 	void SendEntityVelocity             (const cEntity & a_Entity);
 	void SendExperience                 (void);
 	void SendExperienceOrb              (const cExpOrb & a_ExpOrb);
@@ -404,6 +424,16 @@ public:  // tolua_export
 
 	void SendData(ContiguousByteBufferView a_Data);
 
+	/** Queues the data, shared with other clients, for sending without copying it.
+	Small data is copied anyway, since referencing it would cost more. */
+	void SendData(std::shared_ptr<const ContiguousByteBuffer> a_Data);
+
+	/** Calls a_SendFunc and returns the data that it sent to this client, serialized and compressed, instead of queueing it for sending.
+	Only the data sent from the calling thread is captured, sends from other threads go to the client as usual.
+	The returned data may then be sent, via SendData(), to any client that uses the same protocol version;
+	used by the broadcasts to serialize a packet only once for all the recipients. */
+	ContiguousByteBuffer CaptureSentData(cFunctionRef<void()> a_SendFunc);
+
 	/** Called when the player moves into a different world.
 	Sends an UnloadChunk packet for each loaded chunk and resets the streamed chunks. */
 	void RemoveFromWorld(void);
@@ -460,9 +490,27 @@ private:
 	/** Protects m_OutgoingData against multithreaded access. */
 	cCriticalSection m_CSOutgoingData;
 
-	/** Buffer for storing outgoing data from any thread; will get sent in ProcessProtocolOut() at the end of each tick.
+	/** A segment of the outgoing data: either owned by this client (consecutive packets are coalesced into one),
+	or shared with other clients (chunks and broadcasts), so that it isn't copied for each of them. */
+	using cOutgoingSegment = std::variant<ContiguousByteBuffer, std::shared_ptr<const ContiguousByteBuffer>>;
+
+	/** The segments of outgoing data from any thread, in order; will get sent in ProcessProtocolOut() at the end of each tick.
 	Protected by m_CSOutgoingData. */
-	ContiguousByteBuffer m_OutgoingData;
+	std::vector<cOutgoingSegment> m_OutgoingData;
+
+	/** The IDs of the entities whose movement has been held back because of congestion, mapped to the chunk they were in when last held back.
+	The entries are dropped when the entity is destroyed or its chunk unloaded for the client, the client forgets the entity then.
+	Protected by m_CSOutgoingData. */
+	std::unordered_map<UInt32, cChunkCoords> m_DeferredEntityMovements;
+
+	/** Set in ProcessProtocolOut() if the link's send queue has grown too large, the client doesn't keep up with the data. */
+	std::atomic<bool> m_IsCongested;
+
+	/** The client whose sent data the current thread is capturing in CaptureSentData(), nullptr if none. */
+	static thread_local const cClientHandle * ms_CaptureClient;
+
+	/** The buffer into which the current thread is capturing the sent data in CaptureSentData(). */
+	static thread_local ContiguousByteBuffer * ms_CaptureBuffer;
 
 	/** A pointer to a World-owned player object, created in FinishAuthenticate when authentication succeeds.
 	The player should only be accessed from the tick thread of the World that owns him.
@@ -481,9 +529,8 @@ private:
 
 	bool m_HasSentDC;  ///< True if a Disconnect packet has been sent in either direction
 
-	// Chunk position when the last StreamChunks() was called; used to avoid re-streaming while in the same chunk
-	int m_LastStreamedChunkX;
-	int m_LastStreamedChunkZ;
+	/** Picks the chunks to stream to the client, by priority and within the bandwidth budget. Only used in the tick thread, except ChunkSent(). */
+	cChunkStreamer m_ChunkStreamer;
 
 	/** The last time UnloadOutOfRangeChunks was called. */
 	cTickTimeLong m_LastUnloadCheck;
@@ -572,6 +619,13 @@ private:
 	0 for just started, 1 and above for broken. Used for anti-cheat. */
 	float m_BreakProgress;
 
+	/** Hands the outgoing data segments over to the link; the shared segments by reference, unless the protocol encrypts them. */
+	void SendOutgoingData(cTCPLink & a_Link, std::vector<cOutgoingSegment> & a_Data);
+
+	/** Resynchronises the held-back entities that have stopped moving, once the congestion has cleared.
+	The moving ones are resynchronised by their next position broadcast instead. */
+	void ResyncDeferredEntityMovements(void);
+
 	/** Finish logging the user in after authenticating. */
 	void FinishAuthenticate(const AString & a_Name, const cUUID & a_UUID, const Json::Value & a_Properties);
 
@@ -1758,6 +1758,11 @@ void cEntity::SetSize(const float a_Width, const float a_Height)
 {
 	m_Width = a_Width;
 	m_Height = a_Height;
+
+	if (m_ParentChunk != nullptr)
+	{
+		m_ParentChunk->UpdateEntityInGrid(*this);
+	}
 }
 
 
@@ -2258,6 +2263,12 @@ void cEntity::SetPosition(const Vector3d & a_Position)
 
 	m_LastPosition = m_Position;
 	m_Position = {ClampedPosX, ClampedPosY, ClampedPosZ};
+
+	// Keep the chunk's box queries exact, even for teleports and the moves outside of the chunk's tick:
+	if (m_ParentChunk != nullptr)
+	{
+		m_ParentChunk->UpdateEntityInGrid(*this);
+	}
 }
 
 
@@ -0,0 +1,198 @@
+// IncrementalLighting.cpp
+
+// Implements the cIncrementalLighting class that updates the lighting around a single changed block
+
+#include "Globals.h"
+#include "IncrementalLighting.h"
+#include "BlockInfo.h"
+
+
+
+
+
+namespace
+{
+	/** The offsets to the six neighbors of a block. The one below is the first, see SpreadLight(). */
+	const Vector3i NeighborOffsets[] =
+	{
+		{  0, -1,  0 },
+		{  0,  1,  0 },
+		{  1,  0,  0 },
+		{ -1,  0,  0 },
+		{  0,  0,  1 },
+		{  0,  0, -1 },
+	};
+}  // namespace (anonymous)
+
+
+
+
+
+void cIncrementalLighting::BlockChanged(cBlockAccess & a_Access, const Vector3i a_RelPos)
+{
+	cIncrementalLighting BlockLight(a_Access, eChannel::BlockLight);
+	BlockLight.Update(a_RelPos);
+
+	cIncrementalLighting SkyLight(a_Access, eChannel::SkyLight);
+	SkyLight.Update(a_RelPos);
+}
+
+
+
+
+
+cIncrementalLighting::cIncrementalLighting(cBlockAccess & a_Access, const eChannel a_Channel) :
+	m_Access(a_Access),
+	m_Channel(a_Channel)
+{
+}
+
+
+
+
+
+void cIncrementalLighting::Update(const Vector3i a_RelPos)
+{
+	BLOCKTYPE BlockType;
+	NIBBLETYPE OldLight;
+	if (!m_Access.GetBlock(a_RelPos, m_Channel, BlockType, OldLight))
+	{
+		ASSERT(!"The changed block is not available");
+		return;
+	}
+
+	// Remove the light of the changed block and of everything that has been lit through it:
+	m_Access.SetLight(a_RelPos, m_Channel, 0);
+	m_Removals.push_back({ a_RelPos, OldLight });
+	RunRemovals();
+
+	// Light the changed block on its own, if it emits light:
+	const auto Inherent = GetInherentLight(BlockType, a_RelPos.y);
+	if (Inherent > 0)
+	{
+		m_Access.SetLight(a_RelPos, m_Channel, Inherent);
+		m_Additions.push_back(a_RelPos);
+	}
+
+	// Spread the light from the seeds back into the removed area, including the changed block:
+	RunAdditions();
+}
+
+
+
+
+
+void cIncrementalLighting::RunRemovals(void)
+{
+	// The queue is processed in the FIFO order, without popping, and cleared at the end:
+	for (size_t i = 0; i < m_Removals.size(); i++)
+	{
+		const auto Removal = m_Removals[i];
+		for (size_t n = 0; n < ARRAYCOUNT(NeighborOffsets); n++)
+		{
+			const auto Pos = Removal.m_Pos + NeighborOffsets[n];
+			BLOCKTYPE BlockType;
+			NIBBLETYPE Light;
+			if (!m_Access.GetBlock(Pos, m_Channel, BlockType, Light) || (Light == 0))
+			{
+				continue;
+			}
+
+			if (Light > SpreadLight(Removal.m_Light, BlockType, (n == 0)))
+			{
+				// The neighbor is lit from elsewhere, it will spread its light back into the removed area:
+				m_Additions.push_back(Pos);
+				continue;
+			}
+
+			// The neighbor may have been lit through the removed block, remove its light as well:
+			m_Access.SetLight(Pos, m_Channel, 0);
+			m_Removals.push_back({ Pos, Light });
+			const auto Inherent = GetInherentLight(BlockType, Pos.y);
+			if (Inherent > 0)
+			{
+				m_Access.SetLight(Pos, m_Channel, Inherent);
+				m_Additions.push_back(Pos);
+			}
+		}
+	}
+	m_Removals.clear();
+}
+
+
+
+
+
+void cIncrementalLighting::RunAdditions(void)
+{
+	// The queue is processed in the FIFO order, without popping, and cleared at the end:
+	for (size_t i = 0; i < m_Additions.size(); i++)
+	{
+		const auto Pos = m_Additions[i];
+		BLOCKTYPE SrcBlockType;
+		NIBBLETYPE SrcLight;
+		if (!m_Access.GetBlock(Pos, m_Channel, SrcBlockType, SrcLight) || (SrcLight == 0))
+		{
+			// Nothing to spread
+			continue;
+		}
+
+		for (size_t n = 0; n < ARRAYCOUNT(NeighborOffsets); n++)
+		{
+			const auto DstPos = Pos + NeighborOffsets[n];
+			BLOCKTYPE DstBlockType;
+			NIBBLETYPE DstLight;
+			if (!m_Access.GetBlock(DstPos, m_Channel, DstBlockType, DstLight))
+			{
+				continue;
+			}
+			const auto Light = SpreadLight(SrcLight, DstBlockType, (n == 0));
+			if (Light > DstLight)
+			{
+				m_Access.SetLight(DstPos, m_Channel, Light);
+				m_Additions.push_back(DstPos);
+			}
+		}
+	}
+	m_Additions.clear();
+}
+
+
+
+
+
+NIBBLETYPE cIncrementalLighting::GetInherentLight(const BLOCKTYPE a_BlockType, const int a_RelY) const
+{
+	if (m_Channel == eChannel::BlockLight)
+	{
+		return cBlockInfo::GetLightValue(a_BlockType);
+	}
+
+	// Nothing is above the topmost layer, the blocks there that let the sunlight through are fully lit:
+	const bool IsSunlit = (
+		(a_RelY == cChunkDef::Height - 1) &&
+		cBlockInfo::IsTransparent(a_BlockType) &&
+		!cBlockInfo::IsSkylightDispersant(a_BlockType)
+	);
+	return IsSunlit ? 15 : 0;
+}
+
+
+
+
+
+NIBBLETYPE cIncrementalLighting::SpreadLight(const NIBBLETYPE a_SrcLight, const BLOCKTYPE a_DstBlockType, const bool a_IsDownwards) const
+{
+	// Full sunlight goes down unchanged through the blocks that let it through, same as in cLightingThread::PrepareSkyLight():
+	if (
+		(m_Channel == eChannel::SkyLight) && a_IsDownwards && (a_SrcLight == 15) &&
+		cBlockInfo::IsTransparent(a_DstBlockType) &&
+		!cBlockInfo::IsSkylightDispersant(a_DstBlockType)
+	)
+	{
+		return 15;
+	}
+
+	const auto Falloff = cBlockInfo::GetSpreadLightFalloff(a_DstBlockType);
+	return (a_SrcLight > Falloff) ? static_cast<NIBBLETYPE>(a_SrcLight - Falloff) : 0;
+}
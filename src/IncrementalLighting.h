@@ -0,0 +1,108 @@
+// IncrementalLighting.h
+
+// Declares the cIncrementalLighting class that updates the lighting around a single changed block
+
+/*
+When a block changes in a lit chunk, only the light within 15 blocks of it can change (sky light may also change
+down the whole column below it). Instead of invalidating the chunk and relighting its whole 3x3 area in the
+lighting thread, the light is updated in place, using the usual two-phase flood fill:
+1. Removal: the light of the changed block is cleared, and so is, recursively, the light of every neighbor
+	that could have received its light from a cleared block. Neighbors that are brighter than what a cleared block
+	could have given them are lit from elsewhere; they're remembered as seeds for the next phase.
+2. Addition: the light spreads from the seeds (and from the changed block, if it emits light) exactly as in
+	the full calculation in cLightingThread, until it no longer increases anything.
+The update crosses chunk borders into the neighbor chunks, as long as they're loaded and have valid lighting;
+light doesn't flow into or out of chunks that aren't, those get their light from a full relight once they're lit.
+*/
+
+
+
+
+
+#pragma once
+
+#include "ChunkDef.h"
+
+
+
+
+
+class cIncrementalLighting
+{
+public:
+
+	/** The light channels updated separately. */
+	enum class eChannel
+	{
+		BlockLight,
+		SkyLight,
+	};
+
+	/** The blocks and the light that the update reads and writes.
+	The positions are relative to the chunk in which the change happened, and may reach into its neighbors.
+	cChunk provides the implementation used by the server, see cChunk::FastSetBlock(). */
+	class cBlockAccess
+	{
+	public:
+
+		virtual ~cBlockAccess() {}
+
+		/** Reads the block type and the channel's light at the position.
+		Returns false if the position is outside of the world height, or in a chunk that isn't loaded or doesn't have valid lighting;
+		light doesn't flow into or out of such positions. */
+		virtual bool GetBlock(Vector3i a_RelPos, eChannel a_Channel, BLOCKTYPE & a_BlockType, NIBBLETYPE & a_Light) = 0;
+
+		/** Sets the channel's light at the position, which GetBlock() has reported as available. */
+		virtual void SetLight(Vector3i a_RelPos, eChannel a_Channel, NIBBLETYPE a_Light) = 0;
+	} ;
+
+
+	/** Updates the block light and the sky light around the block that has just been changed at a_RelPos.
+	The block's chunk must be available through a_Access. */
+	static void BlockChanged(cBlockAccess & a_Access, Vector3i a_RelPos);
+
+protected:
+
+	/** A position queued for the removal phase along with the light it had. */
+	struct sRemoval
+	{
+		Vector3i m_Pos;
+		NIBBLETYPE m_Light;
+	};
+
+	/** The blocks and the light being updated; all the positions are relative to the chunk of the changed block. */
+	cBlockAccess & m_Access;
+
+	/** The light channel being updated. */
+	eChannel m_Channel;
+
+	/** The queue of the removal phase. */
+	std::vector<sRemoval> m_Removals;
+
+	/** The queue of the addition phase; positions whose light is to be spread to their neighbors. */
+	std::vector<Vector3i> m_Additions;
+
+
+	cIncrementalLighting(cBlockAccess & a_Access, eChannel a_Channel);
+
+	/** Runs both phases of the update of the channel for the changed block. */
+	void Update(Vector3i a_RelPos);
+
+	/** Clears the light depending on the queued removals, collecting the seeds for re-adding. */
+	void RunRemovals(void);
+
+	/** Spreads the light from the queued additions. */
+	void RunAdditions(void);
+
+	/** Returns the light the block emits on its own in the channel:
+	its light value for block light, full light for the sky-exposed blocks at the top of the world for sky light. */
+	NIBBLETYPE GetInherentLight(BLOCKTYPE a_BlockType, int a_RelY) const;
+
+	/** Returns the light that a block of the specified type receives from a neighbor with the specified light.
+	a_IsDownwards is true if the light spreads from the block above. */
+	NIBBLETYPE SpreadLight(NIBBLETYPE a_SrcLight, BLOCKTYPE a_DstBlockType, bool a_IsDownwards) const;
+} ;
+
+
+
+
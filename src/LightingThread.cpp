@@ -13,7 +13,7 @@
 
 
 
-/** Chunk data callback that takes the chunk data and puts them into cLightingThread's m_BlockTypes[] / m_HeightMap[]: */
+/** Chunk data callback that takes the chunk data and puts them into cLightingThread::cLighter's m_BlockTypes[] / m_HeightMap[]: */
 class cReader :
 	public cChunkDataCallback
 {
@@ -21,9 +21,10 @@ class cReader :
 	{
 		BLOCKTYPE * OutputRows = m_BlockTypes;
 		int OutputIdx = m_ReadingChunkX + m_ReadingChunkZ * cChunkDef::Width * 3;
+		ChunkBlockData::BlockArray Scratch;
 		for (size_t i = 0; i != cChunkDef::NumSections; ++i)
 		{
-			const auto Section = a_BlockData.GetSection(i);
+			const auto Section = a_BlockData.GetSection(i, Scratch);
 			if (Section == nullptr)
 			{
 				// Skip to the next section
@@ -99,11 +100,18 @@ public:
 ////////////////////////////////////////////////////////////////////////////////
 // cLightingThread:
 
+cCriticalSection cLightingThread::ms_LightersCS;
+std::vector<std::unique_ptr<cLightingThread::cLighter>> cLightingThread::ms_IdleLighters;
+
+
+
+
+
 cLightingThread::cLightingThread(cWorld & a_World):
 	Super("Lighting Executor"),
 	m_World(a_World),
-	m_MaxHeight(0),
-	m_NumSeeds(0)
+	m_NumLighted(0),
+	m_LightingTimeUS(0)
 {
 }
 
@@ -166,7 +174,7 @@ void cLightingThread::QueueChunk(int a_ChunkX, int a_ChunkZ, std::unique_ptr<cCh
 void cLightingThread::WaitForQueueEmpty(void)
 {
 	cCSLock Lock(m_CS);
-	while (!m_ShouldTerminate && (!m_Queue.empty() || !m_PendingQueue.empty()))
+	while (!m_ShouldTerminate && (!m_Queue.empty() || !m_PendingQueue.empty() || !m_InProgress.empty()))
 	{
 		cCSUnlock Unlock(Lock);
 		m_evtQueueEmpty.Wait();
@@ -180,7 +188,27 @@ void cLightingThread::WaitForQueueEmpty(void)
 size_t cLightingThread::GetQueueLength(void)
 {
 	cCSLock Lock(m_CS);
-	return m_Queue.size() + m_PendingQueue.size();
+	return m_Queue.size() + m_PendingQueue.size() + m_InProgress.size();
+}
+
+
+
+
+
+cLightingThread::sStats cLightingThread::GetStats(void)
+{
+	sStats Stats;
+	{
+		cCSLock Lock(m_CS);
+		Stats.m_NumQueued = m_Queue.size() + m_PendingQueue.size();
+		Stats.m_NumInProgress = m_InProgress.size();
+	}
+	Stats.m_NumLighted = m_NumLighted;
+	if (Stats.m_NumLighted > 0)
+	{
+		Stats.m_AvgLightingTimeMS = static_cast<double>(m_LightingTimeUS) / 1000 / static_cast<double>(Stats.m_NumLighted);
+	}
+	return Stats;
 }
 
 
@@ -189,42 +217,89 @@ size_t cLightingThread::GetQueueLength(void)
 
 void cLightingThread::Execute(void)
 {
-	for (;;)
+	tbb::task_group Pool;  // TBB task group lighting the chunks
+	const auto MaxInProgress = static_cast<size_t>(std::max(tbb::this_task_arena::max_concurrency(), 1));
+
+	while (!m_ShouldTerminate)
 	{
 		{
+			// Start lighting the queued chunks whose areas are free, in the queue order, while there's room for more.
+			// Only look a limited distance into the queue, so that a long queue doesn't make each round expensive:
 			cCSLock Lock(m_CS);
-			if (m_Queue.empty())
+			size_t NumScanned = 0;
+			for (auto itr = m_Queue.begin(); (itr != m_Queue.end()) && (m_InProgress.size() < MaxInProgress) && (NumScanned < 16 * MaxInProgress); NumScanned++)
 			{
-				cCSUnlock Unlock(Lock);
-				m_evtItemAdded.Wait();
+				auto Item = static_cast<cLightingChunkStay *>(*itr);
+				const cChunkCoords Coords(Item->m_ChunkX, Item->m_ChunkZ);
+				if (!IsAreaFree(Coords))
+				{
+					++itr;
+					continue;
+				}
+				itr = m_Queue.erase(itr);
+				m_InProgress.push_back(Coords);
+				Pool.run([this, Item]()
+				{
+					LightChunk(*Item);
+				});
 			}
 		}
 
-		if (m_ShouldTerminate)
+		// Wait for more chunks to be queued, or for a chunk to finish:
+		m_evtItemAdded.Wait();
+	}
+
+	// The tasks still running use the world, let them finish:
+	if (auto Status = Pool.wait(); Status != tbb::complete)
+	{
+		LOGD("Lighting task group result status: %d", Status);
+	}
+}
+
+
+
+
+
+bool cLightingThread::IsAreaFree(const cChunkCoords a_Coords) const
+{
+	return std::none_of(m_InProgress.begin(), m_InProgress.end(), [a_Coords](const cChunkCoords & a_Other)
 		{
-			return;
+			return (std::abs(a_Other.m_ChunkX - a_Coords.m_ChunkX) <= 2) && (std::abs(a_Other.m_ChunkZ - a_Coords.m_ChunkZ) <= 2);
 		}
+	);
+}
+
+
+
 
-		// Process one items from the queue:
-		cLightingChunkStay * Item;
+
+std::unique_ptr<cLightingThread::cLighter> cLightingThread::AcquireLighter(void)
+{
+	{
+		cCSLock Lock(ms_LightersCS);
+		if (!ms_IdleLighters.empty())
 		{
-			cCSLock Lock(m_CS);
-			if (m_Queue.empty())
-			{
-				continue;
-			}
-			Item = static_cast<cLightingChunkStay *>(m_Queue.front());
-			m_Queue.pop_front();
-			if (m_Queue.empty())
-			{
-				m_evtQueueEmpty.Set();
-			}
-		}  // CSLock(m_CS)
+			auto Lighter = std::move(ms_IdleLighters.back());
+			ms_IdleLighters.pop_back();
+			return Lighter;
+		}
+	}
+	return std::make_unique<cLighter>();
+}
+
+
+
 
-		LightChunk(*Item);
-		Item->Disable();
-		delete Item;
+
+void cLightingThread::ReleaseLighter(std::unique_ptr<cLighter> a_Lighter)
+{
+	const auto MaxIdle = static_cast<size_t>(std::max(tbb::this_task_arena::max_concurrency(), 1));
+	cCSLock Lock(ms_LightersCS);
+	if (ms_IdleLighters.size() < MaxIdle)
+	{
+		ms_IdleLighters.push_back(std::move(a_Lighter));
 	}
+	// Otherwise the buffers are freed together with a_Lighter
 }
 
 
@@ -233,19 +308,76 @@ void cLightingThread::Execute(void)
 
 void cLightingThread::LightChunk(cLightingChunkStay & a_Item)
 {
+	const auto Start = std::chrono::steady_clock::now();
+
 	// If the chunk is already lit, skip it (report as success):
-	if (m_World.IsChunkLighted(a_Item.m_ChunkX, a_Item.m_ChunkZ))
+	if (!m_World.IsChunkLighted(a_Item.m_ChunkX, a_Item.m_ChunkZ))
+	{
+		auto Lighter = AcquireLighter();
+		cChunkDef::BlockNibbles BlockLight, SkyLight;
+		Lighter->LightChunk(m_World, a_Item.m_ChunkX, a_Item.m_ChunkZ, BlockLight, SkyLight);
+		ReleaseLighter(std::move(Lighter));
+		m_World.ChunkLighted(a_Item.m_ChunkX, a_Item.m_ChunkZ, BlockLight, SkyLight);
+	}
+
+	if (a_Item.m_CallbackAfter != nullptr)
+	{
+		a_Item.m_CallbackAfter->Call({a_Item.m_ChunkX, a_Item.m_ChunkZ}, true);
+	}
+	const cChunkCoords Coords(a_Item.m_ChunkX, a_Item.m_ChunkZ);
+	a_Item.Disable();
+	delete &a_Item;
+
+	m_NumLighted += 1;
+	m_LightingTimeUS += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - Start).count();
+
+	// Free the chunk's area for the chunks waiting for it:
 	{
-		if (a_Item.m_CallbackAfter != nullptr)
+		cCSLock Lock(m_CS);
+		m_InProgress.erase(std::find(m_InProgress.begin(), m_InProgress.end(), Coords));
+		if (m_Queue.empty() && m_InProgress.empty())
 		{
-			a_Item.m_CallbackAfter->Call({a_Item.m_ChunkX, a_Item.m_ChunkZ}, true);
+			m_evtQueueEmpty.Set();
 		}
-		return;
 	}
+	m_evtItemAdded.Set();
+}
+
+
 
-	cChunkDef::BlockNibbles BlockLight, SkyLight;
 
-	ReadChunks(a_Item.m_ChunkX, a_Item.m_ChunkZ);
+
+void cLightingThread::QueueChunkStay(cLightingChunkStay & a_ChunkStay)
+{
+	// Move the ChunkStay from the Pending queue to the lighting queue.
+	{
+		cCSLock Lock(m_CS);
+		m_PendingQueue.remove(&a_ChunkStay);
+		m_Queue.push_back(&a_ChunkStay);
+	}
+	m_evtItemAdded.Set();
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cLightingThread::cLighter:
+
+cLightingThread::cLighter::cLighter(void) :
+	m_MaxHeight(0),
+	m_NumSeeds(0)
+{
+}
+
+
+
+
+
+void cLightingThread::cLighter::LightChunk(cWorld & a_World, int a_ChunkX, int a_ChunkZ, cChunkDef::BlockNibbles & a_BlockLight, cChunkDef::BlockNibbles & a_SkyLight)
+{
+	ReadChunks(a_World, a_ChunkX, a_ChunkZ);
 
 	PrepareBlockLight();
 	CalcLight(m_BlockLight);
@@ -256,7 +388,7 @@ void cLightingThread::LightChunk(cLightingChunkStay & a_Item)
 	// DEBUG: Save chunk data with highlighted seeds for visual inspection:
 	cFile f4;
 	if (
-		f4.Open(Printf("Chunk_%d_%d_seeds.grab", a_Item.m_ChunkX, a_Item.m_ChunkZ), cFile::fmWrite)
+		f4.Open(Printf("Chunk_%d_%d_seeds.grab", a_ChunkX, a_ChunkZ), cFile::fmWrite)
 	)
 	{
 		for (int z = 0; z < cChunkDef::Width * 3; z++)
@@ -285,9 +417,9 @@ void cLightingThread::LightChunk(cLightingChunkStay & a_Item)
 	// DEBUG: Save XY slices of the chunk data and lighting for visual inspection:
 	cFile f1, f2, f3;
 	if (
-		f1.Open(Printf("Chunk_%d_%d_data.grab",  a_Item.m_ChunkX, a_Item.m_ChunkZ), cFile::fmWrite) &&
-		f2.Open(Printf("Chunk_%d_%d_sky.grab",   a_Item.m_ChunkX, a_Item.m_ChunkZ), cFile::fmWrite) &&
-		f3.Open(Printf("Chunk_%d_%d_glow.grab",  a_Item.m_ChunkX, a_Item.m_ChunkZ), cFile::fmWrite)
+		f1.Open(Printf("Chunk_%d_%d_data.grab",  a_ChunkX, a_ChunkZ), cFile::fmWrite) &&
+		f2.Open(Printf("Chunk_%d_%d_sky.grab",   a_ChunkX, a_ChunkZ), cFile::fmWrite) &&
+		f3.Open(Printf("Chunk_%d_%d_glow.grab",  a_ChunkX, a_ChunkZ), cFile::fmWrite)
 	)
 	{
 		for (int z = 0; z < cChunkDef::Width * 3; z++)
@@ -312,22 +444,15 @@ void cLightingThread::LightChunk(cLightingChunkStay & a_Item)
 	}
 	//*/
 
-	CompressLight(m_BlockLight, BlockLight);
-	CompressLight(m_SkyLight, SkyLight);
-
-	m_World.ChunkLighted(a_Item.m_ChunkX, a_Item.m_ChunkZ, BlockLight, SkyLight);
-
-	if (a_Item.m_CallbackAfter != nullptr)
-	{
-		a_Item.m_CallbackAfter->Call({a_Item.m_ChunkX, a_Item.m_ChunkZ}, true);
-	}
+	CompressLight(m_BlockLight, a_BlockLight);
+	CompressLight(m_SkyLight, a_SkyLight);
 }
 
 
 
 
 
-void cLightingThread::ReadChunks(int a_ChunkX, int a_ChunkZ)
+void cLightingThread::cLighter::ReadChunks(cWorld & a_World, int a_ChunkX, int a_ChunkZ)
 {
 	cReader Reader(m_BlockTypes, m_HeightMap);
 
@@ -337,7 +462,7 @@ void cLightingThread::ReadChunks(int a_ChunkX, int a_ChunkZ)
 		for (int x = 0; x < 3; x++)
 		{
 			Reader.m_ReadingChunkX = x;
-			VERIFY(m_World.GetChunkData({a_ChunkX + x - 1, a_ChunkZ + z - 1}, Reader));
+			VERIFY(a_World.GetChunkData({a_ChunkX + x - 1, a_ChunkZ + z - 1}, Reader));
 		}  // for z
 	}  // for x
 
@@ -350,7 +475,7 @@ void cLightingThread::ReadChunks(int a_ChunkX, int a_ChunkZ)
 
 
 
-void cLightingThread::PrepareSkyLight(void)
+void cLightingThread::cLighter::PrepareSkyLight(void)
 {
 	// Clear seeds:
 	memset(m_IsSeed1, 0, sizeof(m_IsSeed1));
@@ -416,7 +541,7 @@ void cLightingThread::PrepareSkyLight(void)
 
 
 
-void cLightingThread::PrepareBlockLight()
+void cLightingThread::cLighter::PrepareBlockLight()
 {
 	// Clear seeds:
 	memset(m_IsSeed1, 0, sizeof(m_IsSeed1));
@@ -445,7 +570,7 @@ void cLightingThread::PrepareBlockLight()
 
 
 
-void cLightingThread::CalcLight(NIBBLETYPE * a_Light)
+void cLightingThread::cLighter::CalcLight(NIBBLETYPE * a_Light)
 {
 	size_t NumSeeds2 = 0;
 	while (m_NumSeeds > 0)
@@ -470,7 +595,7 @@ void cLightingThread::CalcLight(NIBBLETYPE * a_Light)
 
 
 
-void cLightingThread::CalcLightStep(
+void cLightingThread::cLighter::CalcLightStep(
 	NIBBLETYPE * a_Light,
 	size_t a_NumSeedsIn,    unsigned char * a_IsSeedIn,  unsigned int * a_SeedIdxIn,
 	size_t & a_NumSeedsOut, unsigned char * a_IsSeedOut, unsigned int * a_SeedIdxOut
@@ -517,7 +642,7 @@ void cLightingThread::CalcLightStep(
 
 
 
-void cLightingThread::CompressLight(NIBBLETYPE * a_LightArray, NIBBLETYPE * a_ChunkLight)
+void cLightingThread::cLighter::CompressLight(NIBBLETYPE * a_LightArray, NIBBLETYPE * a_ChunkLight)
 {
 	int InIdx = cChunkDef::Width * 49;  // Index to the first nibble of the middle chunk in the a_LightArray
 	int OutIdx = 0;
@@ -542,7 +667,7 @@ void cLightingThread::CompressLight(NIBBLETYPE * a_LightArray, NIBBLETYPE * a_Ch
 
 
 
-void cLightingThread::PropagateLight(
+void cLightingThread::cLighter::PropagateLight(
 	NIBBLETYPE * a_Light,
 	unsigned int a_SrcIdx, unsigned int a_DstIdx,
 	size_t & a_NumSeedsOut, unsigned char * a_IsSeedOut, unsigned int * a_SeedIdxOut
@@ -569,21 +694,6 @@ void cLightingThread::PropagateLight(
 
 
 
-void cLightingThread::QueueChunkStay(cLightingChunkStay & a_ChunkStay)
-{
-	// Move the ChunkStay from the Pending queue to the lighting queue.
-	{
-		cCSLock Lock(m_CS);
-		m_PendingQueue.remove(&a_ChunkStay);
-		m_Queue.push_back(&a_ChunkStay);
-	}
-	m_evtItemAdded.Set();
-}
-
-
-
-
-
 ////////////////////////////////////////////////////////////////////////////////
 // cLightingThread::cLightingChunkStay:
 
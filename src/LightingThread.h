@@ -22,9 +22,15 @@ Step 2 needs two separate storages for old seeds and new seeds, so there are two
 their content is swapped after each full step-2-cycle.
 
 The thread has two queues of chunks that are to be lighted.
-The first queue, m_Queue, is the only one that is publicly visible, chunks get queued there by external requests.
-The second one, m_PostponedQueue, is for chunks that have been taken out of m_Queue and didn't have neighbors ready.
-Chunks from m_PostponedQueue are moved back into m_Queue when their neighbors get valid, using the ChunkReady callback.
+The first queue, m_Queue, holds the chunks that have their neighbors loaded and are ready to be lit.
+The second one, m_PendingQueue, holds the chunks that are waiting for their neighbors to load; a chunk moves into m_Queue
+once all its neighbors are valid, using the OnAllChunksAvailable callback.
+
+The thread itself only schedules the work, the chunks are lit as parallel tasks on the TBB pool.
+Since lighting a chunk reads the whole 3x3 area around it, a chunk is only started if its area doesn't overlap
+the area of any chunk currently being lit; the other chunks stay queued until the overlapping ones finish.
+Each task borrows a set of lighting buffers from a pool shared by the lighting threads of all the worlds, so that
+the memory used for the buffers depends on the number of chunks lit at once, not on the number of worlds.
 */
 
 
@@ -33,6 +39,7 @@ Chunks from m_PostponedQueue are moved back into m_Queue when their neighbors ge
 
 #include "OSSupport/IsThread.h"
 #include "ChunkStay.h"
+#include "TBBWrapper.h"
 
 
 
@@ -64,8 +71,28 @@ public:
 	/** Blocks until the queue is empty or the thread is terminated */
 	void WaitForQueueEmpty(void);
 
+	/** Returns the number of chunks queued or being lit. */
 	size_t GetQueueLength(void);
 
+	/** The statistics of the lighting, as reported by cWorld::GetChunkStats(). */
+	struct sStats
+	{
+		/** The number of chunks waiting for their neighbors to load or for their turn to be lit. */
+		size_t m_NumQueued = 0;
+
+		/** The number of chunks being lit right now. */
+		size_t m_NumInProgress = 0;
+
+		/** The number of chunks lit since the thread has started. */
+		size_t m_NumLighted = 0;
+
+		/** The average time spent lighting a single chunk, in milliseconds. */
+		double m_AvgLightingTimeMS = 0;
+	};
+
+	/** Returns the current statistics of the lighting. */
+	sStats GetStats(void);
+
 protected:
 
 	class cLightingChunkStay :
@@ -92,9 +119,78 @@ protected:
 	typedef std::list<cChunkStay *> cChunkStays;
 
 
+	/** The buffers for, and the calculation of, the lighting of a single 3x3 chunk area.
+	Each task lighting a chunk borrows an instance from the shared pool, see AcquireLighter() and ReleaseLighter(). */
+	class cLighter
+	{
+	public:
+
+		cLighter(void);
+
+		/** Calculates the lighting of the chunk in the middle of the 3x3 area, which must all be loaded. */
+		void LightChunk(cWorld & a_World, int a_ChunkX, int a_ChunkZ, cChunkDef::BlockNibbles & a_BlockLight, cChunkDef::BlockNibbles & a_SkyLight);
+
+	protected:
+
+		/** The highest block in the current 3x3 chunk data */
+		HEIGHTTYPE m_MaxHeight;
+
+
+		// Buffers for the 3x3 chunk data
+		// These buffers alone are 1.7 MiB in size, therefore they cannot be located on the stack safely - some architectures may have only 1 MiB for stack, or even less
+		// Placing the buffers into the object means that this object can light chunks only in one thread!
+		// The blobs are XZY organized as a whole, instead of 3x3 XZY-organized subarrays ->
+		//  -> This means data has to be scatterred when reading and gathered when writing!
+		static const int BlocksPerYLayer = cChunkDef::Width * cChunkDef::Width * 3 * 3;
+		BLOCKTYPE  m_BlockTypes[BlocksPerYLayer * cChunkDef::Height];
+		NIBBLETYPE m_BlockLight[BlocksPerYLayer * cChunkDef::Height];
+		NIBBLETYPE m_SkyLight  [BlocksPerYLayer * cChunkDef::Height];
+		HEIGHTTYPE m_HeightMap [BlocksPerYLayer];
+
+		// Seed management (5.7 MiB)
+		// Two buffers, in each calc step one is set as input and the other as output, then in the next step they're swapped
+		// Each seed is represented twice in this structure - both as a "list" and as a "position".
+		// "list" allows fast traversal from seed to seed
+		// "position" allows fast checking if a coord is already a seed
+		unsigned char m_IsSeed1 [BlocksPerYLayer * cChunkDef::Height];
+		unsigned int  m_SeedIdx1[BlocksPerYLayer * cChunkDef::Height];
+		unsigned char m_IsSeed2 [BlocksPerYLayer * cChunkDef::Height];
+		unsigned int  m_SeedIdx2[BlocksPerYLayer * cChunkDef::Height];
+		size_t m_NumSeeds;
+
+		/** Prepares m_BlockTypes and m_HeightMap data; zeroes out the light arrays */
+		void ReadChunks(cWorld & a_World, int a_ChunkX, int a_ChunkZ);
+
+		/** Uses m_HeightMap to initialize the m_SkyLight[] data; fills in seeds for the skylight */
+		void PrepareSkyLight(void);
+
+		/** Uses m_BlockTypes to initialize the m_BlockLight[] data; fills in seeds for the blocklight */
+		void PrepareBlockLight(void);
+
+		/** Calculates light in the light array specified, using stored seeds */
+		void CalcLight(NIBBLETYPE * a_Light);
+
+		/** Does one step in the light calculation - one seed propagation and seed recalculation */
+		void CalcLightStep(
+			NIBBLETYPE * a_Light,
+			size_t a_NumSeedsIn,    unsigned char * a_IsSeedIn,  unsigned int * a_SeedIdxIn,
+			size_t & a_NumSeedsOut, unsigned char * a_IsSeedOut, unsigned int * a_SeedIdxOut
+		);
+
+		/** Compresses from 1-block-per-byte (faster calc) into 2-blocks-per-byte (MC storage): */
+		void CompressLight(NIBBLETYPE * a_LightArray, NIBBLETYPE * a_ChunkLight);
+
+		void PropagateLight(
+			NIBBLETYPE * a_Light,
+			unsigned int a_SrcIdx, unsigned int a_DstIdx,
+			size_t & a_NumSeedsOut, unsigned char * a_IsSeedOut, unsigned int * a_SeedIdxOut
+		);
+	} ;
+
+
 	cWorld & m_World;
 
-	/** The mutex to protect m_Queue and m_PendingQueue */
+	/** The mutex to protect m_Queue, m_PendingQueue and m_InProgress */
 	cCriticalSection m_CS;
 
 	/** The ChunkStays that are loaded and are waiting to be lit. */
@@ -103,67 +199,37 @@ protected:
 	/** The ChunkStays that are waiting for load. Used for stopping the thread. */
 	cChunkStays m_PendingQueue;
 
-	cEvent m_evtItemAdded;    // Set when queue is appended, or to stop the thread
-	cEvent m_evtQueueEmpty;   // Set when the queue gets empty
+	/** The coords of the chunks being lit right now. No two of them are closer than 3 chunks, so that their 3x3 areas don't overlap. */
+	std::vector<cChunkCoords> m_InProgress;
 
-	/** The highest block in the current 3x3 chunk data */
-	HEIGHTTYPE m_MaxHeight;
-
-
-	// Buffers for the 3x3 chunk data
-	// These buffers alone are 1.7 MiB in size, therefore they cannot be located on the stack safely - some architectures may have only 1 MiB for stack, or even less
-	// Placing the buffers into the object means that this object can light chunks only in one thread!
-	// The blobs are XZY organized as a whole, instead of 3x3 XZY-organized subarrays ->
-	//  -> This means data has to be scatterred when reading and gathered when writing!
-	static const int BlocksPerYLayer = cChunkDef::Width * cChunkDef::Width * 3 * 3;
-	BLOCKTYPE  m_BlockTypes[BlocksPerYLayer * cChunkDef::Height];
-	NIBBLETYPE m_BlockLight[BlocksPerYLayer * cChunkDef::Height];
-	NIBBLETYPE m_SkyLight  [BlocksPerYLayer * cChunkDef::Height];
-	HEIGHTTYPE m_HeightMap [BlocksPerYLayer];
-
-	// Seed management (5.7 MiB)
-	// Two buffers, in each calc step one is set as input and the other as output, then in the next step they're swapped
-	// Each seed is represented twice in this structure - both as a "list" and as a "position".
-	// "list" allows fast traversal from seed to seed
-	// "position" allows fast checking if a coord is already a seed
-	unsigned char m_IsSeed1 [BlocksPerYLayer * cChunkDef::Height];
-	unsigned int  m_SeedIdx1[BlocksPerYLayer * cChunkDef::Height];
-	unsigned char m_IsSeed2 [BlocksPerYLayer * cChunkDef::Height];
-	unsigned int  m_SeedIdx2[BlocksPerYLayer * cChunkDef::Height];
-	size_t m_NumSeeds;
+	cEvent m_evtItemAdded;    // Set when queue is appended, when a chunk is finished, or to stop the thread
+	cEvent m_evtQueueEmpty;   // Set when the queue gets empty
 
-	virtual void Execute(void) override;
+	/** Protects ms_IdleLighters. */
+	static cCriticalSection ms_LightersCS;
 
-	/** Lights the entire chunk. If neighbor chunks don't exist, touches them and re-queues the chunk */
-	void LightChunk(cLightingChunkStay & a_Item);
+	/** The lighting buffers not used by any task right now, shared by the lighting threads of all the worlds (each is over 7 MiB).
+	At most as many are kept as there can be tasks running on the TBB pool at once, the rest are freed when returned. */
+	static std::vector<std::unique_ptr<cLighter>> ms_IdleLighters;
 
-	/** Prepares m_BlockTypes and m_HeightMap data; zeroes out the light arrays */
-	void ReadChunks(int a_ChunkX, int a_ChunkZ);
+	/** The number of chunks lit, and the total time spent lighting them, in microseconds; for the stats. */
+	std::atomic<size_t> m_NumLighted;
+	std::atomic<Int64> m_LightingTimeUS;
 
-	/** Uses m_HeightMap to initialize the m_SkyLight[] data; fills in seeds for the skylight */
-	void PrepareSkyLight(void);
 
-	/** Uses m_BlockTypes to initialize the m_BlockLight[] data; fills in seeds for the blocklight */
-	void PrepareBlockLight(void);
+	virtual void Execute(void) override;
 
-	/** Calculates light in the light array specified, using stored seeds */
-	void CalcLight(NIBBLETYPE * a_Light);
+	/** Returns true if the 3x3 area around the specified chunk doesn't overlap the area of any chunk being lit. Assumes m_CS is locked. */
+	bool IsAreaFree(cChunkCoords a_Coords) const;
 
-	/** Does one step in the light calculation - one seed propagation and seed recalculation */
-	void CalcLightStep(
-		NIBBLETYPE * a_Light,
-		size_t a_NumSeedsIn,    unsigned char * a_IsSeedIn,  unsigned int * a_SeedIdxIn,
-		size_t & a_NumSeedsOut, unsigned char * a_IsSeedOut, unsigned int * a_SeedIdxOut
-	);
+	/** Returns a set of lighting buffers from the shared pool, allocating a new one if none is idle. */
+	static std::unique_ptr<cLighter> AcquireLighter(void);
 
-	/** Compresses from 1-block-per-byte (faster calc) into 2-blocks-per-byte (MC storage): */
-	void CompressLight(NIBBLETYPE * a_LightArray, NIBBLETYPE * a_ChunkLight);
+	/** Returns the lighting buffers to the shared pool, or frees them if the pool already holds enough. */
+	static void ReleaseLighter(std::unique_ptr<cLighter> a_Lighter);
 
-	void PropagateLight(
-		NIBBLETYPE * a_Light,
-		unsigned int a_SrcIdx, unsigned int a_DstIdx,
-		size_t & a_NumSeedsOut, unsigned char * a_IsSeedOut, unsigned int * a_SeedIdxOut
-	);
+	/** Lights the entire chunk, using buffers borrowed from the shared pool, and finishes the chunkstay. Runs as a task on the TBB pool. */
+	void LightChunk(cLightingChunkStay & a_Item);
 
 	/** Queues a chunkstay that has all of its chunks loaded.
 	Called by cLightingChunkStay when all of its chunks are loaded. */
@@ -260,6 +260,20 @@ void cMonster::StopMovingToPosition()
 
 
 
+void cMonster::Think(cChunk & a_Chunk)
+{
+	// Same conditions as for following the path in Tick():
+	if (!m_PathfinderActivated || (GetMobType() == mtGhast) || (m_Health <= 0))
+	{
+		return;
+	}
+	m_PathFinder.PlanPath(a_Chunk);
+}
+
+
+
+
+
 void cMonster::Tick(std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
 {
 	Super::Tick(a_Dt, a_Chunk);
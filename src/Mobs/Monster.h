@@ -55,6 +55,11 @@ public:
 
 	virtual void Tick(std::chrono::milliseconds a_Dt, cChunk & a_Chunk) override;
 
+	/** Performs the part of this tick's AI work that only reads the world, ahead of Tick(): advances the planning of the mob's path.
+	The world ticks all the mobs' thinking in parallel, while no one is changing the world, and then ticks the mobs one by one.
+	Mustn't change anything but the mob's own AI state. */
+	void Think(cChunk & a_Chunk);
+
 	virtual bool DoTakeDamage(TakeDamageInfo & a_TDI) override;
 
 	virtual void KilledBy(TakeDamageInfo & a_TDI) override;
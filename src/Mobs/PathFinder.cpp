@@ -12,7 +12,9 @@ cPathFinder::cPathFinder(float a_MobWidth, float a_MobHeight) :
 	m_Width(a_MobWidth),
 	m_Height(a_MobHeight),
 	m_GiveUpCounter(0),
-	m_NotFoundCooldown(0)
+	m_NotFoundCooldown(0),
+	m_IsStepPlanned(false),
+	m_PlannedStatus(ePathFinderStatus::CALCULATING)
 {
 }
 
@@ -60,7 +62,10 @@ ePathFinderStatus cPathFinder::GetNextWayPoint(cChunk & a_Chunk, const Vector3d
 		ResetPathFinding(a_Chunk);
 	}
 
-	switch (m_Path->CalculationStep(a_Chunk))
+	// Use the step already performed by PlanPath(), if any, so that the path is advanced only once per call:
+	const auto Status = m_IsStepPlanned ? m_PlannedStatus : m_Path->CalculationStep(a_Chunk);
+	m_IsStepPlanned = false;
+	switch (Status)
 	{
 		case ePathFinderStatus::NEARBY_FOUND:
 		{
@@ -161,8 +166,26 @@ ePathFinderStatus cPathFinder::GetNextWayPoint(cChunk & a_Chunk, const Vector3d
 
 
 
+void cPathFinder::PlanPath(cChunk & a_Chunk)
+{
+	// A cooldown that hasn't run out yet means no step on the next call, a run out one means a new path:
+	if (m_IsStepPlanned || (m_NotFoundCooldown >= 0) || (m_Path == nullptr) || !m_Path->IsValid())
+	{
+		return;
+	}
+
+	m_PlannedStatus = m_Path->CalculationStep(a_Chunk);
+	m_IsStepPlanned = true;
+}
+
+
+
+
+
 void cPathFinder::ResetPathFinding(cChunk &a_Chunk)
 {
+	// Any planned step was for the previous path:
+	m_IsStepPlanned = false;
 	m_GiveUpCounter = 40;
 	m_NoPathToTarget = false;
 	m_PathDestination = m_FinalDestination;
@@ -38,6 +38,13 @@ public:
 	Note: Once NEARBY_FOUND is returned once, subsequent calls return PATH_FOUND. */
 	ePathFinderStatus GetNextWayPoint(cChunk & a_Chunk, const Vector3d & a_Source, Vector3d * a_Destination, Vector3d * a_OutputWaypoint, bool a_DontCare = false);
 
+	/** Performs, ahead of time, the path calculation step that the next GetNextWayPoint() call would otherwise perform itself.
+	Only reads the blocks and changes nothing but this PathFinder, so that the paths of many mobs may be planned in parallel,
+	as long as no one is changing the world meanwhile. Does nothing if there's no path being calculated,
+	or if a step has already been planned and not yet used up by GetNextWayPoint().
+	@param a_Chunk Any chunk near the mob, used for looking up the chunks along the path. */
+	void PlanPath(cChunk & a_Chunk);
+
 private:
 
 	/** The width of the Mob which owns this PathFinder. */
@@ -75,6 +82,12 @@ private:
 	/** When a path is not found, this cooldown prevents any recalculations for several ticks. */
 	int m_NotFoundCooldown;
 
+	/** True if PlanPath() has performed the path's next calculation step, and GetNextWayPoint() is yet to use its result. */
+	bool m_IsStepPlanned;
+
+	/** The result of the calculation step performed by PlanPath(), valid while m_IsStepPlanned is true. */
+	ePathFinderStatus m_PlannedStatus;
+
 	/** Ensures the location is not in the air or under water.
 	May change the Y coordinate of the given vector.
 	1. If a_Vector is the position of water, a_Vector's Y will be modified to point to the first air block above it.
@@ -66,9 +66,10 @@ void cNetherPortalScanner::OnChunkAvailable(int a_ChunkX, int a_ChunkZ)
 
 		virtual void ChunkData(const ChunkBlockData & a_BlockData, const ChunkLightData &) override
 		{
+			ChunkBlockData::BlockArray Scratch;
 			for (size_t Y = 0; Y < cChunkDef::NumSections; ++Y)
 			{
-				const auto Blocks = a_BlockData.GetSection(Y);
+				const auto Blocks = a_BlockData.GetSection(Y, Scratch);
 				if (Blocks == nullptr)
 				{
 					continue;
@@ -9,6 +9,12 @@
 ////////////////////////////////////////////////////////////////////////////////
 // cCriticalSection:
 
+thread_local cCriticalSection * cCriticalSection::ms_BorrowedCS = nullptr;
+
+
+
+
+
 cCriticalSection::cCriticalSection():
 	m_RecursionCount(0)
 {
@@ -20,6 +26,12 @@ cCriticalSection::cCriticalSection():
 
 void cCriticalSection::Lock()
 {
+	if (ms_BorrowedCS == this)
+	{
+		// The owner holds the lock on our behalf:
+		return;
+	}
+
 	m_Mutex.lock();
 
 	m_RecursionCount += 1;
@@ -33,6 +45,11 @@ void cCriticalSection::Lock()
 void cCriticalSection::Unlock()
 {
 	ASSERT(IsLockedByCurrentThread());
+	if (ms_BorrowedCS == this)
+	{
+		return;
+	}
+
 	m_RecursionCount -= 1;
 
 	m_Mutex.unlock();
@@ -53,6 +70,10 @@ bool cCriticalSection::IsLocked(void)
 
 bool cCriticalSection::IsLockedByCurrentThread(void)
 {
+	if (ms_BorrowedCS == this)
+	{
+		return true;
+	}
 	return ((m_RecursionCount > 0) && (m_OwningThreadID == std::this_thread::get_id()));
 }
 
@@ -120,6 +141,32 @@ void cCSLock::Unlock(void)
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+// cCSBorrow:
+
+cCSBorrow::cCSBorrow(cCriticalSection & a_CS) :
+	m_PreviousBorrowedCS(cCriticalSection::ms_BorrowedCS)
+{
+	// Only a single CS can be borrowed at a time:
+	ASSERT((m_PreviousBorrowedCS == nullptr) || (m_PreviousBorrowedCS == &a_CS));
+	ASSERT(a_CS.IsLocked());
+
+	cCriticalSection::ms_BorrowedCS = &a_CS;
+}
+
+
+
+
+
+cCSBorrow::~cCSBorrow()
+{
+	cCriticalSection::ms_BorrowedCS = m_PreviousBorrowedCS;
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // cCSUnlock:
 
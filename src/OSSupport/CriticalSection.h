@@ -8,6 +8,7 @@
 class cCriticalSection
 {
 	friend class cDeadlockDetect;  // Allow the DeadlockDetect to read the internals, so that it may output some statistics
+	friend class cCSBorrow;  // Allow the borrower to mark the CS as borrowed by the current thread
 
 public:
 	void Lock(void);
@@ -43,6 +44,10 @@ private:
 	std::thread::id m_OwningThreadID;
 
 	std::recursive_mutex m_Mutex;
+
+	/** The CS that the current thread has borrowed from its owner through a cCSBorrow, nullptr if none.
+	Locking and unlocking the borrowed CS are no-ops on this thread. */
+	static thread_local cCriticalSection * ms_BorrowedCS;
 };
 
 
@@ -75,6 +80,27 @@ private:
 
 
 
+/** RAII that lets the current thread act as if it held a CS that is actually held by another thread.
+Used for fanning out work from a thread holding a CS onto worker threads (the parallel chunk tick).
+The owner must keep the CS locked for the whole lifetime of the borrow, and it is the owner's responsibility
+that the borrowers don't access the same data concurrently.
+Note that unlocking a borrowed CS (cCSUnlock) doesn't release it, so borrowers mustn't wait for other threads while borrowing. */
+class cCSBorrow
+{
+	cCriticalSection * m_PreviousBorrowedCS;
+
+public:
+	cCSBorrow(cCriticalSection & a_CS);
+	~cCSBorrow();
+
+private:
+	DISALLOW_COPY_AND_ASSIGN(cCSBorrow);
+} ;
+
+
+
+
+
 /** Temporary RAII unlock for a cCSLock. Useful for unlock-wait-relock scenarios */
 class cCSUnlock
 {
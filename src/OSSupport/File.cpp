@@ -8,6 +8,7 @@
 #include "File.h"
 #include <sys/stat.h>
 #ifdef _WIN32
+	#include <io.h>  // for _commit()
 	#include <share.h>  // for _SH_DENYWRITE
 #else
 	#include <dirent.h>
@@ -383,6 +384,21 @@ bool cFile::Rename(const AString & a_OrigFileName, const AString & a_NewFileName
 
 
 
+bool cFile::RenameReplacing(const AString & a_OrigFileName, const AString & a_NewFileName)
+{
+	#ifdef _WIN32
+		// rename() fails on Windows if the dest exists:
+		return (MoveFileExA(a_OrigFileName.c_str(), a_NewFileName.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0);
+	#else
+		// POSIX rename() replaces the dest atomically:
+		return (rename(a_OrigFileName.c_str(), a_NewFileName.c_str()) == 0);
+	#endif
+}
+
+
+
+
+
 bool cFile::Copy(const AString & a_SrcFileName, const AString & a_DstFileName)
 {
 	#ifdef _WIN32
@@ -712,6 +728,25 @@ void cFile::Flush(void)
 
 
 
+bool cFile::Sync(void)
+{
+	ASSERT(IsOpen());
+
+	if (fflush(m_File) != 0)
+	{
+		return false;
+	}
+	#ifdef _WIN32
+		return (_commit(_fileno(m_File)) == 0);
+	#else
+		return (fsync(fileno(m_File)) == 0);
+	#endif
+}
+
+
+
+
+
 template <class StreamType>
 FileStream<StreamType>::FileStream(const std::string & Path)
 {
@@ -120,6 +120,10 @@ public:
 	/** Renames a file or folder, returns true if successful. May fail if dest already exists (libc-dependant)! */
 	static bool Rename(const AString & a_OrigPath, const AString & a_NewPath);  // Exported in ManualBindings.cpp
 
+	/** Renames a file, replacing the dest file if it already exists; returns true if successful.
+	On Windows, the dest file must not be open or mapped by anyone. */
+	static bool RenameReplacing(const AString & a_OrigFileName, const AString & a_NewFileName);
+
 	/** Copies a file, returns true if successful.
 	Overwrites the dest file if it already exists. */
 	static bool Copy(const AString & a_SrcFileName, const AString & a_DstFileName);  // Exported in ManualBindings.cpp
@@ -178,6 +182,10 @@ public:
 	/** Flushes all the bufferef output into the file (only when writing) */
 	void Flush(void);
 
+	/** Flushes all the buffered output and asks the OS to write the file's data through to the disk.
+	Returns true on success. */
+	bool Sync(void);
+
 private:
 	FILE * m_File;
 } ;  // tolua_export
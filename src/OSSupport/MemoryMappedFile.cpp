@@ -0,0 +1,128 @@
+// MemoryMappedFile.cpp
+
+// Implements the cMemoryMappedFile class representing a read-only memory mapping of an entire file
+
+#include "Globals.h"
+
+#include "MemoryMappedFile.h"
+#ifndef _WIN32
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+
+
+
+
+cMemoryMappedFile::cMemoryMappedFile(void) :
+	m_Data(nullptr),
+	m_Size(0)
+{
+}
+
+
+
+
+
+cMemoryMappedFile::~cMemoryMappedFile()
+{
+	Close();
+}
+
+
+
+
+
+bool cMemoryMappedFile::Open(const AString & a_FileName)
+{
+	Close();
+
+	#ifdef _WIN32
+		// Let the other handles keep writing into the file, the mapping stays coherent with them:
+		HANDLE File = CreateFileA(a_FileName.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (File == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+		LARGE_INTEGER Size;
+		if (!GetFileSizeEx(File, &Size) || (Size.QuadPart <= 0) || (static_cast<UInt64>(Size.QuadPart) > std::numeric_limits<size_t>::max()))
+		{
+			CloseHandle(File);
+			return false;
+		}
+		HANDLE Mapping = CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		CloseHandle(File);  // The mapping keeps its own reference to the file
+		if (Mapping == nullptr)
+		{
+			return false;
+		}
+		auto Data = MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(Mapping);  // The view keeps its own reference to the mapping
+		if (Data == nullptr)
+		{
+			return false;
+		}
+		m_Size = static_cast<size_t>(Size.QuadPart);
+	#else
+		int File = open(a_FileName.c_str(), O_RDONLY);
+		if (File < 0)
+		{
+			return false;
+		}
+		struct stat Stat;
+		if ((fstat(File, &Stat) != 0) || (Stat.st_size <= 0))
+		{
+			close(File);
+			return false;
+		}
+		auto Data = mmap(nullptr, static_cast<size_t>(Stat.st_size), PROT_READ, MAP_SHARED, File, 0);
+		close(File);  // The mapping keeps its own reference to the file
+		if (Data == MAP_FAILED)
+		{
+			return false;
+		}
+		m_Size = static_cast<size_t>(Stat.st_size);
+	#endif
+
+	m_Data = static_cast<const std::byte *>(Data);
+	return true;
+}
+
+
+
+
+
+void cMemoryMappedFile::Close(void)
+{
+	if (!IsOpen())
+	{
+		// Closing an unopened mapping is a legal nop
+		return;
+	}
+
+	#ifdef _WIN32
+		UnmapViewOfFile(m_Data);
+	#else
+		munmap(const_cast<std::byte *>(m_Data), m_Size);
+	#endif
+	m_Data = nullptr;
+	m_Size = 0;
+}
+
+
+
+
+
+ContiguousByteBufferView cMemoryMappedFile::GetView(const size_t a_Offset, const size_t a_NumBytes) const
+{
+	if ((a_Offset > m_Size) || (a_NumBytes > m_Size - a_Offset))
+	{
+		return {};
+	}
+	return { m_Data + a_Offset, a_NumBytes };
+}
+
+
+
+
@@ -0,0 +1,59 @@
+// MemoryMappedFile.h
+
+// Declares the cMemoryMappedFile class representing a read-only memory mapping of an entire file
+
+
+
+
+
+#pragma once
+
+
+
+
+
+/** A read-only view of a file's contents, mapped into the memory by the OS.
+The mapping covers the file as large as it was when opened; data written past that size by other handles
+becomes visible only after the file is re-opened. Data written within the mapped range through other handles
+of the same file is visible through the mapping immediately (after it is flushed out of any userspace buffers).
+The object has no multithreading locks, but reading the views from multiple threads is safe. */
+class cMemoryMappedFile
+{
+public:
+
+	cMemoryMappedFile(void);
+
+	/** Unmaps the file, if mapped. All the views into the mapping become invalid. */
+	~cMemoryMappedFile();
+
+	cMemoryMappedFile(const cMemoryMappedFile &) = delete;
+	cMemoryMappedFile & operator = (const cMemoryMappedFile &) = delete;
+
+	/** Maps the entire file. Returns true on success.
+	Fails if the file doesn't exist, or is empty (an empty file cannot be mapped). */
+	bool Open(const AString & a_FileName);
+
+	/** Unmaps the file. All the views into the mapping become invalid. */
+	void Close(void);
+
+	bool IsOpen(void) const { return (m_Data != nullptr); }
+
+	/** Returns the number of bytes mapped. */
+	size_t GetSize(void) const { return m_Size; }
+
+	/** Returns a view of a_NumBytes bytes starting at a_Offset.
+	Returns an empty view if the requested range is not entirely within the mapping. */
+	ContiguousByteBufferView GetView(size_t a_Offset, size_t a_NumBytes) const;
+
+private:
+
+	/** The start of the mapping, nullptr if not mapped. */
+	const std::byte * m_Data;
+
+	/** The number of bytes mapped. */
+	size_t m_Size;
+} ;
+
+
+
+
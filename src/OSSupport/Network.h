@@ -85,6 +85,15 @@ public:
 		return Send(a_Data.data(), a_Data.size());
 	}
 
+	/** Queues the specified data for sending to the remote peer, by reference rather than by copy where possible.
+	The link keeps its reference to the data until the data has been sent, so the data may be shared with other links.
+	Returns true on success, false on failure. Note that this success or failure only reports the queue status, not the actual data delivery. */
+	virtual bool Send(std::shared_ptr<const ContiguousByteBuffer> a_Data) = 0;
+
+	/** Returns the number of bytes queued for sending that haven't been handed over to the OS yet.
+	Used to detect slow peers, whose queue keeps on growing. */
+	virtual size_t GetQueuedSendSize(void) const = 0;
+
 	/** Returns the IP address of the local endpoint of the connection. */
 	virtual AString GetLocalIP(void) const = 0;
 
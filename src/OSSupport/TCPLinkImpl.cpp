@@ -183,6 +183,50 @@ bool cTCPLinkImpl::Send(const void * a_Data, size_t a_Length)
 
 
 
+bool cTCPLinkImpl::Send(std::shared_ptr<const ContiguousByteBuffer> a_Data)
+{
+	if (m_ShouldShutdown)
+	{
+		LOGD("%s: Cannot send data, the link is already shut down.", __FUNCTION__);
+		return false;
+	}
+
+	// The TLS context needs to encrypt the data, copying it anyway:
+	if (m_TlsContext != nullptr)
+	{
+		m_TlsContext->Send(a_Data->data(), a_Data->size());
+		return true;
+	}
+
+	// Hand the data to LibEvent by reference, it keeps the data alive until it has been written to the socket:
+	auto Data = a_Data->data();
+	auto Size = a_Data->size();
+	auto Holder = new std::shared_ptr<const ContiguousByteBuffer>(std::move(a_Data));
+	const auto Cleanup = [](const void *, size_t, void * a_Holder)
+	{
+		delete static_cast<std::shared_ptr<const ContiguousByteBuffer> *>(a_Holder);
+	};
+	if (evbuffer_add_reference(bufferevent_get_output(m_BufferEvent), Data, Size, Cleanup, Holder) != 0)
+	{
+		delete Holder;
+		return false;
+	}
+	return true;
+}
+
+
+
+
+
+size_t cTCPLinkImpl::GetQueuedSendSize(void) const
+{
+	return evbuffer_get_length(bufferevent_get_output(m_BufferEvent));
+}
+
+
+
+
+
 void cTCPLinkImpl::Shutdown(void)
 {
 	// If running in TLS mode, notify the TLS layer:
@@ -60,6 +60,8 @@ public:
 
 	// cTCPLink overrides:
 	virtual bool Send(const void * a_Data, size_t a_Length) override;
+	virtual bool Send(std::shared_ptr<const ContiguousByteBuffer> a_Data) override;
+	virtual size_t GetQueuedSendSize(void) const override;
 	virtual AString GetLocalIP(void) const override { return m_LocalIP; }
 	virtual UInt16 GetLocalPort(void) const override { return m_LocalPort; }
 	virtual AString GetRemoteIP(void) const override { return m_RemoteIP; }
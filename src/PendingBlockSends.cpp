@@ -0,0 +1,57 @@
+// PendingBlockSends.cpp
+
+// Implements the cPendingBlockSends class that collects a chunk's block changes to be sent to its clients
+
+#include "Globals.h"
+#include "PendingBlockSends.h"
+
+
+
+
+
+cPendingBlockSends::cPendingBlockSends(void)
+{
+	m_Counts.fill(0);
+}
+
+
+
+
+
+void cPendingBlockSends::Add(const int a_ChunkX, const int a_ChunkZ, const int a_RelX, const int a_RelY, const int a_RelZ, const BLOCKTYPE a_BlockType, const NIBBLETYPE a_BlockMeta, const size_t a_Threshold)
+{
+	const auto Section = static_cast<size_t>(a_RelY / cChunkDef::SectionHeight);
+	if (m_Sections[Section])
+	{
+		// The whole section is going to be resent:
+		return;
+	}
+
+	m_Blocks.emplace_back(a_ChunkX, a_ChunkZ, a_RelX, a_RelY, a_RelZ, a_BlockType, a_BlockMeta);
+	m_Counts[Section] += 1;
+	if (m_Counts[Section] <= a_Threshold)
+	{
+		return;
+	}
+
+	// Too many changes, resending the section is cheaper than sending each of them:
+	m_Sections.set(Section);
+	m_Blocks.erase(
+		std::remove_if(m_Blocks.begin(), m_Blocks.end(), [Section](const sSetBlock & a_Change)
+		{
+			return (static_cast<size_t>(a_Change.m_RelY / cChunkDef::SectionHeight) == Section);
+		}),
+		m_Blocks.end()
+	);
+}
+
+
+
+
+
+void cPendingBlockSends::Clear(void)
+{
+	m_Blocks.clear();
+	m_Counts.fill(0);
+	m_Sections.reset();
+}
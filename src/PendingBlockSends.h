@@ -0,0 +1,59 @@
+// PendingBlockSends.h
+
+// Declares the cPendingBlockSends class that collects a chunk's block changes to be sent to its clients
+
+/*
+The block changes of a chunk are collected during a tick and sent to its clients at the end of it, coalesced into
+a multi-block-change packet. When a section receives many changes in one tick (explosions, WorldEdit-like plugins),
+resending the whole section as a chunk packet is cheaper than the long list of single changes; once a section goes over
+the threshold, its single changes are dropped and the section is marked to be resent whole instead.
+*/
+
+
+
+
+
+#pragma once
+
+#include "ChunkDef.h"
+
+
+
+
+
+class cPendingBlockSends
+{
+public:
+
+	cPendingBlockSends(void);
+
+	/** Queues the change of the block at the relative coords in the chunk.
+	Once a section has more than a_Threshold changes queued, it's marked to be resent whole and its single changes are dropped;
+	the later changes to it are not queued. */
+	void Add(int a_ChunkX, int a_ChunkZ, int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta, size_t a_Threshold);
+
+	/** Returns the queued single block changes, none of them in the sections to be resent whole. */
+	const sSetBlockVector & GetBlocks(void) const { return m_Blocks; }
+
+	/** Returns the mask of the sections to be resent whole, bit Y set for section Y. */
+	UInt16 GetSectionMask(void) const { return static_cast<UInt16>(m_Sections.to_ulong()); }
+
+	/** Drops everything queued, after it's been sent or when the chunk's data is replaced. */
+	void Clear(void);
+
+protected:
+
+	/** The queued single block changes. */
+	sSetBlockVector m_Blocks;
+
+	/** The number of block changes queued for each section since the last Clear(). */
+	std::array<size_t, cChunkDef::NumSections> m_Counts;
+
+	/** The sections that have had too many block changes, and will be resent whole.
+	Their block changes aren't queued in m_Blocks. */
+	std::bitset<cChunkDef::NumSections> m_Sections;
+} ;
+
+
+
+
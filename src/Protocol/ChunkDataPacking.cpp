@@ -0,0 +1,111 @@
+// ChunkDataPacking.cpp
+
+// Implements the kernels used by cChunkDataSerializer to convert and bit-pack the block data of chunk sections
+
+#include "Globals.h"
+#include "ChunkDataPacking.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+	#define CHUNKDATAPACKING_SSE2
+	#include <emmintrin.h>
+#endif
+
+
+
+
+
+namespace ChunkDataPacking
+{
+	void MakeBlockKeys(const BLOCKTYPE * a_Blocks, const NIBBLETYPE * a_Metas, UInt16 * a_Keys)
+	{
+		#ifdef CHUNKDATAPACKING_SSE2
+			const auto Zero = _mm_setzero_si128();
+			const auto LowNibbles = _mm_set1_epi8(0x0f);
+
+			// 16 blocks at a time, their metas are in 8 bytes:
+			for (size_t i = 0; i < SectionBlockCount; i += 16)
+			{
+				const auto Blocks = (a_Blocks == nullptr) ? Zero : _mm_loadu_si128(reinterpret_cast<const __m128i *>(a_Blocks + i));
+				const auto PackedMetas = (a_Metas == nullptr) ? Zero : _mm_loadl_epi64(reinterpret_cast<const __m128i *>(a_Metas + i / 2));
+
+				// The even blocks' metas are in the low nibbles, the odd blocks' in the high ones; interleave them back into block order:
+				const auto EvenMetas = _mm_and_si128(PackedMetas, LowNibbles);
+				const auto OddMetas = _mm_and_si128(_mm_srli_epi16(PackedMetas, 4), LowNibbles);
+				const auto Metas = _mm_unpacklo_epi8(EvenMetas, OddMetas);
+
+				// Widen to 16 bits and combine:
+				const auto KeysLo = _mm_or_si128(_mm_slli_epi16(_mm_unpacklo_epi8(Blocks, Zero), 4), _mm_unpacklo_epi8(Metas, Zero));
+				const auto KeysHi = _mm_or_si128(_mm_slli_epi16(_mm_unpackhi_epi8(Blocks, Zero), 4), _mm_unpackhi_epi8(Metas, Zero));
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(a_Keys + i), KeysLo);
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(a_Keys + i + 8), KeysHi);
+			}
+		#else
+			MakeBlockKeysScalar(a_Blocks, a_Metas, a_Keys);
+		#endif
+	}
+
+
+
+
+
+	void MakeBlockKeysScalar(const BLOCKTYPE * a_Blocks, const NIBBLETYPE * a_Metas, UInt16 * a_Keys)
+	{
+		for (size_t i = 0; i < SectionBlockCount; i += 2)
+		{
+			const UInt16 Block0 = (a_Blocks == nullptr) ? 0 : a_Blocks[i];
+			const UInt16 Block1 = (a_Blocks == nullptr) ? 0 : a_Blocks[i + 1];
+			const UInt16 Metas = (a_Metas == nullptr) ? 0 : a_Metas[i / 2];
+			a_Keys[i]     = static_cast<UInt16>((Block0 << 4) | (Metas & 0x0f));
+			a_Keys[i + 1] = static_cast<UInt16>((Block1 << 4) | (Metas >> 4));
+		}
+	}
+
+
+
+
+
+	void MapBlockKeys(const UInt16 * a_Keys, const UInt32 * a_Table, UInt32 * a_Values)
+	{
+		for (size_t i = 0; i < SectionBlockCount; i++)
+		{
+			a_Values[i] = a_Table[a_Keys[i]];
+		}
+	}
+
+
+
+
+
+	void PackBits(const UInt32 * a_Values, const UInt8 a_BitsPerEntry, std::byte * a_Out)
+	{
+		// https://wiki.vg/Chunk_Format#Data_structure
+		// The values are composed into Buffer from its least significant bit up; once it has 64 bits, it's written out,
+		// and the bits of the value that didn't fit in start the next long:
+		ASSERT((a_BitsPerEntry > 0) && (a_BitsPerEntry < 32));
+
+		UInt64 Buffer = 0;
+		unsigned BitIndex = 0;
+		for (size_t i = 0; i < SectionBlockCount; i++)
+		{
+			const UInt64 Value = a_Values[i];
+			Buffer |= Value << BitIndex;
+			BitIndex += a_BitsPerEntry;
+			if (BitIndex >= 64)
+			{
+				for (int Byte = 7; Byte >= 0; Byte--)
+				{
+					*a_Out++ = static_cast<std::byte>(Buffer >> (Byte * 8));
+				}
+				BitIndex -= 64;
+				Buffer = (BitIndex == 0) ? 0 : (Value >> (a_BitsPerEntry - BitIndex));
+			}
+		}
+
+		static_assert(((SectionBlockCount % 64) == 0), "Section must fit wholly into a 64-bit long array");
+		ASSERT(BitIndex == 0);
+	}
+}
+
+
+
+
@@ -0,0 +1,58 @@
+// ChunkDataPacking.h
+
+// Declares the kernels used by cChunkDataSerializer to convert and bit-pack the block data of chunk sections
+
+/*
+Serializing a chunk section for the protocol goes through three steps for each of its 4096 blocks:
+1. Combine the block type with its nibble-packed meta into the legacy block key, (BlockType << 4) | BlockMeta.
+2. Map the key through the protocol's palette into the value sent to the client.
+3. Pack the values, each of a fixed bit width, seamlessly into big-endian 64-bit longs.
+Each step is done over the whole section at once, so that the loops are tight and don't call anything per block.
+The first step is vectorized with SSE2 where available (always on x86-64), the rest is plain scalar code;
+the palettes are precomputed into lookup tables of all the 4096 possible keys by the serializer.
+*/
+
+
+
+
+
+#pragma once
+
+#include "../ChunkDef.h"
+
+
+
+
+
+namespace ChunkDataPacking
+{
+	/** The number of blocks in a chunk section. */
+	constexpr size_t SectionBlockCount = 16 * 16 * 16;
+
+	/** The number of distinct legacy block keys, (BlockType << 4) | BlockMeta. */
+	constexpr size_t NumBlockKeys = 256 * 16;
+
+	/** Combines the block types and the nibble-packed metas of a section into the legacy block keys, (BlockType << 4) | BlockMeta.
+	Either input may be nullptr, standing for all zeroes. Uses the vectorized version where available. */
+	void MakeBlockKeys(const BLOCKTYPE * a_Blocks, const NIBBLETYPE * a_Metas, UInt16 * a_Keys);
+
+	/** The scalar version of MakeBlockKeys(), for the CPUs without a vectorized one, and for comparison. */
+	void MakeBlockKeysScalar(const BLOCKTYPE * a_Blocks, const NIBBLETYPE * a_Metas, UInt16 * a_Keys);
+
+	/** Maps each of the section's block keys through the lookup table, which has an entry for each of the NumBlockKeys keys. */
+	void MapBlockKeys(const UInt16 * a_Keys, const UInt32 * a_Table, UInt32 * a_Values);
+
+	/** Packs the section's values, each a_BitsPerEntry wide, seamlessly into 64-bit longs, written big-endian into a_Out.
+	A value may span two longs. a_Out must have room for GetPackedSize(a_BitsPerEntry) bytes. */
+	void PackBits(const UInt32 * a_Values, UInt8 a_BitsPerEntry, std::byte * a_Out);
+
+	/** Returns the number of bytes that PackBits() writes for the specified bit width. */
+	constexpr size_t GetPackedSize(UInt8 a_BitsPerEntry)
+	{
+		return SectionBlockCount * a_BitsPerEntry / 8;
+	}
+}
+
+
+
+
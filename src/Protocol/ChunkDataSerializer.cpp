@@ -1,8 +1,8 @@
 #include "Globals.h"
 #include "ChunkDataSerializer.h"
+#include "ChunkDataPacking.h"
 #include "Protocol_1_8.h"
 #include "Protocol_1_9.h"
-#include "../ClientHandle.h"
 #include "../WorldStorage/FastNBT.h"
 
 #include "Palettes/Upgrade.h"
@@ -14,20 +14,53 @@
 
 
 
+/** Calls the callback for each section in the mask, with the same variables as ChunkDef_ForEachSection.
+Unlike it, the sections in the mask are included even when empty, so that they can be sent as air. */
+#define ForEachSerializedSection(SectionMask, BlockData, LightData, Callback) \
+	do \
+	{ \
+		ChunkBlockData::BlockArray BlocksScratch; \
+		for (size_t Y = 0; Y < cChunkDef::NumSections; ++Y) \
+		{ \
+			if ((((SectionMask) >> Y) & 1) == 0) \
+			{ \
+				continue; \
+			} \
+			const auto Blocks = BlockData.GetSection(Y, BlocksScratch); \
+			const auto Metas = BlockData.GetMetaSection(Y); \
+			const auto BlockLights = LightData.GetBlockLightSection(Y); \
+			const auto SkyLights = LightData.GetSkyLightSection(Y); \
+			UNUSED_VAR(Blocks); \
+			UNUSED_VAR(Metas); \
+			UNUSED_VAR(BlockLights); \
+			UNUSED_VAR(SkyLights); \
+			Callback \
+		} \
+	} while (false)
+
+
+
+
+
 namespace
 {
-	std::pair<UInt16, size_t> GetSectionBitmask(const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData)
+	/** Returns the mask of the sections that have any data in them, the ones that a full chunk packet sends. */
+	UInt16 GetSectionBitmask(const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData)
 	{
-		size_t Present = 0;
 		UInt16 Mask = 0;
 
 		ChunkDef_ForEachSection(a_BlockData, a_LightData,
 		{
-			Present++;
 			Mask |= (1 << Y);
 		});
 
-		return { Mask, Present };
+		return Mask;
+	}
+
+	/** Returns the number of sections in the mask. */
+	size_t CountSections(const UInt16 a_SectionMask)
+	{
+		return std::bitset<cChunkDef::NumSections>(a_SectionMask).count();
 	}
 
 	auto PaletteLegacy(const BLOCKTYPE a_BlockType, const NIBBLETYPE a_Meta)
@@ -49,6 +82,22 @@ namespace
 	{
 		return Palette_1_14::From(PaletteUpgrade::FromBlock(a_BlockType, a_Meta));
 	}
+
+	/** Returns the palette's values for all the legacy block keys, (BlockType << 4) | BlockMeta, computed on first use. */
+	template <auto Palette>
+	const std::array<UInt32, ChunkDataPacking::NumBlockKeys> & GetPaletteTable()
+	{
+		static const auto Table = []
+		{
+			std::array<UInt32, ChunkDataPacking::NumBlockKeys> Result;
+			for (size_t Key = 0; Key < Result.size(); Key++)
+			{
+				Result[Key] = static_cast<UInt32>(Palette(static_cast<BLOCKTYPE>(Key >> 4), static_cast<NIBBLETYPE>(Key & 0x0f)));
+			}
+			return Result;
+		}();
+		return Table;
+	}
 }
 
 
@@ -68,136 +117,134 @@ cChunkDataSerializer::cChunkDataSerializer(const eDimension a_Dimension) :
 
 
 
-void cChunkDataSerializer::SendToClients(const int a_ChunkX, const int a_ChunkZ, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, const unsigned char * a_BiomeMap, const ClientHandles & a_SendTo)
+ContiguousByteBuffer cChunkDataSerializer::Serialize(const CacheVersion a_CacheVersion, const int a_ChunkX, const int a_ChunkZ, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, const unsigned char * a_BiomeMap)
 {
-	for (const auto & Client : a_SendTo)
-	{
-		switch (static_cast<cProtocol::Version>(Client->GetProtocolVersion()))
-		{
-			case cProtocol::Version::v1_8_0:
-			{
-				Serialize(Client, a_ChunkX, a_ChunkZ, a_BlockData, a_LightData, a_BiomeMap, CacheVersion::v47);
-				continue;
-			}
-			case cProtocol::Version::v1_9_0:
-			case cProtocol::Version::v1_9_1:
-			case cProtocol::Version::v1_9_2:
-			{
-				Serialize(Client, a_ChunkX, a_ChunkZ, a_BlockData, a_LightData, a_BiomeMap, CacheVersion::v107);
-				continue;
-			}
-			case cProtocol::Version::v1_9_4:
-			case cProtocol::Version::v1_10_0:
-			case cProtocol::Version::v1_11_0:
-			case cProtocol::Version::v1_11_1:
-			case cProtocol::Version::v1_12:
-			case cProtocol::Version::v1_12_1:
-			case cProtocol::Version::v1_12_2:
-			{
-				Serialize(Client, a_ChunkX, a_ChunkZ, a_BlockData, a_LightData, a_BiomeMap, CacheVersion::v110);
-				continue;
-			}
-			case cProtocol::Version::v1_13:
-			{
-				Serialize(Client, a_ChunkX, a_ChunkZ, a_BlockData, a_LightData, a_BiomeMap, CacheVersion::v393);  // This version didn't last very long xD
-				continue;
-			}
-			case cProtocol::Version::v1_13_1:
-			case cProtocol::Version::v1_13_2:
-			{
-				Serialize(Client, a_ChunkX, a_ChunkZ, a_BlockData, a_LightData, a_BiomeMap, CacheVersion::v401);
-				continue;
-			}
-			case cProtocol::Version::v1_14:
-			{
-				Serialize(Client, a_ChunkX, a_ChunkZ, a_BlockData, a_LightData, a_BiomeMap, CacheVersion::v477);
-				continue;
-			}
-		}
-		UNREACHABLE("Unknown chunk data serialization version");
-	}
-
-	// Our cache is only persistent during the function call:
-	for (auto & Cache : m_Cache)
-	{
-		Cache.Engaged = false;
-	}
+	ASSERT(a_BiomeMap != nullptr);
+	return Serialize(a_CacheVersion, a_ChunkX, a_ChunkZ, GetSectionBitmask(a_BlockData, a_LightData), a_BlockData, a_LightData, a_BiomeMap);
 }
 
 
 
 
 
-inline void cChunkDataSerializer::Serialize(const ClientHandles::value_type & a_Client, const int a_ChunkX, const int a_ChunkZ, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, const unsigned char * a_BiomeMap, const CacheVersion a_CacheVersion)
+ContiguousByteBuffer cChunkDataSerializer::SerializeSections(const CacheVersion a_CacheVersion, const int a_ChunkX, const int a_ChunkZ, const UInt16 a_SectionMask, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData)
 {
-	auto & Cache = m_Cache[static_cast<size_t>(a_CacheVersion)];
-	if (Cache.Engaged)
-	{
-		// Success! We've done it already, just re-use:
-		a_Client->SendChunkData(a_ChunkX, a_ChunkZ, Cache.ToSend);
-		return;
-	}
+	// An empty mask in a packet without the biomes tells the client to unload the chunk:
+	ASSERT(a_SectionMask != 0);
+	return Serialize(a_CacheVersion, a_ChunkX, a_ChunkZ, a_SectionMask, a_BlockData, a_LightData, nullptr);
+}
+
 
+
+
+
+ContiguousByteBuffer cChunkDataSerializer::Serialize(const CacheVersion a_CacheVersion, const int a_ChunkX, const int a_ChunkZ, const UInt16 a_SectionMask, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, const unsigned char * a_BiomeMap)
+{
 	switch (a_CacheVersion)
 	{
 		case CacheVersion::v47:
 		{
-			Serialize47(a_ChunkX, a_ChunkZ, a_BlockData, a_LightData, a_BiomeMap);
+			Serialize47(a_ChunkX, a_ChunkZ, a_SectionMask, a_BlockData, a_LightData, a_BiomeMap);
 			break;
 		}
 		case CacheVersion::v107:
 		{
-			Serialize107(a_ChunkX, a_ChunkZ, a_BlockData, a_LightData, a_BiomeMap);
+			Serialize107(a_ChunkX, a_ChunkZ, a_SectionMask, a_BlockData, a_LightData, a_BiomeMap);
 			break;
 		}
 		case CacheVersion::v110:
 		{
-			Serialize110(a_ChunkX, a_ChunkZ, a_BlockData, a_LightData, a_BiomeMap);
+			Serialize110(a_ChunkX, a_ChunkZ, a_SectionMask, a_BlockData, a_LightData, a_BiomeMap);
 			break;
 		}
 		case CacheVersion::v393:
 		{
-			Serialize393<&Palette393>(a_ChunkX, a_ChunkZ, a_BlockData, a_LightData, a_BiomeMap);
+			Serialize393<&Palette393>(a_ChunkX, a_ChunkZ, a_SectionMask, a_BlockData, a_LightData, a_BiomeMap);
 			break;
 		}
 		case CacheVersion::v401:
 		{
-			Serialize393<&Palette401>(a_ChunkX, a_ChunkZ, a_BlockData, a_LightData, a_BiomeMap);
+			Serialize393<&Palette401>(a_ChunkX, a_ChunkZ, a_SectionMask, a_BlockData, a_LightData, a_BiomeMap);
 			break;
 		}
 		case CacheVersion::v477:
 		{
-			Serialize477(a_ChunkX, a_ChunkZ, a_BlockData, a_LightData, a_BiomeMap);
+			Serialize477(a_ChunkX, a_ChunkZ, a_SectionMask, a_BlockData, a_LightData, a_BiomeMap);
 			break;
 		}
 	}
 
-	CompressPacketInto(Cache);
-	ASSERT(Cache.Engaged);  // Cache must be populated now
-	a_Client->SendChunkData(a_ChunkX, a_ChunkZ, Cache.ToSend);
+	ContiguousByteBuffer Data;
+	CompressPacketInto(Data);
+	return Data;
 }
 
 
 
 
 
-inline void cChunkDataSerializer::Serialize47(const int a_ChunkX, const int a_ChunkZ, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, const unsigned char * a_BiomeMap)
+cChunkDataSerializer::CacheVersion cChunkDataSerializer::GetCacheVersion(const UInt32 a_ProtocolVersion)
+{
+	switch (static_cast<cProtocol::Version>(a_ProtocolVersion))
+	{
+		case cProtocol::Version::v1_8_0:
+		{
+			return CacheVersion::v47;
+		}
+		case cProtocol::Version::v1_9_0:
+		case cProtocol::Version::v1_9_1:
+		case cProtocol::Version::v1_9_2:
+		{
+			return CacheVersion::v107;
+		}
+		case cProtocol::Version::v1_9_4:
+		case cProtocol::Version::v1_10_0:
+		case cProtocol::Version::v1_11_0:
+		case cProtocol::Version::v1_11_1:
+		case cProtocol::Version::v1_12:
+		case cProtocol::Version::v1_12_1:
+		case cProtocol::Version::v1_12_2:
+		{
+			return CacheVersion::v110;
+		}
+		case cProtocol::Version::v1_13:
+		{
+			return CacheVersion::v393;  // This version didn't last very long xD
+		}
+		case cProtocol::Version::v1_13_1:
+		case cProtocol::Version::v1_13_2:
+		{
+			return CacheVersion::v401;
+		}
+		case cProtocol::Version::v1_14:
+		{
+			return CacheVersion::v477;
+		}
+	}
+	UNREACHABLE("Unknown chunk data serialization version");
+}
+
+
+
+
+
+inline void cChunkDataSerializer::Serialize47(const int a_ChunkX, const int a_ChunkZ, const UInt16 a_SectionMask, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, const unsigned char * a_BiomeMap)
 {
 	// This function returns the fully compressed packet (including packet size), not the raw packet!
 
-	const auto Bitmask = GetSectionBitmask(a_BlockData, a_LightData);
+	const auto NumSections = CountSections(a_SectionMask);
 
 	// Create the packet:
 	m_Packet.WriteVarInt32(0x21);  // Packet id (Chunk Data packet)
 	m_Packet.WriteBEInt32(a_ChunkX);
 	m_Packet.WriteBEInt32(a_ChunkZ);
-	m_Packet.WriteBool(true);      // "Ground-up continuous", or rather, "biome data present" flag
-	m_Packet.WriteBEUInt16(Bitmask.first);
+	m_Packet.WriteBool(a_BiomeMap != nullptr);      // "Ground-up continuous", or rather, "biome data present" flag; without it, only the sections in the mask are updated
+	m_Packet.WriteBEUInt16(a_SectionMask);
 
 	// Write the chunk size:
-	const int BiomeDataSize = cChunkDef::Width * cChunkDef::Width;
+	const int BiomeDataSize = (a_BiomeMap == nullptr) ? 0 : (cChunkDef::Width * cChunkDef::Width);
 	const size_t ChunkSize = (
-		Bitmask.second * (ChunkBlockData::SectionBlockCount * 2 + ChunkLightData::SectionLightCount * 2) +  // Blocks and lighting
+		NumSections * (ChunkBlockData::SectionBlockCount * 2 + ChunkLightData::SectionLightCount * 2) +  // Blocks and lighting
 		BiomeDataSize    // Biome data
 	);
 	m_Packet.WriteVarInt32(static_cast<UInt32>(ChunkSize));
@@ -205,23 +252,30 @@ inline void cChunkDataSerializer::Serialize47(const int a_ChunkX, const int a_Ch
 	// Chunk written as seperate arrays of (blocktype + meta), blocklight and skylight
 	// each array stores all present sections of the same kind packed together
 
-	// Write the block types to the packet:
-	ChunkDef_ForEachSection(a_BlockData, a_LightData,
+	// Write the block types to the packet, each as the little-endian 16-bit (BlockType << 4) | BlockMeta
+	// (the array types are aliased, their template argument commas would split the macro's arguments):
+	using KeyArray = std::array<UInt16, ChunkBlockData::SectionBlockCount>;
+	using ByteArray = std::array<Byte, ChunkBlockData::SectionBlockCount * 2>;
+	ForEachSerializedSection(a_SectionMask, a_BlockData, a_LightData,
 	{
-		const bool BlocksExist = Blocks != nullptr;
-		const bool MetasExist = Metas != nullptr;
-
+		KeyArray Keys;
+		ChunkDataPacking::MakeBlockKeys(
+			(Blocks == nullptr) ? nullptr : Blocks->data(),
+			(Metas == nullptr) ? nullptr : Metas->data(),
+			Keys.data()
+		);
+
+		ByteArray Bytes;
 		for (size_t BlockIdx = 0; BlockIdx != ChunkBlockData::SectionBlockCount; ++BlockIdx)
 		{
-			BLOCKTYPE BlockType = BlocksExist ? (*Blocks)[BlockIdx] : 0;
-			NIBBLETYPE BlockMeta = MetasExist ? cChunkDef::ExpandNibble(Metas->data(), BlockIdx) : 0;
-			m_Packet.WriteBEUInt8(static_cast<unsigned char>(BlockType << 4) | BlockMeta);
-			m_Packet.WriteBEUInt8(static_cast<unsigned char>(BlockType >> 4));
+			Bytes[BlockIdx * 2]     = static_cast<Byte>(Keys[BlockIdx] & 0xff);
+			Bytes[BlockIdx * 2 + 1] = static_cast<Byte>(Keys[BlockIdx] >> 8);
 		}
+		m_Packet.WriteBuf(Bytes.data(), Bytes.size());
 	});
 
 	// Write the block lights:
-	ChunkDef_ForEachSection(a_BlockData, a_LightData,
+	ForEachSerializedSection(a_SectionMask, a_BlockData, a_LightData,
 	{
 		if (BlockLights == nullptr)
 		{
@@ -234,7 +288,7 @@ inline void cChunkDataSerializer::Serialize47(const int a_ChunkX, const int a_Ch
 	});
 
 	// Write the sky lights:
-	ChunkDef_ForEachSection(a_BlockData, a_LightData,
+	ForEachSerializedSection(a_SectionMask, a_BlockData, a_LightData,
 	{
 		if (SkyLights == nullptr)
 		{
@@ -247,14 +301,17 @@ inline void cChunkDataSerializer::Serialize47(const int a_ChunkX, const int a_Ch
 	});
 
 	// Write the biome data:
-	m_Packet.WriteBuf(a_BiomeMap, BiomeDataSize);
+	if (a_BiomeMap != nullptr)
+	{
+		m_Packet.WriteBuf(a_BiomeMap, BiomeDataSize);
+	}
 }
 
 
 
 
 
-inline void cChunkDataSerializer::Serialize107(const int a_ChunkX, const int a_ChunkZ, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, const unsigned char * a_BiomeMap)
+inline void cChunkDataSerializer::Serialize107(const int a_ChunkX, const int a_ChunkZ, const UInt16 a_SectionMask, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, const unsigned char * a_BiomeMap)
 {
 	// This function returns the fully compressed packet (including packet size), not the raw packet!
 	// Below variables tagged static because of https://developercommunity.visualstudio.com/content/problem/367326
@@ -262,14 +319,14 @@ inline void cChunkDataSerializer::Serialize107(const int a_ChunkX, const int a_C
 	static constexpr UInt8 BitsPerEntry = 13;
 	static constexpr size_t ChunkSectionDataArraySize = (ChunkBlockData::SectionBlockCount * BitsPerEntry) / 8 / 8;  // Convert from bit count to long count
 
-	const auto Bitmask = GetSectionBitmask(a_BlockData, a_LightData);
+	const auto NumSections = CountSections(a_SectionMask);
 
 	// Create the packet:
 	m_Packet.WriteVarInt32(0x20);  // Packet id (Chunk Data packet)
 	m_Packet.WriteBEInt32(a_ChunkX);
 	m_Packet.WriteBEInt32(a_ChunkZ);
-	m_Packet.WriteBool(true);        // "Ground-up continuous", or rather, "biome data present" flag
-	m_Packet.WriteVarInt32(Bitmask.first);
+	m_Packet.WriteBool(a_BiomeMap != nullptr);        // "Ground-up continuous", or rather, "biome data present" flag; without it, only the sections in the mask are updated
+	m_Packet.WriteVarInt32(a_SectionMask);
 
 	size_t ChunkSectionSize = (
 		1 +                                // Bits per block - set to 13, so the global palette is used and the palette has a length of 0
@@ -285,9 +342,9 @@ inline void cChunkDataSerializer::Serialize107(const int a_ChunkX, const int a_C
 		ChunkSectionSize += ChunkLightData::SectionLightCount;
 	}
 
-	const size_t BiomeDataSize = cChunkDef::Width * cChunkDef::Width;
+	const size_t BiomeDataSize = (a_BiomeMap == nullptr) ? 0 : (cChunkDef::Width * cChunkDef::Width);
 	const size_t ChunkSize = (
-		ChunkSectionSize * Bitmask.second +
+		ChunkSectionSize * NumSections +
 		BiomeDataSize
 	);
 
@@ -295,7 +352,7 @@ inline void cChunkDataSerializer::Serialize107(const int a_ChunkX, const int a_C
 	m_Packet.WriteVarInt32(static_cast<UInt32>(ChunkSize));
 
 	// Write each chunk section...
-	ChunkDef_ForEachSection(a_BlockData, a_LightData,
+	ForEachSerializedSection(a_SectionMask, a_BlockData, a_LightData,
 	{
 		m_Packet.WriteBEUInt8(BitsPerEntry);
 		m_Packet.WriteVarInt32(0);  // Palette length is 0
@@ -305,14 +362,17 @@ inline void cChunkDataSerializer::Serialize107(const int a_ChunkX, const int a_C
 	});
 
 	// Write the biome data
-	m_Packet.WriteBuf(a_BiomeMap, BiomeDataSize);
+	if (a_BiomeMap != nullptr)
+	{
+		m_Packet.WriteBuf(a_BiomeMap, BiomeDataSize);
+	}
 }
 
 
 
 
 
-inline void cChunkDataSerializer::Serialize110(const int a_ChunkX, const int a_ChunkZ, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, const unsigned char * a_BiomeMap)
+inline void cChunkDataSerializer::Serialize110(const int a_ChunkX, const int a_ChunkZ, const UInt16 a_SectionMask, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, const unsigned char * a_BiomeMap)
 {
 	// This function returns the fully compressed packet (including packet size), not the raw packet!
 	// Below variables tagged static because of https://developercommunity.visualstudio.com/content/problem/367326
@@ -320,14 +380,14 @@ inline void cChunkDataSerializer::Serialize110(const int a_ChunkX, const int a_C
 	static constexpr UInt8 BitsPerEntry = 13;
 	static constexpr size_t ChunkSectionDataArraySize = (ChunkBlockData::SectionBlockCount * BitsPerEntry) / 8 / 8;  // Convert from bit count to long count
 
-	const auto Bitmask = GetSectionBitmask(a_BlockData, a_LightData);
+	const auto NumSections = CountSections(a_SectionMask);
 
 	// Create the packet:
 	m_Packet.WriteVarInt32(0x20);  // Packet id (Chunk Data packet)
 	m_Packet.WriteBEInt32(a_ChunkX);
 	m_Packet.WriteBEInt32(a_ChunkZ);
-	m_Packet.WriteBool(true);        // "Ground-up continuous", or rather, "biome data present" flag
-	m_Packet.WriteVarInt32(Bitmask.first);
+	m_Packet.WriteBool(a_BiomeMap != nullptr);        // "Ground-up continuous", or rather, "biome data present" flag; without it, only the sections in the mask are updated
+	m_Packet.WriteVarInt32(a_SectionMask);
 
 	size_t ChunkSectionSize = (
 		1 +                                // Bits per block - set to 13, so the global palette is used and the palette has a length of 0
@@ -343,9 +403,9 @@ inline void cChunkDataSerializer::Serialize110(const int a_ChunkX, const int a_C
 		ChunkSectionSize += ChunkLightData::SectionLightCount;
 	}
 
-	const size_t BiomeDataSize = cChunkDef::Width * cChunkDef::Width;
+	const size_t BiomeDataSize = (a_BiomeMap == nullptr) ? 0 : (cChunkDef::Width * cChunkDef::Width);
 	const size_t ChunkSize = (
-		ChunkSectionSize * Bitmask.second +
+		ChunkSectionSize * NumSections +
 		BiomeDataSize
 	);
 
@@ -353,7 +413,7 @@ inline void cChunkDataSerializer::Serialize110(const int a_ChunkX, const int a_C
 	m_Packet.WriteVarInt32(static_cast<UInt32>(ChunkSize));
 
 	// Write each chunk section...
-	ChunkDef_ForEachSection(a_BlockData, a_LightData,
+	ForEachSerializedSection(a_SectionMask, a_BlockData, a_LightData,
 	{
 		m_Packet.WriteBEUInt8(BitsPerEntry);
 		m_Packet.WriteVarInt32(0);  // Palette length is 0
@@ -363,7 +423,10 @@ inline void cChunkDataSerializer::Serialize110(const int a_ChunkX, const int a_C
 	});
 
 	// Write the biome data
-	m_Packet.WriteBuf(a_BiomeMap, BiomeDataSize);
+	if (a_BiomeMap != nullptr)
+	{
+		m_Packet.WriteBuf(a_BiomeMap, BiomeDataSize);
+	}
 
 	// Identify 1.9.4's tile entity list as empty
 	m_Packet.WriteBEUInt8(0);
@@ -374,7 +437,7 @@ inline void cChunkDataSerializer::Serialize110(const int a_ChunkX, const int a_C
 
 
 template <auto Palette>
-inline void cChunkDataSerializer::Serialize393(const int a_ChunkX, const int a_ChunkZ, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, const unsigned char * a_BiomeMap)
+inline void cChunkDataSerializer::Serialize393(const int a_ChunkX, const int a_ChunkZ, const UInt16 a_SectionMask, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, const unsigned char * a_BiomeMap)
 {
 	// This function returns the fully compressed packet (including packet size), not the raw packet!
 	// Below variables tagged static because of https://developercommunity.visualstudio.com/content/problem/367326
@@ -382,14 +445,14 @@ inline void cChunkDataSerializer::Serialize393(const int a_ChunkX, const int a_C
 	static constexpr UInt8 BitsPerEntry = 14;
 	static constexpr size_t ChunkSectionDataArraySize = (ChunkBlockData::SectionBlockCount * BitsPerEntry) / 8 / 8;
 
-	const auto Bitmask = GetSectionBitmask(a_BlockData, a_LightData);
+	const auto NumSections = CountSections(a_SectionMask);
 
 	// Create the packet:
 	m_Packet.WriteVarInt32(0x22);  // Packet id (Chunk Data packet)
 	m_Packet.WriteBEInt32(a_ChunkX);
 	m_Packet.WriteBEInt32(a_ChunkZ);
-	m_Packet.WriteBool(true);  // "Ground-up continuous", or rather, "biome data present" flag
-	m_Packet.WriteVarInt32(Bitmask.first);
+	m_Packet.WriteBool(a_BiomeMap != nullptr);  // "Ground-up continuous", or rather, "biome data present" flag; without it, only the sections in the mask are updated
+	m_Packet.WriteVarInt32(a_SectionMask);
 
 	size_t ChunkSectionSize = (
 		1 +  // Bits per entry, BEUInt8, 1 byte
@@ -404,9 +467,9 @@ inline void cChunkDataSerializer::Serialize393(const int a_ChunkX, const int a_C
 		ChunkSectionSize += ChunkLightData::SectionLightCount;
 	}
 
-	const size_t BiomeDataSize = cChunkDef::Width * cChunkDef::Width;
+	const size_t BiomeDataSize = (a_BiomeMap == nullptr) ? 0 : (cChunkDef::Width * cChunkDef::Width);
 	const size_t ChunkSize = (
-		ChunkSectionSize * Bitmask.second +
+		ChunkSectionSize * NumSections +
 		BiomeDataSize * 4  // Biome data now BE ints
 	);
 
@@ -414,7 +477,7 @@ inline void cChunkDataSerializer::Serialize393(const int a_ChunkX, const int a_C
 	m_Packet.WriteVarInt32(static_cast<UInt32>(ChunkSize));
 
 	// Write each chunk section...
-	ChunkDef_ForEachSection(a_BlockData, a_LightData,
+	ForEachSerializedSection(a_SectionMask, a_BlockData, a_LightData,
 	{
 		m_Packet.WriteBEUInt8(BitsPerEntry);
 		m_Packet.WriteVarInt32(static_cast<UInt32>(ChunkSectionDataArraySize));
@@ -436,7 +499,7 @@ inline void cChunkDataSerializer::Serialize393(const int a_ChunkX, const int a_C
 
 
 
-inline void cChunkDataSerializer::Serialize477(const int a_ChunkX, const int a_ChunkZ, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, const unsigned char * a_BiomeMap)
+inline void cChunkDataSerializer::Serialize477(const int a_ChunkX, const int a_ChunkZ, const UInt16 a_SectionMask, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, const unsigned char * a_BiomeMap)
 {
 	// This function returns the fully compressed packet (including packet size), not the raw packet!
 	// Below variables tagged static because of https://developercommunity.visualstudio.com/content/problem/367326
@@ -444,14 +507,14 @@ inline void cChunkDataSerializer::Serialize477(const int a_ChunkX, const int a_C
 	static constexpr UInt8 BitsPerEntry = 14;
 	static constexpr size_t ChunkSectionDataArraySize = (ChunkBlockData::SectionBlockCount * BitsPerEntry) / 8 / 8;
 
-	const auto Bitmask = GetSectionBitmask(a_BlockData, a_LightData);
+	const auto NumSections = CountSections(a_SectionMask);
 
 	// Create the packet:
 	m_Packet.WriteVarInt32(0x21);  // Packet id (Chunk Data packet)
 	m_Packet.WriteBEInt32(a_ChunkX);
 	m_Packet.WriteBEInt32(a_ChunkZ);
-	m_Packet.WriteBool(true);  // "Ground-up continuous", or rather, "biome data present" flag
-	m_Packet.WriteVarInt32(Bitmask.first);
+	m_Packet.WriteBool(a_BiomeMap != nullptr);  // "Ground-up continuous", or rather, "biome data present" flag; without it, only the sections in the mask are updated
+	m_Packet.WriteVarInt32(a_SectionMask);
 
 	{
 		cFastNBTWriter Writer;
@@ -469,9 +532,9 @@ inline void cChunkDataSerializer::Serialize477(const int a_ChunkX, const int a_C
 		ChunkSectionDataArraySize * 8  // Actual section data, lots of bytes (multiplier 1 long = 8 bytes)
 	);
 
-	const size_t BiomeDataSize = cChunkDef::Width * cChunkDef::Width;
+	const size_t BiomeDataSize = (a_BiomeMap == nullptr) ? 0 : (cChunkDef::Width * cChunkDef::Width);
 	const size_t ChunkSize = (
-		ChunkSectionSize * Bitmask.second +
+		ChunkSectionSize * NumSections +
 		BiomeDataSize * 4  // Biome data now BE ints
 	);
 
@@ -479,7 +542,7 @@ inline void cChunkDataSerializer::Serialize477(const int a_ChunkX, const int a_C
 	m_Packet.WriteVarInt32(static_cast<UInt32>(ChunkSize));
 
 	// Write each chunk section...
-	ChunkDef_ForEachSection(a_BlockData, a_LightData,
+	ForEachSerializedSection(a_SectionMask, a_BlockData, a_LightData,
 	{
 		m_Packet.WriteBEInt16(-1);
 		m_Packet.WriteBEUInt8(BitsPerEntry);
@@ -505,46 +568,23 @@ template <auto Palette>
 inline void cChunkDataSerializer::WriteBlockSectionSeamless(const ChunkBlockData::BlockArray * a_Blocks, const ChunkBlockData::MetaArray * a_Metas, const UInt8 a_BitsPerEntry)
 {
 	// https://wiki.vg/Chunk_Format#Data_structure
+	// The whole section is converted and packed at once, see ChunkDataPacking.h:
 
-	// We shift a UInt64 by a_BitsPerEntry, the latter cannot be too big:
-	ASSERT(a_BitsPerEntry < 64);
-
-	UInt64 Buffer = 0;  // A buffer to compose multiple smaller bitsizes into one 64-bit number
-	unsigned char BitIndex = 0;  // The bit-position in Buffer that represents where to write next
-
-	const bool BlocksExist = a_Blocks != nullptr;
-	const bool MetasExist = a_Metas != nullptr;
-
-	for (size_t Index = 0; Index != ChunkBlockData::SectionBlockCount; Index++)
-	{
-		const BLOCKTYPE BlockType = BlocksExist ? (*a_Blocks)[Index] : 0;
-		const NIBBLETYPE BlockMeta = MetasExist ? cChunkDef::ExpandNibble(a_Metas->data(), Index) : 0;
-		const auto Value = Palette(BlockType, BlockMeta);
-
-		// Write as much as possible of Value, starting from BitIndex, into Buffer:
-		Buffer |= static_cast<UInt64>(Value) << BitIndex;
-
-		// The _signed_ count of bits in Value left to write
-		const auto Remaining = static_cast<char>(a_BitsPerEntry - (64 - BitIndex));
-		if (Remaining >= 0)
-		{
-			// There were some bits remaining: we've filled the buffer. Flush it:
-			m_Packet.WriteBEUInt64(Buffer);
+	std::array<UInt16, ChunkBlockData::SectionBlockCount> Keys;
+	ChunkDataPacking::MakeBlockKeys(
+		(a_Blocks == nullptr) ? nullptr : a_Blocks->data(),
+		(a_Metas == nullptr) ? nullptr : a_Metas->data(),
+		Keys.data()
+	);
 
-			// And write the remaining bits, setting the new BitIndex:
-			Buffer = static_cast<UInt64>(Value >> (a_BitsPerEntry - Remaining));
-			BitIndex = static_cast<unsigned char>(Remaining);
-		}
-		else
-		{
-			// It fit, excellent.
-			BitIndex += a_BitsPerEntry;
-		}
-	}
+	std::array<UInt32, ChunkBlockData::SectionBlockCount> Values;
+	ChunkDataPacking::MapBlockKeys(Keys.data(), GetPaletteTable<Palette>().data(), Values.data());
 
-	static_assert((ChunkBlockData::SectionBlockCount % 64) == 0, "Section must fit wholly into a 64-bit long array");
-	ASSERT(BitIndex == 0);
-	ASSERT(Buffer == 0);
+	// Sized for the widest entries that are used:
+	std::array<std::byte, ChunkDataPacking::GetPackedSize(14)> Packed;
+	ASSERT(ChunkDataPacking::GetPackedSize(a_BitsPerEntry) <= Packed.size());
+	ChunkDataPacking::PackBits(Values.data(), a_BitsPerEntry, Packed.data());
+	m_Packet.WriteBuf(Packed.data(), ChunkDataPacking::GetPackedSize(a_BitsPerEntry));
 }
 
 
@@ -581,12 +621,14 @@ inline void cChunkDataSerializer::WriteLightSectionGrouped(const ChunkLightData:
 
 
 
-inline void cChunkDataSerializer::CompressPacketInto(ChunkDataCache & a_Cache)
+inline void cChunkDataSerializer::CompressPacketInto(ContiguousByteBuffer & a_Data)
 {
 	m_Compressor.ReadFrom(m_Packet);
 	m_Packet.CommitRead();
 
-	cProtocol_1_8_0::CompressPacket(m_Compressor, a_Cache.ToSend);
-
-	a_Cache.Engaged = true;
+	// The data is returned and shared by all the clients, so it must start with the packet; this is done once per serialized chunk:
+	const auto Packet = cProtocol_1_8_0::CompressPacket(m_Compressor, a_Data);
+	const auto PacketStart = static_cast<size_t>(Packet.data() - a_Data.data());
+	a_Data.resize(PacketStart + Packet.size());
+	a_Data.erase(0, PacketStart);
 }
@@ -16,12 +16,12 @@ class cByteBuffer;
 
 
 
-/** Serializes one chunk's data to (possibly multiple) protocol versions.
-Caches the serialized data for as long as this object lives, so that the same data can be sent to
-other clients using the same protocol. */
+/** Serializes chunk data to the protocol versions.
+Each thread serializing needs its own instance, it keeps a staging buffer and a compressor between the calls.
+The serialized data is returned independent of this object; caching it for other clients is up to the caller, see cSerializedChunkCache. */
 class cChunkDataSerializer
 {
-	using ClientHandles = std::vector<std::shared_ptr<cClientHandle>>;
+public:
 
 	/** Enum to collapse protocol versions into a contiguous index. */
 	enum class CacheVersion
@@ -36,33 +36,34 @@ class cChunkDataSerializer
 		Last = CacheVersion::v477
 	};
 
-	/** A single cache entry containing the raw data, compressed data, and a validity flag. */
-	struct ChunkDataCache
-	{
-		ContiguousByteBuffer ToSend;
-		bool Engaged = false;
-	};
-
-public:
+	/** The number of distinct CacheVersion values. */
+	static constexpr size_t NumCacheVersions = static_cast<size_t>(CacheVersion::Last) + 1;
 
 	cChunkDataSerializer(eDimension a_Dimension);
 
-	/** For each client, serializes the chunk into their protocol version and sends it.
-	Parameters are the coordinates of the chunk to serialise, and the data and biome data read from the chunk. */
-	void SendToClients(int a_ChunkX, int a_ChunkZ, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, const unsigned char * a_BiomeMap, const ClientHandles & a_SendTo);
+	/** Serializes the chunk into the specified version and returns the compressed packet, ready to be sent via cClientHandle::SendChunkData().
+	The returned data is independent of this object. */
+	ContiguousByteBuffer Serialize(CacheVersion a_CacheVersion, int a_ChunkX, int a_ChunkZ, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, const unsigned char * a_BiomeMap);
+
+	/** Serializes only the sections in a_SectionMask into the specified version, as a chunk packet that updates just them on a client that has the chunk.
+	The sections in the mask are sent even when empty, as air; the biomes aren't sent. a_SectionMask must not be empty.
+	The returned data is independent of this object. */
+	ContiguousByteBuffer SerializeSections(CacheVersion a_CacheVersion, int a_ChunkX, int a_ChunkZ, UInt16 a_SectionMask, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData);
+
+	/** Returns the version of the chunk data that the clients with the specified protocol version expect. */
+	static CacheVersion GetCacheVersion(UInt32 a_ProtocolVersion);
 
 private:
 
-	/** Serialises the given chunk, storing the result into the given cache entry, and sends the data.
-	If the cache entry is already present, simply re-uses it. */
-	inline void Serialize(const ClientHandles::value_type & a_Client, int a_ChunkX, int a_ChunkZ, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, const unsigned char * a_BiomeMap, CacheVersion a_CacheVersion);
+	/** Serializes the sections in a_SectionMask into the specified version. Without a_BiomeMap, only the sections are updated on the client. */
+	ContiguousByteBuffer Serialize(CacheVersion a_CacheVersion, int a_ChunkX, int a_ChunkZ, UInt16 a_SectionMask, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, const unsigned char * a_BiomeMap);
 
-	inline void Serialize47 (int a_ChunkX, int a_ChunkZ, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, const unsigned char * a_BiomeMap);  // Release 1.8
-	inline void Serialize107(int a_ChunkX, int a_ChunkZ, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, const unsigned char * a_BiomeMap);  // Release 1.9
-	inline void Serialize110(int a_ChunkX, int a_ChunkZ, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, const unsigned char * a_BiomeMap);  // Release 1.9.4
+	inline void Serialize47 (int a_ChunkX, int a_ChunkZ, UInt16 a_SectionMask, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, const unsigned char * a_BiomeMap);  // Release 1.8
+	inline void Serialize107(int a_ChunkX, int a_ChunkZ, UInt16 a_SectionMask, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, const unsigned char * a_BiomeMap);  // Release 1.9
+	inline void Serialize110(int a_ChunkX, int a_ChunkZ, UInt16 a_SectionMask, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, const unsigned char * a_BiomeMap);  // Release 1.9.4
 	template <auto Palette>
-	inline void Serialize393(int a_ChunkX, int a_ChunkZ, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, const unsigned char * a_BiomeMap);  // Release 1.13 - 1.13.2
-	inline void Serialize477(int a_ChunkX, int a_ChunkZ, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, const unsigned char * a_BiomeMap);  // Release 1.14 - 1.14.4
+	inline void Serialize393(int a_ChunkX, int a_ChunkZ, UInt16 a_SectionMask, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, const unsigned char * a_BiomeMap);  // Release 1.13 - 1.13.2
+	inline void Serialize477(int a_ChunkX, int a_ChunkZ, UInt16 a_SectionMask, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, const unsigned char * a_BiomeMap);  // Release 1.14 - 1.14.4
 
 	/** Writes all blocks in a chunk section into a series of Int64.
 	Writes start from the bit directly subsequent to the previous write's end, possibly crossing over to the next Int64. */
@@ -72,8 +73,8 @@ private:
 	/** Copies all lights in a chunk section into the packet, block light followed immediately by sky light. */
 	inline void WriteLightSectionGrouped(const ChunkLightData::LightArray * a_BlockLights, const ChunkLightData::LightArray * a_SkyLights);
 
-	/** Finalises the data, compresses it if required, and stores it into cache. */
-	inline void CompressPacketInto(ChunkDataCache & a_Cache);
+	/** Finalises the data, compresses it if required, and stores it into a_Data. */
+	inline void CompressPacketInto(ContiguousByteBuffer & a_Data);
 
 	/** A staging area used to construct the chunk packet, persistent to avoid reallocating. */
 	cByteBuffer m_Packet;
@@ -83,8 +84,4 @@ private:
 
 	/** The dimension for the World this Serializer is tied to. */
 	const eDimension m_Dimension;
-
-	/** A cache, mapping protocol version to a fully serialised chunk.
-	It is used during a single invocation of SendToClients with more than one client. */
-	std::array<ChunkDataCache, static_cast<size_t>(CacheVersion::Last) + 1> m_Cache;
 } ;
@@ -355,6 +355,9 @@ public:
 	The protocol modifies the provided buffer in-place. */
 	virtual void DataPrepared(ContiguousByteBuffer & a_Data) = 0;
 
+	/** Returns true if DataPrepared() modifies the data, so that data shared with other clients needs copying first. */
+	virtual bool IsEncrypted(void) const = 0;
+
 	// Sending stuff to clients (alphabetically sorted):
 	virtual void SendAttachEntity               (const cEntity & a_Entity, const cEntity & a_Vehicle) = 0;
 	virtual void SendBlockAction                (int a_BlockX, int a_BlockY, int a_BlockZ, char a_Byte1, char a_Byte2, BLOCKTYPE a_BlockType) = 0;
@@ -371,7 +374,7 @@ public:
 	virtual void SendChat                       (const AString & a_Message, eChatType a_Type) = 0;
 	virtual void SendChat                       (const cCompositeChat & a_Message, eChatType a_Type, bool a_ShouldUseChatPrefixes) = 0;
 	virtual void SendChatRaw                    (const AString & a_MessageRaw, eChatType a_Type) = 0;
-	virtual void SendChunkData                  (ContiguousByteBufferView a_ChunkData) = 0;
+	virtual void SendChunkData                  (std::shared_ptr<const ContiguousByteBuffer> a_ChunkData) = 0;
 	virtual void SendCollectEntity              (const cEntity & a_Collected, const cEntity & a_Collector, unsigned a_Count) = 0;
 	virtual void SendDestroyEntity              (const cEntity & a_Entity) = 0;
 	virtual void SendDetachEntity               (const cEntity & a_Entity, const cEntity & a_PreviousVehicle) = 0;
@@ -385,6 +388,7 @@ public:
 	virtual void SendEntityMetadata             (const cEntity & a_Entity) = 0;
 	virtual void SendEntityPosition             (const cEntity & a_Entity) = 0;
 	virtual void SendEntityProperties           (const cEntity & a_Entity) = 0;
+	virtual void SendEntityTeleport             (const cEntity & a_Entity) = 0;
 	virtual void SendEntityVelocity             (const cEntity & a_Entity) = 0;
 	virtual void SendExplosion                  (Vector3f a_Position, float a_Power) = 0;
 	virtual void SendGameMode                   (eGameMode a_GameMode) = 0;
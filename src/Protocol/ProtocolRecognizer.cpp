@@ -214,6 +214,15 @@ void cMultiVersionProtocol::HandleOutgoingData(ContiguousByteBuffer & a_Data)
 
 
 
+bool cMultiVersionProtocol::IsOutgoingDataModified() const
+{
+	return (m_Protocol != nullptr) && m_Protocol->IsEncrypted();
+}
+
+
+
+
+
 void cMultiVersionProtocol::SendDisconnect(cClientHandle & a_Client, const AString & a_Reason)
 {
 	if (m_Protocol != nullptr)
@@ -45,6 +45,9 @@ public:
 	/** Allows the protocol (if any) to do a final pass on outgiong data, possibly modifying the provided buffer in-place. */
 	void HandleOutgoingData(ContiguousByteBuffer & a_Data);
 
+	/** Returns true if HandleOutgoingData() modifies the data, so that data shared with other clients needs copying first. */
+	bool IsOutgoingDataModified() const;
+
 	/** Sends a disconnect to the client as a result of a recognition error.
 	This function can be used to disconnect before any protocol has been recognised. */
 	void SendDisconnect(cClientHandle & a_Client, const AString & a_Reason);
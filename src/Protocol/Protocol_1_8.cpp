@@ -92,6 +92,24 @@ static const UInt32 CompressionThreshold = 256;  // After how large a packet sho
 
 
 
+/** Writes the compressed-format packet header, the PacketSize and DataSize VarInts, to a_Out, which must have room for them. */
+static void WritePacketHeader(std::byte * a_Out, const UInt32 a_PacketSize, const UInt32 a_DataSize)
+{
+	for (auto Value : { a_PacketSize, a_DataSize })
+	{
+		while (Value >= 0x80)
+		{
+			*a_Out++ = static_cast<std::byte>((Value & 0x7f) | 0x80);
+			Value >>= 7;
+		}
+		*a_Out++ = static_cast<std::byte>(Value);
+	}
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // cProtocol_1_8_0:
 
@@ -375,12 +393,12 @@ void cProtocol_1_8_0::SendChatRaw(const AString & a_MessageRaw, eChatType a_Type
 
 
 
-void cProtocol_1_8_0::SendChunkData(const ContiguousByteBufferView a_ChunkData)
+void cProtocol_1_8_0::SendChunkData(std::shared_ptr<const ContiguousByteBuffer> a_ChunkData)
 {
 	ASSERT(m_State == 3);  // In game mode?
 
 	cCSLock Lock(m_CSPacket);
-	m_Client->SendData(a_ChunkData);
+	m_Client->SendData(std::move(a_ChunkData));
 }
 
 
@@ -649,6 +667,24 @@ void cProtocol_1_8_0::SendEntityProperties(const cEntity & a_Entity)
 
 
 
+void cProtocol_1_8_0::SendEntityTeleport(const cEntity & a_Entity)
+{
+	ASSERT(m_State == 3);  // In game mode?
+
+	cPacketizer Pkt(*this, pktTeleportEntity);
+	Pkt.WriteVarInt32(a_Entity.GetUniqueID());
+	Pkt.WriteFPInt(a_Entity.GetPosX());
+	Pkt.WriteFPInt(a_Entity.GetPosY());
+	Pkt.WriteFPInt(a_Entity.GetPosZ());
+	Pkt.WriteByteAngle(a_Entity.GetYaw());
+	Pkt.WriteByteAngle(a_Entity.GetPitch());
+	Pkt.WriteBool(a_Entity.IsOnGround());
+}
+
+
+
+
+
 void cProtocol_1_8_0::SendEntityVelocity(const cEntity & a_Entity)
 {
 	ASSERT(m_State == 3);  // In game mode?
@@ -1764,7 +1800,7 @@ void cProtocol_1_8_0::SendWindowProperty(const cWindow & a_Window, size_t a_Prop
 
 
 
-void cProtocol_1_8_0::CompressPacket(CircularBufferCompressor & a_Packet, ContiguousByteBuffer & a_CompressedData)
+ContiguousByteBufferView cProtocol_1_8_0::CompressPacket(CircularBufferCompressor & a_Packet, ContiguousByteBuffer & a_CompressedData)
 {
 	const auto Uncompressed = a_Packet.GetView();
 
@@ -1782,23 +1818,13 @@ void cProtocol_1_8_0::CompressPacket(CircularBufferCompressor & a_Packet, Contig
 		*/
 		const UInt32 DataSize = 0;
 		const auto PacketSize = static_cast<UInt32>(cByteBuffer::GetVarIntSize(DataSize) + Uncompressed.size());
+		const auto HeaderSize = cByteBuffer::GetVarIntSize(PacketSize) + cByteBuffer::GetVarIntSize(DataSize);
 
-		cByteBuffer LengthHeaderBuffer(
-			cByteBuffer::GetVarIntSize(PacketSize) +
-			cByteBuffer::GetVarIntSize(DataSize)
-		);
-
-		LengthHeaderBuffer.WriteVarInt32(PacketSize);
-		LengthHeaderBuffer.WriteVarInt32(DataSize);
-
-		ContiguousByteBuffer LengthData;
-		LengthHeaderBuffer.ReadAll(LengthData);
-
-		a_CompressedData.reserve(LengthData.size() + Uncompressed.size());
-		a_CompressedData = LengthData;
+		a_CompressedData.resize(HeaderSize);
+		WritePacketHeader(a_CompressedData.data(), PacketSize, DataSize);
 		a_CompressedData += Uncompressed;
 
-		return;
+		return a_CompressedData;
 	}
 
 	/* Definitely worth compressing.
@@ -1812,26 +1838,23 @@ void cProtocol_1_8_0::CompressPacket(CircularBufferCompressor & a_Packet, Contig
 	----------------------------------------------
 	*/
 
-	const auto CompressedData = a_Packet.Compress();
-	const auto Compressed = CompressedData.GetView();
-
+	// Compress directly into a_CompressedData, after room for the largest header the compressed size can need:
 	const UInt32 DataSize = static_cast<UInt32>(Uncompressed.size());
-	const auto PacketSize = static_cast<UInt32>(cByteBuffer::GetVarIntSize(DataSize) + Compressed.size());
-
-	cByteBuffer LengthHeaderBuffer(
-		cByteBuffer::GetVarIntSize(PacketSize) +
+	const auto Bound = a_Packet.GetCompressBound();
+	const auto MaxHeaderSize = (
+		cByteBuffer::GetVarIntSize(static_cast<UInt32>(cByteBuffer::GetVarIntSize(DataSize) + Bound)) +
 		cByteBuffer::GetVarIntSize(DataSize)
 	);
+	a_CompressedData.resize(MaxHeaderSize + Bound);
+	const auto CompressedSize = a_Packet.CompressInto(a_CompressedData.data() + MaxHeaderSize, Bound);
+	ASSERT(CompressedSize != 0);  // The bound is always enough
 
-	LengthHeaderBuffer.WriteVarInt32(PacketSize);
-	LengthHeaderBuffer.WriteVarInt32(DataSize);
-
-	ContiguousByteBuffer LengthData;
-	LengthHeaderBuffer.ReadAll(LengthData);
-
-	a_CompressedData.reserve(LengthData.size() + Compressed.size());
-	a_CompressedData = LengthData;
-	a_CompressedData += Compressed;
+	// Write the header right before the compressed data; the packet starts wherever the header does, the room before it is skipped rather than erased:
+	const auto PacketSize = static_cast<UInt32>(cByteBuffer::GetVarIntSize(DataSize) + CompressedSize);
+	const auto HeaderSize = cByteBuffer::GetVarIntSize(PacketSize) + cByteBuffer::GetVarIntSize(DataSize);
+	const auto PacketStart = MaxHeaderSize - HeaderSize;
+	WritePacketHeader(a_CompressedData.data() + PacketStart, PacketSize, DataSize);
+	return { a_CompressedData.data() + PacketStart, HeaderSize + CompressedSize };
 }
 
 
@@ -3034,13 +3057,11 @@ void cProtocol_1_8_0::SendPacket(cPacketizer & a_Pkt)
 
 	if (m_State == 3)
 	{
-		ContiguousByteBuffer CompressedPacket;
+		// Reused by all the packets the thread sends, so that it doesn't need allocating each time:
+		thread_local ContiguousByteBuffer CompressedPacket;
 
-		// Compress the packet payload:
-		cProtocol_1_8_0::CompressPacket(m_Compressor, CompressedPacket);
-
-		// Send the packet's payload compressed:
-		m_Client->SendData(CompressedPacket);
+		// Compress the packet payload and send it:
+		m_Client->SendData(cProtocol_1_8_0::CompressPacket(m_Compressor, CompressedPacket));
 	}
 	else
 	{
@@ -4204,22 +4225,6 @@ void cProtocol_1_8_0::HandlePacket(cByteBuffer & a_Buffer)
 
 
 
-void cProtocol_1_8_0::SendEntityTeleport(const cEntity & a_Entity)
-{
-	cPacketizer Pkt(*this, pktTeleportEntity);
-	Pkt.WriteVarInt32(a_Entity.GetUniqueID());
-	Pkt.WriteFPInt(a_Entity.GetPosX());
-	Pkt.WriteFPInt(a_Entity.GetPosY());
-	Pkt.WriteFPInt(a_Entity.GetPosZ());
-	Pkt.WriteByteAngle(a_Entity.GetYaw());
-	Pkt.WriteByteAngle(a_Entity.GetPitch());
-	Pkt.WriteBool(a_Entity.IsOnGround());
-}
-
-
-
-
-
 void cProtocol_1_8_0::StartEncryption(const Byte * a_Key)
 {
 	m_Encryptor.Init(a_Key, a_Key);
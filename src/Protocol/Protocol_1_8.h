@@ -38,6 +38,7 @@ public:
 
 	virtual void DataReceived(cByteBuffer & a_Buffer, ContiguousByteBuffer & a_Data) override;
 	virtual void DataPrepared(ContiguousByteBuffer & a_Data) override;
+	virtual bool IsEncrypted(void) const override { return m_IsEncrypted; }
 
 	// Sending stuff to clients (alphabetically sorted):
 	virtual void SendAttachEntity               (const cEntity & a_Entity, const cEntity & a_Vehicle) override;
@@ -55,7 +56,7 @@ public:
 	virtual void SendChat                       (const AString & a_Message, eChatType a_Type) override;
 	virtual void SendChat                       (const cCompositeChat & a_Message, eChatType a_Type, bool a_ShouldUseChatPrefixes) override;
 	virtual void SendChatRaw                    (const AString & a_MessageRaw, eChatType a_Type) override;
-	virtual void SendChunkData                  (ContiguousByteBufferView a_ChunkData) override;
+	virtual void SendChunkData                  (std::shared_ptr<const ContiguousByteBuffer> a_ChunkData) override;
 	virtual void SendCollectEntity              (const cEntity & a_Collected, const cEntity & a_Collector, unsigned a_Count) override;
 	virtual void SendDestroyEntity              (const cEntity & a_Entity) override;
 	virtual void SendDetachEntity               (const cEntity & a_Entity, const cEntity & a_PreviousVehicle) override;
@@ -69,6 +70,11 @@ public:
 	virtual void SendEntityMetadata             (const cEntity & a_Entity) override;
 	virtual void SendEntityPosition             (const cEntity & a_Entity) override;
 	virtual void SendEntityProperties           (const cEntity & a_Entity) override;
+
+	/** Sends an entity teleport packet.
+	Also mitigates a 1.8 bug where the position in the entity spawn packet is ignored,
+	and so entities don't show up until a teleport is sent. */
+	virtual void SendEntityTeleport             (const cEntity & a_Entity) override;
 	virtual void SendEntityVelocity             (const cEntity & a_Entity) override;
 	virtual void SendExperience                 (void) override;
 	virtual void SendExperienceOrb              (const cExpOrb & a_ExpOrb) override;
@@ -132,8 +138,9 @@ public:
 	virtual AString GetAuthServerID(void) override { return m_AuthServerID; }
 
 	/** Compress the packet. a_Packet must be without packet length.
-	a_Compressed will be set to the compressed packet includes packet length and data length. */
-	static void CompressPacket(CircularBufferCompressor & a_Packet, ContiguousByteBuffer & a_Compressed);
+	The compressed packet, including the packet length and data length, is written into a_Compressed, which is reused between the calls.
+	Returns the view of the packet within a_Compressed; it doesn't necessarily start at the beginning of a_Compressed. */
+	static ContiguousByteBufferView CompressPacket(CircularBufferCompressor & a_Packet, ContiguousByteBuffer & a_Compressed);
 
 protected:
 
@@ -268,10 +275,5 @@ private:
 	/** Handle a complete packet stored in the given buffer. */
 	void HandlePacket(cByteBuffer & a_Buffer);
 
-	/** Sends an entity teleport packet.
-	Mitigates a 1.8 bug where the position in the entity spawn packet is ignored,
-	and so entities don't show up until a teleport is sent. */
-	void SendEntityTeleport(const cEntity & a_Entity);
-
 	void StartEncryption(const Byte * a_Key);
 } ;
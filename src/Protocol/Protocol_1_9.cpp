@@ -355,6 +355,17 @@ void cProtocol_1_9_0::SendEntityPosition(const cEntity & a_Entity)
 	}
 
 	// Too big a movement, do a teleport
+	SendEntityTeleport(a_Entity);
+}
+
+
+
+
+
+void cProtocol_1_9_0::SendEntityTeleport(const cEntity & a_Entity)
+{
+	ASSERT(m_State == 3);  // In game mode?
+
 	cPacketizer Pkt(*this, pktTeleportEntity);
 	Pkt.WriteVarInt32(a_Entity.GetUniqueID());
 	Pkt.WriteBEDouble(a_Entity.GetPosX());
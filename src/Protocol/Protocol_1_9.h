@@ -46,6 +46,7 @@ public:
 	virtual void SendEntityEquipment    (const cEntity & a_Entity, short a_SlotNum, const cItem & a_Item) override;
 	virtual void SendEntityMetadata     (const cEntity & a_Entity) override;
 	virtual void SendEntityPosition     (const cEntity & a_Entity) override;
+	virtual void SendEntityTeleport     (const cEntity & a_Entity) override;
 	virtual void SendExperienceOrb      (const cExpOrb & a_ExpOrb) override;
 	virtual void SendKeepAlive          (UInt32 a_PingID) override;
 	virtual void SendLeashEntity        (const cEntity & a_Entity, const cEntity & a_EntityLeashedTo) override;
@@ -946,15 +946,24 @@ void cRoot::LogChunkStats(cCommandOutputCallback & a_Output)
 		const auto NumInLoadQueue = World.GetStorageLoadQueueLength();
 		int NumValid = 0;
 		int NumDirty = 0;
-		int NumInLighting = 0;
-		World.GetChunkStats(NumValid, NumDirty, NumInLighting);
+		cLightingThread::sStats Lighting;
+		World.GetChunkStats(NumValid, NumDirty, Lighting);
+		const auto NumInLighting = static_cast<int>(Lighting.m_NumQueued + Lighting.m_NumInProgress);
 		a_Output.Out("World %s:", World.GetName().c_str());
 		a_Output.Out("  Num loaded chunks: %d", NumValid);
 		a_Output.Out("  Num dirty chunks: %d", NumDirty);
-		a_Output.Out("  Num chunks in lighting queue: %d", NumInLighting);
+		a_Output.Out("  Num chunks in lighting queue: %d (%zu being lit)", NumInLighting, Lighting.m_NumInProgress);
+		a_Output.Out("  Num chunks lit: %zu (%.2f ms per chunk)", Lighting.m_NumLighted, Lighting.m_AvgLightingTimeMS);
 		a_Output.Out("  Num chunks in generator queue: %zu", NumInGenerator);
 		a_Output.Out("  Num chunks in storage load queue: %zu", NumInLoadQueue);
 		a_Output.Out("  Num chunks in storage save queue: %zu", NumInSaveQueue);
+		const auto Caches = World.GetChunkCacheStats();
+		a_Output.Out("  Serialized chunk cache: %zu hits, %zu misses, %zu KiB held",
+			Caches.m_NumSerializedHits, Caches.m_NumSerializedMisses, (Caches.m_SerializedMemory + 1023) / 1024
+		);
+		a_Output.Out("  Chunk prefetching: %zu chunks waiting, %zu used, %zu evicted unused",
+			Caches.m_NumPrefetched, Caches.m_NumPrefetchUsed, Caches.m_NumPrefetchEvicted
+		);
 		int Mem = NumValid * static_cast<int>(sizeof(cChunk));
 		a_Output.Out("  Memory used by chunks: %d KiB (%d MiB)", (Mem + 1023) / 1024, (Mem + 1024 * 1024 - 1) / (1024 * 1024));
 		a_Output.Out("  Per-chunk memory size breakdown:");
@@ -975,6 +984,17 @@ void cRoot::LogChunkStats(cCommandOutputCallback & a_Output)
 	a_Output.Out("  Num chunks in lighting queue: %d", SumNumInLighting);
 	a_Output.Out("  Num chunks in generator queue: %d", SumNumInGenerator);
 	a_Output.Out("  Memory used by chunks: %d KiB (%d MiB)", (SumMem + 1023) / 1024, (SumMem + 1024 * 1024 - 1) / (1024 * 1024));
+
+	// The section arrays are shared by all worlds:
+	a_Output.Out("Chunk section pool:");
+	for (const auto & Class : cChunkSectionPool::GetStats())
+	{
+		const auto Reserved = Class.m_NumBlocksTotal * Class.m_BlockSize;
+		a_Output.Out("  %4zu-byte sections: %zu in use, %zu free (%zu shared), %zu KiB reserved, %zu allocations and %zu slabs released so far",
+			Class.m_BlockSize, Class.m_NumBlocksInUse, Class.m_NumBlocksTotal - Class.m_NumBlocksInUse, Class.m_NumBlocksSharedFree,
+			(Reserved + 1023) / 1024, Class.m_NumAllocations, Class.m_NumSlabsReleased
+		);
+	}
 }
 
 
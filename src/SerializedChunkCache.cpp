@@ -0,0 +1,94 @@
+// SerializedChunkCache.cpp
+
+// Implements the cSerializedChunkCache class that keeps the recently sent chunk packets for reuse
+
+#include "Globals.h"
+#include "SerializedChunkCache.h"
+
+
+
+
+
+cSerializedChunkCache::cSerializedChunkCache(const size_t a_MaxMemory) :
+	m_MaxMemory(a_MaxMemory),
+	m_MemoryUsed(0),
+	m_NumHits(0),
+	m_NumMisses(0)
+{
+}
+
+
+
+
+
+cSerializedChunkCache::cData cSerializedChunkCache::Find(const cChunkCoords a_Chunk, const size_t a_Version, const UInt64 a_DataVersion)
+{
+	const auto Itr = m_Index.find({ a_Chunk, a_Version });
+	if (Itr == m_Index.end())
+	{
+		m_NumMisses += 1;
+		return nullptr;
+	}
+
+	const auto Entry = Itr->second;
+	if (Entry->m_DataVersion != a_DataVersion)
+	{
+		// The chunk has changed since, the entry will never be used again:
+		Erase(Entry);
+		m_NumMisses += 1;
+		return nullptr;
+	}
+
+	// Mark as the most recently used:
+	m_Entries.splice(m_Entries.begin(), m_Entries, Entry);
+	m_NumHits += 1;
+	return Entry->m_Data;
+}
+
+
+
+
+
+void cSerializedChunkCache::Insert(const cChunkCoords a_Chunk, const size_t a_Version, const UInt64 a_DataVersion, cData a_Data)
+{
+	ASSERT(a_Data != nullptr);
+
+	const sKey Key { a_Chunk, a_Version };
+	const auto Itr = m_Index.find(Key);
+	if (Itr != m_Index.end())
+	{
+		Erase(Itr->second);
+	}
+
+	// Data larger than the whole cache isn't worth evicting everything else for:
+	const auto Size = a_Data->size();
+	if (Size > m_MaxMemory)
+	{
+		return;
+	}
+
+	m_Entries.push_front({ Key, a_DataVersion, std::move(a_Data) });
+	m_Index.emplace(Key, m_Entries.begin());
+	m_MemoryUsed += Size;
+
+	// Drop the least recently used entries to fit into the limit:
+	while (m_MemoryUsed > m_MaxMemory)
+	{
+		Erase(std::prev(m_Entries.end()));
+	}
+}
+
+
+
+
+
+void cSerializedChunkCache::Erase(const cEntries::iterator a_Entry)
+{
+	m_MemoryUsed -= a_Entry->m_Data->size();
+	m_Index.erase(a_Entry->m_Key);
+	m_Entries.erase(a_Entry);
+}
+
+
+
+
@@ -0,0 +1,113 @@
+// SerializedChunkCache.h
+
+// Declares the cSerializedChunkCache class that keeps the recently sent chunk packets for reuse
+
+/*
+The chunk sender serializes and compresses each chunk for each protocol version used by the clients it's sent to.
+Chunks around the spawn and other busy places are sent over and over again, mostly without any change in between;
+this cache keeps the resulting packets so that they can be sent again without repeating the work.
+
+Each entry is tagged with the chunk's data version (cChunk::GetDataVersion()) it was serialized from.
+Since any change to the chunk's blocks, light or biomes assigns it a new data version, an entry is only
+ever returned for the exact data it was made from; outdated entries are dropped once they're looked up,
+or when they become the least recently used ones while the cache is over its memory limit.
+*/
+
+
+
+
+
+#pragma once
+
+#include "ChunkDef.h"
+
+
+
+
+
+class cSerializedChunkCache
+{
+public:
+
+	/** The serialized data, shared so that it can be sent while the cache drops the entry meanwhile. */
+	using cData = std::shared_ptr<const ContiguousByteBuffer>;
+
+	/** Creates a cache that holds up to the specified amount of serialized data, in bytes. */
+	cSerializedChunkCache(size_t a_MaxMemory);
+
+	/** Returns the data of the chunk serialized in the specified version, if it has been serialized from the specified data version.
+	Returns nullptr if it isn't cached; drops the entry if it is cached, but for a different data version.
+	a_Version is the index of the serialized format, cChunkDataSerializer::CacheVersion. */
+	cData Find(cChunkCoords a_Chunk, size_t a_Version, UInt64 a_DataVersion);
+
+	/** Stores the data of the chunk serialized in the specified version from the specified data version, replacing any previous entry.
+	Drops the least recently used entries if the cache goes over its memory limit. */
+	void Insert(cChunkCoords a_Chunk, size_t a_Version, UInt64 a_DataVersion, cData a_Data);
+
+	/** Returns the number of entries in the cache. */
+	size_t GetNumEntries(void) const { return m_Entries.size(); }
+
+	/** Returns the amount of serialized data held by the cache, in bytes. Safe to call from any thread, as are the other stats below. */
+	size_t GetMemoryUsed(void) const { return m_MemoryUsed; }
+
+	/** Returns the number of the Find() calls that returned the cached data. */
+	size_t GetNumHits(void) const { return m_NumHits; }
+
+	/** Returns the number of the Find() calls that didn't return any data. */
+	size_t GetNumMisses(void) const { return m_NumMisses; }
+
+protected:
+
+	/** The key identifying a single entry. */
+	struct sKey
+	{
+		cChunkCoords m_Chunk;
+		size_t m_Version;
+
+		bool operator == (const sKey & a_Other) const
+		{
+			return (m_Chunk == a_Other.m_Chunk) && (m_Version == a_Other.m_Version);
+		}
+	};
+
+	struct sKeyHash
+	{
+		size_t operator () (const sKey & a_Key) const
+		{
+			return cChunkCoordsHash()(a_Key.m_Chunk) ^ (a_Key.m_Version << 24);
+		}
+	};
+
+	struct sEntry
+	{
+		sKey m_Key;
+		UInt64 m_DataVersion;
+		cData m_Data;
+	};
+
+	using cEntries = std::list<sEntry>;
+
+	/** The maximum amount of serialized data to hold, in bytes. */
+	size_t m_MaxMemory;
+
+	/** The amount of serialized data currently held, in bytes.
+	Atomic, like the stats below, so that it can be read for the stats from other threads than the one using the cache. */
+	std::atomic<size_t> m_MemoryUsed;
+
+	/** The entries, from the most recently used to the least recently used. */
+	cEntries m_Entries;
+
+	/** The entries by their key. */
+	std::unordered_map<sKey, cEntries::iterator, sKeyHash> m_Index;
+
+	std::atomic<size_t> m_NumHits;
+	std::atomic<size_t> m_NumMisses;
+
+
+	/** Drops the specified entry. */
+	void Erase(cEntries::iterator a_Entry);
+};
+
+
+
+
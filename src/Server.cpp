@@ -3,6 +3,8 @@
 #include "Globals.h"  // NOTE: MSVC stupidness requires this to be the same across all modules
 
 #include "Server.h"
+#include "ChunkStreamer.h"
+#include "CircularBufferCompressor.h"
 #include "ClientHandle.h"
 #include "Mobs/Monster.h"
 #include "Root.h"
@@ -158,6 +160,8 @@ bool cServer::InitServer(cSettingsRepositoryInterface & a_Settings, bool a_Shoul
 	m_bIsHardcore = a_Settings.GetValueSetB("Server", "HardcoreEnabled", false);
 	m_bAllowMultiLogin = a_Settings.GetValueSetB("Server", "AllowMultiLogin", false);
 	m_ResourcePackUrl = a_Settings.GetValueSet("Server", "ResourcePackUrl", "");
+	CircularBufferCompressor::SetCompressionFactor(a_Settings.GetValueSetI("Server", "NetworkCompressionFactor", 6));
+	cChunkStreamer::SetBandwidth(static_cast<size_t>(std::max(a_Settings.GetValueSetI("Server", "ChunkStreamingBandwidth", 4096), 1)) * 1 KiB);  // KiB per second, per client
 
 	m_FaviconData = Base64Encode(cFile::ReadWholeFile(AString("favicon.png")));  // Will return empty string if file nonexistant; client doesn't mind
 
@@ -17,22 +17,43 @@
 ////////////////////////////////////////////////////////////////////////////////
 // cDelayedFluidSimulatorChunkData::cSlot
 
+bool cDelayedFluidSimulatorChunkData::cSlot::HasBlock(int a_RelX, int a_RelY, int a_RelZ) const
+{
+	ASSERT(cChunkDef::IsValidRelPos({ a_RelX, a_RelY, a_RelZ }));
+
+	const auto & Blocks = m_Sections[static_cast<size_t>(a_RelY / cChunkDef::SectionHeight)];
+	if (Blocks == nullptr)
+	{
+		return false;
+	}
+	const auto Index = IndexInSection(a_RelX, a_RelY, a_RelZ);
+	return (((*Blocks)[Index / 64] >> (Index % 64)) & 1) != 0;
+}
+
+
+
+
+
 bool cDelayedFluidSimulatorChunkData::cSlot::Add(int a_RelX, int a_RelY, int a_RelZ)
 {
-	ASSERT(a_RelZ >= 0);
-	ASSERT(a_RelZ < static_cast<int>(ARRAYCOUNT(m_Blocks)));
+	ASSERT(cChunkDef::IsValidRelPos({ a_RelX, a_RelY, a_RelZ }));
 
-	auto & Blocks = m_Blocks[a_RelZ];
-	const auto Index = cChunkDef::MakeIndex(a_RelX, a_RelY, a_RelZ);
-	for (const auto & Block : Blocks)
+	auto & Blocks = m_Sections[static_cast<size_t>(a_RelY / cChunkDef::SectionHeight)];
+	if (Blocks == nullptr)
 	{
-		if (Block.Data == Index)
-		{
-			// Already present
-			return false;
-		}
-	}  // for itr - Blocks[]
-	Blocks.emplace_back(a_RelX, a_RelY, a_RelZ, Index);
+		Blocks = std::make_unique<cSectionBlocks>();
+		Blocks->fill(0);
+	}
+
+	const auto Index = IndexInSection(a_RelX, a_RelY, a_RelZ);
+	auto & Word = (*Blocks)[Index / 64];
+	const auto Bit = UInt64(1) << (Index % 64);
+	if ((Word & Bit) != 0)
+	{
+		// Already present
+		return false;
+	}
+	Word |= Bit;
 	return true;
 }
 
@@ -98,20 +119,33 @@ void cDelayedFluidSimulator::SimulateChunk(std::chrono::milliseconds a_Dt, int a
 	cDelayedFluidSimulatorChunkData * ChunkData = static_cast<cDelayedFluidSimulatorChunkData *>(ChunkDataRaw);
 	cDelayedFluidSimulatorChunkData::cSlot & Slot = ChunkData->m_Slots[m_SimSlotNum];
 
-	// Simulate all the blocks in the scheduled slot:
-	for (size_t i = 0; i < ARRAYCOUNT(Slot.m_Blocks); i++)
+	// Simulate all the blocks in the scheduled slot, section by section:
+	for (size_t SectionY = 0; SectionY < Slot.m_Sections.size(); SectionY++)
 	{
-		auto & Blocks = Slot.m_Blocks[i];
-		if (Blocks.empty())
+		// Take the section's blocks out of the slot, any blocks scheduled into the slot while simulating are kept for its next turn:
+		const auto Blocks = std::move(Slot.m_Sections[SectionY]);
+		if (Blocks == nullptr)
 		{
 			continue;
 		}
-		for (const auto & Block : Blocks)
+
+		int NumBlocks = 0;
+		for (size_t WordIdx = 0; WordIdx < Blocks->size(); WordIdx++)
 		{
-			SimulateBlock(a_Chunk, Block.x, Block.y, Block.z);
+			// Runs of 64 blocks with nothing scheduled are skipped at once:
+			auto Word = (*Blocks)[WordIdx];
+			for (size_t Index = WordIdx * 64; Word != 0; Index++, Word >>= 1)
+			{
+				if ((Word & 1) == 0)
+				{
+					continue;
+				}
+				const auto Position = cDelayedFluidSimulatorChunkData::cSlot::PositionOf(SectionY, Index);
+				SimulateBlock(a_Chunk, Position.x, Position.y, Position.z);
+				NumBlocks += 1;
+			}
 		}
-		m_TotalBlocks -= static_cast<int>(Blocks.size());
-		Blocks.clear();
+		m_TotalBlocks -= NumBlocks;
 	}
 }
 
@@ -22,16 +22,39 @@ public:
 	class cSlot
 	{
 	public:
+		/** The number of blocks in a single chunk section */
+		static const size_t SectionBlockCount = cChunkDef::Width * cChunkDef::Width * cChunkDef::SectionHeight;
+
+		/** The blocks of a single chunk section, one bit per block, indexed by IndexInSection() */
+		using cSectionBlocks = std::array<UInt64, SectionBlockCount / 64>;
+
 		/** Returns true if the specified block is stored */
-		bool HasBlock(int a_RelX, int a_RelY, int a_RelZ);
+		bool HasBlock(int a_RelX, int a_RelY, int a_RelZ) const;
 
 		/** Adds the specified block unless already present; returns true if added, false if the block was already present */
 		bool Add(int a_RelX, int a_RelY, int a_RelZ);
 
-		/** Array of block containers, each item stores blocks for one Z coord
-		size_t param is the block index (for faster duplicate comparison in Add())
-		*/
-		std::vector<cCoordWithData<size_t>> m_Blocks[16];
+		/** Returns the index of the block within its section's bits */
+		static size_t IndexInSection(int a_RelX, int a_RelY, int a_RelZ)
+		{
+			return static_cast<size_t>(a_RelX + cChunkDef::Width * (a_RelZ + cChunkDef::Width * (a_RelY % cChunkDef::SectionHeight)));
+		}
+
+		/** Returns the chunk-relative position of the block at the specified index within the specified section's bits */
+		static Vector3i PositionOf(size_t a_SectionY, size_t a_Index)
+		{
+			return
+			{
+				static_cast<int>(a_Index % cChunkDef::Width),
+				static_cast<int>(a_SectionY) * cChunkDef::SectionHeight + static_cast<int>(a_Index / (cChunkDef::Width * cChunkDef::Width)),
+				static_cast<int>((a_Index / cChunkDef::Width) % cChunkDef::Width)
+			};
+		}
+
+		/** The stored blocks, per chunk section; nullptr for the sections that have none.
+		Adding a block is a single bit set, without searching through the already stored blocks,
+		and the simulation skips the sections, and the runs of 64 blocks, that have nothing stored. */
+		std::array<std::unique_ptr<cSectionBlocks>, cChunkDef::NumSections> m_Sections;
 	} ;
 
 	cDelayedFluidSimulatorChunkData(int a_TickDelay);
@@ -66,7 +89,7 @@ protected:
 	int m_AddSlotNum;  // Index into m_Slots[] where to add new blocks in each ChunkData
 	int m_SimSlotNum;  // Index into m_Slots[] where to simulate blocks in each ChunkData
 
-	int m_TotalBlocks;  // Statistics only: the total number of blocks currently queued
+	std::atomic<int> m_TotalBlocks;  // Statistics only: the total number of blocks currently queued
 
 	/* Slots:
 	| 0 | 1 | ... | m_AddSlotNum | m_SimSlotNum | ... | m_TickDelay - 1 |
@@ -304,8 +304,7 @@ void cFloodyFluidSimulator::SpreadToNeighbor(cChunk * a_NearChunk, int a_RelX, i
 
 	// Spread:
 	FLUID_FLOG("  Spreading to {0} with meta {1}", absPos, a_NewMeta);
-	a_NearChunk->SetBlock(relPos, m_FluidBlock, a_NewMeta);
-	m_World.GetSimulatorManager()->WakeUp(*a_NearChunk, relPos);
+	a_NearChunk->SetBlock(relPos, m_FluidBlock, a_NewMeta);  // Also wakes up the simulators for the block and its neighbors
 
 	HardenBlock(a_NearChunk, relPos, m_FluidBlock, a_NewMeta);
 }
@@ -16,7 +16,9 @@ ForEachSourceCallback::ForEachSourceCallback(const cChunk & Chunk, const Vector3
 	Power(0),
 	m_Chunk(Chunk),
 	m_Position(Position),
-	m_CurrentBlock(CurrentBlock)
+	m_CurrentBlock(CurrentBlock),
+	m_Links(nullptr),
+	m_LinksComplete(true)
 {
 }
 
@@ -24,6 +26,16 @@ ForEachSourceCallback::ForEachSourceCallback(const cChunk & Chunk, const Vector3
 
 
 
+ForEachSourceCallback::ForEachSourceCallback(const cChunk & Chunk, const Vector3i Position, const BLOCKTYPE CurrentBlock, std::vector<sRedstoneLink> & Links) :
+	ForEachSourceCallback(Chunk, Position, CurrentBlock)
+{
+	m_Links = &Links;
+}
+
+
+
+
+
 void ForEachSourceCallback::operator()(Vector3i Location)
 {
 	if (!cChunkDef::IsValidHeight(Location.y))
@@ -31,9 +43,11 @@ void ForEachSourceCallback::operator()(Vector3i Location)
 		return;
 	}
 
+	const auto ChunkRelativeLocation = Location;
 	const auto NeighbourChunk = m_Chunk.GetRelNeighborChunkAdjustCoords(Location);
 	if ((NeighbourChunk == nullptr) || !NeighbourChunk->IsValid())
 	{
+		m_LinksComplete = false;
 		return;
 	}
 
@@ -43,9 +57,18 @@ void ForEachSourceCallback::operator()(Vector3i Location)
 	if (ShouldQueryLinkedPosition(PotentialSourceBlock))
 	{
 		Power = std::max(Power, QueryLinkedPower(*NeighbourChunk, NeighbourRelativeQueryPosition, m_CurrentBlock, Location));
+		if (m_Links != nullptr)
+		{
+			RecordLinkedSources(ChunkRelativeLocation);
+		}
 	}
 	else
 	{
+		if ((m_Links != nullptr) && cIncrementalRedstoneSimulator::IsRedstone(PotentialSourceBlock))
+		{
+			m_Links->push_back({ ChunkRelativeLocation, m_Position, m_CurrentBlock, false });
+		}
+
 		Power = std::max(
 			Power,
 			RedstoneHandler::GetPowerDeliveredToPosition(
@@ -73,6 +96,7 @@ void ForEachSourceCallback::CheckIndirectPower()
 	// Object representing restarted power calculation where the
 	// block above this piston, dropspenser is requesting a power level.
 	ForEachSourceCallback QuasiQueryCallback(m_Chunk, Above, m_Chunk.GetBlock(Above));
+	QuasiQueryCallback.m_Links = m_Links;
 
 	// Manually feed the callback object all positions that may deliver power to Above:
 	for (const auto & QuasiPowerOffset : cSimulator::GetLinkedOffsets(OffsetYP))
@@ -82,12 +106,41 @@ void ForEachSourceCallback::CheckIndirectPower()
 
 	// Get the results:
 	Power = std::max(Power, QuasiQueryCallback.Power);
+	m_LinksComplete = m_LinksComplete && QuasiQueryCallback.m_LinksComplete;
 }
 
 
 
 
 
+PowerLevel ForEachSourceCallback::QueryCompiledPower(const cChunk & Chunk, const std::vector<sRedstoneLink> & Links)
+{
+	PowerLevel Power = 0;
+
+	for (const auto & Link : Links)
+	{
+		auto SourcePosition = Link.m_Source;
+		const auto NeighbourChunk = Chunk.GetRelNeighborChunkAdjustCoords(SourcePosition);
+		if ((NeighbourChunk == nullptr) || !NeighbourChunk->IsValid())
+		{
+			continue;
+		}
+
+		// The source's block type is read anew, the simulator changes it without invalidating the links (torches turning on and off, etc.):
+		Power = std::max(
+			Power,
+			RedstoneHandler::GetPowerDeliveredToPosition(
+				*NeighbourChunk, SourcePosition, NeighbourChunk->GetBlock(SourcePosition),
+				cIncrementalRedstoneSimulatorChunkData::RebaseRelativePosition(Chunk, *NeighbourChunk, Link.m_Query), Link.m_QueryBlock, Link.m_IsLinked
+			)
+		);
+	}
+
+	return Power;
+}
+
+
+
 bool ForEachSourceCallback::ShouldQueryLinkedPosition(const BLOCKTYPE Block)
 {
 	switch (Block)
@@ -148,3 +201,31 @@ PowerLevel ForEachSourceCallback::QueryLinkedPower(const cChunk & Chunk, const V
 
 	return Power;
 }
+
+
+
+
+
+void ForEachSourceCallback::RecordLinkedSources(const Vector3i Location)
+{
+	for (const auto & Offset : cSimulator::GetLinkedOffsets(Location - m_Position))
+	{
+		auto SourcePosition = m_Position + Offset;
+		if (!cChunkDef::IsValidHeight(SourcePosition.y))
+		{
+			continue;
+		}
+
+		const auto NeighbourChunk = m_Chunk.GetRelNeighborChunkAdjustCoords(SourcePosition);
+		if ((NeighbourChunk == nullptr) || !NeighbourChunk->IsValid())
+		{
+			m_LinksComplete = false;
+			continue;
+		}
+
+		if (cIncrementalRedstoneSimulator::IsRedstone(NeighbourChunk->GetBlock(SourcePosition)))
+		{
+			m_Links->push_back({ m_Position + Offset, Location, m_CurrentBlock, true });
+		}
+	}
+}
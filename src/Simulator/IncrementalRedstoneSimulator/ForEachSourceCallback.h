@@ -13,12 +13,22 @@ public:
 
 	ForEachSourceCallback(const cChunk & Chunk, Vector3i Position, BLOCKTYPE CurrentBlock);
 
+	/** Creates a callback that also records each block it asks for power into Links, so that the power can later be
+	asked for again without the scan, see QueryCompiledPower(). Only the blocks that have a redstone handler are recorded. */
+	ForEachSourceCallback(const cChunk & Chunk, Vector3i Position, BLOCKTYPE CurrentBlock, std::vector<sRedstoneLink> & Links);
+
 	/** Callback invoked for each potential source position of the redstone component. */
 	void operator()(Vector3i Location);
 
 	/** Callback invoked for blocks supporting quasiconnectivity. */
 	void CheckIndirectPower();
 
+	/** Returns the maximum power level delivered through the compiled links, all relative to Chunk. */
+	static PowerLevel QueryCompiledPower(const cChunk & Chunk, const std::vector<sRedstoneLink> & Links);
+
+	/** Returns true if all the scanned positions were in valid chunks, so that the recorded links are the complete set of inputs. */
+	bool AreLinksComplete() const { return m_LinksComplete; }
+
 	// The maximum power level of all source locations.
 	PowerLevel Power;
 
@@ -31,7 +41,16 @@ private:
 	Both QueryPosition and SolidBlockPosition are relative to Chunk. */
 	static PowerLevel QueryLinkedPower(const cChunk & Chunk, Vector3i QueryPosition, BLOCKTYPE QueryBlock, Vector3i SolidBlockPosition);
 
+	/** Records the linked sources around the solid block at Location, as queried by QueryLinkedPower. */
+	void RecordLinkedSources(Vector3i Location);
+
 	const cChunk & m_Chunk;
 	const Vector3i m_Position;
 	const BLOCKTYPE m_CurrentBlock;
+
+	/** Where to record the queried blocks, or nullptr if not recording. Positions are relative to m_Chunk. */
+	std::vector<sRedstoneLink> * m_Links;
+
+	/** False if any of the scanned positions was in a chunk that isn't valid. */
+	bool m_LinksComplete;
 };
@@ -6,6 +6,7 @@
 #include "RedstoneHandler.h"
 #include "RedstoneSimulatorChunkData.h"
 #include "ForEachSourceCallback.h"
+#include "Registries/BlockStates.h"
 
 
 
@@ -101,6 +102,13 @@ void cIncrementalRedstoneSimulator::ProcessWorkItem(cChunk & Chunk, cChunk & Tic
 	NIBBLETYPE CurrentMeta;
 	Chunk.GetBlockTypeMeta(Position, CurrentBlock, CurrentMeta);
 
+	if (m_CompileComponents)
+	{
+		const auto Power = GetCompiledPower(Chunk, Position, CurrentBlock, CurrentMeta);
+		RedstoneHandler::Update(Chunk, TickingSource, Position, CurrentBlock, CurrentMeta, Power);
+		return;
+	}
+
 	ForEachSourceCallback Callback(Chunk, Position, CurrentBlock);
 	RedstoneHandler::ForValidSourcePositions(Chunk, Position, CurrentBlock, CurrentMeta, Callback);
 
@@ -112,16 +120,99 @@ void cIncrementalRedstoneSimulator::ProcessWorkItem(cChunk & Chunk, cChunk & Tic
 
 
 
+UInt32 cIncrementalRedstoneSimulator::GetComponentTopology(const cIncrementalRedstoneSimulatorChunkData & Data, const Vector3i Position, const BLOCKTYPE Block, const NIBBLETYPE Meta)
+{
+	const auto Topology = [](const BLOCKTYPE a_Block, const NIBBLETYPE a_Facing, const uint_least16_t a_WireState = 0)
+	{
+		return static_cast<UInt32>(a_Block) | (static_cast<UInt32>(a_Facing) << 8) | (static_cast<UInt32>(a_WireState) << 12);
+	};
+
+	switch (Block)
+	{
+		case E_BLOCK_REDSTONE_WIRE:
+		{
+			// The meta is the power level. The connections are in the wire's state, rebuilt here without its power:
+			const auto State = Data.GetWireState(Position);
+			if (State == nullptr)
+			{
+				return Topology(Block, 0);
+			}
+			namespace Wire = Block::RedstoneWire;
+			return Topology(Block, 0, Wire::RedstoneWire(Wire::East(*State), Wire::North(*State), 0, Wire::South(*State), Wire::West(*State)).ID);
+		}
+
+		case E_BLOCK_ACTIVE_COMPARATOR:
+		case E_BLOCK_INACTIVE_COMPARATOR: return Topology(E_BLOCK_INACTIVE_COMPARATOR, Meta & 0x03);
+		case E_BLOCK_PISTON:
+		case E_BLOCK_STICKY_PISTON: return Topology(Block, Meta & 0x07);
+		case E_BLOCK_REDSTONE_LAMP_OFF:
+		case E_BLOCK_REDSTONE_LAMP_ON: return Topology(E_BLOCK_REDSTONE_LAMP_OFF, 0);
+		case E_BLOCK_REDSTONE_REPEATER_OFF:
+		case E_BLOCK_REDSTONE_REPEATER_ON: return Topology(E_BLOCK_REDSTONE_REPEATER_OFF, Meta & E_META_REDSTONE_REPEATER_FACING_MASK);
+		case E_BLOCK_REDSTONE_TORCH_OFF:
+		case E_BLOCK_REDSTONE_TORCH_ON: return Topology(E_BLOCK_REDSTONE_TORCH_ON, Meta);
+
+		// The other components' sources don't depend on their meta:
+		default: return Topology(Block, 0);
+	}
+}
+
+
+
+
+
+PowerLevel cIncrementalRedstoneSimulator::GetCompiledPower(cChunk & Chunk, const Vector3i Position, const BLOCKTYPE CurrentBlock, const NIBBLETYPE CurrentMeta)
+{
+	auto & ChunkData = *static_cast<cIncrementalRedstoneSimulatorChunkData *>(Chunk.GetRedstoneSimulatorData());
+	const auto Topology = GetComponentTopology(ChunkData, Position, CurrentBlock, CurrentMeta);
+
+	const auto Compiled = ChunkData.GetCompiledComponent(Position);
+	if (
+		(Compiled != nullptr) &&
+		(Compiled->m_Topology == Topology) &&
+		ChunkData.IsCompiledComponentValid(Position, *Compiled)
+	)
+	{
+		return ForEachSourceCallback::QueryCompiledPower(Chunk, Compiled->m_Links);
+	}
+
+	// Scan the surroundings as usual, recording the sources found:
+	sRedstoneCompiledComponent Component{ Topology, ++m_CompileGeneration, {} };
+	ForEachSourceCallback Callback(Chunk, Position, CurrentBlock, Component.m_Links);
+	RedstoneHandler::ForValidSourcePositions(Chunk, Position, CurrentBlock, CurrentMeta, Callback);
+
+	// Don't keep the links if some of the surroundings weren't loaded, they'd miss the sources there once it is:
+	if (Callback.AreLinksComplete())
+	{
+		ChunkData.SetCompiledComponent(Position, std::move(Component));
+	}
+	else
+	{
+		ChunkData.EraseCompiledComponent(Position);
+	}
+
+	return Callback.Power;
+}
+
+
+
+
+
 void cIncrementalRedstoneSimulator::SimulateChunk(std::chrono::milliseconds a_Dt, int a_ChunkX, int a_ChunkZ, cChunk * a_Chunk)
 {
 	auto & ChunkData = *static_cast<cIncrementalRedstoneSimulatorChunkData *>(a_Chunk->GetRedstoneSimulatorData());
-	for (auto & DelayInfo : ChunkData.m_MechanismDelays)
+	if (m_CompileComponents)
+	{
+		ChunkData.PruneCompiledComponents();
+	}
+
+	ChunkData.ForEachMechanismDelay([&ChunkData](const Vector3i a_Position, cRedstoneChunkStore::cDelayInfo & a_DelayInfo)
 	{
-		if ((--DelayInfo.second.first) == 0)
+		if ((--a_DelayInfo.first) == 0)
 		{
-			ChunkData.WakeUp(DelayInfo.first);
+			ChunkData.WakeUp(a_Position);
 		}
-	}
+	});
 
 	// Build our work queue
 	auto & WorkQueue = ChunkData.GetActiveBlocks();
@@ -142,10 +233,10 @@ void cIncrementalRedstoneSimulator::SimulateChunk(std::chrono::milliseconds a_Dt
 		ProcessWorkItem(*NeighbourChunk, *a_Chunk, CurrentLocation);
 	}
 
-	for (const auto & Position : ChunkData.AlwaysTickedPositions)
+	ChunkData.ForEachAlwaysTicked([&ChunkData](const Vector3i a_Position)
 	{
-		ChunkData.WakeUp(Position);
-	}
+		ChunkData.WakeUp(a_Position);
+	});
 }
 
 
@@ -154,6 +245,12 @@ void cIncrementalRedstoneSimulator::SimulateChunk(std::chrono::milliseconds a_Dt
 
 void cIncrementalRedstoneSimulator::AddBlock(cChunk & a_Chunk, Vector3i a_Position, BLOCKTYPE a_Block)
 {
+	// Any block change, or a chunk being loaded, comes through here; even non-redstone blocks decide where the power flows:
+	if (m_CompileComponents)
+	{
+		InvalidateCompiledComponents(a_Chunk, a_Position);
+	}
+
 	// Never update blocks without a handler:
 	if (!IsRedstone(a_Block))
 	{
@@ -164,7 +261,7 @@ void cIncrementalRedstoneSimulator::AddBlock(cChunk & a_Chunk, Vector3i a_Positi
 
 	if (IsAlwaysTicked(a_Block))
 	{
-		ChunkData.AlwaysTickedPositions.emplace(a_Position);
+		ChunkData.SetAlwaysTicked(a_Position);
 	}
 
 	// Temporary: in the absence of block state support calculate our own:
@@ -181,6 +278,30 @@ void cIncrementalRedstoneSimulator::AddBlock(cChunk & a_Chunk, Vector3i a_Positi
 
 
 
+void cIncrementalRedstoneSimulator::InvalidateCompiledComponents(cChunk & a_Chunk, const Vector3i a_Position)
+{
+	const auto Generation = m_CompileGeneration.load();
+
+	// The reach is less than a chunk, so the corners of the reached area cover all the chunks it touches:
+	for (const auto RelX : { a_Position.x - COMPILED_COMPONENT_REACH, a_Position.x + COMPILED_COMPONENT_REACH })
+	{
+		for (const auto RelZ : { a_Position.z - COMPILED_COMPONENT_REACH, a_Position.z + COMPILED_COMPONENT_REACH })
+		{
+			const auto Chunk = a_Chunk.GetRelNeighborChunk(RelX, RelZ);
+			if (Chunk != nullptr)
+			{
+				static_cast<cIncrementalRedstoneSimulatorChunkData *>(Chunk->GetRedstoneSimulatorData())->InvalidateCompiledComponents(
+					Generation, a_Position.y - COMPILED_COMPONENT_REACH, a_Position.y + COMPILED_COMPONENT_REACH
+				);
+			}
+		}
+	}
+}
+
+
+
+
+
 cRedstoneSimulatorChunkData * cIncrementalRedstoneSimulator::CreateChunkData()
 {
 	return new cIncrementalRedstoneSimulatorChunkData;
@@ -2,6 +2,13 @@
 #pragma once
 
 #include "../RedstoneSimulator.h"
+#include "RedstoneChunkStore.h"
+
+
+
+
+
+class cIncrementalRedstoneSimulatorChunkData;
 
 
 
@@ -16,16 +23,42 @@ public:
 
 	using Super::Super;
 
+	/** Returns if a block is any sort of redstone device */
+	static bool IsRedstone(BLOCKTYPE a_Block);
+
+	/** Enables or disables compiling the components' power inputs.
+	When enabled, each component's scan of its surroundings for power sources is recorded the first time it's updated,
+	and later updates only ask the recorded sources, until a block near the component changes. */
+	void SetCompileComponents(bool a_CompileComponents) { m_CompileComponents = a_CompileComponents; }
+
 private:
 
+	/** How far, in any direction, from a component the blocks that determine its power inputs may be. */
+	static const int COMPILED_COMPONENT_REACH = 3;
+
+	/** If true, the components' power inputs are compiled, see SetCompileComponents(). */
+	bool m_CompileComponents = false;
+
+	/** Incremented each time a component is compiled, to tell the components compiled before a block change from those compiled after.
+	Chunks may be ticked in parallel, hence atomic. */
+	std::atomic<UInt64> m_CompileGeneration{0};
+
 	/** Returns if a redstone device is always ticked due to influence by its environment */
 	static bool IsAlwaysTicked(BLOCKTYPE a_Block);
 
-	/** Returns if a block is any sort of redstone device */
-	static bool IsRedstone(BLOCKTYPE a_Block);
-
 	void ProcessWorkItem(cChunk & Chunk, cChunk & TickingSource, const Vector3i Position);
 
+	/** Returns the parts of the component's state that decide where its scan looks for sources: the block type, with the on and off
+	variants counted as one, the facing, and a wire's connections. The power and on / off state are left out, so that a component
+	switching by itself keeps its compiled inputs. */
+	static UInt32 GetComponentTopology(const cIncrementalRedstoneSimulatorChunkData & Data, Vector3i Position, BLOCKTYPE Block, NIBBLETYPE Meta);
+
+	/** Returns the power delivered to the component, asking its compiled inputs, or compiling them first if they're missing or outdated. */
+	PowerLevel GetCompiledPower(cChunk & Chunk, Vector3i Position, BLOCKTYPE CurrentBlock, NIBBLETYPE CurrentMeta);
+
+	/** Marks the compiled components of all chunks that may depend on the block as outdated. */
+	void InvalidateCompiledComponents(cChunk & a_Chunk, Vector3i a_Position);
+
 	virtual void Simulate(float Dt) override {}
 	virtual void SimulateChunk(std::chrono::milliseconds Dt, int ChunkX, int ChunkZ, cChunk * Chunk) override;
 	virtual void AddBlock(cChunk & a_Chunk, Vector3i a_Position, BLOCKTYPE a_Block) override;
@@ -23,27 +23,20 @@ namespace ObserverHandler
 			return false;
 		}
 
-		auto & ObserverCache = a_Data.ObserverCache;
-		const auto FindResult = ObserverCache.find(a_Position);
+		const auto Previous = a_Data.GetObservedBlock(a_Position);
 		const auto Observed = std::make_pair(BlockType, BlockMeta);
 
-		if (FindResult == ObserverCache.end())
+		if (Previous == nullptr)
 		{
 			// Cache the last seen block for this position:
-			ObserverCache.emplace(a_Position, Observed);
+			a_Data.SetObservedBlock(a_Position, Observed);
 
 			// Definitely should signal update:
 			return true;
 		}
 
-		// The block this observer previously saw.
-		const auto Previous = FindResult->second;
-
-		// Update the last seen block:
-		FindResult->second = Observed;
-
-		// Determine if to signal an update based on the block previously observed changed
-		return Previous != Observed;
+		// Update the last seen block, determining if to signal an update based on the block previously observed changed:
+		return std::exchange(*Previous, Observed) != Observed;
 	}
 
 	static PowerLevel GetPowerDeliveredToPosition(const cChunk & a_Chunk, Vector3i a_Position, BLOCKTYPE a_BlockType, Vector3i a_QueryPosition, BLOCKTYPE a_QueryBlockType, bool IsLinked)
@@ -68,7 +61,7 @@ namespace ObserverHandler
 
 			// From rest, we've determined there was a block update
 			// Schedule power-on 1 tick in the future
-			Data.m_MechanismDelays[a_Position] = std::make_pair(1, true);
+			Data.SetMechanismDelayInfo(a_Position, std::make_pair(1, true));
 
 			return;
 		}
@@ -91,7 +84,7 @@ namespace ObserverHandler
 		else
 		{
 			// We've reset. Erase delay data in preparation for detecting further updates
-			Data.m_MechanismDelays.erase(a_Position);
+			Data.EraseMechanismDelayInfo(a_Position);
 			a_Chunk.SetMeta(a_Position, a_Meta & ~0x8);
 		}
 
@@ -137,7 +137,7 @@ namespace PressurePlateHandler
 
 			// From rest, a player stepped on us
 			// Schedule a minimum 0.5 second delay before even thinking about releasing
-			ChunkData.m_MechanismDelays[a_Position] = std::make_pair(5, true);
+			ChunkData.SetMechanismDelayInfo(a_Position, std::make_pair(5, true));
 
 			a_Chunk.GetWorld()->BroadcastSoundEffect(GetClickOnSound(a_BlockType), Absolute, 0.5f, 0.6f);
 
@@ -208,7 +208,7 @@ namespace PressurePlateHandler
 		}
 
 		// Just got out of the subsequent release phase, reset everything and raise the plate
-		ChunkData.m_MechanismDelays.erase(a_Position);
+		ChunkData.EraseMechanismDelayInfo(a_Position);
 
 		a_Chunk.GetWorld()->BroadcastSoundEffect(GetClickOffSound(a_BlockType), Absolute, 0.5f, 0.5f);
 		ChunkData.SetCachedPowerData(a_Position, PowerLevel);
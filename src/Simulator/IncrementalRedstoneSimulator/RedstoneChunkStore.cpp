@@ -0,0 +1,313 @@
+// RedstoneChunkStore.cpp
+
+// Implements the cRedstoneChunkStore class that holds the incremental redstone simulator's per-block data of a single chunk
+
+#include "Globals.h"
+#include "RedstoneChunkStore.h"
+
+
+
+
+
+/** Returns the index of the section containing the block. */
+static size_t SectionOf(const Vector3i a_Position)
+{
+	return static_cast<size_t>(a_Position.y / cChunkDef::SectionHeight);
+}
+
+
+
+
+
+/** Returns the index of the block within its section. */
+static size_t IndexInSection(const Vector3i a_Position)
+{
+	return static_cast<size_t>(a_Position.x + cChunkDef::Width * (a_Position.z + cChunkDef::Width * (a_Position.y % cChunkDef::SectionHeight)));
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cRedstoneChunkStore::sRecord:
+
+cRedstoneChunkStore::sRecord::sRecord(const UInt16 a_BlockIndex) :
+	m_Delay(0, false),
+	m_WireState(0),
+	m_ObservedBlock(0, 0),
+	m_Power(0),
+	m_Flags(0),
+	m_BlockIndex(a_BlockIndex)
+{
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cRedstoneChunkStore::sSection:
+
+cRedstoneChunkStore::sSection::sSection(void)
+{
+	m_Index.fill(0);
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cRedstoneChunkStore:
+
+PowerLevel cRedstoneChunkStore::GetPower(const Vector3i a_Position) const
+{
+	const auto Record = Find(a_Position);
+	return (Record == nullptr) ? 0 : Record->m_Power;
+}
+
+
+
+
+
+void cRedstoneChunkStore::SetPower(const Vector3i a_Position, const PowerLevel a_Power)
+{
+	ExchangePower(a_Position, a_Power);
+}
+
+
+
+
+
+PowerLevel cRedstoneChunkStore::ExchangePower(const Vector3i a_Position, const PowerLevel a_Power)
+{
+	if (a_Power == 0)
+	{
+		// Zero is the same as no power level, don't create a record just for that:
+		const auto Record = Find(a_Position);
+		if (Record == nullptr)
+		{
+			return 0;
+		}
+		const auto Previous = std::exchange(Record->m_Power, a_Power);
+		RemoveIfEmpty(a_Position);
+		return Previous;
+	}
+
+	return std::exchange(FindOrCreate(a_Position).m_Power, a_Power);
+}
+
+
+
+
+
+cRedstoneChunkStore::cDelayInfo * cRedstoneChunkStore::GetDelay(const Vector3i a_Position)
+{
+	const auto Record = Find(a_Position);
+	return ((Record == nullptr) || ((Record->m_Flags & HAS_DELAY) == 0)) ? nullptr : &Record->m_Delay;
+}
+
+
+
+
+
+void cRedstoneChunkStore::SetDelay(const Vector3i a_Position, const cDelayInfo a_Delay)
+{
+	auto & Record = FindOrCreate(a_Position);
+	Record.m_Delay = a_Delay;
+	Record.m_Flags |= HAS_DELAY;
+}
+
+
+
+
+
+void cRedstoneChunkStore::EraseDelay(const Vector3i a_Position)
+{
+	const auto Record = Find(a_Position);
+	if (Record != nullptr)
+	{
+		Record->m_Flags &= ~HAS_DELAY;
+		RemoveIfEmpty(a_Position);
+	}
+}
+
+
+
+
+
+BlockState * cRedstoneChunkStore::GetWireState(const Vector3i a_Position)
+{
+	return const_cast<BlockState *>(static_cast<const cRedstoneChunkStore *>(this)->GetWireState(a_Position));
+}
+
+
+
+
+
+const BlockState * cRedstoneChunkStore::GetWireState(const Vector3i a_Position) const
+{
+	const auto Record = Find(a_Position);
+	return ((Record == nullptr) || ((Record->m_Flags & HAS_WIRE_STATE) == 0)) ? nullptr : &Record->m_WireState;
+}
+
+
+
+
+
+void cRedstoneChunkStore::SetWireState(const Vector3i a_Position, const BlockState a_State)
+{
+	auto & Record = FindOrCreate(a_Position);
+	Record.m_WireState = a_State;
+	Record.m_Flags |= HAS_WIRE_STATE;
+}
+
+
+
+
+
+cRedstoneChunkStore::cObservedBlock * cRedstoneChunkStore::GetObservedBlock(const Vector3i a_Position)
+{
+	const auto Record = Find(a_Position);
+	return ((Record == nullptr) || ((Record->m_Flags & HAS_OBSERVED_BLOCK) == 0)) ? nullptr : &Record->m_ObservedBlock;
+}
+
+
+
+
+
+void cRedstoneChunkStore::SetObservedBlock(const Vector3i a_Position, const cObservedBlock a_Block)
+{
+	auto & Record = FindOrCreate(a_Position);
+	Record.m_ObservedBlock = a_Block;
+	Record.m_Flags |= HAS_OBSERVED_BLOCK;
+}
+
+
+
+
+
+void cRedstoneChunkStore::SetAlwaysTicked(const Vector3i a_Position)
+{
+	FindOrCreate(a_Position).m_Flags |= IS_ALWAYS_TICKED;
+}
+
+
+
+
+
+void cRedstoneChunkStore::Erase(const Vector3i a_Position)
+{
+	const auto Record = Find(a_Position);
+	if (Record != nullptr)
+	{
+		Record->m_Flags = 0;
+		Record->m_Power = 0;
+		RemoveIfEmpty(a_Position);
+	}
+}
+
+
+
+
+
+size_t cRedstoneChunkStore::GetNumRecords(void) const
+{
+	size_t Count = 0;
+	for (const auto & Section : m_Sections)
+	{
+		if (Section != nullptr)
+		{
+			Count += Section->m_Records.size();
+		}
+	}
+	return Count;
+}
+
+
+
+
+
+cRedstoneChunkStore::sRecord * cRedstoneChunkStore::Find(const Vector3i a_Position)
+{
+	return const_cast<sRecord *>(static_cast<const cRedstoneChunkStore *>(this)->Find(a_Position));
+}
+
+
+
+
+
+const cRedstoneChunkStore::sRecord * cRedstoneChunkStore::Find(const Vector3i a_Position) const
+{
+	if (!cChunkDef::IsValidRelPos(a_Position))
+	{
+		return nullptr;
+	}
+
+	const auto & Section = m_Sections[SectionOf(a_Position)];
+	if (Section == nullptr)
+	{
+		return nullptr;
+	}
+
+	const auto Index = Section->m_Index[IndexInSection(a_Position)];
+	return (Index == 0) ? nullptr : &Section->m_Records[Index - 1U];
+}
+
+
+
+
+
+cRedstoneChunkStore::sRecord & cRedstoneChunkStore::FindOrCreate(const Vector3i a_Position)
+{
+	ASSERT(cChunkDef::IsValidRelPos(a_Position));
+
+	auto & Section = m_Sections[SectionOf(a_Position)];
+	if (Section == nullptr)
+	{
+		Section = std::make_unique<sSection>();
+	}
+
+	const auto BlockIndex = IndexInSection(a_Position);
+	auto & Index = Section->m_Index[BlockIndex];
+	if (Index == 0)
+	{
+		Section->m_Records.emplace_back(static_cast<UInt16>(BlockIndex));
+		Index = static_cast<UInt16>(Section->m_Records.size());
+	}
+	return Section->m_Records[Index - 1U];
+}
+
+
+
+
+
+void cRedstoneChunkStore::RemoveIfEmpty(const Vector3i a_Position)
+{
+	auto & Section = m_Sections[SectionOf(a_Position)];
+	auto & Index = Section->m_Index[IndexInSection(a_Position)];
+	auto & Records = Section->m_Records;
+	if (!Records[Index - 1U].IsEmpty())
+	{
+		return;
+	}
+
+	// Move the last record into the hole, keeping the records packed:
+	if (Index != Records.size())
+	{
+		Records[Index - 1U] = Records.back();
+		Section->m_Index[Records.back().m_BlockIndex] = Index;
+	}
+	Records.pop_back();
+	Index = 0;
+
+	if (Records.empty())
+	{
+		Section.reset();
+	}
+}
+
+
+
+
@@ -0,0 +1,201 @@
+// RedstoneChunkStore.h
+
+// Declares the cRedstoneChunkStore class that holds the incremental redstone simulator's per-block data of a single chunk
+
+/*
+The simulator remembers a few things about some of the blocks in a chunk: the last power level a device has seen,
+the delay countdown of repeaters, torches, comparators and the like, the connection state of wires,
+the block an observer has last seen, and whether the block needs ticking every tick.
+
+All of that is kept in a single record per block, and the records are stored per chunk section:
+each section that has any records has a flat index of all its 4096 blocks, pointing into a packed array of the records.
+Looking a block up is then a plain array access, rather than a hash probe into a separate container for each kind of data,
+and walking all the delays or always-ticked blocks of a chunk is a walk over the packed arrays.
+A record is removed once it holds no data, and a section's storage once it holds no records.
+
+Pointers returned by the getters stay valid until a record is added or removed in the same section;
+changing the data of an existing record doesn't move it.
+*/
+
+
+
+
+
+#pragma once
+
+#include "BlockState.h"
+#include "ChunkDef.h"
+
+
+
+
+
+using PowerLevel = unsigned char;
+
+
+
+
+
+class cRedstoneChunkStore
+{
+public:
+
+	/** A mechanism's delay countdown, in ticks, and whether it's to be powered on once the countdown elapses. */
+	using cDelayInfo = std::pair<int, bool>;
+
+	/** The block type and meta last seen by an observer. */
+	using cObservedBlock = std::pair<BLOCKTYPE, NIBBLETYPE>;
+
+	/** Returns the power level remembered for the block, or zero if there's none. */
+	PowerLevel GetPower(Vector3i a_Position) const;
+
+	/** Remembers the power level for the block. */
+	void SetPower(Vector3i a_Position, PowerLevel a_Power);
+
+	/** Remembers the power level for the block, returning the previous one, or zero if there was none. */
+	PowerLevel ExchangePower(Vector3i a_Position, PowerLevel a_Power);
+
+	/** Returns the block's delay info, or nullptr if it has none. */
+	cDelayInfo * GetDelay(Vector3i a_Position);
+
+	/** Sets the block's delay info, replacing any previous one. */
+	void SetDelay(Vector3i a_Position, cDelayInfo a_Delay);
+
+	/** Removes the block's delay info, if any. */
+	void EraseDelay(Vector3i a_Position);
+
+	/** Returns the wire's connection state, or nullptr if it has none. */
+	BlockState * GetWireState(Vector3i a_Position);
+	const BlockState * GetWireState(Vector3i a_Position) const;
+
+	/** Sets the wire's connection state, replacing any previous one. */
+	void SetWireState(Vector3i a_Position, BlockState a_State);
+
+	/** Returns the block last seen by the observer, or nullptr if it has none. */
+	cObservedBlock * GetObservedBlock(Vector3i a_Position);
+
+	/** Sets the block last seen by the observer, replacing any previous one. */
+	void SetObservedBlock(Vector3i a_Position, cObservedBlock a_Block);
+
+	/** Marks the block as needing a tick every tick. */
+	void SetAlwaysTicked(Vector3i a_Position);
+
+	/** Removes all the data of the block. */
+	void Erase(Vector3i a_Position);
+
+	/** Calls the callback with the position and the delay info of each block that has one. */
+	template <class Callback>
+	void ForEachDelay(Callback a_Callback)
+	{
+		ForEachRecordWith(HAS_DELAY, [&a_Callback](const Vector3i a_Position, sRecord & a_Record)
+		{
+			a_Callback(a_Position, a_Record.m_Delay);
+		});
+	}
+
+	/** Calls the callback with the position of each block that needs a tick every tick. */
+	template <class Callback>
+	void ForEachAlwaysTicked(Callback a_Callback)
+	{
+		ForEachRecordWith(IS_ALWAYS_TICKED, [&a_Callback](const Vector3i a_Position, sRecord & a_Record)
+		{
+			UNUSED(a_Record);
+			a_Callback(a_Position);
+		});
+	}
+
+	/** Returns the number of blocks that have any data. */
+	size_t GetNumRecords(void) const;
+
+protected:
+
+	/** The flags marking which of a record's data is valid. The power level is valid whenever it's nonzero. */
+	enum : UInt8
+	{
+		HAS_DELAY = 0x01,
+		HAS_WIRE_STATE = 0x02,
+		HAS_OBSERVED_BLOCK = 0x04,
+		IS_ALWAYS_TICKED = 0x08,
+	};
+
+	/** All the data of a single block. */
+	struct sRecord
+	{
+		cDelayInfo m_Delay;
+		BlockState m_WireState;
+		cObservedBlock m_ObservedBlock;
+		PowerLevel m_Power;
+		UInt8 m_Flags;
+
+		/** The index of the block within its section, so that the record's position is known when walking the records. */
+		UInt16 m_BlockIndex;
+
+		sRecord(UInt16 a_BlockIndex);
+
+		/** Returns true if the record holds no data and can be removed. */
+		bool IsEmpty(void) const { return (m_Flags == 0) && (m_Power == 0); }
+	};
+
+	static const size_t SectionBlockCount = cChunkDef::Width * cChunkDef::Width * cChunkDef::SectionHeight;
+
+	/** The records of a single chunk section. */
+	struct sSection
+	{
+		/** For each block of the section, one plus the index of its record in m_Records, or zero if it has none. */
+		std::array<UInt16, SectionBlockCount> m_Index;
+
+		/** The records of the blocks that have any data, packed, in no particular order. */
+		std::vector<sRecord> m_Records;
+
+		sSection(void);
+	};
+
+	/** The sections that have any records, nullptr for those that don't. */
+	std::array<std::unique_ptr<sSection>, cChunkDef::NumSections> m_Sections;
+
+
+	/** Returns the block's record, or nullptr if it has none. Positions outside the chunk have none. */
+	sRecord * Find(Vector3i a_Position);
+	const sRecord * Find(Vector3i a_Position) const;
+
+	/** Returns the block's record, creating an empty one if it has none. */
+	sRecord & FindOrCreate(Vector3i a_Position);
+
+	/** Removes the block's record if it holds no data. */
+	void RemoveIfEmpty(Vector3i a_Position);
+
+	/** Calls the callback with the position and the record of each record that has any of the specified flags. */
+	template <class Callback>
+	void ForEachRecordWith(UInt8 a_Flags, Callback a_Callback)
+	{
+		for (size_t SectionY = 0; SectionY < m_Sections.size(); SectionY++)
+		{
+			if (m_Sections[SectionY] == nullptr)
+			{
+				continue;
+			}
+			for (auto & Record : m_Sections[SectionY]->m_Records)
+			{
+				if ((Record.m_Flags & a_Flags) != 0)
+				{
+					a_Callback(PositionOf(SectionY, Record.m_BlockIndex), Record);
+				}
+			}
+		}
+	}
+
+	/** Returns the position of the block with the specified index within the specified section. */
+	static Vector3i PositionOf(size_t a_SectionY, UInt16 a_BlockIndex)
+	{
+		return
+		{
+			a_BlockIndex % cChunkDef::Width,
+			static_cast<int>(a_SectionY) * cChunkDef::SectionHeight + a_BlockIndex / (cChunkDef::Width * cChunkDef::Width),
+			(a_BlockIndex / cChunkDef::Width) % cChunkDef::Width
+		};
+	}
+};
+
+
+
+
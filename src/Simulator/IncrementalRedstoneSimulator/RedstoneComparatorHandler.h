@@ -97,7 +97,7 @@ namespace RedstoneComparatorHandler
 
 			if (ShouldUpdate)
 			{
-				Data.m_MechanismDelays[a_Position] = std::make_pair(1, bool());
+				Data.SetMechanismDelayInfo(a_Position, std::make_pair(1, bool()));
 			}
 
 			return;
@@ -119,7 +119,7 @@ namespace RedstoneComparatorHandler
 		Data.ExchangeUpdateOncePowerData(a_Position, FrontPower);
 
 		a_Chunk.SetMeta(a_Position, NewMeta);
-		Data.m_MechanismDelays.erase(a_Position);
+		Data.EraseMechanismDelayInfo(a_Position);
 
 		// Assume that an update (to front power) is needed:
 		UpdateAdjustedRelative(a_Chunk, CurrentlyTicking, a_Position, cBlockComparatorHandler::GetFrontCoordinate(a_Position, a_Meta & 0x3) - a_Position);
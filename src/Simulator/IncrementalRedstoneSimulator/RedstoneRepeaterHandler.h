@@ -110,7 +110,7 @@ namespace RedstoneRepeaterHandler
 		{
 			if (DelayInfo != nullptr)
 			{
-				Data.m_MechanismDelays.erase(a_Position);
+				Data.EraseMechanismDelayInfo(a_Position);
 			}
 
 			return;
@@ -121,7 +121,7 @@ namespace RedstoneRepeaterHandler
 			bool ShouldBeOn = (Power != 0);
 			if (ShouldBeOn != IsOn(a_BlockType))
 			{
-				Data.m_MechanismDelays[a_Position] = std::make_pair((((a_Meta & 0xC) >> 0x2) + 1), ShouldBeOn);
+				Data.SetMechanismDelayInfo(a_Position, std::make_pair((((a_Meta & 0xC) >> 0x2) + 1), ShouldBeOn));
 			}
 
 			return;
@@ -138,7 +138,7 @@ namespace RedstoneRepeaterHandler
 
 		const auto NewType = ShouldPowerOn ? E_BLOCK_REDSTONE_REPEATER_ON : E_BLOCK_REDSTONE_REPEATER_OFF;
 		a_Chunk.FastSetBlock(a_Position, NewType, a_Meta);
-		Data.m_MechanismDelays.erase(a_Position);
+		Data.EraseMechanismDelayInfo(a_Position);
 
 		// While sleeping, we ignore any power changes and apply our saved ShouldBeOn when sleep expires
 		// Now, we need to recalculate to be aware of any new changes that may e.g. cause a new output change
@@ -5,13 +5,46 @@
 
 #include "Chunk.h"
 #include "BlockState.h"
+#include "RedstoneChunkStore.h"
 #include "Simulator/RedstoneSimulator.h"
 
 
 
 
 
-using PowerLevel = unsigned char;
+/** A single power input of a compiled component: a block that may deliver power, and how to ask it.
+Positions are relative to the component's chunk. */
+struct sRedstoneLink
+{
+	/** The position of the block that may deliver power. */
+	Vector3i m_Source;
+
+	/** The position the power is asked for; the component itself, the block above it for quasiconnectivity, or the solid block conducting linked power. */
+	Vector3i m_Query;
+
+	/** The block type the power is asked for.
+	The sources only tell wires from other blocks, so this stays valid when the component switches between its on and off block types. */
+	BLOCKTYPE m_QueryBlock;
+
+	/** Whether the power is conducted through the solid block at m_Query. */
+	bool m_IsLinked;
+};
+
+
+
+
+
+/** The power inputs of a component, compiled from a scan of its surroundings, and the component topology they were compiled for. */
+struct sRedstoneCompiledComponent
+{
+	/** The parts of the component's state that decide where the scan looks for sources, see cIncrementalRedstoneSimulator::GetComponentTopology(). */
+	UInt32 m_Topology;
+
+	/** The simulator's compile generation when the links were compiled, see cIncrementalRedstoneSimulatorChunkData::IsCompiledComponentValid(). */
+	UInt64 m_CompiledAt;
+
+	std::vector<sRedstoneLink> m_Links;
+};
 
 
 
@@ -33,42 +66,152 @@ public:
 
 	PowerLevel GetCachedPowerData(const Vector3i Position) const
 	{
-		auto Result = m_CachedPowerLevels.find(Position);
-		return (Result == m_CachedPowerLevels.end()) ? 0 : Result->second;
+		return m_Store.GetPower(Position);
 	}
 
 	void SetCachedPowerData(const Vector3i Position, const PowerLevel PowerLevel)
 	{
-		m_CachedPowerLevels[Position] = PowerLevel;
+		m_Store.SetPower(Position, PowerLevel);
+	}
+
+	cRedstoneChunkStore::cDelayInfo * GetMechanismDelayInfo(const Vector3i Position)
+	{
+		return m_Store.GetDelay(Position);
+	}
+
+	void SetMechanismDelayInfo(const Vector3i Position, const cRedstoneChunkStore::cDelayInfo DelayInfo)
+	{
+		m_Store.SetDelay(Position, DelayInfo);
+	}
+
+	void EraseMechanismDelayInfo(const Vector3i Position)
+	{
+		m_Store.EraseDelay(Position);
+	}
+
+	/** Temporary, should be chunk data: wire block store, to avoid recomputing states every time.
+	Returns nullptr if the wire's state hasn't been computed yet. */
+	BlockState * GetWireState(const Vector3i Position)
+	{
+		return m_Store.GetWireState(Position);
+	}
+
+	const BlockState * GetWireState(const Vector3i Position) const
+	{
+		return m_Store.GetWireState(Position);
+	}
+
+	void SetWireState(const Vector3i Position, const BlockState State)
+	{
+		m_Store.SetWireState(Position, State);
+	}
+
+	/** Returns the observer's last seen block, or nullptr if it hasn't seen any yet. */
+	cRedstoneChunkStore::cObservedBlock * GetObservedBlock(const Vector3i Position)
+	{
+		return m_Store.GetObservedBlock(Position);
+	}
+
+	void SetObservedBlock(const Vector3i Position, const cRedstoneChunkStore::cObservedBlock Block)
+	{
+		m_Store.SetObservedBlock(Position, Block);
 	}
 
-	std::pair<int, bool> * GetMechanismDelayInfo(const Vector3i Position)
+	void SetAlwaysTicked(const Vector3i Position)
 	{
-		auto Result = m_MechanismDelays.find(Position);
-		return (Result == m_MechanismDelays.end()) ? nullptr : &Result->second;
+		m_Store.SetAlwaysTicked(Position);
 	}
 
 	/** Erase all cached redstone data for position. */
 	void ErasePowerData(const Vector3i Position)
 	{
-		m_CachedPowerLevels.erase(Position);
-		m_MechanismDelays.erase(Position);
-		AlwaysTickedPositions.erase(Position);
-		WireStates.erase(Position);
-		ObserverCache.erase(Position);
+		m_Store.Erase(Position);
+		m_CompiledComponents.erase(Position);
 	}
 
 	PowerLevel ExchangeUpdateOncePowerData(const Vector3i & a_Position, PowerLevel Power)
 	{
-		auto Result = m_CachedPowerLevels.find(a_Position);
+		return m_Store.ExchangePower(a_Position, Power);
+	}
+
+	/** Calls the callback with the position and the delay info of each mechanism that has one. */
+	template <class Callback>
+	void ForEachMechanismDelay(Callback a_Callback)
+	{
+		m_Store.ForEachDelay(a_Callback);
+	}
+
+	/** Calls the callback with the position of each block that needs a tick every tick. */
+	template <class Callback>
+	void ForEachAlwaysTicked(Callback a_Callback)
+	{
+		m_Store.ForEachAlwaysTicked(a_Callback);
+	}
+
+	/** Returns the component's compiled power inputs, or nullptr if it has none.
+	The caller needs to check that they match the component, and that they are still valid, see IsCompiledComponentValid(). */
+	const sRedstoneCompiledComponent * GetCompiledComponent(const Vector3i Position) const
+	{
+		const auto Itr = m_CompiledComponents.find(Position);
+		return (Itr == m_CompiledComponents.end()) ? nullptr : &Itr->second;
+	}
 
-		if (Result == m_CachedPowerLevels.end())
+	void SetCompiledComponent(const Vector3i Position, sRedstoneCompiledComponent && Component)
+	{
+		m_CompiledComponents[Position] = std::move(Component);
+	}
+
+	void EraseCompiledComponent(const Vector3i Position)
+	{
+		m_CompiledComponents.erase(Position);
+	}
+
+	/** Marks the compiled components in this chunk between MinY and MaxY as outdated, because a block they may depend on has changed.
+	Whole sections are marked, the heights are clamped to the chunk. Generation is the simulator's current compile generation. */
+	void InvalidateCompiledComponents(const UInt64 Generation, const int MinY, const int MaxY)
+	{
+		const auto MinSection = std::max(MinY, 0) / cChunkDef::SectionHeight;
+		const auto MaxSection = std::min(MaxY, cChunkDef::Height - 1) / cChunkDef::SectionHeight;
+		for (auto Section = MinSection; Section <= MaxSection; Section++)
 		{
-			m_CachedPowerLevels[a_Position] = Power;
-			return 0;
+			m_TopologyChangedAt[static_cast<size_t>(Section)] = Generation;
 		}
+		m_HasOutdatedCompiledComponents = !m_CompiledComponents.empty();
+	}
 
-		return std::exchange(Result->second, Power);
+	/** Returns true if no block the component at Position may depend on has changed since it was compiled. */
+	bool IsCompiledComponentValid(const Vector3i Position, const sRedstoneCompiledComponent & Component) const
+	{
+		return Component.m_CompiledAt > m_TopologyChangedAt[static_cast<size_t>(Position.y / cChunkDef::SectionHeight)];
+	}
+
+	/** Erases the outdated compiled components, if any were marked since the last call.
+	The outdated ones are otherwise only replaced once their component is updated again, which may be never. */
+	void PruneCompiledComponents()
+	{
+		if (!m_HasOutdatedCompiledComponents)
+		{
+			return;
+		}
+
+		for (auto Itr = m_CompiledComponents.begin(); Itr != m_CompiledComponents.end();)
+		{
+			if (IsCompiledComponentValid(Itr->first, Itr->second))
+			{
+				++Itr;
+			}
+			else
+			{
+				Itr = m_CompiledComponents.erase(Itr);
+			}
+		}
+		m_HasOutdatedCompiledComponents = false;
+	}
+
+	/** Returns the number of compiled components kept in this chunk, outdated or not. */
+	size_t GetNumCompiledComponents() const
+	{
+		return m_CompiledComponents.size();
 	}
 
 	/** Adjust From-relative coordinates into To-relative coordinates. */
@@ -82,24 +225,23 @@ public:
 		};
 	}
 
-	/** Temporary, should be chunk data: wire block store, to avoid recomputing states every time. */
-	std::unordered_map<Vector3i, BlockState, VectorHasher<int>> WireStates;
-
-	std::unordered_set<Vector3i, VectorHasher<int>> AlwaysTickedPositions;
-
-	/** Structure storing an observer's last seen block. */
-	std::unordered_map<Vector3i, std::pair<BLOCKTYPE, NIBBLETYPE>, VectorHasher<int>> ObserverCache;
-
-	/** Structure storing position of mechanism + it's delay ticks (countdown) & if to power on. */
-	std::unordered_map<Vector3i, std::pair<int, bool>, VectorHasher<int>> m_MechanismDelays;
-
 private:
 
 	std::stack<Vector3i, std::vector<Vector3i>> m_ActiveBlocks;
 
 	// TODO: map<Vector3i, int> -> Position of torch + it's heat level
 
-	std::unordered_map<Vector3i, PowerLevel, VectorHasher<int>> m_CachedPowerLevels;
+	/** The power levels, mechanism delays, wire states, observed blocks and always ticked flags of the blocks. */
+	cRedstoneChunkStore m_Store;
+
+	/** The compiled power inputs of the components, used instead of scanning their surroundings when the simulator compiles components. */
+	std::unordered_map<Vector3i, sRedstoneCompiledComponent, VectorHasher<int>> m_CompiledComponents;
+
+	/** The simulator's compile generation when a block that the compiled components in each section may depend on last changed. */
+	std::array<UInt64, cChunkDef::NumSections> m_TopologyChangedAt{};
+
+	/** True if some compiled components may have been outdated since the last PruneCompiledComponents(). */
+	bool m_HasOutdatedCompiledComponents = false;
 
 	friend class cRedstoneHandlerFactory;
 };
@@ -57,7 +57,7 @@ namespace RedstoneTorchHandler
 			const bool ShouldBeOn = (Power == 0);
 			if (ShouldBeOn != IsOn(a_BlockType))
 			{
-				Data.m_MechanismDelays[a_Position] = std::make_pair(1, ShouldBeOn);
+				Data.SetMechanismDelayInfo(a_Position, std::make_pair(1, ShouldBeOn));
 			}
 
 			return;
@@ -73,7 +73,7 @@ namespace RedstoneTorchHandler
 		}
 
 		a_Chunk.FastSetBlock(a_Position, ShouldPowerOn ? E_BLOCK_REDSTONE_TORCH_ON : E_BLOCK_REDSTONE_TORCH_OFF, a_Meta);
-		Data.m_MechanismDelays.erase(a_Position);
+		Data.EraseMechanismDelayInfo(a_Position);
 
 		for (const auto & Adjacent : RelativeAdjacents)
 		{
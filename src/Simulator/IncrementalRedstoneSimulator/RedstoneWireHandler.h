@@ -133,7 +133,7 @@ namespace RedstoneWireHandler
 				// This function is called during chunk load (through AddBlock). Attempt to tell it its new state:
 				if ((NeighbourChunk != &Chunk) && (LateralBlock == E_BLOCK_REDSTONE_WIRE))
 				{
-					auto & NeighbourBlock = DataForChunk(*NeighbourChunk).WireStates.find(Adjacent)->second;
+					auto & NeighbourBlock = *DataForChunk(*NeighbourChunk).GetWireState(Adjacent);
 					SetDirectionState(-Offset, NeighbourBlock, TemporaryDirection::Side);
 				}
 
@@ -150,7 +150,7 @@ namespace RedstoneWireHandler
 
 				if (NeighbourChunk != &Chunk)
 				{
-					auto & NeighbourBlock = DataForChunk(*NeighbourChunk).WireStates.find(Adjacent + OffsetYP)->second;
+					auto & NeighbourBlock = *DataForChunk(*NeighbourChunk).GetWireState(Adjacent + OffsetYP);
 					SetDirectionState(-Offset, NeighbourBlock, TemporaryDirection::Side);
 				}
 
@@ -168,19 +168,18 @@ namespace RedstoneWireHandler
 
 				if (NeighbourChunk != &Chunk)
 				{
-					auto & NeighbourBlock = DataForChunk(*NeighbourChunk).WireStates.find(Adjacent + OffsetYM)->second;
+					auto & NeighbourBlock = *DataForChunk(*NeighbourChunk).GetWireState(Adjacent + OffsetYM);
 					SetDirectionState(-Offset, NeighbourBlock, TemporaryDirection::Up);
 				}
 			}
 		}
 
-		auto & States = DataForChunk(Chunk).WireStates;
-		const auto FindResult = States.find(Position);
-		if (FindResult != States.end())
+		const auto Previous = DataForChunk(Chunk).GetWireState(Position);
+		if (Previous != nullptr)
 		{
-			if (Block != FindResult->second)
+			if (Block != *Previous)
 			{
-				FindResult->second = Block;
+				*Previous = Block;
 
 				// TODO: when state is stored as the block, the block handler updating via SetBlock will do this automatically
 				// When a wire changes connection state, it needs to update its neighbours:
@@ -190,7 +189,7 @@ namespace RedstoneWireHandler
 			return;
 		}
 
-		DataForChunk(Chunk).WireStates.emplace(Position, Block);
+		DataForChunk(Chunk).SetWireState(Position, Block);
 	}
 
 	static PowerLevel GetPowerDeliveredToPosition(const cChunk & a_Chunk, Vector3i a_Position, BLOCKTYPE a_BlockType, Vector3i a_QueryPosition, BLOCKTYPE a_QueryBlockType, bool IsLinked)
@@ -214,7 +213,7 @@ namespace RedstoneWireHandler
 		}
 
 		const auto & Data = DataForChunk(a_Chunk);
-		const auto Block = Data.WireStates.find(a_Position)->second;
+		const auto Block = *Data.GetWireState(a_Position);
 
 		DoWithDirectionState(QueryOffset, Block, [a_QueryBlockType, &Power](const auto Left, const auto Front, const auto Right)
 		{
@@ -289,7 +288,7 @@ namespace RedstoneWireHandler
 		Callback(a_Position + OffsetYM);
 
 		const auto & Data = DataForChunk(a_Chunk);
-		const auto Block = Data.WireStates.find(a_Position)->second;
+		const auto Block = *Data.GetWireState(a_Position);
 
 		// Figure out, based on our pre-computed block, where we connect to:
 		for (const auto & Offset : RelativeLaterals)
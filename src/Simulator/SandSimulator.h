@@ -60,7 +60,7 @@ private:
 
 	bool m_IsInstantFall;  // If set to true, blocks don't fall using cFallingBlock entity, but instantly instead
 
-	int  m_TotalBlocks;    // Total number of blocks currently in the queue for simulating
+	std::atomic<int> m_TotalBlocks;  // Total number of blocks currently in the queue for simulating
 
 	virtual void AddBlock(cChunk & a_Chunk, Vector3i a_Position, BLOCKTYPE a_Block) override;
 
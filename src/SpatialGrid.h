@@ -0,0 +1,190 @@
+// SpatialGrid.h
+
+// Declares the cSpatialGrid class template that indexes items by their position, for finding the items near a place
+
+/*
+Finding the entities within a box used to mean checking every entity of each chunk the box touches,
+which gets expensive in chunks with hundreds of entities (mob farms, item piles), where each entity
+looks for the others around itself every tick.
+
+The grid divides the space into cubic cells and remembers, for each cell, the items positioned in it.
+Only the cells that have any items are stored. Finding the items within a box then only visits the cells
+the box overlaps, or all the items if that's less work (huge boxes).
+
+The grid only knows the positions it's been told, it's up to the owner to tell it when an item moves
+and to allow, in its queries, for the items' sizes and for any moves the grid hasn't been told about yet.
+The callback may get items slightly outside the box (the cell granularity), it's expected to do the exact check.
+*/
+
+
+
+
+
+#pragma once
+
+#include "Vector3.h"
+
+
+
+
+
+template <class Item>
+class cSpatialGrid
+{
+public:
+
+	/** Creates an empty grid with the specified cell size, in blocks, along each axis. */
+	explicit cSpatialGrid(double a_CellSize) :
+		m_CellSize(a_CellSize)
+	{
+		ASSERT(a_CellSize > 0);
+	}
+
+	/** Adds the item at the specified position. The item must not be in the grid already. */
+	void Add(Item a_Item, const Vector3d a_Position)
+	{
+		const auto Cell = CellOf(a_Position);
+		const bool IsNew = m_ItemCells.emplace(a_Item, Cell).second;
+		ASSERT(IsNew);
+		UNUSED(IsNew);
+		m_Cells[Cell].push_back(a_Item);
+	}
+
+	/** Updates the position of an item already in the grid. Cheap if the item stays within its cell. */
+	void Move(Item a_Item, const Vector3d a_Position)
+	{
+		const auto Itr = m_ItemCells.find(a_Item);
+		ASSERT(Itr != m_ItemCells.end());
+
+		const auto Cell = CellOf(a_Position);
+		if (Itr->second == Cell)
+		{
+			return;
+		}
+		RemoveFromCell(a_Item, Itr->second);
+		Itr->second = Cell;
+		m_Cells[Cell].push_back(a_Item);
+	}
+
+	/** Removes the item from the grid. Returns false if the item wasn't in the grid. */
+	bool Remove(Item a_Item)
+	{
+		const auto Itr = m_ItemCells.find(a_Item);
+		if (Itr == m_ItemCells.end())
+		{
+			return false;
+		}
+		RemoveFromCell(a_Item, Itr->second);
+		m_ItemCells.erase(Itr);
+		return true;
+	}
+
+	/** Removes all the items. */
+	void Clear(void)
+	{
+		m_Cells.clear();
+		m_ItemCells.clear();
+	}
+
+	/** Returns the number of items in the grid. */
+	size_t GetNumItems(void) const { return m_ItemCells.size(); }
+
+	/** Calls the callback for each item in the cells overlapping the box between the specified corners.
+	If the callback returns true, the enumeration is aborted and false is returned. */
+	template <class Callback>
+	bool ForEachInBox(const Vector3d a_Min, const Vector3d a_Max, Callback a_Callback) const
+	{
+		const auto MinCell = CellOf(a_Min);
+		const auto MaxCell = CellOf(a_Max);
+		const auto NumCells =
+			static_cast<double>(MaxCell.x - MinCell.x + 1) *
+			static_cast<double>(MaxCell.y - MinCell.y + 1) *
+			static_cast<double>(MaxCell.z - MinCell.z + 1);
+
+		if (NumCells > static_cast<double>(m_Cells.size()))
+		{
+			// There are fewer non-empty cells than the box overlaps, check all the cells' coords instead:
+			for (const auto & Cell : m_Cells)
+			{
+				if (
+					(Cell.first.x < MinCell.x) || (Cell.first.x > MaxCell.x) ||
+					(Cell.first.y < MinCell.y) || (Cell.first.y > MaxCell.y) ||
+					(Cell.first.z < MinCell.z) || (Cell.first.z > MaxCell.z)
+				)
+				{
+					continue;
+				}
+				if (!ForEachInCell(Cell.second, a_Callback))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		for (int y = MinCell.y; y <= MaxCell.y; y++)
+		{
+			for (int z = MinCell.z; z <= MaxCell.z; z++)
+			{
+				for (int x = MinCell.x; x <= MaxCell.x; x++)
+				{
+					const auto Itr = m_Cells.find({ x, y, z });
+					if ((Itr != m_Cells.end()) && !ForEachInCell(Itr->second, a_Callback))
+					{
+						return false;
+					}
+				}  // for x
+			}  // for z
+		}  // for y
+		return true;
+	}
+
+protected:
+
+	/** The size of a cell along each axis. */
+	double m_CellSize;
+
+	/** The items in each non-empty cell, keyed by the cell's coords. */
+	std::unordered_map<Vector3i, std::vector<Item>, VectorHasher<int>> m_Cells;
+
+	/** The cell each item is in. */
+	std::unordered_map<Item, Vector3i> m_ItemCells;
+
+
+	/** Returns the coords of the cell containing the specified position. */
+	Vector3i CellOf(const Vector3d a_Position) const
+	{
+		return (a_Position / m_CellSize).Floor();
+	}
+
+	/** Removes the item from the specified cell's list, and the cell, if it becomes empty. */
+	void RemoveFromCell(Item a_Item, const Vector3i a_Cell)
+	{
+		const auto CellItr = m_Cells.find(a_Cell);
+		ASSERT(CellItr != m_Cells.end());
+
+		auto & Items = CellItr->second;
+		const auto Itr = std::find(Items.begin(), Items.end(), a_Item);
+		ASSERT(Itr != Items.end());
+		*Itr = Items.back();
+		Items.pop_back();
+		if (Items.empty())
+		{
+			m_Cells.erase(CellItr);
+		}
+	}
+
+	/** Calls the callback for each item in the cell. Returns false if the callback aborted the enumeration. */
+	template <class Callback>
+	static bool ForEachInCell(const std::vector<Item> & a_Items, Callback & a_Callback)
+	{
+		for (const auto & Entry : a_Items)
+		{
+			if (a_Callback(Entry))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+};
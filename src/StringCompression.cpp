@@ -134,6 +134,57 @@ Compression::Result Compression::Compressor::CompressZLib(const void * const Inp
 
 
 
+void Compression::Compressor::CompressZLib(const ContiguousByteBufferView Input, ContiguousByteBuffer & Output)
+{
+	Output.resize(GetZLibBound(Input.size()));
+	const auto BytesWrittenOut = CompressZLibInto(Input, Output.data(), Output.size());
+
+	// The bound is always enough:
+	ASSERT(BytesWrittenOut != 0);
+	Output.resize(BytesWrittenOut);
+}
+
+
+
+
+
+size_t Compression::Compressor::CompressZLibInto(const ContiguousByteBufferView Input, std::byte * const Output, const size_t OutputSize)
+{
+	return libdeflate_zlib_compress(m_Handle, Input.data(), Input.size(), Output, OutputSize);
+}
+
+
+
+
+
+size_t Compression::Compressor::GetZLibBound(const size_t InputSize) const
+{
+	return libdeflate_zlib_compress_bound(m_Handle, InputSize);
+}
+
+
+
+
+
+Compression::Compressor & Compression::GetThreadCompressor(const int CompressionFactor)
+{
+	// libdeflate supports factors 0 to 12:
+	static constexpr int MaxCompressionFactor = 12;
+	thread_local std::array<std::unique_ptr<Compressor>, MaxCompressionFactor + 1> Compressors;
+
+	const auto Factor = Clamp(CompressionFactor, 0, MaxCompressionFactor);
+	auto & Instance = Compressors[static_cast<size_t>(Factor)];
+	if (Instance == nullptr)
+	{
+		Instance = std::make_unique<Compressor>(Factor);
+	}
+	return *Instance;
+}
+
+
+
+
+
 Compression::Extractor::Extractor()
 {
 	m_Handle = libdeflate_alloc_decompressor();
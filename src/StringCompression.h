@@ -52,6 +52,16 @@ namespace Compression
 		Result CompressZLib(ContiguousByteBufferView Input);
 		Result CompressZLib(const void * Input, size_t Size);
 
+		/** Compresses directly into Output, which is sized to fit, without any intermediate buffer. */
+		void CompressZLib(ContiguousByteBufferView Input, ContiguousByteBuffer & Output);
+
+		/** Compresses directly into the caller's buffer of OutputSize bytes.
+		Returns the compressed size, or 0 if it doesn't fit; GetZLibBound() bytes always fit. */
+		size_t CompressZLibInto(ContiguousByteBufferView Input, std::byte * Output, size_t OutputSize);
+
+		/** Returns the maximum size that the zlib-compressed data of the specified size can have. */
+		size_t GetZLibBound(size_t InputSize) const;
+
 	private:
 
 		template <auto Algorithm>
@@ -80,4 +90,8 @@ namespace Compression
 
 		libdeflate_decompressor * m_Handle;
 	};
+
+	/** Returns the calling thread's compressor with the specified compression factor [0-12], creating it on first use.
+	Compressors are large and expensive to create, sharing them per thread is cheaper than having one per user. */
+	Compressor & GetThreadCompressor(int CompressionFactor);
 }
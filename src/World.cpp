@@ -58,6 +58,7 @@
 #include "SpawnPrepare.h"
 #include "FastRandom.h"
 #include "OpaqueWorld.h"
+#include "TBBWrapper.h"
 
 
 
@@ -149,6 +150,10 @@ cWorld::cWorld(
 #else
 	m_StorageCompressionFactor(6),
 #endif
+	m_StorageMaxParallelIO(8),
+	m_StorageSaveFlushIntervalMS(1000),
+	m_StorageShouldSyncSaves(false),
+	m_StorageCompactionThreshold(50),
 	m_IsSavingEnabled(true),
 	m_Dimension(a_Dimension),
 	m_IsSpawnExplicitlySet(false),
@@ -169,6 +174,7 @@ cWorld::cWorld(
 	m_IsDeepSnowEnabled(false),
 	m_ShouldLavaSpawnFire(true),
 	m_VillagersShouldHarvestCrops(true),
+	m_ParallelMobThinking(false),
 	m_SimulatorManager(),
 	m_SandSimulator(),
 	m_WaterSimulator(nullptr),
@@ -277,6 +283,10 @@ cWorld::cWorld(
 
 	m_StorageSchema               = IniFile.GetValueSet ("Storage",       "Schema",                      m_StorageSchema);
 	m_StorageCompressionFactor    = IniFile.GetValueSetI("Storage",       "CompressionFactor",           m_StorageCompressionFactor);
+	m_StorageMaxParallelIO        = IniFile.GetValueSetI("Storage",       "MaxParallelIO",               m_StorageMaxParallelIO);
+	m_StorageSaveFlushIntervalMS  = IniFile.GetValueSetI("Storage",       "SaveFlushIntervalMS",         m_StorageSaveFlushIntervalMS);
+	m_StorageShouldSyncSaves      = IniFile.GetValueSetB("Storage",       "FsyncOnFlush",                m_StorageShouldSyncSaves);
+	m_StorageCompactionThreshold  = IniFile.GetValueSetI("Storage",       "CompactRegionWastePercent",   m_StorageCompactionThreshold);
 	m_MaxCactusHeight             = IniFile.GetValueSetI("Plants",        "MaxCactusHeight",             3);
 	m_MaxSugarcaneHeight          = IniFile.GetValueSetI("Plants",        "MaxSugarcaneHeight",          3);
 	/* TODO: Enable when functionality exists again
@@ -306,11 +316,15 @@ cWorld::cWorld(
 	m_MinNetherPortalHeight       = IniFile.GetValueSetI("Mechanics",     "MinNetherPortalHeight",       3);
 	m_MaxNetherPortalHeight       = IniFile.GetValueSetI("Mechanics",     "MaxNetherPortalHeight",       21);
 	m_VillagersShouldHarvestCrops = IniFile.GetValueSetB("Monsters",      "VillagersShouldHarvestCrops", true);
+	m_ParallelMobThinking         = IniFile.GetValueSetB("Monsters",      "ParallelThinking",            false);
 	m_IsDaylightCycleEnabled      = IniFile.GetValueSetB("General",       "IsDaylightCycleEnabled",      true);
 	int GameMode                  = IniFile.GetValueSetI("General",       "Gamemode",                    static_cast<int>(m_GameMode));
 	int Weather                   = IniFile.GetValueSetI("General",       "Weather",                     static_cast<int>(m_Weather));
 
 	m_WorldAge = std::chrono::milliseconds(IniFile.GetValueSetI("General", "WorldAgeMS", 0LL));
+	m_ChunkMap.SetParallelTicking(IniFile.GetValueSetB("General", "ParallelChunkTicking", false));
+	m_ChunkMap.SetSectionResendThreshold(static_cast<size_t>(std::max(IniFile.GetValueSetI("General", "SectionResendThreshold", 1024), 0)));
+	m_ChunkMap.SetMaxPrefetchedChunks(static_cast<size_t>(std::max(IniFile.GetValueSetI("General", "MaxPrefetchedChunks", 1024), 0)));
 
 	// Load the weather frequency data:
 	if (m_Dimension == dimOverworld)
@@ -422,7 +436,10 @@ cWorld::cWorld(
 	m_SimulatorManager->RegisterSimulator(m_SandSimulator.get(), 1);
 	m_SimulatorManager->RegisterSimulator(m_FireSimulator.get(), 1);
 
-	m_Storage.Initialize(*this, m_StorageSchema, m_StorageCompressionFactor);
+	m_Storage.Initialize(
+		*this, m_StorageSchema, m_StorageCompressionFactor, m_StorageMaxParallelIO,
+		std::chrono::milliseconds(m_StorageSaveFlushIntervalMS), m_StorageShouldSyncSaves, m_StorageCompactionThreshold
+	);
 	m_Generator.Initialize(m_GeneratorCallbacks, m_GeneratorCallbacks, IniFile);
 
 	m_MapManager.LoadMapData();
@@ -1143,6 +1160,41 @@ void cWorld::TickMobs(std::chrono::milliseconds a_Dt)
 		}  // for i - AllFamilies[]
 	}  // if (Spawning enabled)
 
+	if (m_ParallelMobThinking)
+	{
+		// Let the mobs that are about to be ticked think in parallel, while the world lock keeps the world unchanged:
+		std::vector<std::pair<cMonster *, cChunk *>> Thinkers;
+		ForEachEntity([&Thinkers](cEntity & a_Entity)
+			{
+				if (a_Entity.IsMob() && a_Entity.IsTicking() && a_Entity.GetParentChunk()->HasAnyClients())
+				{
+					Thinkers.emplace_back(static_cast<cMonster *>(&a_Entity), a_Entity.GetParentChunk());
+				}
+				return false;
+			}
+		);
+		auto & ChunksCS = m_ChunkMap.GetCS();
+
+		// Isolated, so that this thread doesn't pick up unrelated tasks while waiting; these would get the chunkmap's CS that this thread owns:
+		tbb::this_task_arena::isolate([&Thinkers, &ChunksCS]()
+			{
+				tbb::parallel_for(
+					tbb::blocked_range<size_t>(0, Thinkers.size()),
+					[&Thinkers, &ChunksCS](const tbb::blocked_range<size_t> & a_Range)
+					{
+						// This thread holds the chunkmap's CS for us for the entire duration of the parallel thinking:
+						cCSBorrow Borrow(ChunksCS);
+						for (size_t Idx = a_Range.begin(); Idx != a_Range.end(); ++Idx)
+						{
+							Thinkers[Idx].first->Think(*Thinkers[Idx].second);
+						}
+					}
+				);
+			}
+		);
+	}
+
+	// Tick the mobs one by one, acting on what they've thought:
 	ForEachEntity([=](cEntity & a_Entity)
 		{
 			if (!a_Entity.IsMob())
@@ -2529,6 +2581,19 @@ void cWorld::PrepareChunk(int a_ChunkX, int a_ChunkZ, std::unique_ptr<cChunkCoor
 
 
 
+void cWorld::PrefetchChunks(cChunkCoordsVector a_Chunks)
+{
+	// Chunks may not be created while the chunkmap is being ticked in parallel, postpone to the tick thread proper:
+	QueueTask([Chunks = std::move(a_Chunks)](cWorld & a_World)
+	{
+		a_World.m_ChunkMap.PrefetchChunks(Chunks);
+	});
+}
+
+
+
+
+
 void cWorld::ChunkLoadFailed(int a_ChunkX, int a_ChunkZ)
 {
 	m_ChunkMap.ChunkLoadFailed(a_ChunkX, a_ChunkZ);
@@ -2806,10 +2871,22 @@ size_t cWorld::GetNumUnusedDirtyChunks(void) const
 
 
 
-void cWorld::GetChunkStats(int & a_NumValid, int & a_NumDirty, int & a_NumInLightingQueue)
+void cWorld::GetChunkStats(int & a_NumValid, int & a_NumDirty, cLightingThread::sStats & a_LightingStats)
 {
 	m_ChunkMap.GetChunkStats(a_NumValid, a_NumDirty);
-	a_NumInLightingQueue = static_cast<int>(m_Lighting.GetQueueLength());
+	a_LightingStats = m_Lighting.GetStats();
+}
+
+
+
+
+
+cWorld::sChunkCacheStats cWorld::GetChunkCacheStats(void) const
+{
+	sChunkCacheStats Stats;
+	m_ChunkSender.GetCacheStats(Stats.m_NumSerializedHits, Stats.m_NumSerializedMisses, Stats.m_SerializedMemory);
+	m_ChunkMap.GetPrefetchStats(Stats.m_NumPrefetched, Stats.m_NumPrefetchUsed, Stats.m_NumPrefetchEvicted);
+	return Stats;
 }
 
 
@@ -3038,7 +3115,9 @@ cRedstoneSimulator * cWorld::InitializeRedstoneSimulator(cIniFile & a_IniFile)
 
 	if (NoCaseCompare(SimulatorName, "Incremental") == 0)
 	{
-		res = new cIncrementalRedstoneSimulator(*this);
+		auto Simulator = new cIncrementalRedstoneSimulator(*this);
+		Simulator->SetCompileComponents(a_IniFile.GetValueSetB("Physics", "RedstoneCompileComponents", false));
+		res = Simulator;
 	}
 	else if (NoCaseCompare(SimulatorName, "noop") == 0)
 	{
@@ -307,6 +307,10 @@ public:
 	It is legal to call with no callback. */
 	void PrepareChunk(int a_ChunkX, int a_ChunkZ, std::unique_ptr<cChunkCoordCallback> a_CallAfter = {});
 
+	/** Queues the chunks to be loaded or generated ahead of the clients needing them, see cChunkMap::PrefetchChunks().
+	May be called from any thread, the chunks are prefetched in the tick thread. */
+	void PrefetchChunks(cChunkCoordsVector a_Chunks);
+
 	/** Marks the chunk as failed-to-load: */
 	void ChunkLoadFailed(int a_ChunkX, int a_ChunkZ);
 
@@ -752,8 +756,27 @@ public:
 	/** Returns the number of unused dirty chunks. That's the number of chunks that we can save and then unload. */
 	size_t GetNumUnusedDirtyChunks(void) const;  // tolua_export
 
-	/** Returns the number of chunks loaded and dirty, and in the lighting queue */
-	void GetChunkStats(int & a_NumValid, int & a_NumDirty, int & a_NumInLightingQueue);
+	/** Returns the number of chunks loaded and dirty, and the lighting queue and throughput stats */
+	void GetChunkStats(int & a_NumValid, int & a_NumDirty, cLightingThread::sStats & a_LightingStats);
+
+	/** The statistics of the chunk caches, as reported by GetChunkCacheStats(). */
+	struct sChunkCacheStats
+	{
+		/** The number of chunk sends that reused the serialized data from the cache, and that had to serialize the chunk. */
+		size_t m_NumSerializedHits = 0;
+		size_t m_NumSerializedMisses = 0;
+
+		/** The amount of serialized data held by the cache, in bytes. */
+		size_t m_SerializedMemory = 0;
+
+		/** The number of prefetched chunks waiting for a client, used by a client, and evicted without having been used. */
+		size_t m_NumPrefetched = 0;
+		size_t m_NumPrefetchUsed = 0;
+		size_t m_NumPrefetchEvicted = 0;
+	};
+
+	/** Returns the statistics of the serialized chunk cache and of the chunk prefetching. */
+	sChunkCacheStats GetChunkCacheStats(void) const;
 
 	// Various queues length queries (cannot be const, they lock their CS):
 	inline size_t GetGeneratorQueueLength  (void) { return m_Generator.GetQueueLength();   }    // tolua_export
@@ -948,6 +971,18 @@ private:
 
 	int m_StorageCompressionFactor;
 
+	/** The maximum number of chunk loads and saves the storage runs at the same time */
+	int m_StorageMaxParallelIO;
+
+	/** How long the storage holds back the chunk saves, to coalesce them and write them in batches per region */
+	int m_StorageSaveFlushIntervalMS;
+
+	/** Whether the storage syncs the region files to the disk after writing each batch of saves */
+	bool m_StorageShouldSyncSaves;
+
+	/** The percentage of unused space in a region file above which the storage compacts the file after saving into it; 0 disables the compaction */
+	int m_StorageCompactionThreshold;
+
 	/** Whether or not writing chunks to disk is currently enabled */
 	std::atomic<bool> m_IsSavingEnabled;
 
@@ -997,6 +1032,9 @@ private:
 	bool m_ShouldLavaSpawnFire;
 	bool m_VillagersShouldHarvestCrops;
 
+	/** If true, the mobs' thinking (cMonster::Think()) is ticked in parallel on the thread pool, before the mobs are ticked one by one. */
+	bool m_ParallelMobThinking;
+
 	std::vector<BlockTickQueueItem *> m_BlockTickQueue;
 	std::vector<BlockTickQueueItem *> m_BlockTickQueueCopy;  // Second is for safely removing the objects from the queue
 
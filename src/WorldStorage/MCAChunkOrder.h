@@ -0,0 +1,36 @@
+// MCAChunkOrder.h
+
+// Declares the order in which the chunks are laid out in a compacted or defragmented region (MCA) file
+
+
+
+
+
+#pragma once
+
+
+
+
+
+namespace MCAChunkOrder
+{
+	/** The number of chunks in a single region file. */
+	constexpr size_t NumChunks = 32 * 32;
+
+	/** Returns the index into the region file header tables of the chunk that is a_Order-th in the Z-order (Morton order)
+	of the region's chunk coords. Laying the chunks out in this order keeps the chunks near each other in the world
+	near each other in the file. */
+	inline size_t GetZOrderChunkIndex(const size_t a_Order)
+	{
+		ASSERT(a_Order < NumChunks);
+
+		// The even bits of the order are the X coord, the odd bits are the Z coord:
+		size_t LocalX = 0, LocalZ = 0;
+		for (size_t Bit = 0; Bit < 5; Bit++)
+		{
+			LocalX |= ((a_Order >> (2 * Bit)) & 1) << Bit;
+			LocalZ |= ((a_Order >> (2 * Bit + 1)) & 1) << Bit;
+		}
+		return LocalX + 32 * LocalZ;
+	}
+}
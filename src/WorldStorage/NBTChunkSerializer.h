@@ -21,6 +21,8 @@ class NBTChunkSerializer
 {
 public:
 
-	/** Serializes the chunk into the specified writer. The chunk must be present. */
+	/** Serializes the chunk into the specified writer. The chunk must be present.
+	The chunk's data is copied, and its entities and block entities serialized, while holding the chunkmap lock;
+	the block sections are written out after the lock is released. */
 	static void Serialize(const cWorld & aWorld, cChunkCoords aCoords, cFastNBTWriter & aWriter);
 };
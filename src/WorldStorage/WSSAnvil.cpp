@@ -8,6 +8,7 @@
 #include "NBTChunkSerializer.h"
 #include "EnchantmentSerializer.h"
 #include "NamespaceSerializer.h"
+#include "MCAChunkOrder.h"
 #include "json/json.h"
 #include "OSSupport/GZipFile.h"
 #include "../World.h"
@@ -78,6 +79,9 @@ Since only the header is actually in the memory, this number can be high, but st
 */
 #define MAX_MCA_FILES 32
 
+/** Maximum number of bytes of consecutive chunks that are written to an MCA file with a single write. */
+#define MAX_MCA_COALESCED_WRITE (4 MiB)
+
 
 
 
@@ -85,9 +89,11 @@ Since only the header is actually in the memory, this number can be high, but st
 ////////////////////////////////////////////////////////////////////////////////
 // cWSSAnvil:
 
-cWSSAnvil::cWSSAnvil(cWorld * a_World, int a_CompressionFactor) :
+cWSSAnvil::cWSSAnvil(cWorld * a_World, int a_CompressionFactor, bool a_ShouldSyncSaves, int a_CompactionThreshold) :
 	Super(a_World),
-	m_Compressor(a_CompressionFactor)
+	m_ShouldSyncSaves(a_ShouldSyncSaves),
+	m_CompactionThreshold(Clamp(a_CompactionThreshold, 0, 100)),
+	m_CompressionFactor(a_CompressionFactor)
 {
 	// Create a level.dat file for mapping tools, if it doesn't already exist:
 	AString fnam;
@@ -129,10 +135,7 @@ cWSSAnvil::cWSSAnvil(cWorld * a_World, int a_CompressionFactor) :
 cWSSAnvil::~cWSSAnvil()
 {
 	cCSLock Lock(m_CS);
-	for (cMCAFiles::iterator itr = m_Files.begin(); itr != m_Files.end(); ++itr)
-	{
-		delete *itr;
-	}  // for itr - m_Files[]
+	m_Files.clear();
 }
 
 
@@ -141,8 +144,9 @@ cWSSAnvil::~cWSSAnvil()
 
 bool cWSSAnvil::LoadChunk(const cChunkCoords & a_Chunk)
 {
-	ContiguousByteBuffer ChunkData;
-	if (!GetChunkData(a_Chunk, ChunkData))
+	ContiguousByteBufferView ChunkData;
+	std::shared_ptr<const cMemoryMappedFile> Mapping;  // Keeps ChunkData valid
+	if (!GetChunkData(a_Chunk, ChunkData, Mapping))
 	{
 		// The reason for failure is already printed in GetChunkData()
 		return false;
@@ -159,7 +163,7 @@ bool cWSSAnvil::SaveChunk(const cChunkCoords & a_Chunk)
 {
 	try
 	{
-		if (!SetChunkData(a_Chunk, SaveChunkToData(a_Chunk).GetView()))
+		if (!SetChunkData(a_Chunk, SaveChunkToData(a_Chunk)))
 		{
 			LOGWARNING("Cannot store chunk [%d, %d] data", a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ);
 			return false;
@@ -179,6 +183,70 @@ bool cWSSAnvil::SaveChunk(const cChunkCoords & a_Chunk)
 
 
 
+std::vector<cChunkCoords> cWSSAnvil::SaveChunks(const std::vector<cChunkCoords> & a_Chunks)
+{
+	// Serialize and compress all the chunks in parallel. Note that gathering each chunk's data, including the NBT of its
+	// entities and block entities, happens under the chunkmap lock, so only the section encoding and the compression overlap:
+	std::vector<ContiguousByteBuffer> Data(a_Chunks.size());
+	tbb::parallel_for(size_t(0), a_Chunks.size(), [&](size_t a_Idx)
+	{
+		try
+		{
+			Data[a_Idx] = SaveChunkToData(a_Chunks[a_Idx]);
+		}
+		catch (const std::exception & Oops)
+		{
+			LOGWARNING("Cannot serialize chunk [%d, %d] into data: %s", a_Chunks[a_Idx].m_ChunkX, a_Chunks[a_Idx].m_ChunkZ, Oops.what());
+		}
+	});
+
+	// Group the serialized chunks by region file:
+	std::map<std::pair<int, int>, std::vector<cMCAFile::sChunkWrite>> Regions;
+	for (size_t i = 0; i < a_Chunks.size(); i++)
+	{
+		if (!Data[i].empty())
+		{
+			const auto & Coords = a_Chunks[i];
+			Regions[{ FAST_FLOOR_DIV(Coords.m_ChunkX, 32), FAST_FLOOR_DIV(Coords.m_ChunkZ, 32) }].push_back({ Coords, Data[i] });
+		}
+	}
+
+	// Write each region's chunks in a single batch:
+	std::vector<cChunkCoords> Saved;
+	Saved.reserve(a_Chunks.size());
+	for (auto & Region : Regions)
+	{
+		std::shared_ptr<cMCAFile> File;
+		{
+			cCSLock Lock(m_CS);
+			File = LoadMCAFile(Region.second.front().m_Coords);
+		}
+		if (File == nullptr)
+		{
+			continue;
+		}
+		File->SetChunksData(Region.second);
+
+		// Compact the region only if no other thread is about to use it (the cache and this function hold the only references):
+		if ((m_CompactionThreshold > 0) && (File.use_count() <= 2))
+		{
+			File->Compact(m_CompactionThreshold);
+		}
+		for (const auto & Chunk : Region.second)
+		{
+			if (Chunk.m_IsWritten)
+			{
+				Saved.push_back(Chunk.m_Coords);
+			}
+		}
+	}
+	return Saved;
+}
+
+
+
+
+
 void cWSSAnvil::ChunkLoadFailed(int a_ChunkX, int a_ChunkZ, const AString & a_Reason, const ContiguousByteBufferView a_ChunkDataToSave)
 {
 	// Construct the filename for offloading:
@@ -229,15 +297,18 @@ void cWSSAnvil::ChunkLoadFailed(int a_ChunkX, int a_ChunkZ, const AString & a_Re
 
 
 
-bool cWSSAnvil::GetChunkData(const cChunkCoords & a_Chunk, ContiguousByteBuffer & a_Data)
+bool cWSSAnvil::GetChunkData(const cChunkCoords & a_Chunk, ContiguousByteBufferView & a_Data, std::shared_ptr<const cMemoryMappedFile> & a_Mapping)
 {
-	cCSLock Lock(m_CS);
-	cMCAFile * File = LoadMCAFile(a_Chunk);
+	std::shared_ptr<cMCAFile> File;
+	{
+		cCSLock Lock(m_CS);
+		File = LoadMCAFile(a_Chunk);
+	}
 	if (File == nullptr)
 	{
 		return false;
 	}
-	return File->GetChunkData(a_Chunk, a_Data);
+	return File->GetChunkData(a_Chunk, a_Data, a_Mapping);
 }
 
 
@@ -246,8 +317,11 @@ bool cWSSAnvil::GetChunkData(const cChunkCoords & a_Chunk, ContiguousByteBuffer
 
 bool cWSSAnvil::SetChunkData(const cChunkCoords & a_Chunk, const ContiguousByteBufferView a_Data)
 {
-	cCSLock Lock(m_CS);
-	cMCAFile * File = LoadMCAFile(a_Chunk);
+	std::shared_ptr<cMCAFile> File;
+	{
+		cCSLock Lock(m_CS);
+		File = LoadMCAFile(a_Chunk);
+	}
 	if (File == nullptr)
 	{
 		return false;
@@ -259,7 +333,7 @@ bool cWSSAnvil::SetChunkData(const cChunkCoords & a_Chunk, const ContiguousByteB
 
 
 
-cWSSAnvil::cMCAFile * cWSSAnvil::LoadMCAFile(const cChunkCoords & a_Chunk)
+std::shared_ptr<cWSSAnvil::cMCAFile> cWSSAnvil::LoadMCAFile(const cChunkCoords & a_Chunk)
 {
 	// ASSUME m_CS is locked
 	ASSERT(m_CS.IsLocked());
@@ -277,13 +351,11 @@ cWSSAnvil::cMCAFile * cWSSAnvil::LoadMCAFile(const cChunkCoords & a_Chunk)
 		if (((*itr) != nullptr) && ((*itr)->GetRegionX() == RegionX) && ((*itr)->GetRegionZ() == RegionZ))
 		{
 			// Move the file to front and return it:
-			cMCAFile * f = *itr;
 			if (itr != m_Files.begin())
 			{
-				m_Files.erase(itr);
-				m_Files.push_front(f);
+				m_Files.splice(m_Files.begin(), m_Files, itr);
 			}
-			return f;
+			return m_Files.front();
 		}
 	}
 
@@ -292,18 +364,21 @@ cWSSAnvil::cMCAFile * cWSSAnvil::LoadMCAFile(const cChunkCoords & a_Chunk)
 	Printf(FileName, "%s%cregion", m_World->GetDataPath().c_str(), cFile::PathSeparator());
 	cFile::CreateFolder(FileName);
 	AppendPrintf(FileName, "/r.%d.%d.mca", RegionX, RegionZ);
-	cMCAFile * f = new cMCAFile(*this, FileName, RegionX, RegionZ);
-	if (f == nullptr)
-	{
-		return nullptr;
-	}
+	auto f = std::make_shared<cMCAFile>(*this, FileName, RegionX, RegionZ);
 	m_Files.push_front(f);
 
-	// If there are too many MCA files cached, delete the last one used:
+	// If there are too many MCA files cached, delete the least recently used one that isn't being read or written right now.
+	// All references are handed out under m_CS, so an unreferenced file cannot get picked up while it's being deleted:
 	if (m_Files.size() > MAX_MCA_FILES)
 	{
-		delete m_Files.back();
-		m_Files.pop_back();
+		for (auto itr = m_Files.rbegin(); itr != m_Files.rend(); ++itr)
+		{
+			if (itr->use_count() == 1)
+			{
+				m_Files.erase(std::next(itr).base());
+				break;
+			}
+		}
 	}
 	return f;
 }
@@ -316,7 +391,7 @@ bool cWSSAnvil::LoadChunkFromData(const cChunkCoords & a_Chunk, const Contiguous
 {
 	try
 	{
-		const auto Extracted = m_Extractor.ExtractZLib(a_Data);
+		const auto Extracted = m_Extractors.local().ExtractZLib(a_Data);
 		cParsedNBT NBT(Extracted.GetView());
 
 		if (!NBT.IsValid())
@@ -339,13 +414,15 @@ bool cWSSAnvil::LoadChunkFromData(const cChunkCoords & a_Chunk, const Contiguous
 
 
 
-Compression::Result cWSSAnvil::SaveChunkToData(const cChunkCoords & a_Chunk)
+ContiguousByteBuffer cWSSAnvil::SaveChunkToData(const cChunkCoords & a_Chunk)
 {
 	cFastNBTWriter Writer;
 	NBTChunkSerializer::Serialize(*m_World, a_Chunk, Writer);
 	Writer.Finish();
 
-	return m_Compressor.CompressZLib(Writer.GetResult());
+	ContiguousByteBuffer Data;
+	Compression::GetThreadCompressor(m_CompressionFactor).CompressZLib(Writer.GetResult(), Data);
+	return Data;
 }
 
 
@@ -3876,7 +3953,10 @@ cWSSAnvil::cMCAFile::cMCAFile(cWSSAnvil & a_ParentSchema, const AString & a_File
 	m_ParentSchema(a_ParentSchema),
 	m_RegionX(a_RegionX),
 	m_RegionZ(a_RegionZ),
-	m_FileName(a_FileName)
+	m_FileName(a_FileName),
+	m_CanCompact(true),
+	m_IsCompacting(false),
+	m_NumWrites(0)
 {
 }
 
@@ -3886,8 +3966,6 @@ cWSSAnvil::cMCAFile::cMCAFile(cWSSAnvil & a_ParentSchema, const AString & a_File
 
 bool cWSSAnvil::cMCAFile::OpenFile(bool a_IsForReading)
 {
-	bool writeOutNeeded = false;
-
 	if (m_File.IsOpen())
 	{
 		// Already open
@@ -3909,36 +3987,30 @@ bool cWSSAnvil::cMCAFile::OpenFile(bool a_IsForReading)
 		return false;
 	}
 
-	// Load the header:
-	if (m_File.Read(m_Header, sizeof(m_Header)) != sizeof(m_Header))
+	const auto FileSize = static_cast<size_t>(std::max(m_File.GetSize(), 0L));
+	if (FileSize < MCA_HEADER_SIZE)
 	{
-		// Cannot read the header - perhaps the file has just been created?
-		// Try writing a nullptr header for chunk offsets:
-		memset(m_Header, 0, sizeof(m_Header));
-		writeOutNeeded = true;
-	}
-
-	// Load the TimeStamps:
-	if (m_File.Read(m_TimeStamps, sizeof(m_TimeStamps)) != sizeof(m_TimeStamps))
-	{
-		// Cannot read the time stamps - perhaps the file has just been created?
-		// Try writing a nullptr header for timestamps:
-		memset(m_TimeStamps, 0, sizeof(m_TimeStamps));
-		writeOutNeeded = true;
-	}
-
-	if (writeOutNeeded)
-	{
-		m_File.Seek(0);
-		if (
-			(m_File.Write(m_Header, sizeof(m_Header)) != sizeof(m_Header)) ||           // Write chunk offsets
-			(m_File.Write(m_TimeStamps, sizeof(m_TimeStamps)) != sizeof(m_TimeStamps))  // Write chunk timestamps
-		)
+		// Cannot read the whole header and timestamps - perhaps the file has just been created?
+		// Try padding the chunk offsets and timestamps with nullptr entries:
+		static const char EmptyHeader[MCA_HEADER_SIZE] = {0};
+		const auto PaddingSize = MCA_HEADER_SIZE - FileSize;
+		m_File.Seek(static_cast<int>(FileSize));
+		if (m_File.Write(EmptyHeader, PaddingSize) != static_cast<int>(PaddingSize))
 		{
 			LOGWARNING("Cannot process MCA header in file \"%s\", chunks in that file will be lost", m_FileName.c_str());
 			m_File.Close();
 			return false;
 		}
+		m_File.Flush();
+	}
+
+	// Map the file, the header and the timestamps are read from the mapping from now on:
+	m_Mapping.reset();
+	if (!EnsureMapped(MCA_HEADER_SIZE))
+	{
+		LOGWARNING("Cannot map MCA file \"%s\" into memory, chunks in that file will be lost", m_FileName.c_str());
+		m_File.Close();
+		return false;
 	}
 	return true;
 }
@@ -3947,38 +4019,65 @@ bool cWSSAnvil::cMCAFile::OpenFile(bool a_IsForReading)
 
 
 
-bool cWSSAnvil::cMCAFile::GetChunkData(const cChunkCoords & a_Chunk, ContiguousByteBuffer & a_Data)
+bool cWSSAnvil::cMCAFile::EnsureMapped(const size_t a_End)
 {
-	if (!OpenFile(true))
+	if ((m_Mapping != nullptr) && (m_Mapping->GetSize() >= a_End))
 	{
-		return false;
+		return true;
 	}
 
-	int LocalX = a_Chunk.m_ChunkX % 32;
-	if (LocalX < 0)
+	// Data has been appended to the file since it was mapped, map it anew.
+	// Readers still using the old mapping keep it alive until they're done:
+	auto Mapping = std::make_shared<cMemoryMappedFile>();
+	if (!Mapping->Open(m_FileName))
 	{
-		LocalX = 32 + LocalX;
+		return false;
 	}
-	int LocalZ = a_Chunk.m_ChunkZ % 32;
-	if (LocalZ < 0)
+	m_Mapping = std::move(Mapping);
+	return (m_Mapping->GetSize() >= a_End);
+}
+
+
+
+
+
+UInt32 cWSSAnvil::cMCAFile::GetChunkLocation(const size_t a_Index) const
+{
+	ASSERT(a_Index < MCA_MAX_CHUNKS);
+	UInt32 Location;
+	memcpy(&Location, m_Mapping->GetView(a_Index * sizeof(Location), sizeof(Location)).data(), sizeof(Location));
+	return ntohl(Location);
+}
+
+
+
+
+
+bool cWSSAnvil::cMCAFile::GetChunkData(const cChunkCoords & a_Chunk, ContiguousByteBufferView & a_Data, std::shared_ptr<const cMemoryMappedFile> & a_Mapping)
+{
+	cCSLock Lock(m_CS);
+	if (!OpenFile(true))
 	{
-		LocalZ = 32 + LocalZ;
+		return false;
 	}
-	unsigned ChunkLocation = ntohl(m_Header[LocalX + 32 * LocalZ]);
+
+	unsigned ChunkLocation = GetChunkLocation(GetChunkIndex(a_Chunk));
 	unsigned ChunkOffset = ChunkLocation >> 8;
 	if (ChunkOffset < 2)
 	{
 		return false;
 	}
 
-	m_File.Seek(static_cast<int>(ChunkOffset * 4096));
-
-	UInt32 ChunkSize = 0;
-	if (m_File.Read(&ChunkSize, 4) != 4)
+	const size_t ChunkStart = ChunkOffset * 4096;
+	if (!EnsureMapped(ChunkStart + MCA_CHUNK_HEADER_LENGTH))
 	{
 		m_ParentSchema.ChunkLoadFailed(a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, "Cannot read chunk size", {});
 		return false;
 	}
+	const auto ChunkHeader = m_Mapping->GetView(ChunkStart, MCA_CHUNK_HEADER_LENGTH);
+
+	UInt32 ChunkSize = 0;
+	memcpy(&ChunkSize, ChunkHeader.data(), 4);
 	ChunkSize = ntohl(ChunkSize);
 	if (ChunkSize < 1)
 	{
@@ -3987,20 +4086,16 @@ bool cWSSAnvil::cMCAFile::GetChunkData(const cChunkCoords & a_Chunk, ContiguousB
 		return false;
 	}
 
-	char CompressionType = 0;
-	if (m_File.Read(&CompressionType, 1) != 1)
-	{
-		m_ParentSchema.ChunkLoadFailed(a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, "Cannot read chunk compression", {});
-		return false;
-	}
+	const auto CompressionType = static_cast<char>(ChunkHeader[4]);
 	ChunkSize--;
 
-	a_Data = m_File.Read(ChunkSize);
-	if (a_Data.size() != ChunkSize)
+	const size_t DataStart = ChunkStart + MCA_CHUNK_HEADER_LENGTH;
+	if (!EnsureMapped(DataStart + ChunkSize))
 	{
-		m_ParentSchema.ChunkLoadFailed(a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, "Cannot read entire chunk data", a_Data);
+		m_ParentSchema.ChunkLoadFailed(a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, "Cannot read entire chunk data", m_Mapping->GetView(DataStart, m_Mapping->GetSize() - DataStart));
 		return false;
 	}
+	a_Data = m_Mapping->GetView(DataStart, ChunkSize);
 
 	if (CompressionType != 2)
 	{
@@ -4008,6 +4103,7 @@ bool cWSSAnvil::cMCAFile::GetChunkData(const cChunkCoords & a_Chunk, ContiguousB
 		m_ParentSchema.ChunkLoadFailed(a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, Printf("Unknown chunk compression: %d", CompressionType), a_Data);
 		return false;
 	}
+	a_Mapping = m_Mapping;
 	return true;
 }
 
@@ -4031,85 +4127,316 @@ const std::byte * cWSSAnvil::GetSectionData(const cParsedNBT & a_NBT, int a_Tag,
 
 bool cWSSAnvil::cMCAFile::SetChunkData(const cChunkCoords & a_Chunk, const ContiguousByteBufferView a_Data)
 {
+	std::vector<sChunkWrite> Chunks{ { a_Chunk, a_Data } };
+	return SetChunksData(Chunks);
+}
+
+
+
+
+
+bool cWSSAnvil::cMCAFile::SetChunksData(std::vector<sChunkWrite> & a_Chunks)
+{
+	cCSLock Lock(m_CS);
 	if (!OpenFile(false))
 	{
-		LOGWARNING("Cannot save chunk [%d, %d], opening file \"%s\" failed", a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, GetFileName().c_str());
+		LOGWARNING("Cannot save %zu chunk(s), opening file \"%s\" failed", a_Chunks.size(), GetFileName().c_str());
 		return false;
 	}
 
-	int LocalX = a_Chunk.m_ChunkX % 32;
-	if (LocalX < 0)
+	// Work on a copy of the chunk locations and timestamps, so that they're written out only once, after all the chunk data.
+	// Both are kept in the network byte order, as in the file:
+	std::array<UInt32, 2 * MCA_MAX_CHUNKS> Header, OldHeader;
+	static_assert(sizeof(Header) == MCA_HEADER_SIZE);
+	memcpy(Header.data(), m_Mapping->GetView(0, sizeof(Header)).data(), sizeof(Header));
+	OldHeader = Header;
+
+	// Data that doesn't fit its chunk's current location is appended past the end of all the chunks
+	// (we're wasting a lot of space, the region needs compacting once in a while):
+	unsigned EndSector = 2;  // Minimum sector is #2 - after the headers
+	for (size_t i = 0; i < MCA_MAX_CHUNKS; i++)
 	{
-		LocalX = 32 + LocalX;
+		const auto Location = ntohl(Header[i]);
+		EndSector = std::max(EndSector, (Location >> 8) + (Location & 0xff));
 	}
-	int LocalZ = a_Chunk.m_ChunkZ % 32;
-	if (LocalZ < 0)
+
+	// Decide where each chunk goes:
+	struct sPlacement
 	{
-		LocalZ = 32 + LocalZ;
+		unsigned m_Sector;
+		unsigned m_NumSectors;
+		size_t m_ChunkIdx;
+	};
+	std::vector<sPlacement> Placements;
+	Placements.reserve(a_Chunks.size());
+	const auto TimeStamp = htonl(static_cast<UInt32>(time(nullptr)));
+	for (size_t i = 0; i < a_Chunks.size(); i++)
+	{
+		auto & Chunk = a_Chunks[i];
+		Chunk.m_IsWritten = false;
+
+		// Round data size up to nearest 4KB sector, make it a sector number:
+		const auto NumSectors = static_cast<unsigned>((Chunk.m_Data.size() + MCA_CHUNK_HEADER_LENGTH + 4095) / 4096);
+		if (NumSectors > 255)
+		{
+			LOGWARNING("Cannot save chunk [%d, %d], the data is too large (%u KiB, maximum is 1024 KiB). Remove some entities and retry.",
+				Chunk.m_Coords.m_ChunkX, Chunk.m_Coords.m_ChunkZ, NumSectors * 4
+			);
+			continue;
+		}
+
+		// Reuse the current location if the data fits, append otherwise:
+		const auto Index = GetChunkIndex(Chunk.m_Coords);
+		const auto Location = ntohl(Header[Index]);
+		unsigned Sector = Location >> 8;
+		if (NumSectors > (Location & 0xff))
+		{
+			Sector = EndSector;
+			EndSector += NumSectors;
+		}
+		Header[Index] = htonl((Sector << 8) | NumSectors);
+		Header[MCA_MAX_CHUNKS + Index] = TimeStamp;
+		Placements.push_back({ Sector, NumSectors, i });
 	}
 
-	unsigned ChunkSector = FindFreeLocation(LocalX, LocalZ, a_Data.size());
+	// Write the chunks in the file order, each run of chunks in consecutive sectors with a single write:
+	std::stable_sort(Placements.begin(), Placements.end(), [](const sPlacement & a_First, const sPlacement & a_Second)
+		{
+			return (a_First.m_Sector < a_Second.m_Sector);
+		}
+	);
+	ContiguousByteBuffer Run;
+	unsigned RunSector = 0;
+	size_t RunStart = 0;
+	auto WriteRun = [&](size_t a_RunEnd)
+	{
+		const bool IsWritten = (
+			(m_File.Seek(static_cast<int>(RunSector * 4096)) >= 0) &&
+			(m_File.Write(Run.data(), Run.size()) == static_cast<int>(Run.size()))
+		);
+		for (size_t p = RunStart; p < a_RunEnd; p++)
+		{
+			auto & Chunk = a_Chunks[Placements[p].m_ChunkIdx];
+			if (IsWritten)
+			{
+				Chunk.m_IsWritten = true;
+				continue;
+			}
+			LOGWARNING("Cannot save chunk [%d, %d], writing data to file \"%s\" failed", Chunk.m_Coords.m_ChunkX, Chunk.m_Coords.m_ChunkZ, GetFileName().c_str());
+			const auto Index = GetChunkIndex(Chunk.m_Coords);
+			Header[Index] = OldHeader[Index];
+			Header[MCA_MAX_CHUNKS + Index] = OldHeader[MCA_MAX_CHUNKS + Index];
+		}
+		Run.clear();
+	};
+	for (size_t p = 0; p < Placements.size(); p++)
+	{
+		const auto & Placement = Placements[p];
+		if (!Run.empty() && ((Placement.m_Sector != RunSector + Run.size() / 4096) || (Run.size() >= MAX_MCA_COALESCED_WRITE)))
+		{
+			WriteRun(p);
+		}
+		if (Run.empty())
+		{
+			RunSector = Placement.m_Sector;
+			RunStart = p;
+		}
 
-	// Store the chunk data:
-	m_File.Seek(static_cast<int>(ChunkSector * 4096));
-	UInt32 ChunkSize = htonl(static_cast<UInt32>(a_Data.size() + 1));
-	if (m_File.Write(&ChunkSize, 4) != 4)
+		// Chunk header, data and padding to the 4K boundary:
+		const auto & Data = a_Chunks[Placement.m_ChunkIdx].m_Data;
+		const UInt32 ChunkSize = htonl(static_cast<UInt32>(Data.size() + 1));
+		const auto CompressionType = std::byte(2);
+		Run.append(reinterpret_cast<const std::byte *>(&ChunkSize), sizeof(ChunkSize));
+		Run.push_back(CompressionType);
+		Run.append(Data);
+		Run.resize(Run.size() + Placement.m_NumSectors * 4096 - (Data.size() + MCA_CHUNK_HEADER_LENGTH));
+	}
+	if (!Run.empty())
 	{
-		LOGWARNING("Cannot save chunk [%d, %d], writing(1) data to file \"%s\" failed", a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, GetFileName().c_str());
-		return false;
+		WriteRun(Placements.size());
 	}
-	char CompressionType = 2;
-	if (m_File.Write(&CompressionType, 1) != 1)
+
+	// Store the header info and the modification times, all at once:
+	if ((m_File.Seek(0) < 0) || (m_File.Write(Header.data(), sizeof(Header)) != sizeof(Header)))
 	{
-		LOGWARNING("Cannot save chunk [%d, %d], writing(2) data to file \"%s\" failed", a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, GetFileName().c_str());
+		LOGWARNING("Cannot save %zu chunk(s), writing header to file \"%s\" failed", a_Chunks.size(), GetFileName().c_str());
+		for (auto & Chunk : a_Chunks)
+		{
+			Chunk.m_IsWritten = false;
+		}
 		return false;
 	}
-	if (m_File.Write(a_Data.data(), a_Data.size()) != static_cast<int>(a_Data.size()))
+
+	// Make the written data visible through the mapping, and durable if requested:
+	m_NumWrites += 1;
+	m_File.Flush();
+	if (m_ParentSchema.m_ShouldSyncSaves && !m_File.Sync())
 	{
-		LOGWARNING("Cannot save chunk [%d, %d], writing(3) data to file \"%s\" failed", a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, GetFileName().c_str());
-		return false;
+		LOGWARNING("Cannot sync file \"%s\" to disk, the saved chunks may be lost on a power failure", GetFileName().c_str());
 	}
+	return std::all_of(a_Chunks.begin(), a_Chunks.end(), [](const sChunkWrite & a_Chunk) { return a_Chunk.m_IsWritten; });
+}
+
 
-	// Add padding to 4K boundary:
-	size_t BytesWritten = a_Data.size() + MCA_CHUNK_HEADER_LENGTH;
-	if (BytesWritten % 4096 != 0)
+
+
+
+bool cWSSAnvil::cMCAFile::Compact(const int a_MinWastePercent)
+{
+	// Take a snapshot of the chunk locations and of the mapping under the lock, then copy the chunks without holding it,
+	// so that the loads from this region aren't stalled by the copying and syncing:
+	cHeader Header;
+	std::shared_ptr<const cMemoryMappedFile> Mapping;
+	size_t FileSize;
+	unsigned NumWrites;
 	{
-		static const char Padding[4095] = {0};
-		m_File.Write(Padding, 4096 - (BytesWritten % 4096));
+		cCSLock Lock(m_CS);
+		if (!m_CanCompact || m_IsCompacting || !OpenFile(true))
+		{
+			return false;
+		}
+
+		// Check how much of the file is taken by the chunks' sectors:
+		FileSize = static_cast<size_t>(std::max(m_File.GetSize(), 0L));
+		memcpy(Header.data(), m_Mapping->GetView(0, sizeof(Header)).data(), sizeof(Header));
+		size_t UsedSize = MCA_HEADER_SIZE;
+		for (size_t i = 0; i < MCA_MAX_CHUNKS; i++)
+		{
+			UsedSize += (ntohl(Header[i]) & 0xff) * 4096;
+		}
+		if ((FileSize <= UsedSize) || ((FileSize - UsedSize) * 100 < FileSize * static_cast<size_t>(a_MinWastePercent)))
+		{
+			return false;
+		}
+		if (!EnsureMapped(FileSize))
+		{
+			return false;
+		}
+		Mapping = m_Mapping;
+		NumWrites = m_NumWrites;
+		m_IsCompacting = true;
 	}
 
-	// Store the header:
-	ChunkSize = (static_cast<UInt32>(a_Data.size()) + MCA_CHUNK_HEADER_LENGTH + 4095) / 4096;  // Round data size up to nearest 4KB sector, make it a sector number
-	if (ChunkSize > 255)
+	const AString CompactFileName = m_FileName + ".compact";
+	unsigned NumSectors = 0;
+	const bool IsWritten = WriteCompactedFile(CompactFileName, Header, *Mapping, NumSectors);
+	Mapping.reset();
+
+	cCSLock Lock(m_CS);
+	m_IsCompacting = false;
+	if (!IsWritten)
 	{
-		LOGWARNING("Cannot save chunk [%d, %d], the data is too large (%u KiB, maximum is 1024 KiB). Remove some entities and retry.",
-			a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, static_cast<unsigned>(ChunkSize * 4)
-		);
+		cFile::Delete(CompactFileName);
+		return false;
+	}
+	if (m_NumWrites != NumWrites)
+	{
+		// Chunks have been saved into the region while copying, the copy is stale. The compaction is retried after the next save:
+		cFile::Delete(CompactFileName);
 		return false;
 	}
 
-	// Store the header info in the table
-	m_Header[LocalX + 32 * LocalZ] = htonl(static_cast<UInt32>((ChunkSector << 8) | ChunkSize));
-
-	// Set the modification time
-	m_TimeStamps[LocalX + 32 * LocalZ] =  htonl(static_cast<UInt32>(time(nullptr)));
+	#ifdef _WIN32
+		// The original cannot be replaced while any reader still has it mapped; retry after the next save:
+		if (m_Mapping.use_count() > 1)
+		{
+			cFile::Delete(CompactFileName);
+			return false;
+		}
+	#endif
 
-	if (m_File.Seek(0) < 0)
+	// Replace the original. Elsewhere, readers still holding the old mapping keep reading the original data until they release it.
+	// The file is re-opened and mapped anew on the next access:
+	m_Mapping.reset();
+	m_File.Close();
+	if (!cFile::RenameReplacing(CompactFileName, m_FileName))
 	{
-		LOGWARNING("Cannot save chunk [%d, %d], seeking in file \"%s\" failed", a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, GetFileName().c_str());
+		LOGWARNING("Cannot compact file \"%s\", replacing it with the compacted file failed. The file is left as it is.", GetFileName().c_str());
+		cFile::Delete(CompactFileName);
+		m_CanCompact = false;
 		return false;
 	}
-	if (m_File.Write(m_Header, sizeof(m_Header)) != sizeof(m_Header))
+	LOGD("Compacted region file \"%s\" from %zu KiB to %u KiB", GetFileName().c_str(), FileSize / 1024, NumSectors * 4);
+	return true;
+}
+
+
+
+
+
+bool cWSSAnvil::cMCAFile::WriteCompactedFile(const AString & a_FileName, const cHeader & a_Header, const cMemoryMappedFile & a_Mapping, unsigned & a_NumSectors) const
+{
+	// Copy the chunks into the new file, in the Z-order, each taking only as many sectors as it needs:
+	cFile Out;
+	if (!Out.Open(a_FileName, cFile::fmWrite))
 	{
-		LOGWARNING("Cannot save chunk [%d, %d], writing header to file \"%s\" failed", a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, GetFileName().c_str());
+		LOGWARNING("Cannot compact file \"%s\", creating file \"%s\" failed", GetFileName().c_str(), a_FileName.c_str());
 		return false;
 	}
-	if (m_File.Write(m_TimeStamps, sizeof(m_TimeStamps)) != sizeof(m_TimeStamps))
+	auto Abort = [&](const char * a_Reason)
 	{
-		LOGWARNING("Cannot save chunk [%d, %d], writing timestamps to file \"%s\" failed", a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, GetFileName().c_str());
+		LOGWARNING("Cannot compact file \"%s\": %s. The file is left as it is.", GetFileName().c_str(), a_Reason);
 		return false;
+	};
+	cHeader NewHeader{};
+	ContiguousByteBuffer Run(MCA_HEADER_SIZE, std::byte(0));  // The header is written once all the locations are known
+	unsigned NextSector = 2;
+	for (size_t Order = 0; Order < MCA_MAX_CHUNKS; Order++)
+	{
+		const auto Index = MCAChunkOrder::GetZOrderChunkIndex(Order);
+		const auto Location = ntohl(a_Header[Index]);
+		if ((Location >> 8) < 2)
+		{
+			// No chunk
+			continue;
+		}
+
+		// Copy the chunk, including its header, as it is:
+		const size_t ChunkStart = (Location >> 8) * 4096;
+		const auto ChunkHeader = a_Mapping.GetView(ChunkStart, MCA_CHUNK_HEADER_LENGTH);
+		if (ChunkHeader.empty())
+		{
+			return Abort("a chunk lies past the end of the file");
+		}
+		UInt32 ChunkSize = 0;
+		memcpy(&ChunkSize, ChunkHeader.data(), 4);
+		ChunkSize = ntohl(ChunkSize);
+		const auto ChunkData = a_Mapping.GetView(ChunkStart, static_cast<size_t>(ChunkSize) + 4);
+		const auto NumSectors = static_cast<unsigned>((ChunkData.size() + 4095) / 4096);
+		if ((ChunkSize < 1) || ChunkData.empty() || (NumSectors > 255))
+		{
+			return Abort("a chunk has an invalid size");
+		}
+		Run.append(ChunkData);
+		Run.resize(Run.size() + NumSectors * 4096 - ChunkData.size());
+		NewHeader[Index] = htonl((NextSector << 8) | NumSectors);
+		NewHeader[MCA_MAX_CHUNKS + Index] = a_Header[MCA_MAX_CHUNKS + Index];
+		NextSector += NumSectors;
+
+		if (Run.size() >= MAX_MCA_COALESCED_WRITE)
+		{
+			if (Out.Write(Run.data(), Run.size()) != static_cast<int>(Run.size()))
+			{
+				return Abort("writing the compacted file failed");
+			}
+			Run.clear();
+		}
+	}
+	if (
+		(Out.Write(Run.data(), Run.size()) != static_cast<int>(Run.size())) ||
+		(Out.Seek(0) < 0) ||
+		(Out.Write(NewHeader.data(), sizeof(NewHeader)) != sizeof(NewHeader))
+	)
+	{
+		return Abort("writing the compacted file failed");
 	}
 
+	// The compacted file must be on the disk before it replaces the original, otherwise a power failure could lose the whole region:
+	if (!Out.Sync())
+	{
+		return Abort("syncing the compacted file to disk failed");
+	}
+	a_NumSectors = NextSector;
 	return true;
 }
 
@@ -4117,26 +4444,17 @@ bool cWSSAnvil::cMCAFile::SetChunkData(const cChunkCoords & a_Chunk, const Conti
 
 
 
-unsigned cWSSAnvil::cMCAFile::FindFreeLocation(int a_LocalX, int a_LocalZ, const size_t a_DataSize)
+size_t cWSSAnvil::cMCAFile::GetChunkIndex(const cChunkCoords & a_Chunk)
 {
-	// See if it fits the current location:
-	unsigned ChunkLocation = ntohl(m_Header[a_LocalX + 32 * a_LocalZ]);
-	unsigned ChunkLen = ChunkLocation & 0xff;
-	if (a_DataSize + MCA_CHUNK_HEADER_LENGTH <= (ChunkLen * 4096))
+	int LocalX = a_Chunk.m_ChunkX % 32;
+	if (LocalX < 0)
 	{
-		return ChunkLocation >> 8;
+		LocalX = 32 + LocalX;
 	}
-
-	// Doesn't fit, append to the end of file (we're wasting a lot of space, TODO: fix this later)
-	unsigned MaxLocation = 2 << 8;  // Minimum sector is #2 - after the headers
-	for (size_t i = 0; i < ARRAYCOUNT(m_Header); i++)
+	int LocalZ = a_Chunk.m_ChunkZ % 32;
+	if (LocalZ < 0)
 	{
-		ChunkLocation = ntohl(m_Header[i]);
-		ChunkLocation = ChunkLocation + ((ChunkLocation & 0xff) << 8);  // Add the number of sectors used; don't care about the 4th byte
-		if (MaxLocation < ChunkLocation)
-		{
-			MaxLocation = ChunkLocation;
-		}
-	}  // for i - m_Header[]
-	return MaxLocation >> 8;
+		LocalZ = 32 + LocalZ;
+	}
+	return static_cast<size_t>(LocalX + 32 * LocalZ);
 }
@@ -12,6 +12,7 @@
 #include "WorldStorage.h"
 #include "FastNBT.h"
 #include "StringCompression.h"
+#include "../OSSupport/MemoryMappedFile.h"
 
 
 
@@ -53,20 +54,51 @@ class cWSSAnvil:
 
 public:
 
-	cWSSAnvil(cWorld * a_World, int a_CompressionFactor);
+	/** If a_ShouldSyncSaves is true, each region file is synced to the disk after a batch of chunks is written into it.
+	A region file is compacted after a batch of chunks is written into it, if at least a_CompactionThreshold percent of it is unused; 0 disables the compaction. */
+	cWSSAnvil(cWorld * a_World, int a_CompressionFactor, bool a_ShouldSyncSaves, int a_CompactionThreshold);
 	virtual ~cWSSAnvil() override;
 
 protected:
 
+	/** A single region file. Each file has its own lock, so that different regions can be read and written in parallel.
+	The file is read through a memory mapping, including the header and timestamps tables; writes go through a regular file handle. */
 	class cMCAFile
 	{
 	public:
 
+		/** The data of a single chunk to be written by SetChunksData(). */
+		struct sChunkWrite
+		{
+			cChunkCoords m_Coords;
+			ContiguousByteBufferView m_Data;
+
+			/** Set by SetChunksData() if the chunk has been written successfully. */
+			bool m_IsWritten = false;
+		};
+
 		cMCAFile(cWSSAnvil & a_ParentSchema, const AString & a_FileName, int a_RegionX, int a_RegionZ);
 
-		bool GetChunkData  (const cChunkCoords & a_Chunk, ContiguousByteBuffer & a_Data);
+		/** Provides a view of the chunk's raw (compressed) data directly in the file mapping; locks the file's CS.
+		a_Mapping receives the mapping that a_Data points into, the view stays valid as long as the mapping is held. */
+		bool GetChunkData  (const cChunkCoords & a_Chunk, ContiguousByteBufferView & a_Data, std::shared_ptr<const cMemoryMappedFile> & a_Mapping);
+
+		/** Writes the chunk's raw (compressed) data into the file; locks the file's CS. */
 		bool SetChunkData  (const cChunkCoords & a_Chunk, ContiguousByteBufferView a_Data);
 
+		/** Writes the raw (compressed) data of multiple chunks into the file; locks the file's CS.
+		The chunks in consecutive sectors are written with a single write, and the header is written only once, at the end.
+		Returns true if all the chunks have been written, marks each chunk written in its m_IsWritten. */
+		bool SetChunksData(std::vector<sChunkWrite> & a_Chunks);
+
+		/** Rewrites the file with all its chunks laid out contiguously in the Z-order of their coords, dropping the unused sectors.
+		Does nothing if less than a_MinWastePercent of the file is unused.
+		The compacted file is written next to the original without holding the file's CS, so that loads can continue meanwhile,
+		and then renamed over the original under the CS, so the original stays intact on failure.
+		If chunks are written into the file while it is being copied, the copy is dropped and the compaction is left for the next time.
+		Returns true if the file has been compacted. */
+		bool Compact(int a_MinWastePercent);
+
 		int             GetRegionX (void) const {return m_RegionX; }
 		int             GetRegionZ (void) const {return m_RegionZ; }
 		const AString & GetFileName(void) const {return m_FileName; }
@@ -75,37 +107,73 @@ protected:
 
 		cWSSAnvil & m_ParentSchema;
 
+		/** Protects the file handle, the header and the timestamps */
+		cCriticalSection m_CS;
+
 		int     m_RegionX;
 		int     m_RegionZ;
 		cFile   m_File;
 		AString m_FileName;
 
-		// The header, copied from the file so we don't have to seek to it all the time
-		// First 1024 entries are chunk locations - the 3 + 1 byte sector-offset and sector-count
-		unsigned m_Header[MCA_MAX_CHUNKS];
+		/** The read-only mapping of the file.
+		Replaced by a new mapping when data past its end is needed; readers may still hold the old one.
+		The header (first 1024 entries are chunk locations - the 3 + 1 byte sector-offset and sector-count)
+		and the chunk timestamps following it are read directly from the mapping. */
+		std::shared_ptr<cMemoryMappedFile> m_Mapping;
+
+		/** Set to false once replacing the file with its compacted copy fails, so that it isn't retried over and over. */
+		bool m_CanCompact;
+
+		/** Set while Compact() is copying the file outside of the CS, so that only one compaction runs at a time. */
+		bool m_IsCompacting;
 
-		// Chunk timestamps, following the chunk headers
-		unsigned m_TimeStamps[MCA_MAX_CHUNKS];
+		/** The number of batches of chunks written into the file, Compact() uses it to detect writes made while it was copying. */
+		unsigned m_NumWrites;
 
-		/** Finds a free location large enough to hold a_Data. Returns the sector number. */
-		unsigned FindFreeLocation(int a_LocalX, int a_LocalZ, size_t a_DataSize);
+		/** The chunk locations followed by the chunk timestamps, in the network byte order, as in the file. */
+		using cHeader = std::array<UInt32, 2 * MCA_MAX_CHUNKS>;
+
+		/** Returns the chunk location entry for the specified chunk index from the header, in the host byte order. */
+		UInt32 GetChunkLocation(size_t a_Index) const;
+
+		/** Makes sure that the mapping covers the file up to a_End bytes, re-mapping the file if needed.
+		Returns false if the file is not that large. */
+		bool EnsureMapped(size_t a_End);
+
+		/** Returns the index of the chunk into the header tables. */
+		static size_t GetChunkIndex(const cChunkCoords & a_Chunk);
+
+		/** Writes the chunks from a_Mapping, located by a_Header, into a new compacted file a_FileName, and syncs it to the disk.
+		Returns true on success, with a_NumSectors set to the number of sectors in the new file; logs the reason on failure. */
+		bool WriteCompactedFile(const AString & a_FileName, const cHeader & a_Header, const cMemoryMappedFile & a_Mapping, unsigned & a_NumSectors) const;
 
 		/** Opens a MCA file either for a Read operation (fails if doesn't exist) or for a Write operation (creates new if not found) */
 		bool OpenFile(bool a_IsForReading);
 	} ;
-	typedef std::list<cMCAFile *> cMCAFiles;
+	typedef std::list<std::shared_ptr<cMCAFile>> cMCAFiles;
 
+	/** Protects m_Files; held only while looking up a file, not during the file's I/O */
 	cCriticalSection m_CS;
 	cMCAFiles        m_Files;  // a MRU cache of MCA files
 
-	Compression::Extractor m_Extractor;
-	Compression::Compressor m_Compressor;
+	/** Whether the region files are synced to the disk after each batch of chunks written */
+	bool m_ShouldSyncSaves;
+
+	/** The minimum percentage of unused space in a region file for it to be compacted after a save; 0 disables the compaction */
+	int m_CompactionThreshold;
+
+	/** The per-thread decompressors, so that multiple chunks can be decompressed in parallel */
+	tbb::enumerable_thread_specific<Compression::Extractor> m_Extractors;
+
+	/** The compression factor for the chunk data, the compressors are per-thread and shared with other users of the same factor */
+	int m_CompressionFactor;
 
 	/** Reports that the specified chunk failed to load and saves the chunk data to an external file. */
 	void ChunkLoadFailed(int a_ChunkX, int a_ChunkZ, const AString & a_Reason, ContiguousByteBufferView a_ChunkDataToSave);
 
-	/** Gets chunk data from the correct file; locks file CS as needed */
-	bool GetChunkData(const cChunkCoords & a_Chunk, ContiguousByteBuffer & a_Data);
+	/** Gets a view of the chunk data from the correct file; locks file CS as needed.
+	a_Mapping receives the file mapping that keeps the view valid. */
+	bool GetChunkData(const cChunkCoords & a_Chunk, ContiguousByteBufferView & a_Data, std::shared_ptr<const cMemoryMappedFile> & a_Mapping);
 
 	/** Copies a_Length bytes of data from the specified NBT Tag's Child into the a_Destination buffer */
 	const std::byte * GetSectionData(const cParsedNBT & a_NBT, int a_Tag, const AString & a_ChildName, size_t a_Length);
@@ -117,7 +185,7 @@ protected:
 	bool LoadChunkFromData(const cChunkCoords & a_Chunk, ContiguousByteBufferView a_Data);
 
 	/** Saves the chunk into datastream (no locking needed) */
-	Compression::Result SaveChunkToData(const cChunkCoords & a_Chunk);
+	ContiguousByteBuffer SaveChunkToData(const cChunkCoords & a_Chunk);
 
 	/** Loads the chunk from NBT data (no locking needed).
 	a_RawChunkData is the raw (compressed) chunk data, used for offloading when chunk loading fails. */
@@ -300,11 +368,13 @@ protected:
 	/** Helper function for extracting the X, Y, and Z int subtags of a NBT compound; returns true if successful */
 	bool GetBlockEntityNBTPos(const cParsedNBT & a_NBT, int a_TagIdx, Vector3i & a_AbsPos);
 
-	/** Gets the correct MCA file either from cache or from disk, manages the m_MCAFiles cache; assumes m_CS is locked */
-	cMCAFile * LoadMCAFile(const cChunkCoords & a_Chunk);
+	/** Gets the correct MCA file either from cache or from disk, manages the m_MCAFiles cache; assumes m_CS is locked.
+	Files that are in use by other threads are never evicted from the cache, so that there's never more than one object per region file. */
+	std::shared_ptr<cMCAFile> LoadMCAFile(const cChunkCoords & a_Chunk);
 
 	// cWSSchema overrides:
 	virtual bool LoadChunk(const cChunkCoords & a_Chunk) override;
 	virtual bool SaveChunk(const cChunkCoords & a_Chunk) override;
+	virtual std::vector<cChunkCoords> SaveChunks(const std::vector<cChunkCoords> & a_Chunks) override;
 	virtual const AString GetName(void) const override {return "anvil"; }
 } ;
@@ -16,6 +16,26 @@
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+// cWSSchema:
+
+std::vector<cChunkCoords> cWSSchema::SaveChunks(const std::vector<cChunkCoords> & a_Chunks)
+{
+	std::vector<cChunkCoords> Saved;
+	for (const auto & Coords : a_Chunks)
+	{
+		if (SaveChunk(Coords))
+		{
+			Saved.push_back(Coords);
+		}
+	}
+	return Saved;
+}
+
+
+
+
+
 /** Example storage schema - forgets all chunks */
 class cWSSForgetful :
 	public cWSSchema
@@ -40,7 +60,14 @@ protected:
 cWorldStorage::cWorldStorage(void) :
 	Super("World Storage Executor"),
 	m_World(nullptr),
-	m_SaveSchema(nullptr)
+	m_SaveSchema(nullptr),
+	m_MaxParallelOperations(1),
+	m_SaveFlushInterval(0),
+	m_NumLoadsInProgress(0),
+	m_NumSavesInProgress(0),
+	m_NumSaveBatchesInProgress(0),
+	m_IsFlushingSaves(false),
+	m_ShouldFlushSaves(false)
 {
 }
 
@@ -60,11 +87,21 @@ cWorldStorage::~cWorldStorage()
 
 
 
-void cWorldStorage::Initialize(cWorld & a_World, const AString & a_StorageSchemaName, int a_StorageCompressionFactor)
+void cWorldStorage::Initialize(
+	cWorld & a_World,
+	const AString & a_StorageSchemaName,
+	int a_StorageCompressionFactor,
+	int a_MaxParallelOperations,
+	std::chrono::milliseconds a_SaveFlushInterval,
+	bool a_ShouldSyncSaves,
+	int a_CompactionThreshold
+)
 {
 	m_World = &a_World;
 	m_StorageSchemaName = a_StorageSchemaName;
-	InitSchemas(a_StorageCompressionFactor);
+	m_MaxParallelOperations = static_cast<size_t>(std::max(a_MaxParallelOperations, 1));
+	m_SaveFlushInterval = std::max(a_SaveFlushInterval, std::chrono::milliseconds(0));
+	InitSchemas(a_StorageCompressionFactor, a_ShouldSyncSaves, a_CompactionThreshold);
 }
 
 
@@ -105,6 +142,7 @@ void cWorldStorage::WaitForFinish(void)
 void cWorldStorage::WaitForLoadQueueEmpty(void)
 {
 	m_LoadQueue.BlockTillEmpty();
+	WaitForOperationsFinished(m_NumLoadsInProgress);
 }
 
 
@@ -113,7 +151,26 @@ void cWorldStorage::WaitForLoadQueueEmpty(void)
 
 void cWorldStorage::WaitForSaveQueueEmpty(void)
 {
-	m_SaveQueue.BlockTillEmpty();
+	while (GetSaveQueueLength() > 0)
+	{
+		// Keep asking for the flush, saves may have been queued after the previous flush started:
+		m_ShouldFlushSaves = true;
+		m_Event.Set();
+		m_evtOperationFinished.Wait(100);
+	}
+}
+
+
+
+
+
+void cWorldStorage::WaitForOperationsFinished(const std::atomic<size_t> & a_NumInProgress)
+{
+	while (a_NumInProgress > 0)
+	{
+		// Don't rely on the event alone, another waiter may have consumed it:
+		m_evtOperationFinished.Wait(100);
+	}
 }
 
 
@@ -122,7 +179,7 @@ void cWorldStorage::WaitForSaveQueueEmpty(void)
 
 size_t cWorldStorage::GetLoadQueueLength(void)
 {
-	return m_LoadQueue.Size();
+	return m_LoadQueue.Size() + m_NumLoadsInProgress;
 }
 
 
@@ -131,7 +188,7 @@ size_t cWorldStorage::GetLoadQueueLength(void)
 
 size_t cWorldStorage::GetSaveQueueLength(void)
 {
-	return m_SaveQueue.Size();
+	return m_SaveQueue.Size() + m_NumSavesInProgress;
 }
 
 
@@ -164,10 +221,10 @@ void cWorldStorage::QueueSaveChunk(int a_ChunkX, int a_ChunkZ)
 
 
 
-void cWorldStorage::InitSchemas(int a_StorageCompressionFactor)
+void cWorldStorage::InitSchemas(int a_StorageCompressionFactor, bool a_ShouldSyncSaves, int a_CompactionThreshold)
 {
 	// The first schema added is considered the default
-	m_Schemas.push_back(new cWSSAnvil    (m_World, a_StorageCompressionFactor));
+	m_Schemas.push_back(new cWSSAnvil    (m_World, a_StorageCompressionFactor, a_ShouldSyncSaves, a_CompactionThreshold));
 	m_Schemas.push_back(new cWSSForgetful(m_World));
 	// Add new schemas here
 
@@ -202,21 +259,52 @@ void cWorldStorage::InitSchemas(int a_StorageCompressionFactor)
 
 void cWorldStorage::Execute(void)
 {
+	tbb::task_group Pool;  // TBB task group running the loads and saves
+
 	while (!m_ShouldTerminate)
 	{
-		m_Event.Wait();
-		// Process both queues until they are empty again:
-		bool Success;
-		do
+		if (m_PendingSaves.empty() || m_IsFlushingSaves)
+		{
+			m_Event.Wait();
+		}
+		else
+		{
+			// Wake up when the pending saves are due at the latest:
+			const auto Remaining = std::chrono::duration_cast<std::chrono::milliseconds>(m_PendingSavesSince + m_SaveFlushInterval - std::chrono::steady_clock::now());
+			if (Remaining.count() > 0)
+			{
+				m_Event.Wait(static_cast<unsigned>(Remaining.count()));
+			}
+		}
+
+		CollectSaves();
+		if (
+			!m_IsFlushingSaves &&
+			!m_PendingSaves.empty() &&
+			(m_ShouldFlushSaves.exchange(false) || (std::chrono::steady_clock::now() - m_PendingSavesSince >= m_SaveFlushInterval))
+		)
+		{
+			m_IsFlushingSaves = true;
+		}
+		if (m_IsFlushingSaves)
+		{
+			DispatchSaves(Pool);
+		}
+
+		// Dispatch the queued loads while there's room for more; each finished operation sets the event again:
+		while (!m_ShouldTerminate && (m_NumLoadsInProgress + m_NumSaveBatchesInProgress < m_MaxParallelOperations))
 		{
-			if (m_ShouldTerminate)
+			if (!DispatchOneLoad(Pool))
 			{
-				return;
+				break;
 			}
+		}
+	}
 
-			Success = LoadOneChunk();
-			Success |= SaveOneChunk();
-		} while (Success);
+	// The operations still running use the schemas and the world, let them finish:
+	if (auto Status = Pool.wait(); Status != tbb::complete)
+	{
+		LOGD("World storage task group result status: %d", Status);
 	}
 }
 
@@ -224,46 +312,116 @@ void cWorldStorage::Execute(void)
 
 
 
-bool cWorldStorage::LoadOneChunk(void)
+void cWorldStorage::CollectSaves(void)
 {
-	// Dequeue an item, bail out if there's none left:
-	cChunkCoords ToLoad(0, 0);
-	bool ShouldLoad = m_LoadQueue.TryDequeueItem(ToLoad);
-	if (!ShouldLoad)
+	for (;;)
 	{
-		return false;
+		// Count the save as in progress before dequeueing it, so that it's never counted by neither the queue nor the counter:
+		m_NumSavesInProgress += 1;
+		cChunkCoords Coords(0, 0);
+		if (!m_SaveQueue.TryDequeueItem(Coords))
+		{
+			m_NumSavesInProgress -= 1;
+			return;
+		}
+
+		if (m_PendingSaves.empty())
+		{
+			m_PendingSavesSince = std::chrono::steady_clock::now();
+		}
+		auto & Region = m_PendingSaves[{ FAST_FLOOR_DIV(Coords.m_ChunkX, 32), FAST_FLOOR_DIV(Coords.m_ChunkZ, 32) }];
+		if (!Region.insert(Coords).second)
+		{
+			// The chunk is already pending, the single save will cover both:
+			m_NumSavesInProgress -= 1;
+		}
 	}
+}
 
-	// Load the chunk:
-	LoadChunk(ToLoad.m_ChunkX, ToLoad.m_ChunkZ);
 
-	return true;
+
+
+
+void cWorldStorage::DispatchSaves(tbb::task_group & a_Pool)
+{
+	while (!m_PendingSaves.empty() && (m_NumLoadsInProgress + m_NumSaveBatchesInProgress < m_MaxParallelOperations))
+	{
+		auto Region = m_PendingSaves.begin();
+		std::vector<cChunkCoords> Batch;
+		Batch.reserve(Region->second.size());
+		{
+			cCSLock Lock(m_CSChunkOperations);
+			for (const auto & Coords : Region->second)
+			{
+				auto itr = m_ChunkOperations.find(Coords);
+				if (itr != m_ChunkOperations.end())
+				{
+					// There's an operation running on this chunk, the task running it will save the chunk afterwards:
+					itr->second.push_back(eOperation::Save);
+					continue;
+				}
+				m_ChunkOperations.emplace(Coords, std::deque<eOperation>());
+				Batch.push_back(Coords);
+			}
+		}
+		m_PendingSaves.erase(Region);
+		if (Batch.empty())
+		{
+			continue;
+		}
+
+		m_NumSaveBatchesInProgress += 1;
+		a_Pool.run([this, Batch = std::move(Batch)]()
+		{
+			SaveChunks(Batch);
+			m_NumSaveBatchesInProgress -= 1;
+			for (const auto & Coords : Batch)
+			{
+				m_NumSavesInProgress -= 1;
+				FinishOperation(Coords);
+			}
+			m_evtOperationFinished.SetAll();
+			m_Event.Set();  // Wake up the storage thread to dispatch more
+		});
+	}
+
+	if (m_PendingSaves.empty())
+	{
+		m_IsFlushingSaves = false;
+	}
 }
 
 
 
 
 
-bool cWorldStorage::SaveOneChunk(void)
+bool cWorldStorage::DispatchOneLoad(tbb::task_group & a_Pool)
 {
-	// Dequeue one chunk to save:
-	cChunkCoords ToSave(0, 0);
-	bool ShouldSave = m_SaveQueue.TryDequeueItem(ToSave);
-	if (!ShouldSave)
+	// Count the load as in progress before dequeueing it, so that it's never counted by neither the queue nor the counter:
+	m_NumLoadsInProgress += 1;
+	cChunkCoords Coords(0, 0);
+	if (!m_LoadQueue.TryDequeueItem(Coords))
 	{
+		m_NumLoadsInProgress -= 1;
 		return false;
 	}
 
-	// Save the chunk, if it's valid:
-	if (m_World->IsChunkValid(ToSave.m_ChunkX, ToSave.m_ChunkZ))
 	{
-		m_World->MarkChunkSaving(ToSave.m_ChunkX, ToSave.m_ChunkZ);
-		if (m_SaveSchema->SaveChunk(cChunkCoords(ToSave.m_ChunkX, ToSave.m_ChunkZ)))
+		cCSLock Lock(m_CSChunkOperations);
+		auto itr = m_ChunkOperations.find(Coords);
+		if (itr != m_ChunkOperations.end())
 		{
-			m_World->MarkChunkSaved(ToSave.m_ChunkX, ToSave.m_ChunkZ);
+			// There's an operation running on this chunk, the task running it will pick this one up afterwards:
+			itr->second.push_back(eOperation::Load);
+			return true;
 		}
+		m_ChunkOperations.emplace(Coords, std::deque<eOperation>());
 	}
 
+	a_Pool.run([this, Coords]()
+	{
+		RunOperations(Coords, eOperation::Load);
+	});
 	return true;
 }
 
@@ -271,6 +429,85 @@ bool cWorldStorage::SaveOneChunk(void)
 
 
 
+void cWorldStorage::RunOperations(const cChunkCoords a_Coords, const eOperation a_Operation)
+{
+	switch (a_Operation)
+	{
+		case eOperation::Load:
+		{
+			LoadChunk(a_Coords.m_ChunkX, a_Coords.m_ChunkZ);
+			m_NumLoadsInProgress -= 1;
+			break;
+		}
+		case eOperation::Save:
+		{
+			SaveChunks({ a_Coords });
+			m_NumSavesInProgress -= 1;
+			break;
+		}
+	}
+	m_evtOperationFinished.SetAll();
+	m_Event.Set();  // Wake up the storage thread to dispatch more
+
+	FinishOperation(a_Coords);
+}
+
+
+
+
+
+void cWorldStorage::FinishOperation(const cChunkCoords a_Coords)
+{
+	eOperation Next;
+	{
+		cCSLock Lock(m_CSChunkOperations);
+		auto itr = m_ChunkOperations.find(a_Coords);
+		ASSERT(itr != m_ChunkOperations.end());
+		if (itr->second.empty())
+		{
+			m_ChunkOperations.erase(itr);
+			return;
+		}
+		Next = itr->second.front();
+		itr->second.pop_front();
+	}
+
+	// Continue with the next operation waiting on this chunk:
+	RunOperations(a_Coords, Next);
+}
+
+
+
+
+
+void cWorldStorage::SaveChunks(const std::vector<cChunkCoords> & a_Chunks)
+{
+	// Only the chunks still loaded can be saved. Mark them as being saved, so that any change made meanwhile keeps them dirty:
+	std::vector<cChunkCoords> ToSave;
+	ToSave.reserve(a_Chunks.size());
+	for (const auto & Coords : a_Chunks)
+	{
+		if (m_World->IsChunkValid(Coords.m_ChunkX, Coords.m_ChunkZ))
+		{
+			m_World->MarkChunkSaving(Coords.m_ChunkX, Coords.m_ChunkZ);
+			ToSave.push_back(Coords);
+		}
+	}
+	if (ToSave.empty())
+	{
+		return;
+	}
+
+	for (const auto & Coords : m_SaveSchema->SaveChunks(ToSave))
+	{
+		m_World->MarkChunkSaved(Coords.m_ChunkX, Coords.m_ChunkZ);
+	}
+}
+
+
+
+
+
 bool cWorldStorage::LoadChunk(int a_ChunkX, int a_ChunkZ)
 {
 	ASSERT(m_World->IsChunkQueued(a_ChunkX, a_ChunkZ));
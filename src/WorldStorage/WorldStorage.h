@@ -3,6 +3,7 @@
 
 // Interfaces to the cWorldStorage class representing the chunk loading / saving thread
 // This class decides which storage schema to use for saving; it queries all available schemas for loading
+// The loads and saves themselves run in parallel as TBB tasks, the thread only dispatches them
 // Also declares the base class for all storage schemas, cWSSchema
 // Helper serialization class cJsonChunkSerializer is declared as well
 
@@ -14,6 +15,7 @@
 
 #include "../OSSupport/IsThread.h"
 #include "../OSSupport/Queue.h"
+#include "../TBBWrapper.h"
 #include "ChunkDef.h"
 
 
@@ -26,7 +28,8 @@ class cWorld;
 
 
 
-/** Interface that all the world storage schemas need to implement */
+/** Interface that all the world storage schemas need to implement.
+LoadChunk(), SaveChunk() and SaveChunks() may be called from multiple threads at once, but never for the same chunk at the same time. */
 class cWSSchema abstract
 {
 public:
@@ -37,6 +40,10 @@ public:
 	virtual bool SaveChunk(const cChunkCoords & a_Chunk) = 0;
 	virtual const AString GetName(void) const = 0;
 
+	/** Saves all the specified chunks, returns the ones that were saved successfully.
+	Schemas that can write multiple chunks at once more efficiently than one by one should override this. */
+	virtual std::vector<cChunkCoords> SaveChunks(const std::vector<cChunkCoords> & a_Chunks);
+
 protected:
 
 	cWorld * m_World;
@@ -48,7 +55,12 @@ typedef std::list<cWSSchema *> cWSSchemaList;
 
 
 
-/** The actual world storage class */
+/** The actual world storage class.
+The thread dequeues the loads and saves and runs them as TBB tasks, up to a configured number at a time.
+Operations on different chunks run in parallel; operations on a single chunk run strictly one after another,
+in the order they were dequeued.
+Saves are held back for the flush interval, coalescing repeated saves of the same chunk, and then flushed
+as one batch per region, so that the schema can write each region with a few large writes. */
 class cWorldStorage:
 	public cIsThread
 {
@@ -65,18 +77,45 @@ public:
 	/** Queues a chunk to be saved, asynchronously. */
 	void QueueSaveChunk(int a_ChunkX, int a_ChunkZ);
 
-	/** Initializes the storage schemas, ready to be started. */
-	void Initialize(cWorld & a_World, const AString & a_StorageSchemaName, int a_StorageCompressionFactor);
+	/** Initializes the storage schemas, ready to be started.
+	a_MaxParallelOperations is the maximum number of loads and region save batches that run at the same time; 1 processes them one by one.
+	a_SaveFlushInterval is how long the queued saves are held back before they're written; zero writes them as soon as possible.
+	If a_ShouldSyncSaves is true, each region file is synced to the disk after its batch of saves is written.
+	a_CompactionThreshold is the percentage of unused space in a region file above which the file is compacted after a save; 0 disables the compaction. */
+	void Initialize(
+		cWorld & a_World,
+		const AString & a_StorageSchemaName,
+		int a_StorageCompressionFactor,
+		int a_MaxParallelOperations,
+		std::chrono::milliseconds a_SaveFlushInterval,
+		bool a_ShouldSyncSaves,
+		int a_CompactionThreshold
+	);
+
 	void Stop(void);  // Hide the cIsThread's Stop() method, we need to signal the event
 	void WaitForFinish(void);
 	void WaitForLoadQueueEmpty(void);
+
+	/** Flushes all the saves held back and waits until they're written. */
 	void WaitForSaveQueueEmpty(void);
 
+	/** Returns the number of chunks waiting to be loaded, including those whose load is in progress. */
 	size_t GetLoadQueueLength(void);
+
+	/** Returns the number of chunks waiting to be saved, including those held back and those whose save is in progress. */
 	size_t GetSaveQueueLength(void);
 
 protected:
 
+	enum class eOperation
+	{
+		Load,
+		Save,
+	};
+
+	/** The coords of a region, used for grouping the saves. */
+	using cRegionCoords = std::pair<int, int>;
+
 	cWorld * m_World;
 	AString  m_StorageSchemaName;
 
@@ -89,22 +128,74 @@ protected:
 	/** The one storage schema used for saving */
 	cWSSchema * m_SaveSchema;
 
-	/** Set when there's any addition to the queues */
+	/** Set when there's any addition to the queues, and whenever an operation finishes */
 	cEvent m_Event;
 
+	/** Set when an operation finishes, used for waiting until all the dequeued operations are finished */
+	cEvent m_evtOperationFinished;
+
+	/** The maximum number of loads and region save batches running at the same time. */
+	size_t m_MaxParallelOperations;
+
+	/** How long the saves are held back before they're flushed. */
+	std::chrono::milliseconds m_SaveFlushInterval;
+
+	/** The number of loads and saves dequeued and not finished yet. */
+	std::atomic<size_t> m_NumLoadsInProgress;
+	std::atomic<size_t> m_NumSavesInProgress;
+
+	/** The number of region save batches running. */
+	std::atomic<size_t> m_NumSaveBatchesInProgress;
+
+	/** The saves held back, grouped by region. The sets coalesce repeated saves of the same chunk.
+	Only accessed by the storage thread. */
+	std::map<cRegionCoords, std::set<cChunkCoords>> m_PendingSaves;
+
+	/** When the oldest of m_PendingSaves was dequeued. */
+	std::chrono::steady_clock::time_point m_PendingSavesSince;
+
+	/** Set while m_PendingSaves are being dispatched, until they're all dispatched. Only accessed by the storage thread. */
+	bool m_IsFlushingSaves;
+
+	/** Set by WaitForSaveQueueEmpty() to have the storage thread flush the saves without waiting for the interval. */
+	std::atomic<bool> m_ShouldFlushSaves;
+
+	/** Protects m_ChunkOperations */
+	cCriticalSection m_CSChunkOperations;
+
+	/** The chunks that have an operation running, each mapped to the operations waiting for that operation to finish.
+	The waiting operations are run by the same task, in order, once the running operation finishes. */
+	std::unordered_map<cChunkCoords, std::deque<eOperation>, cChunkCoordsHash> m_ChunkOperations;
+
 
 	/** Loads the chunk specified; returns true on success, false on failure */
 	bool LoadChunk(int a_ChunkX, int a_ChunkZ);
 
-	void InitSchemas(int a_StorageCompressionFactor);
+	/** Saves those of the chunks specified that are valid, through the save schema. */
+	void SaveChunks(const std::vector<cChunkCoords> & a_Chunks);
+
+	void InitSchemas(int a_StorageCompressionFactor, bool a_ShouldSyncSaves, int a_CompactionThreshold);
 
 	virtual void Execute(void) override;
 
-	/** Loads one chunk from the queue (if any queued); returns true if there was a chunk in the queue to load */
-	bool LoadOneChunk(void);
+	/** Moves all the queued saves into m_PendingSaves. */
+	void CollectSaves(void);
+
+	/** Dispatches the pending saves, one task per region, while there's room for more operations. */
+	void DispatchSaves(tbb::task_group & a_Pool);
+
+	/** Dequeues one chunk from the load queue (if any queued) and starts loading it in a_Pool.
+	Returns true if there was a chunk in the queue. */
+	bool DispatchOneLoad(tbb::task_group & a_Pool);
+
+	/** Runs the operation on the chunk, then all the operations that have queued up behind it. Executed as a TBB task. */
+	void RunOperations(cChunkCoords a_Coords, eOperation a_Operation);
+
+	/** Marks the operation running on the chunk as finished, and runs all the operations that have queued up behind it. */
+	void FinishOperation(cChunkCoords a_Coords);
 
-	/** Saves one chunk from the queue (if any queued); returns true if there was a chunk in the queue to save */
-	bool SaveOneChunk(void);
+	/** Blocks until a_NumInProgress drops to zero. */
+	void WaitForOperationsFinished(const std::atomic<size_t> & a_NumInProgress);
 } ;
 
 
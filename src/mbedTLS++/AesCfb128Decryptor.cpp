@@ -19,6 +19,7 @@ cAesCfb128Decryptor::cAesCfb128Decryptor(void) :
 		throw std::system_error(GetLastError(), std::system_category());
 	}
 #else
+	m_UseAesNi = false;
 	mbedtls_aes_init(&m_Aes);
 #endif
 }
@@ -63,7 +64,15 @@ void cAesCfb128Decryptor::Init(const Byte a_Key[16], const Byte a_IV[16])
 	CryptSetKeyParam(m_Key, KP_IV, a_IV, 0);
 #else
 	std::copy_n(a_IV, 16, m_IV);
-	mbedtls_aes_setkey_enc(&m_Aes, a_Key, 128);
+	m_UseAesNi = AesNiCfb8::IsSupported();
+	if (m_UseAesNi)
+	{
+		AesNiCfb8::ExpandKey(a_Key, m_AesNiKey);
+	}
+	else
+	{
+		mbedtls_aes_setkey_enc(&m_Aes, a_Key, 128);
+	}
 #endif
 
 	m_IsValid = true;
@@ -83,6 +92,11 @@ void cAesCfb128Decryptor::ProcessData(std::byte * const a_EncryptedIn, const siz
 	DWORD Length = static_cast<DWORD>(a_Length);
 	CryptDecrypt(m_Key, 0, FALSE, 0, reinterpret_cast<BYTE *>(a_EncryptedIn), &Length);
 #else
+	if (m_UseAesNi)
+	{
+		AesNiCfb8::Decrypt(m_AesNiKey, m_IV, a_EncryptedIn, a_Length);
+		return;
+	}
 	mbedtls_aes_crypt_cfb8(&m_Aes, MBEDTLS_AES_DECRYPT, a_Length, m_IV, reinterpret_cast<unsigned char *>(a_EncryptedIn), reinterpret_cast<unsigned char *>(a_EncryptedIn));
 #endif
 }
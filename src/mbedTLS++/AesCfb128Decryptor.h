@@ -12,6 +12,7 @@
 #if PLATFORM_CRYPTOGRAPHY && defined(_WIN32)
 #include <wincrypt.h>
 #else
+#include "AesNiCfb8.h"
 #include "mbedtls/aes.h"
 #endif
 
@@ -43,6 +44,12 @@ protected:
 	HCRYPTKEY m_Key;
 #else
 	mbedtls_aes_context m_Aes;
+
+	/** The expanded key for AesNiCfb8, used instead of m_Aes if the CPU supports AES-NI */
+	AesNiCfb8::sKey m_AesNiKey;
+
+	/** Indicates whether the data is decrypted by AesNiCfb8 rather than mbedTLS */
+	bool m_UseAesNi;
 #endif
 
 	/** The InitialVector, used by the CFB mode decryption */
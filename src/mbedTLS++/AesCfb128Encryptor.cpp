@@ -11,7 +11,8 @@
 
 
 cAesCfb128Encryptor::cAesCfb128Encryptor(void):
-	m_IsValid(false)
+	m_IsValid(false),
+	m_UseAesNi(false)
 {
 	mbedtls_aes_init(&m_Aes);
 }
@@ -35,7 +36,15 @@ void cAesCfb128Encryptor::Init(const Byte a_Key[16], const Byte a_IV[16])
 	ASSERT(!IsValid());  // Cannot Init twice
 
 	memcpy(m_IV, a_IV, 16);
-	mbedtls_aes_setkey_enc(&m_Aes, a_Key, 128);
+	m_UseAesNi = AesNiCfb8::IsSupported();
+	if (m_UseAesNi)
+	{
+		AesNiCfb8::ExpandKey(a_Key, m_AesNiKey);
+	}
+	else
+	{
+		mbedtls_aes_setkey_enc(&m_Aes, a_Key, 128);
+	}
 	m_IsValid = true;
 }
 
@@ -46,5 +55,11 @@ void cAesCfb128Encryptor::Init(const Byte a_Key[16], const Byte a_IV[16])
 void cAesCfb128Encryptor::ProcessData(std::byte * const a_PlainIn, const size_t a_Length)
 {
 	ASSERT(IsValid());  // Must Init() first
+
+	if (m_UseAesNi)
+	{
+		AesNiCfb8::Encrypt(m_AesNiKey, m_IV, a_PlainIn, a_Length);
+		return;
+	}
 	mbedtls_aes_crypt_cfb8(&m_Aes, MBEDTLS_AES_ENCRYPT, a_Length, m_IV, reinterpret_cast<const unsigned char *>(a_PlainIn), reinterpret_cast<unsigned char *>(a_PlainIn));
 }
@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include "AesNiCfb8.h"
 #include "mbedtls/aes.h"
 
 
@@ -36,9 +37,15 @@ protected:
 
 	mbedtls_aes_context m_Aes;
 
+	/** The expanded key for AesNiCfb8, used instead of m_Aes if the CPU supports AES-NI */
+	AesNiCfb8::sKey m_AesNiKey;
+
 	/** The InitialVector, used by the CFB mode encryption */
 	Byte m_IV[16];
 
 	/** Indicates whether the object has been initialized with the Key / IV */
 	bool m_IsValid;
+
+	/** Indicates whether the data is encrypted by AesNiCfb8 rather than mbedTLS */
+	bool m_UseAesNi;
 } ;
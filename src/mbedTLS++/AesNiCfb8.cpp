@@ -0,0 +1,243 @@
+// AesNiCfb8.cpp
+
+// Implements the AES-128 CFB8 functions using the AES-NI instructions
+
+#include "Globals.h"
+#include "AesNiCfb8.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	#define AESNICFB8_X86
+	#ifdef _MSC_VER
+		#include <intrin.h>
+		#define AESNICFB8_TARGET
+	#else
+		#include <cpuid.h>
+		// The instructions are only used after checking for them at runtime, so only these functions may use them:
+		#define AESNICFB8_TARGET __attribute__((target("aes,sse2")))
+	#endif
+	#include <emmintrin.h>
+	#include <wmmintrin.h>
+#endif
+
+
+
+
+
+#ifdef AESNICFB8_X86
+
+namespace
+{
+	/** The number of blocks that Decrypt() encrypts at once. */
+	constexpr size_t DecryptBlocks = 8;
+
+	/** Computes the next round key from the previous one and its keygen assist. */
+	AESNICFB8_TARGET inline __m128i ExpandKeyStep(__m128i a_Key, __m128i a_Assist)
+	{
+		a_Assist = _mm_shuffle_epi32(a_Assist, 0xff);
+		a_Key = _mm_xor_si128(a_Key, _mm_slli_si128(a_Key, 4));
+		a_Key = _mm_xor_si128(a_Key, _mm_slli_si128(a_Key, 4));
+		a_Key = _mm_xor_si128(a_Key, _mm_slli_si128(a_Key, 4));
+		return _mm_xor_si128(a_Key, a_Assist);
+	}
+
+	/** Loads the round keys into the registers. */
+	AESNICFB8_TARGET inline void LoadKeys(const AesNiCfb8::sKey & a_Key, __m128i (& a_Keys)[11])
+	{
+		for (size_t i = 0; i < 11; i++)
+		{
+			a_Keys[i] = _mm_load_si128(reinterpret_cast<const __m128i *>(a_Key.m_RoundKeys + i * 16));
+		}
+	}
+
+	/** Performs one encryption round on all the blocks. Written out, so that the blocks stay in registers even without loop unrolling. */
+	AESNICFB8_TARGET inline void EncryptRound(__m128i (& a_Blocks)[DecryptBlocks], const __m128i a_Key)
+	{
+		static_assert(DecryptBlocks == 8, "EncryptRound must process all the blocks");
+		a_Blocks[0] = _mm_aesenc_si128(a_Blocks[0], a_Key);
+		a_Blocks[1] = _mm_aesenc_si128(a_Blocks[1], a_Key);
+		a_Blocks[2] = _mm_aesenc_si128(a_Blocks[2], a_Key);
+		a_Blocks[3] = _mm_aesenc_si128(a_Blocks[3], a_Key);
+		a_Blocks[4] = _mm_aesenc_si128(a_Blocks[4], a_Key);
+		a_Blocks[5] = _mm_aesenc_si128(a_Blocks[5], a_Key);
+		a_Blocks[6] = _mm_aesenc_si128(a_Blocks[6], a_Key);
+		a_Blocks[7] = _mm_aesenc_si128(a_Blocks[7], a_Key);
+	}
+
+	/** Encrypts a single block, returning the first byte of the result. */
+	AESNICFB8_TARGET inline Byte EncryptBlock(const __m128i (& a_Keys)[11], __m128i a_Block)
+	{
+		a_Block = _mm_xor_si128(a_Block, a_Keys[0]);
+		for (size_t i = 1; i < 10; i++)
+		{
+			a_Block = _mm_aesenc_si128(a_Block, a_Keys[i]);
+		}
+		return static_cast<Byte>(_mm_cvtsi128_si32(_mm_aesenclast_si128(a_Block, a_Keys[10])));
+	}
+}
+
+
+
+
+
+bool AesNiCfb8::IsSupported(void)
+{
+	static const bool IsSupported = []
+	{
+		#ifdef _MSC_VER
+			int Info[4];
+			__cpuid(Info, 1);
+			return ((Info[2] & (1 << 25)) != 0) && ((Info[3] & (1 << 26)) != 0);
+		#else
+			unsigned Eax, Ebx, Ecx, Edx;
+			if (__get_cpuid(1, &Eax, &Ebx, &Ecx, &Edx) == 0)
+			{
+				return false;
+			}
+			return ((Ecx & bit_AES) != 0) && ((Edx & bit_SSE2) != 0);
+		#endif
+	}();
+	return IsSupported;
+}
+
+
+
+
+
+AESNICFB8_TARGET void AesNiCfb8::ExpandKey(const Byte a_Key[16], sKey & a_Expanded)
+{
+	__m128i Keys[11];
+	Keys[0] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a_Key));
+
+	// The round constants must be immediates:
+	Keys[1]  = ExpandKeyStep(Keys[0], _mm_aeskeygenassist_si128(Keys[0], 0x01));
+	Keys[2]  = ExpandKeyStep(Keys[1], _mm_aeskeygenassist_si128(Keys[1], 0x02));
+	Keys[3]  = ExpandKeyStep(Keys[2], _mm_aeskeygenassist_si128(Keys[2], 0x04));
+	Keys[4]  = ExpandKeyStep(Keys[3], _mm_aeskeygenassist_si128(Keys[3], 0x08));
+	Keys[5]  = ExpandKeyStep(Keys[4], _mm_aeskeygenassist_si128(Keys[4], 0x10));
+	Keys[6]  = ExpandKeyStep(Keys[5], _mm_aeskeygenassist_si128(Keys[5], 0x20));
+	Keys[7]  = ExpandKeyStep(Keys[6], _mm_aeskeygenassist_si128(Keys[6], 0x40));
+	Keys[8]  = ExpandKeyStep(Keys[7], _mm_aeskeygenassist_si128(Keys[7], 0x80));
+	Keys[9]  = ExpandKeyStep(Keys[8], _mm_aeskeygenassist_si128(Keys[8], 0x1b));
+	Keys[10] = ExpandKeyStep(Keys[9], _mm_aeskeygenassist_si128(Keys[9], 0x36));
+
+	for (size_t i = 0; i < 11; i++)
+	{
+		_mm_store_si128(reinterpret_cast<__m128i *>(a_Expanded.m_RoundKeys + i * 16), Keys[i]);
+	}
+}
+
+
+
+
+
+AESNICFB8_TARGET void AesNiCfb8::Encrypt(const sKey & a_Key, Byte a_IV[16], std::byte * const a_Data, const size_t a_Length)
+{
+	__m128i Keys[11];
+	LoadKeys(a_Key, Keys);
+
+	auto IV = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a_IV));
+	for (size_t i = 0; i < a_Length; i++)
+	{
+		const auto Encrypted = static_cast<Byte>(EncryptBlock(Keys, IV) ^ std::to_integer<Byte>(a_Data[i]));
+		a_Data[i] = static_cast<std::byte>(Encrypted);
+
+		// Shift the IV by one byte, taking in the encrypted byte at the end:
+		IV = _mm_or_si128(_mm_srli_si128(IV, 1), _mm_slli_si128(_mm_cvtsi32_si128(Encrypted), 15));
+	}
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(a_IV), IV);
+}
+
+
+
+
+
+AESNICFB8_TARGET void AesNiCfb8::Decrypt(const sKey & a_Key, Byte a_IV[16], std::byte * const a_Data, const size_t a_Length)
+{
+	__m128i Keys[11];
+	LoadKeys(a_Key, Keys);
+
+	// The encrypted data, starting with the IV, is kept in Window, since the decryption overwrites it;
+	// Window holds the 16 bytes preceding the current position and the DecryptBlocks bytes from it on:
+	Byte Window[16 + DecryptBlocks];
+	std::copy_n(a_IV, 16, Window);
+
+	size_t i = 0;
+	for (; i + DecryptBlocks <= a_Length; i += DecryptBlocks)
+	{
+		std::memcpy(Window + 16, a_Data + i, DecryptBlocks);
+
+		// Encrypt the IVs of all the bytes together, interleaved:
+		__m128i Blocks[DecryptBlocks];
+		for (size_t Block = 0; Block < DecryptBlocks; Block++)
+		{
+			Blocks[Block] = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(Window + Block)), Keys[0]);
+		}
+		for (size_t Round = 1; Round < 10; Round++)
+		{
+			EncryptRound(Blocks, Keys[Round]);
+		}
+		for (size_t Block = 0; Block < DecryptBlocks; Block++)
+		{
+			const auto Decrypted = static_cast<Byte>(_mm_cvtsi128_si32(_mm_aesenclast_si128(Blocks[Block], Keys[10])) ^ Window[16 + Block]);
+			a_Data[i + Block] = static_cast<std::byte>(Decrypted);
+		}
+
+		std::memmove(Window, Window + DecryptBlocks, 16);
+	}
+
+	// The rest, one byte at a time:
+	for (; i < a_Length; i++)
+	{
+		Window[16] = std::to_integer<Byte>(a_Data[i]);
+		a_Data[i] = static_cast<std::byte>(EncryptBlock(Keys, _mm_loadu_si128(reinterpret_cast<const __m128i *>(Window))) ^ Window[16]);
+		std::memmove(Window, Window + 1, 16);
+	}
+
+	std::copy_n(Window, 16, a_IV);
+}
+
+#else  // AESNICFB8_X86
+
+bool AesNiCfb8::IsSupported(void)
+{
+	return false;
+}
+
+
+
+
+
+void AesNiCfb8::ExpandKey(const Byte a_Key[16], sKey & a_Expanded)
+{
+	UNUSED(a_Key);
+	UNUSED(a_Expanded);
+	ASSERT(!"AES-NI is not supported on this platform");
+}
+
+
+
+
+
+void AesNiCfb8::Encrypt(const sKey & a_Key, Byte a_IV[16], std::byte * a_Data, size_t a_Length)
+{
+	UNUSED(a_Key);
+	UNUSED(a_IV);
+	UNUSED(a_Data);
+	UNUSED(a_Length);
+	ASSERT(!"AES-NI is not supported on this platform");
+}
+
+
+
+
+
+void AesNiCfb8::Decrypt(const sKey & a_Key, Byte a_IV[16], std::byte * a_Data, size_t a_Length)
+{
+	UNUSED(a_Key);
+	UNUSED(a_IV);
+	UNUSED(a_Data);
+	UNUSED(a_Length);
+	ASSERT(!"AES-NI is not supported on this platform");
+}
+
+#endif  // else AESNICFB8_X86
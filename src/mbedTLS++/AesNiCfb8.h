@@ -0,0 +1,45 @@
+// AesNiCfb8.h
+
+// Declares the AES-128 CFB8 functions using the AES-NI instructions, used by cAesCfb128Encryptor and cAesCfb128Decryptor
+
+/*
+In CFB8, each byte of data is XORed with the first byte of the AES encryption of the 16-byte IV,
+and the IV then shifts by one byte, taking in the encrypted byte; that's a whole AES block for every byte.
+mbedTLS does that through its generic block function, copying the IV around for each byte.
+These functions keep the IV and the round keys in registers instead:
+- Encryption is inherently serial, each block depends on the previous output byte; the win is in the overhead.
+- Decryption knows all the IVs up front from the encrypted data, so it encrypts 8 of them at once, interleaved,
+hiding the latency of the AES instructions.
+Whether the CPU supports AES-NI is only known at runtime, IsSupported() tells; the callers fall back to mbedTLS otherwise.
+*/
+
+
+
+
+
+#pragma once
+
+
+
+
+
+namespace AesNiCfb8
+{
+	/** The expanded AES-128 encryption key, the 11 round keys. */
+	struct sKey
+	{
+		alignas(16) Byte m_RoundKeys[11 * 16];
+	};
+
+	/** Returns true if the CPU supports the AES-NI instructions, and the functions below may be used. */
+	bool IsSupported(void);
+
+	/** Expands the AES-128 key into the round keys. */
+	void ExpandKey(const Byte a_Key[16], sKey & a_Expanded);
+
+	/** Encrypts a_Length bytes of data in-place, updating the IV. */
+	void Encrypt(const sKey & a_Key, Byte a_IV[16], std::byte * a_Data, size_t a_Length);
+
+	/** Decrypts a_Length bytes of data in-place, updating the IV. */
+	void Decrypt(const sKey & a_Key, Byte a_IV[16], std::byte * a_Data, size_t a_Length);
+}
@@ -0,0 +1,141 @@
+// AesCfbTest.cpp
+
+// Tests the AES CFB8 encryption and decryption against the reference mbedTLS implementation
+
+#include "Globals.h"
+#include "../TestHelpers.h"
+#include "mbedTLS++/AesCfb128Decryptor.h"
+#include "mbedTLS++/AesCfb128Encryptor.h"
+#include "mbedTLS++/AesNiCfb8.h"
+
+#include <random>
+
+
+
+
+
+/** The lengths of the data pieces processed by a single call; covers both the interleaved blocks and the leftovers. */
+static const size_t PieceLengths[] = { 0, 1, 7, 8, 9, 15, 16, 17, 63, 64, 65, 1000, 4096 };
+
+
+
+
+
+/** Fills the container with random bytes. */
+template <typename T>
+static void Randomize(std::minstd_rand & a_Random, T & a_Data)
+{
+	for (auto & Value : a_Data)
+	{
+		Value = static_cast<std::remove_reference_t<decltype(Value)>>(a_Random() % 256);
+	}
+}
+
+
+
+
+
+/** Returns the data encrypted by mbedTLS, in a single call. */
+static ContiguousByteBuffer ReferenceEncrypt(const Byte a_Key[16], const Byte a_IV[16], ContiguousByteBuffer a_Data)
+{
+	mbedtls_aes_context Aes;
+	mbedtls_aes_init(&Aes);
+	mbedtls_aes_setkey_enc(&Aes, a_Key, 128);
+	Byte IV[16];
+	std::copy_n(a_IV, 16, IV);
+	auto Data = reinterpret_cast<unsigned char *>(a_Data.data());
+	mbedtls_aes_crypt_cfb8(&Aes, MBEDTLS_AES_ENCRYPT, a_Data.size(), IV, Data, Data);
+	mbedtls_aes_free(&Aes);
+	return a_Data;
+}
+
+
+
+
+
+/** Tests that the AES-NI functions produce the same data as mbedTLS, however the data is split between the calls. */
+static void TestAesNi()
+{
+	if (!AesNiCfb8::IsSupported())
+	{
+		LOG("AES-NI is not supported by this CPU, skipping its test.");
+		return;
+	}
+
+	std::minstd_rand Random(1);
+	for (int Round = 0; Round < 20; Round++)
+	{
+		Byte Key[16], InitialIV[16];
+		Randomize(Random, Key);
+		Randomize(Random, InitialIV);
+		ContiguousByteBuffer Plain(10000, std::byte(0));
+		Randomize(Random, Plain);
+
+		AesNiCfb8::sKey Expanded;
+		AesNiCfb8::ExpandKey(Key, Expanded);
+
+		// Encrypt and decrypt in random pieces:
+		auto Data = Plain;
+		Byte EncryptIV[16], DecryptIV[16];
+		std::copy_n(InitialIV, 16, EncryptIV);
+		std::copy_n(InitialIV, 16, DecryptIV);
+		size_t Length = 0;
+		while (Length < Data.size())
+		{
+			const auto PieceLength = std::min(PieceLengths[Random() % ARRAYCOUNT(PieceLengths)], Data.size() - Length);
+			AesNiCfb8::Encrypt(Expanded, EncryptIV, Data.data() + Length, PieceLength);
+			Length += PieceLength;
+		}
+		TEST_TRUE((Data == ReferenceEncrypt(Key, InitialIV, Plain)));
+
+		Length = 0;
+		while (Length < Data.size())
+		{
+			const auto PieceLength = std::min(PieceLengths[Random() % ARRAYCOUNT(PieceLengths)], Data.size() - Length);
+			AesNiCfb8::Decrypt(Expanded, DecryptIV, Data.data() + Length, PieceLength);
+			Length += PieceLength;
+		}
+		TEST_TRUE((Data == Plain));
+		TEST_TRUE(std::equal(EncryptIV, EncryptIV + 16, DecryptIV));
+	}
+}
+
+
+
+
+
+/** Tests that the encryptor and the decryptor, whichever implementation they pick, match mbedTLS and each other. */
+static void TestEncryptorDecryptor()
+{
+	std::minstd_rand Random(2);
+	Byte Key[16], IV[16];
+	Randomize(Random, Key);
+	Randomize(Random, IV);
+	cAesCfb128Encryptor Encryptor;
+	cAesCfb128Decryptor Decryptor;
+	Encryptor.Init(Key, IV);
+	Decryptor.Init(Key, IV);
+
+	ContiguousByteBuffer AllPlain, AllEncrypted;
+	for (const auto PieceLength : PieceLengths)
+	{
+		ContiguousByteBuffer Piece(PieceLength, std::byte(0));
+		Randomize(Random, Piece);
+		AllPlain += Piece;
+
+		Encryptor.ProcessData(Piece.data(), Piece.size());
+		AllEncrypted += Piece;
+		Decryptor.ProcessData(Piece.data(), Piece.size());
+		TEST_TRUE((Piece == ContiguousByteBufferView(AllPlain).substr(AllPlain.size() - PieceLength)));
+	}
+	TEST_TRUE((AllEncrypted == ReferenceEncrypt(Key, IV, AllPlain)));
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("AesCfb",
+	TestAesNi();
+	TestEncryptorDecryptor();
+)
@@ -49,21 +49,71 @@ static void TestWrite(void)
 static void TestWrap(void)
 {
 	cByteBuffer buf(3);
+
+	// Keep a byte unread over each commit, so that the buffer is never empty and rewound, and its positions wrap around its end:
+	TEST_TRUE(buf.Write("a", 1));
+	size_t NumWrapped = 0;
 	for (int i = 0; i < 1000; i++)
 	{
+		const auto Next = static_cast<char>('a' + (i + 1) % 26);
+		TEST_EQUAL(buf.GetReadableSpace(), 1);
 		size_t FreeSpace = buf.GetFreeSpace();
-		TEST_EQUAL(buf.GetReadableSpace(), 0);
 		TEST_GREATER_THAN_OR_EQUAL(FreeSpace, 1);
-		TEST_TRUE(buf.Write("a", 1));
-		TEST_TRUE(buf.CanReadBytes(1));
-		TEST_EQUAL(buf.GetReadableSpace(), 1);
+		TEST_TRUE(buf.Write(&Next, 1));
+		TEST_TRUE(buf.CanReadBytes(2));
+		TEST_EQUAL(buf.GetReadableSpace(), 2);
+
+		// The two bytes can't be read in place when they're split by the end of the buffer:
+		ContiguousByteBufferView View;
+		if (buf.ReadView(View, 2))
+		{
+			buf.ResetRead();
+		}
+		else
+		{
+			NumWrapped += 1;
+		}
+
 		UInt8 v = 0;
 		TEST_TRUE(buf.ReadBEUInt8(v));
-		TEST_EQUAL(v, 'a');
-		TEST_EQUAL(buf.GetReadableSpace(), 0);
+		TEST_EQUAL(v, 'a' + i % 26);
+		TEST_EQUAL(buf.GetReadableSpace(), 1);
 		buf.CommitRead();
 		TEST_EQUAL(buf.GetFreeSpace(), FreeSpace);  // We're back to normal
 	}
+	TEST_GREATER_THAN_OR_EQUAL(NumWrapped, 100);
+}
+
+
+
+
+
+static void TestReadView(void)
+{
+	cByteBuffer buf(10);
+	ContiguousByteBufferView View;
+
+	// Contiguous data is read in place:
+	TEST_TRUE(buf.Write("abcdefgh", 8));
+	TEST_FALSE(buf.ReadView(View, 9));
+	TEST_TRUE(buf.ReadView(View, 6));
+	TEST_EQUAL(View.size(), 6);
+	TEST_EQUAL(memcmp(View.data(), "abcdef", View.size()), 0);
+	buf.CommitRead();
+
+	// Data wrapping around the ringbuffer end isn't read:
+	TEST_TRUE(buf.Write("ijklmn", 6));
+	TEST_FALSE(buf.ReadView(View, 8));
+	TEST_EQUAL(buf.GetReadableSpace(), 8);
+	ContiguousByteBuffer All;
+	buf.ReadAll(All);
+	TEST_EQUAL(memcmp(All.data(), "ghijklmn", All.size()), 0);
+
+	// Once drained, the buffer restarts at the beginning, so its whole capacity is contiguous:
+	buf.CommitRead();
+	TEST_TRUE(buf.Write("0123456789", 10));
+	TEST_TRUE(buf.ReadView(View, 10));
+	TEST_EQUAL(memcmp(View.data(), "0123456789", View.size()), 0);
 }
 
 
@@ -74,4 +124,5 @@ IMPLEMENT_TEST_MAIN("ByteBuffer",
 	TestRead();
 	TestWrite();
 	TestWrap();
+	TestReadView();
 )
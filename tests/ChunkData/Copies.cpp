@@ -3,6 +3,8 @@
 #include "../TestHelpers.h"
 #include "ChunkData.h"
 
+#include <functional>  // for std::invoke
+
 
 
 
@@ -15,7 +17,7 @@ static void CopyAll(const StoreType & Data, GetType Getter, DefaultType Default,
 
 	for (size_t Y = 0; Y != 16; Y++)
 	{
-		const auto Section = (Data.*Getter)(Y);
+		const auto Section = std::invoke(Getter, Data, Y);
 		static_assert(SectionCount == std::tuple_size<std::remove_pointer_t<decltype(Section)>>::value, "Output array has wrong size");
 
 		if (Section == nullptr)
@@ -33,6 +35,17 @@ static void CopyAll(const StoreType & Data, GetType Getter, DefaultType Default,
 
 
 
+/** Getter for CopyAll that unpacks the paletted block sections. */
+static const ChunkBlockData::BlockArray * GetBlockSection(const ChunkBlockData & a_Data, size_t a_Y)
+{
+	static ChunkBlockData::BlockArray Scratch;
+	return a_Data.GetSection(a_Y, Scratch);
+}
+
+
+
+
+
 /** Performs the entire Copies test. */
 static void Test()
 {
@@ -61,12 +74,12 @@ static void Test()
 
 		buffer.SetAll(SrcBlockBuffer, SrcNibbleBuffer);
 		BLOCKTYPE DstBlockBuffer[16 * 16 * 256];
-		CopyAll(buffer, &ChunkBlockData::GetSection, ChunkBlockData::DefaultValue, DstBlockBuffer);
+		CopyAll(buffer, GetBlockSection, ChunkBlockData::DefaultValue, DstBlockBuffer);
 		TEST_EQUAL(memcmp(SrcBlockBuffer, DstBlockBuffer, (16 * 16 * 256) - 1), 0);
 
 		memset(SrcBlockBuffer, 0x00, 16 * 16 * 256);
 		buffer.SetAll(SrcBlockBuffer, SrcNibbleBuffer);
-		CopyAll(buffer, &ChunkBlockData::GetSection, ChunkBlockData::DefaultValue, DstBlockBuffer);
+		CopyAll(buffer, GetBlockSection, ChunkBlockData::DefaultValue, DstBlockBuffer);
 		TEST_EQUAL(memcmp(SrcBlockBuffer, DstBlockBuffer, (16 * 16 * 256) - 1), 0);
 	}
 
@@ -146,7 +159,7 @@ static void Test()
 		BLOCKTYPE SrcBlockBuffer[16 * 16 * 256];
 		memset(SrcBlockBuffer, 0x00, 16 * 16 * 256);
 		BLOCKTYPE DstBlockBuffer[16 * 16 * 256];
-		CopyAll(buffer, &ChunkBlockData::GetSection, ChunkBlockData::DefaultValue, DstBlockBuffer);
+		CopyAll(buffer, GetBlockSection, ChunkBlockData::DefaultValue, DstBlockBuffer);
 		TEST_EQUAL(memcmp(SrcBlockBuffer, DstBlockBuffer, (16 * 16 * 256) - 1), 0);
 
 		NIBBLETYPE SrcNibbleBuffer[16 * 16 * 256 / 2];
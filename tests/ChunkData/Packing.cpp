@@ -0,0 +1,121 @@
+#include "Globals.h"
+#include "../TestHelpers.h"
+#include "Protocol/ChunkDataPacking.h"
+
+#include <random>
+
+
+
+
+
+using namespace ChunkDataPacking;
+
+
+
+
+
+/** Tests that the block keys are made correctly from the blocks and the nibble-packed metas, including the missing ones. */
+static void TestBlockKeys()
+{
+	std::minstd_rand Random(1);
+	std::vector<BLOCKTYPE> Blocks(SectionBlockCount);
+	std::vector<NIBBLETYPE> Metas(SectionBlockCount / 2);
+	for (auto & Block : Blocks)
+	{
+		Block = static_cast<BLOCKTYPE>(Random() % 256);
+	}
+	for (auto & Meta : Metas)
+	{
+		Meta = static_cast<NIBBLETYPE>(Random() % 256);
+	}
+
+	const BLOCKTYPE * BlockInputs[] = { Blocks.data(), nullptr };
+	const NIBBLETYPE * MetaInputs[] = { Metas.data(), nullptr };
+	for (const auto BlockInput : BlockInputs)
+	{
+		for (const auto MetaInput : MetaInputs)
+		{
+			std::vector<UInt16> Keys(SectionBlockCount), ScalarKeys(SectionBlockCount);
+			MakeBlockKeys(BlockInput, MetaInput, Keys.data());
+			MakeBlockKeysScalar(BlockInput, MetaInput, ScalarKeys.data());
+			for (size_t i = 0; i < SectionBlockCount; i++)
+			{
+				const UInt16 Block = (BlockInput == nullptr) ? 0 : BlockInput[i];
+				const UInt16 Meta = (MetaInput == nullptr) ? 0 : cChunkDef::ExpandNibble(MetaInput, i);
+				const auto Expected = static_cast<UInt16>((Block << 4) | Meta);
+				TEST_EQUAL(Keys[i], Expected);
+				TEST_EQUAL(ScalarKeys[i], Expected);
+			}
+		}
+	}
+}
+
+
+
+
+
+/** Tests that mapping through a table looks up each key. */
+static void TestMapping()
+{
+	std::vector<UInt32> Table(NumBlockKeys);
+	for (size_t i = 0; i < NumBlockKeys; i++)
+	{
+		Table[i] = static_cast<UInt32>(NumBlockKeys - i);
+	}
+	std::vector<UInt16> Keys(SectionBlockCount);
+	for (size_t i = 0; i < SectionBlockCount; i++)
+	{
+		Keys[i] = static_cast<UInt16>((i * 7) % NumBlockKeys);
+	}
+	std::vector<UInt32> Values(SectionBlockCount);
+	MapBlockKeys(Keys.data(), Table.data(), Values.data());
+	for (size_t i = 0; i < SectionBlockCount; i++)
+	{
+		TEST_EQUAL(Values[i], Table[Keys[i]]);
+	}
+}
+
+
+
+
+
+/** Tests that the packed values can be read back bit by bit, in the protocol's layout:
+the longs are big-endian, and each value starts at the lowest free bit of the current long, continuing into the next one. */
+static void TestPacking()
+{
+	std::minstd_rand Random(1);
+	for (UInt8 Bits : { 4, 5, 8, 13, 14 })
+	{
+		std::vector<UInt32> Values(SectionBlockCount);
+		for (auto & Value : Values)
+		{
+			Value = static_cast<UInt32>(Random() % (1U << Bits));
+		}
+		std::vector<std::byte> Packed(GetPackedSize(Bits));
+		PackBits(Values.data(), Bits, Packed.data());
+
+		for (size_t i = 0; i < SectionBlockCount; i++)
+		{
+			UInt32 Value = 0;
+			for (size_t Bit = 0; Bit < Bits; Bit++)
+			{
+				const size_t BitIndex = i * Bits + Bit;
+				const size_t Long = BitIndex / 64;
+				const size_t BitInLong = BitIndex % 64;
+				const auto Byte = std::to_integer<UInt32>(Packed[Long * 8 + 7 - BitInLong / 8]);
+				Value |= ((Byte >> (BitInLong % 8)) & 1) << Bit;
+			}
+			TEST_EQUAL(Value, Values[i]);
+		}
+	}
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("ChunkDataPacking",
+	TestBlockKeys();
+	TestMapping();
+	TestPacking();
+)
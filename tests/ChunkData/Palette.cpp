@@ -0,0 +1,189 @@
+#include "Globals.h"
+#include "../TestHelpers.h"
+#include "BlockType.h"
+#include "ChunkData.h"
+
+
+
+
+
+/** Tests that the paletted section grows through all its representations and keeps the data intact. */
+static void TestUpgrade()
+{
+	PalettedBlockSection Section;
+	TEST_FALSE(Section.IsPresent());
+
+	Section.Fill(E_BLOCK_STONE);
+	TEST_TRUE(Section.IsPresent());
+	TEST_EQUAL(Section.GetBitsPerEntry(), 0);
+	TEST_EQUAL(Section.GetMemoryUsage(), 0);
+	TEST_EQUAL(Section.Get(1234), E_BLOCK_STONE);
+
+	// Setting the same value keeps the single-value representation:
+	Section.Set(10, E_BLOCK_STONE);
+	TEST_EQUAL(Section.GetBitsPerEntry(), 0);
+
+	// Each new distinct block type upgrades as needed:
+	BLOCKTYPE Reference[PalettedBlockSection::BlockCount];
+	std::fill(std::begin(Reference), std::end(Reference), static_cast<BLOCKTYPE>(E_BLOCK_STONE));
+	const UInt8 ExpectedBits[] = { 1, 2, 2, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 8, 8 };
+	for (size_t i = 0; i < ARRAYCOUNT(ExpectedBits); i++)
+	{
+		const size_t Index = i * 211;
+		const auto Block = static_cast<BLOCKTYPE>(100 + i);
+		Section.Set(Index, Block);
+		Reference[Index] = Block;
+		TEST_EQUAL(Section.GetBitsPerEntry(), ExpectedBits[i]);
+	}
+
+	BLOCKTYPE Copy[PalettedBlockSection::BlockCount];
+	Section.CopyTo(Copy);
+	TEST_EQUAL(memcmp(Copy, Reference, sizeof(Copy)), 0);
+	for (size_t i = 0; i < PalettedBlockSection::BlockCount; i++)
+	{
+		TEST_EQUAL(Section.Get(i), Reference[i]);
+	}
+}
+
+
+
+
+
+/** Tests that rebuilding a section picks the smallest representation, and that a full palette reuses unused entries. */
+static void TestDowngrade()
+{
+	BLOCKTYPE Blocks[PalettedBlockSection::BlockCount];
+	for (size_t i = 0; i < PalettedBlockSection::BlockCount; i++)
+	{
+		Blocks[i] = static_cast<BLOCKTYPE>(i % 3);
+	}
+
+	PalettedBlockSection Section;
+	Section.SetAll(Blocks);
+	TEST_EQUAL(Section.GetBitsPerEntry(), 2);
+	TEST_EQUAL(Section.GetPaletteSize(), 3);
+	TEST_EQUAL(Section.GetMemoryUsage(), PalettedBlockSection::BlockCount / 4);
+
+	std::fill(std::begin(Blocks), std::end(Blocks), static_cast<BLOCKTYPE>(E_BLOCK_DIRT));
+	Section.SetAll(Blocks);
+	TEST_EQUAL(Section.GetBitsPerEntry(), 0);
+	TEST_EQUAL(Section.Get(0), E_BLOCK_DIRT);
+
+	// Fill a 1-bit palette, then overwrite one of the values completely; the next new value should take its place:
+	Section.Set(0, E_BLOCK_STONE);
+	TEST_EQUAL(Section.GetBitsPerEntry(), 1);
+	Section.Set(0, E_BLOCK_DIRT);
+	Section.Set(1, E_BLOCK_GRASS);
+	TEST_EQUAL(Section.GetBitsPerEntry(), 1);
+	TEST_EQUAL(Section.Get(0), E_BLOCK_DIRT);
+	TEST_EQUAL(Section.Get(1), E_BLOCK_GRASS);
+}
+
+
+
+
+
+/** Tests that a full palette hands the entries no longer used by any block to new block types, in place. */
+static void TestReuse()
+{
+	BLOCKTYPE Blocks[PalettedBlockSection::BlockCount];
+	for (size_t i = 0; i < PalettedBlockSection::BlockCount; i++)
+	{
+		Blocks[i] = static_cast<BLOCKTYPE>(i % 4);
+	}
+	PalettedBlockSection Section;
+	Section.SetAll(Blocks);
+	TEST_EQUAL(Section.GetBitsPerEntry(), 2);
+	TEST_EQUAL(Section.GetPaletteSize(), 4);
+
+	// Replace all the blocks of type 1, leaving its entry unused:
+	for (size_t i = 1; i < PalettedBlockSection::BlockCount; i += 4)
+	{
+		Section.Set(i, 0);
+		Blocks[i] = 0;
+	}
+
+	// Toggle a single block between a new type and back many times, it should keep taking over the same entry:
+	for (int Toggle = 0; Toggle < 100; Toggle++)
+	{
+		Section.Set(2, E_BLOCK_REDSTONE_TORCH_ON);
+		TEST_EQUAL(Section.GetPalette()[1], E_BLOCK_REDSTONE_TORCH_ON);
+		Section.Set(2, E_BLOCK_REDSTONE_TORCH_OFF);
+		TEST_EQUAL(Section.GetPalette()[1], E_BLOCK_REDSTONE_TORCH_OFF);
+		TEST_EQUAL(Section.GetBitsPerEntry(), 2);
+		TEST_EQUAL(Section.GetPaletteSize(), 4);
+	}
+	Blocks[2] = E_BLOCK_REDSTONE_TORCH_OFF;
+
+	for (size_t i = 0; i < PalettedBlockSection::BlockCount; i++)
+	{
+		TEST_EQUAL(Section.Get(i), Blocks[i]);
+	}
+
+	// A copy keeps the use counts, so the copy reuses the entries as well:
+	PalettedBlockSection Copy(Section);
+	Copy.Set(2, 0);
+	Copy.Set(3, E_BLOCK_STONE);
+	TEST_EQUAL(Copy.GetBitsPerEntry(), 2);
+	TEST_EQUAL(Copy.GetPalette()[1], E_BLOCK_STONE);
+	TEST_EQUAL(Copy.Get(3), E_BLOCK_STONE);
+	TEST_EQUAL(Copy.Get(7), 3);
+}
+
+
+
+
+
+/** Tests that the paletted storage behaves the same as the flat arrays through the ChunkBlockData API. */
+static void TestChunkBlockData()
+{
+	ChunkBlockData Data;
+	TEST_FALSE(Data.HasSection(0));
+	Data.SetBlock({ 0, 0, 0 }, E_BLOCK_AIR);
+	TEST_FALSE(Data.HasSection(0));
+
+	for (int y = 0; y < 32; y++)
+	{
+		for (int z = 0; z < cChunkDef::Width; z++)
+		{
+			for (int x = 0; x < cChunkDef::Width; x++)
+			{
+				Data.SetBlock({ x, y, z }, static_cast<BLOCKTYPE>((x * 7 + y * 3 + z) % 40));
+			}
+		}
+	}
+	TEST_TRUE(Data.HasSection(0));
+	TEST_TRUE(Data.HasSection(1));
+	TEST_FALSE(Data.HasSection(2));
+	TEST_EQUAL(Data.GetPalettedSection(0).GetBitsPerEntry(), 8);
+
+	ChunkBlockData Copy;
+	Copy.Assign(Data);
+	ChunkBlockData::BlockArray Scratch;
+	const auto Section = Copy.GetSection(1, Scratch);
+	TEST_NOTEQUAL(Section, nullptr);
+	for (int y = 16; y < 32; y++)
+	{
+		for (int z = 0; z < cChunkDef::Width; z++)
+		{
+			for (int x = 0; x < cChunkDef::Width; x++)
+			{
+				const auto Expected = static_cast<BLOCKTYPE>((x * 7 + y * 3 + z) % 40);
+				TEST_EQUAL(Copy.GetBlock({ x, y, z }), Expected);
+				TEST_EQUAL((*Section)[static_cast<size_t>(cChunkDef::MakeIndex(x, y - 16, z))], Expected);
+			}
+		}
+	}
+	TEST_EQUAL(Copy.GetSection(2, Scratch), nullptr);
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("ChunkData Palette",
+	TestUpgrade();
+	TestDowngrade();
+	TestReuse();
+	TestChunkBlockData();
+)
@@ -0,0 +1,137 @@
+#include "Globals.h"
+#include "../TestHelpers.h"
+#include "ChunkSectionPool.h"
+
+#include <thread>
+
+
+
+
+
+/** Returns the stats of the size class for the specified block size. */
+static cChunkSectionPool::sClassStats GetClassStats(size_t a_BlockSize)
+{
+	for (const auto & Class : cChunkSectionPool::GetStats())
+	{
+		if (Class.m_BlockSize == a_BlockSize)
+		{
+			return Class;
+		}
+	}
+	return {};
+}
+
+
+
+
+
+/** Tests that freed blocks are reused and counted. */
+static void TestReuse()
+{
+	const auto Before = GetClassStats(2048);
+
+	auto First = cChunkSectionPool::Allocate(2048);
+	TEST_NOTEQUAL(First, nullptr);
+	TEST_EQUAL(GetClassStats(2048).m_NumBlocksInUse, Before.m_NumBlocksInUse + 1);
+	cChunkSectionPool::Free(First, 2048);
+	TEST_EQUAL(GetClassStats(2048).m_NumBlocksInUse, Before.m_NumBlocksInUse);
+
+	// The most recently freed block is handed out again from the thread cache:
+	auto Second = cChunkSectionPool::Allocate(2048);
+	TEST_EQUAL(Second, First);
+	cChunkSectionPool::Free(Second, 2048);
+
+	// Blocks of different size classes don't overlap:
+	auto Small = static_cast<UInt8 *>(cChunkSectionPool::Allocate(512));
+	auto Large = static_cast<UInt8 *>(cChunkSectionPool::Allocate(4096));
+	std::fill_n(Small, 512, 0x11);
+	std::fill_n(Large, 4096, 0x22);
+	TEST_EQUAL(Small[511], 0x11);
+	TEST_EQUAL(Large[0], 0x22);
+	cChunkSectionPool::Free(Small, 512);
+	cChunkSectionPool::Free(Large, 4096);
+}
+
+
+
+
+
+/** Tests allocating on one thread and freeing on another, past the thread cache limits. */
+static void TestCrossThread()
+{
+	std::vector<void *> Blocks;
+	std::thread Allocator([&Blocks]()
+	{
+		for (int i = 0; i < 1000; i++)
+		{
+			auto Block = cChunkSectionPool::AllocateForOverwrite<std::array<UInt8, 1024>>();
+			Block->fill(static_cast<UInt8>(i));
+			Blocks.push_back(Block);
+		}
+	});
+	Allocator.join();
+
+	// All the blocks must be distinct:
+	auto Sorted = Blocks;
+	std::sort(Sorted.begin(), Sorted.end());
+	TEST_TRUE((std::adjacent_find(Sorted.begin(), Sorted.end()) == Sorted.end()));
+
+	const auto InUse = GetClassStats(1024).m_NumBlocksInUse;
+	TEST_TRUE((InUse >= 1000));
+	TEST_TRUE((GetClassStats(1024).m_NumBlocksTotal >= 1000));
+	for (auto Block : Blocks)
+	{
+		cChunkSectionPool::Free(Block, 1024);
+	}
+	const auto Stats = GetClassStats(1024);
+	TEST_EQUAL(Stats.m_NumBlocksInUse, InUse - 1000);
+	TEST_TRUE((Stats.m_NumBlocksSharedFree > 0));
+}
+
+
+
+
+
+/** Tests that the slabs are released once all their blocks are free again, except for a single spare one. */
+static void TestRelease()
+{
+	const auto Before = GetClassStats(4096);
+	const size_t BlocksPerSlab = 64;  // 256 KiB slabs of 4 KiB blocks
+
+	std::thread Worker([]()
+	{
+		std::vector<void *> Blocks;
+		for (size_t i = 0; i < 4 * BlocksPerSlab; i++)
+		{
+			Blocks.push_back(cChunkSectionPool::Allocate(4096));
+		}
+		TEST_TRUE((GetClassStats(4096).m_NumBlocksTotal >= 4 * BlocksPerSlab));
+		for (auto Block : Blocks)
+		{
+			cChunkSectionPool::Free(Block, 4096);
+		}
+		// The thread cache gives the rest of its blocks back when the thread exits
+	});
+	Worker.join();
+
+	const auto After = GetClassStats(4096);
+	TEST_TRUE((After.m_NumSlabsReleased >= Before.m_NumSlabsReleased + 3));
+	TEST_TRUE((After.m_NumBlocksTotal <= Before.m_NumBlocksTotal + BlocksPerSlab));
+	TEST_EQUAL(After.m_NumBlocksInUse, Before.m_NumBlocksInUse);
+
+	// The pool still works after releasing:
+	auto Block = static_cast<UInt8 *>(cChunkSectionPool::Allocate(4096));
+	std::fill_n(Block, 4096, 0x33);
+	TEST_EQUAL(Block[4095], 0x33);
+	cChunkSectionPool::Free(Block, 4096);
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("ChunkData SectionPool",
+	TestReuse();
+	TestCrossThread();
+	TestRelease();
+)
@@ -0,0 +1,195 @@
+// SerializeSectionsTest.cpp
+
+// Tests the chunk packets that resend only some of a chunk's sections, against the full chunk packets
+
+#include "Globals.h"
+#include "../TestHelpers.h"
+#include "BlockType.h"
+#include "Protocol/ChunkDataSerializer.h"
+
+
+
+
+
+/** Reads the packet serialized by cChunkDataSerializer into a buffer, skipping the header that the stubbed CompressPacket() writes. */
+static void ReadPacket(const ContiguousByteBuffer & a_Data, cByteBuffer & a_Packet)
+{
+	TEST_TRUE(a_Packet.Write(a_Data.data(), a_Data.size()));
+	UInt32 PacketSize, DataSize;
+	TEST_TRUE(a_Packet.ReadVarInt32(PacketSize));
+	TEST_TRUE(a_Packet.ReadVarInt32(DataSize));
+	TEST_EQUAL(DataSize, 0);
+	TEST_EQUAL(PacketSize, a_Packet.GetReadableSpace() + 1);
+
+	UInt32 PacketID;
+	TEST_TRUE(a_Packet.ReadVarInt32(PacketID));
+	TEST_EQUAL(PacketID, 0x21);
+}
+
+
+
+
+
+/** Returns the chunk data used by the tests: a stone block with meta 3 at {1, 17, 2}, in section 1; all the other sections are empty. */
+static ChunkBlockData MakeBlockData()
+{
+	ChunkBlockData Blocks;
+	Blocks.SetBlock({ 1, 17, 2 }, E_BLOCK_STONE);
+	Blocks.SetMeta({ 1, 17, 2 }, 3);
+	return Blocks;
+}
+
+
+
+
+
+/** Tests the 1.8 sections packet: only the requested sections, including the empty ones as air, and no biomes. */
+static void TestSections47()
+{
+	const auto Blocks = MakeBlockData();
+	const ChunkLightData Light;
+	cChunkDataSerializer Serializer(dimOverworld);
+	const UInt16 Mask = (1 << 1) | (1 << 3);
+	const auto Data = Serializer.SerializeSections(cChunkDataSerializer::CacheVersion::v47, 5, -3, Mask, Blocks, Light);
+
+	cByteBuffer Packet(Data.size() + 1);
+	ReadPacket(Data, Packet);
+	Int32 ChunkX, ChunkZ;
+	bool HasBiomes;
+	UInt16 SectionMask;
+	UInt32 ChunkSize;
+	TEST_TRUE(Packet.ReadBEInt32(ChunkX));
+	TEST_TRUE(Packet.ReadBEInt32(ChunkZ));
+	TEST_TRUE(Packet.ReadBool(HasBiomes));
+	TEST_TRUE(Packet.ReadBEUInt16(SectionMask));
+	TEST_TRUE(Packet.ReadVarInt32(ChunkSize));
+	TEST_EQUAL(ChunkX, 5);
+	TEST_EQUAL(ChunkZ, -3);
+	TEST_FALSE(HasBiomes);  // Without the biomes, the client updates only the sections in the mask
+	TEST_EQUAL(SectionMask, Mask);
+
+	// Two sections of blocks, block light and sky light, nothing else:
+	const size_t SectionSize = ChunkBlockData::SectionBlockCount * 2 + ChunkLightData::SectionLightCount * 2;
+	TEST_EQUAL(ChunkSize, 2 * SectionSize);
+	TEST_EQUAL(Packet.GetReadableSpace(), ChunkSize);
+
+	// The block types, as little-endian (BlockType << 4) | BlockMeta, section 1 followed by section 3:
+	ContiguousByteBuffer Types;
+	TEST_TRUE(Packet.ReadSome(Types, 2 * ChunkBlockData::SectionBlockCount * 2));
+	const size_t StoneIdx = 1 + 2 * cChunkDef::Width + (17 - cChunkDef::SectionHeight) * cChunkDef::Width * cChunkDef::Width;
+	TEST_EQUAL(static_cast<int>(Types[StoneIdx * 2]), ((E_BLOCK_STONE << 4) | 3));
+	TEST_EQUAL(static_cast<int>(Types[StoneIdx * 2 + 1]), 0);
+	const auto NumAir = std::count(Types.begin(), Types.end(), std::byte(0));
+	TEST_EQUAL(static_cast<size_t>(NumAir), Types.size() - 1);
+
+	// The default light of the sections without any light data:
+	ContiguousByteBuffer BlockLight, SkyLight;
+	TEST_TRUE(Packet.ReadSome(BlockLight, 2 * ChunkLightData::SectionLightCount));
+	TEST_TRUE(Packet.ReadSome(SkyLight, 2 * ChunkLightData::SectionLightCount));
+	TEST_EQUAL(static_cast<size_t>(std::count(BlockLight.begin(), BlockLight.end(), std::byte(ChunkLightData::DefaultBlockLightValue))), BlockLight.size());
+	TEST_EQUAL(static_cast<size_t>(std::count(SkyLight.begin(), SkyLight.end(), std::byte(ChunkLightData::DefaultSkyLightValue))), SkyLight.size());
+	TEST_EQUAL(Packet.GetReadableSpace(), 0);
+}
+
+
+
+
+
+/** Tests the 1.8 full chunk packet of the same data, for comparison: only the non-empty sections, followed by the biomes. */
+static void TestFull47()
+{
+	const auto Blocks = MakeBlockData();
+	const ChunkLightData Light;
+	cChunkDef::BiomeMap Biomes;
+	std::fill(std::begin(Biomes), std::end(Biomes), biPlains);
+	unsigned char BiomeBytes[cChunkDef::Width * cChunkDef::Width];
+	std::fill(std::begin(BiomeBytes), std::end(BiomeBytes), static_cast<unsigned char>(biPlains));
+	cChunkDataSerializer Serializer(dimOverworld);
+	const auto Data = Serializer.Serialize(cChunkDataSerializer::CacheVersion::v47, 5, -3, Blocks, Light, BiomeBytes);
+
+	cByteBuffer Packet(Data.size() + 1);
+	ReadPacket(Data, Packet);
+	Int32 ChunkX, ChunkZ;
+	bool HasBiomes;
+	UInt16 SectionMask;
+	UInt32 ChunkSize;
+	TEST_TRUE(Packet.ReadBEInt32(ChunkX));
+	TEST_TRUE(Packet.ReadBEInt32(ChunkZ));
+	TEST_TRUE(Packet.ReadBool(HasBiomes));
+	TEST_TRUE(Packet.ReadBEUInt16(SectionMask));
+	TEST_TRUE(Packet.ReadVarInt32(ChunkSize));
+	TEST_TRUE(HasBiomes);
+	TEST_EQUAL(SectionMask, 1 << 1);
+	const size_t SectionSize = ChunkBlockData::SectionBlockCount * 2 + ChunkLightData::SectionLightCount * 2;
+	TEST_EQUAL(ChunkSize, SectionSize + cChunkDef::Width * cChunkDef::Width);
+	TEST_EQUAL(Packet.GetReadableSpace(), ChunkSize);
+}
+
+
+
+
+
+/** Tests the 1.14 sections packet: the mask, one fixed-size block array per requested section, and no biomes. */
+static void TestSections477()
+{
+	const auto Blocks = MakeBlockData();
+	const ChunkLightData Light;
+	cChunkDataSerializer Serializer(dimOverworld);
+	const UInt16 Mask = (1 << 0) | (1 << 1) | (1 << 15);
+	const auto Data = Serializer.SerializeSections(cChunkDataSerializer::CacheVersion::v477, 5, -3, Mask, Blocks, Light);
+
+	cByteBuffer Packet(Data.size() + 1);
+	ReadPacket(Data, Packet);
+	Int32 ChunkX, ChunkZ;
+	bool HasBiomes;
+	UInt32 SectionMask;
+	TEST_TRUE(Packet.ReadBEInt32(ChunkX));
+	TEST_TRUE(Packet.ReadBEInt32(ChunkZ));
+	TEST_TRUE(Packet.ReadBool(HasBiomes));
+	TEST_TRUE(Packet.ReadVarInt32(SectionMask));
+	TEST_FALSE(HasBiomes);
+	TEST_EQUAL(SectionMask, Mask);
+
+	// Skip the heightmaps NBT, an empty compound:
+	Byte TagType;
+	UInt16 NameLength;
+	TEST_TRUE(Packet.ReadBEUInt8(TagType));
+	TEST_TRUE(Packet.ReadBEUInt16(NameLength));
+	TEST_TRUE(Packet.SkipRead(NameLength));
+	TEST_TRUE(Packet.ReadBEUInt8(TagType));
+	TEST_EQUAL(TagType, 0);  // TAG_End
+
+	// Each section: block count, bits per entry, data array length and the data array of 14-bit entries:
+	const size_t NumLongs = ChunkBlockData::SectionBlockCount * 14 / 64;
+	const size_t SectionSize = 2 + 1 + cByteBuffer::GetVarIntSize(static_cast<UInt32>(NumLongs)) + NumLongs * 8;
+	UInt32 ChunkSize;
+	TEST_TRUE(Packet.ReadVarInt32(ChunkSize));
+	TEST_EQUAL(ChunkSize, 3 * SectionSize);
+	for (int i = 0; i < 3; i++)
+	{
+		UInt8 BitsPerEntry;
+		UInt32 ArrayLength;
+		TEST_TRUE(Packet.SkipRead(2));
+		TEST_TRUE(Packet.ReadBEUInt8(BitsPerEntry));
+		TEST_TRUE(Packet.ReadVarInt32(ArrayLength));
+		TEST_EQUAL(BitsPerEntry, 14);
+		TEST_EQUAL(ArrayLength, NumLongs);
+		TEST_TRUE(Packet.SkipRead(NumLongs * 8));
+	}
+
+	// No block entities:
+	UInt32 NumBlockEntities;
+	TEST_TRUE(Packet.ReadVarInt32(NumBlockEntities));
+	TEST_EQUAL(NumBlockEntities, 0);
+	TEST_EQUAL(Packet.GetReadableSpace(), 0);
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("ChunkDataSerializer",
+	TestSections47();
+	TestFull47();
+	TestSections477();
+)
@@ -0,0 +1,32 @@
+// Stubs.cpp
+
+// Implements stubs of various Cuberite methods that are needed for linking but not for runtime
+// This is required so that we don't bring in the entire Cuberite via dependencies
+
+#include "Globals.h"
+#include "ByteBuffer.h"
+#include "Protocol/Protocol_1_8.h"
+#include "UUID.h"
+
+
+
+
+
+void cUUID::FromRaw(const std::array<Byte, 16> &){}
+
+
+
+
+
+ContiguousByteBufferView cProtocol_1_8_0::CompressPacket(CircularBufferCompressor & a_Packet, ContiguousByteBuffer & a_Compressed)
+{
+	// The test reads the packet back, write it the way the protocol writes the packets that aren't worth compressing:
+	const auto Uncompressed = a_Packet.GetView();
+	cByteBuffer Header(16);
+	Header.WriteVarInt32(static_cast<UInt32>(cByteBuffer::GetVarIntSize(0) + Uncompressed.size()));
+	Header.WriteVarInt32(0);
+	a_Compressed.clear();
+	Header.ReadAll(a_Compressed);
+	a_Compressed += Uncompressed;
+	return a_Compressed;
+}
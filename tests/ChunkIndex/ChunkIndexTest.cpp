@@ -0,0 +1,96 @@
+// ChunkIndexTest.cpp
+
+#include "Globals.h"
+#include "../TestHelpers.h"
+#include "ChunkIndex.h"
+
+
+
+
+
+/** Tests inserting, finding and erasing a few entries. */
+static void ChunkIndexBasic()
+{
+	int Values[3] = {};
+	cChunkIndex<int> Index;
+	TEST_EQUAL(Index.Find({ 0, 0 }), nullptr);
+	TEST_FALSE(Index.Erase({ 0, 0 }));
+
+	Index.Insert({ 0, 0 }, &Values[0]);
+	Index.Insert({ -1, 5 }, &Values[1]);
+	Index.Insert({ 5, -1 }, &Values[2]);
+	TEST_EQUAL(Index.GetSize(), 3);
+	TEST_EQUAL(Index.Find({ 0, 0 }), &Values[0]);
+	TEST_EQUAL(Index.Find({ -1, 5 }), &Values[1]);
+	TEST_EQUAL(Index.Find({ 5, -1 }), &Values[2]);
+	TEST_EQUAL(Index.Find({ 1, 0 }), nullptr);
+
+	TEST_TRUE(Index.Erase({ -1, 5 }));
+	TEST_FALSE(Index.Erase({ -1, 5 }));
+	TEST_EQUAL(Index.Find({ -1, 5 }), nullptr);
+	TEST_EQUAL(Index.Find({ 0, 0 }), &Values[0]);
+	TEST_EQUAL(Index.Find({ 5, -1 }), &Values[2]);
+	TEST_EQUAL(Index.GetSize(), 2);
+
+	Index.Clear();
+	TEST_EQUAL(Index.GetSize(), 0);
+	TEST_EQUAL(Index.Find({ 0, 0 }), nullptr);
+}
+
+
+
+
+
+/** Tests that the index stays consistent with a std::map through many inserts and erases, including regrowing. */
+static void ChunkIndexVsMap()
+{
+	static const int Radius = 40;
+	std::vector<int> Values((2 * Radius + 1) * (2 * Radius + 1));
+	std::map<cChunkCoords, int *> Reference;
+	cChunkIndex<int> Index;
+
+	// Insert a square of chunks:
+	for (int z = -Radius; z <= Radius; z++)
+	{
+		for (int x = -Radius; x <= Radius; x++)
+		{
+			auto Value = &Values[static_cast<size_t>((x + Radius) + (z + Radius) * (2 * Radius + 1))];
+			Index.Insert({ x, z }, Value);
+			Reference[{ x, z }] = Value;
+		}
+	}
+	TEST_EQUAL(Index.GetSize(), Reference.size());
+
+	// Erase a checkerboard-ish pattern, so that the probe sequences get holes in them:
+	for (int z = -Radius; z <= Radius; z++)
+	{
+		for (int x = -Radius; x <= Radius; x++)
+		{
+			if (((x * 7 + z * 3) % 5) == 0)
+			{
+				TEST_TRUE(Index.Erase({ x, z }));
+				Reference.erase({ x, z });
+			}
+		}
+	}
+	TEST_EQUAL(Index.GetSize(), Reference.size());
+
+	// Everything must still be found, or not found, exactly as in the reference:
+	for (int z = -Radius - 2; z <= Radius + 2; z++)
+	{
+		for (int x = -Radius - 2; x <= Radius + 2; x++)
+		{
+			auto itr = Reference.find({ x, z });
+			TEST_EQUAL(Index.Find({ x, z }), ((itr == Reference.end()) ? nullptr : itr->second));
+		}
+	}
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("ChunkIndex",
+	ChunkIndexBasic();
+	ChunkIndexVsMap();
+)
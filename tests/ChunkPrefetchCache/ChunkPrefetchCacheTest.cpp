@@ -0,0 +1,81 @@
+// ChunkPrefetchCacheTest.cpp
+
+#include "Globals.h"
+#include "../TestHelpers.h"
+#include "ChunkPrefetchCache.h"
+
+
+
+
+
+/** Tests that the chunks are added once, and that the used ones are removed. */
+static void ChunkPrefetchCacheAddRemove()
+{
+	cChunkPrefetchCache Cache(10);
+	cChunkCoordsVector Evicted;
+	TEST_TRUE(Cache.Add({ 0, 0 }, Evicted));
+	TEST_TRUE(Cache.Add({ 1, 0 }, Evicted));
+	TEST_FALSE(Cache.Add({ 0, 0 }, Evicted));
+	TEST_EQUAL(Cache.GetNumChunks(), 2);
+	TEST_TRUE(Evicted.empty());
+
+	TEST_TRUE(Cache.Remove({ 0, 0 }));
+	TEST_FALSE(Cache.Remove({ 0, 0 }));
+	TEST_FALSE(Cache.Remove({ 5, 5 }));
+	TEST_EQUAL(Cache.GetNumChunks(), 1);
+	TEST_EQUAL(Cache.GetNumUsed(), 1);
+
+	// A removed chunk can be prefetched again:
+	TEST_TRUE(Cache.Add({ 0, 0 }, Evicted));
+	TEST_EQUAL(Cache.GetNumChunks(), 2);
+
+	// Nothing is added while disabled:
+	cChunkPrefetchCache Disabled(0);
+	TEST_FALSE(Disabled.Add({ 0, 0 }, Evicted));
+	TEST_EQUAL(Disabled.GetNumChunks(), 0);
+	TEST_TRUE(Evicted.empty());
+}
+
+
+
+
+
+/** Tests that the least recently requested chunks are evicted to keep within the limit. */
+static void ChunkPrefetchCacheEviction()
+{
+	cChunkPrefetchCache Cache(4);
+	cChunkCoordsVector Evicted;
+	for (int i = 0; i < 4; i++)
+	{
+		TEST_TRUE(Cache.Add({ i, 0 }, Evicted));
+	}
+	TEST_TRUE(Evicted.empty());
+
+	// Requesting the oldest chunk again makes the second oldest one go first:
+	TEST_FALSE(Cache.Add({ 0, 0 }, Evicted));
+	TEST_TRUE(Cache.Add({ 4, 0 }, Evicted));
+	TEST_EQUAL(Evicted.size(), 1);
+	TEST_EQUAL(Evicted[0], cChunkCoords(1, 0));
+	TEST_EQUAL(Cache.GetNumChunks(), 4);
+	TEST_EQUAL(Cache.GetNumEvicted(), 1);
+	TEST_FALSE(Cache.Remove({ 1, 0 }));
+
+	// Lowering the limit evicts as many as needed, oldest first:
+	Evicted.clear();
+	Cache.SetMaxChunks(1, Evicted);
+	TEST_EQUAL(Evicted.size(), 3);
+	TEST_EQUAL(Evicted[0], cChunkCoords(2, 0));
+	TEST_EQUAL(Evicted[1], cChunkCoords(3, 0));
+	TEST_EQUAL(Evicted[2], cChunkCoords(0, 0));
+	TEST_EQUAL(Cache.GetNumChunks(), 1);
+	TEST_TRUE(Cache.Remove({ 4, 0 }));
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("ChunkPrefetchCache",
+	ChunkPrefetchCacheAddRemove();
+	ChunkPrefetchCacheEviction();
+)
@@ -0,0 +1,236 @@
+// ChunkStreamerTest.cpp
+
+#include "Globals.h"
+#include "../TestHelpers.h"
+#include "ChunkStreamer.h"
+
+
+
+
+
+/** A tick long enough to fill up the budget completely. */
+static const std::chrono::milliseconds LONG_TICK(1000);
+
+
+
+
+
+/** Returns the number of chunks within the view distance, inclusive, around a chunk. */
+static size_t NumChunksInRange(int a_ViewDistance)
+{
+	return static_cast<size_t>((2 * a_ViewDistance + 1) * (2 * a_ViewDistance + 1));
+}
+
+
+
+
+
+/** Takes all the chunks the budget allows from the streamer. */
+static std::vector<cChunkStreamer::sChunk> TakeChunks(cChunkStreamer & a_Streamer)
+{
+	std::vector<cChunkStreamer::sChunk> Chunks;
+	a_Streamer.TakeNextChunks(Chunks);
+	return Chunks;
+}
+
+
+
+
+
+/** Tests that the frontier covers the unknown chunks in range, and follows the player between chunks. */
+static void ChunkStreamerFrontier()
+{
+	cChunkStreamer Streamer;
+	auto IsNothingKnown = [](cChunkCoords a_Chunk) { UNUSED(a_Chunk); return false; };
+	Streamer.UpdateFrontier({ 0, 0 }, 4, IsNothingKnown);
+	TEST_EQUAL(Streamer.GetFrontierSize(), NumChunksInRange(4));
+
+	// The known chunks are left out:
+	Streamer.Reset();
+	Streamer.UpdateFrontier({ 0, 0 }, 4, [](cChunkCoords a_Chunk) { return (a_Chunk.m_ChunkX < 0); });
+	TEST_EQUAL(Streamer.GetFrontierSize(), 9 * 5);
+
+	// Moving by one chunk checks just the new column:
+	size_t NumChecked = 0;
+	Streamer.UpdateFrontier({ 1, 0 }, 4, [&NumChecked](cChunkCoords a_Chunk)
+	{
+		NumChecked += 1;
+		TEST_EQUAL(a_Chunk.m_ChunkX, 5);
+		return false;
+	});
+	TEST_EQUAL(NumChecked, 9);
+	TEST_EQUAL(Streamer.GetFrontierSize(), 9 * 6);
+
+	// Staying in the same chunk checks nothing:
+	Streamer.UpdateFrontier({ 1, 0 }, 4, [](cChunkCoords a_Chunk) { UNUSED(a_Chunk); TEST_FAIL("Unexpected check"); return false; });
+
+	// Moving further drops the column left behind:
+	Streamer.UpdateFrontier({ 5, 0 }, 4, IsNothingKnown);
+	TEST_EQUAL(Streamer.GetFrontierSize(), NumChunksInRange(4));
+
+	// Changing the view distance rebuilds it:
+	Streamer.UpdateFrontier({ 5, 0 }, 2, IsNothingKnown);
+	TEST_EQUAL(Streamer.GetFrontierSize(), NumChunksInRange(2));
+}
+
+
+
+
+
+/** Tests that the closest chunks are streamed first, and that the budget limits the number of chunks per tick. */
+static void ChunkStreamerNearestFirst()
+{
+	cChunkStreamer::SetBandwidth(64 KiB);
+	cChunkStreamer Streamer;
+	Streamer.UpdateFrontier({ 0, 0 }, 8, [](cChunkCoords a_Chunk) { UNUSED(a_Chunk); return false; });
+
+	// Nothing is streamed before the budget fills up:
+	TEST_TRUE(TakeChunks(Streamer).empty());
+
+	// Looking straight down, so that the direction doesn't matter:
+	Streamer.Tick(LONG_TICK, { 8, 64, 8 }, { 0, -1, 0 });
+	auto Chunks = TakeChunks(Streamer);
+	TEST_EQUAL(Chunks.size(), 2);  // 16 KiB of burst, at the initial 8 KiB per chunk
+	TEST_EQUAL(Chunks[0].m_Chunk, cChunkCoords(0, 0));
+	TEST_LESS_THAN_OR_EQUAL(Chunks[1].m_Distance, 1);
+
+	// Smaller chunks make room for more of them, still nearest first:
+	for (int i = 0; i < 50; i++)
+	{
+		Streamer.ChunkSent(1 KiB);
+	}
+	Streamer.Tick(LONG_TICK, { 8, 64, 8 }, { 0, -1, 0 });
+	Chunks = TakeChunks(Streamer);
+	TEST_GREATER_THAN_OR_EQUAL(Chunks.size(), 8);
+	for (size_t i = 1; i < Chunks.size(); i++)
+	{
+		TEST_LESS_THAN_OR_EQUAL(Chunks[i - 1].m_Distance, Chunks[i].m_Distance);
+	}
+	TEST_EQUAL(Streamer.GetFrontierSize(), NumChunksInRange(8) - 2 - Chunks.size());
+}
+
+
+
+
+
+/** Returns the index of the chunk in the list, or the size of the list if it isn't there. */
+static size_t IndexOf(const std::vector<cChunkStreamer::sChunk> & a_Chunks, cChunkCoords a_Chunk)
+{
+	const auto Itr = std::find_if(a_Chunks.begin(), a_Chunks.end(), [a_Chunk](const cChunkStreamer::sChunk & a_Entry)
+	{
+		return (a_Entry.m_Chunk == a_Chunk);
+	});
+	return static_cast<size_t>(Itr - a_Chunks.begin());
+}
+
+
+
+
+
+/** Tests that the chunks in the look direction are preferred. */
+static void ChunkStreamerLookDirection()
+{
+	cChunkStreamer::SetBandwidth(16 MiB);
+	cChunkStreamer Streamer;
+	Streamer.UpdateFrontier({ 0, 0 }, 8, [](cChunkCoords a_Chunk) { UNUSED(a_Chunk); return false; });
+	Streamer.Tick(LONG_TICK, { 8, 64, 8 }, { 1, 0, 0 });
+	const auto Chunks = TakeChunks(Streamer);
+	TEST_EQUAL(Chunks.size(), NumChunksInRange(8));
+
+	// Of the chunks at the same distance, the one looked at goes first, the one behind last:
+	TEST_TRUE((IndexOf(Chunks, { 2, 0 }) < IndexOf(Chunks, { 0, 2 })));
+	TEST_TRUE((IndexOf(Chunks, { 0, 2 }) < IndexOf(Chunks, { -2, 0 })));
+	TEST_TRUE(Chunks[IndexOf(Chunks, { 2, 0 })].m_IsAhead);
+	TEST_FALSE(Chunks[IndexOf(Chunks, { -2, 0 })].m_IsAhead);
+}
+
+
+
+
+
+/** Tests that the chunks along the player's movement are sent before the player gets there. */
+static void ChunkStreamerMovement()
+{
+	cChunkStreamer::SetBandwidth(16 MiB);
+	cChunkStreamer Streamer;
+
+	// Fly along the Z axis at 40 blocks per second, looking straight down so that the direction doesn't matter:
+	const std::chrono::milliseconds Tick(50);
+	for (int i = 0; i < 20; i++)
+	{
+		Streamer.Tick(Tick, { 8, 64, 8.0 + 2 * i }, { 0, -1, 0 });
+	}
+	TEST_TRUE((Streamer.GetVelocity().z > 30));
+	TEST_TRUE((std::abs(Streamer.GetVelocity().x) < 0.001));
+
+	// Far ahead of the player, the chunks go before the closer ones behind:
+	Streamer.UpdateFrontier({ 0, 2 }, 8, [](cChunkCoords a_Chunk) { UNUSED(a_Chunk); return false; });
+	const auto Chunks = TakeChunks(Streamer);
+	TEST_EQUAL(Chunks.size(), NumChunksInRange(8));
+	TEST_TRUE((IndexOf(Chunks, { 0, 8 }) < IndexOf(Chunks, { 0, -2 })));
+	TEST_TRUE(Chunks[IndexOf(Chunks, { 0, 8 })].m_IsAhead);
+
+	// The immediate surroundings still go first:
+	TEST_EQUAL(Chunks[0].m_Chunk, cChunkCoords(0, 2));
+
+	// Teleports don't count as movement:
+	Streamer.Tick(Tick, { 10000, 64, 48 }, { 0, -1, 0 });
+	TEST_EQUAL(Streamer.GetVelocity().Length(), 0);
+}
+
+
+
+
+
+/** Tests that the chunks beyond the view distance along the player's path are picked for prefetching. */
+static void ChunkStreamerPrefetch()
+{
+	cChunkStreamer Streamer;
+	Streamer.UpdateFrontier({ 0, 0 }, 4, [](cChunkCoords a_Chunk) { UNUSED(a_Chunk); return false; });
+
+	// Walking speed doesn't need prefetching:
+	const std::chrono::milliseconds Tick(50);
+	for (int i = 0; i < 20; i++)
+	{
+		Streamer.Tick(Tick, { 8.0 + 0.2 * i, 64, 8 }, { 0, -1, 0 });
+	}
+	cChunkCoordsVector Chunks;
+	Streamer.GetPrefetchChunks(Chunks);
+	TEST_TRUE(Chunks.empty());
+
+	// Fly along the X axis at 40 blocks per second:
+	for (int i = 0; i < 20; i++)
+	{
+		Streamer.Tick(Tick, { 16.0 + 2 * i, 64, 8 }, { 0, -1, 0 });
+	}
+	Streamer.UpdateFrontier({ 3, 0 }, 4, [](cChunkCoords a_Chunk) { UNUSED(a_Chunk); return false; });
+	Streamer.GetPrefetchChunks(Chunks);
+	TEST_FALSE(Chunks.empty());
+	for (const auto & Chunk : Chunks)
+	{
+		// Only the chunks ahead, beyond the view distance, within the band along the path:
+		TEST_TRUE((Chunk.m_ChunkX > 3 + 4));
+		TEST_TRUE((Chunk.m_ChunkX <= 3 + 4 + 6 + 1));
+		TEST_TRUE((std::abs(Chunk.m_ChunkZ) <= 1));
+	}
+	TEST_TRUE((std::find(Chunks.begin(), Chunks.end(), cChunkCoords(8, 0)) != Chunks.end()));
+	TEST_TRUE((std::is_sorted(Chunks.begin(), Chunks.end())));
+	TEST_TRUE((std::adjacent_find(Chunks.begin(), Chunks.end()) == Chunks.end()));
+
+	// Nothing more until the player moves into another chunk:
+	Chunks.clear();
+	Streamer.GetPrefetchChunks(Chunks);
+	TEST_TRUE(Chunks.empty());
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("ChunkStreamer",
+	ChunkStreamerFrontier();
+	ChunkStreamerNearestFirst();
+	ChunkStreamerLookDirection();
+	ChunkStreamerMovement();
+	ChunkStreamerPrefetch();
+)
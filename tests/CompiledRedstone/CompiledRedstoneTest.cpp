@@ -0,0 +1,271 @@
+// CompiledRedstoneTest.cpp
+
+// Runs a small redstone circuit both with the compiled components and with the neighbourhood scans, and compares the results
+
+#include "Globals.h"
+#include "../TestHelpers.h"
+#include "BlockType.h"
+#include "Chunk.h"
+#include "World.h"
+#include "Simulator/IncrementalRedstoneSimulator/IncrementalRedstoneSimulator.h"
+#include "Simulator/IncrementalRedstoneSimulator/RedstoneSimulatorChunkData.h"
+
+
+
+
+
+/** The simulator that the chunks implemented in Stubs.cpp create their data with, notify of block changes, and tick. */
+extern cRedstoneSimulator * g_RedstoneSimulator;
+
+/** The blocks of the circuit's area, in the order they are read by TakeSnapshot(). */
+using Snapshot = std::vector<std::pair<BLOCKTYPE, NIBBLETYPE>>;
+
+/** The circuit runs along this row. The lever and the first wires are in chunk 0, far enough from the rest in chunk 1
+that switching the lever doesn't outdate the compiled components there. */
+static const int CircuitY = 2;
+static const int CircuitZ = 5;
+
+// The circuit: lever -> 8 wires -> repeater -> stone with a torch on the other side -> 4 wires -> lamp:
+static const int LeverX = 9;
+static const int RepeaterX = 18;
+static const int StoneX = 19;
+static const int TorchX = 20;
+static const int LampX = 25;
+
+
+
+
+
+/** The two chunks that hold the circuit, and the simulator they use. */
+class cCircuit
+{
+public:
+
+	cCircuit(bool a_CompileComponents):
+		m_Simulator(*reinterpret_cast<cWorld *>(m_WorldStorage))
+	{
+		m_Simulator.SetCompileComponents(a_CompileComponents);
+		g_RedstoneSimulator = &m_Simulator;
+		m_Chunks[0] = std::make_unique<cChunk>(0, 0, nullptr, reinterpret_cast<cWorld *>(m_WorldStorage));
+		m_Chunks[1] = std::make_unique<cChunk>(1, 0, nullptr, reinterpret_cast<cWorld *>(m_WorldStorage));
+	}
+
+	~cCircuit()
+	{
+		m_Chunks[0].reset();
+		m_Chunks[1].reset();
+		g_RedstoneSimulator = nullptr;
+	}
+
+	/** Sets the block at the absolute X, waking up the simulator as a player placing it would. */
+	void SetBlock(int a_X, int a_Y, int a_Z, BLOCKTYPE a_Block, NIBBLETYPE a_Meta = 0)
+	{
+		GetChunk(a_X).SetBlock({ a_X % cChunkDef::Width, a_Y, a_Z }, a_Block, a_Meta);
+	}
+
+	BLOCKTYPE GetBlock(int a_X, int a_Y = CircuitY, int a_Z = CircuitZ)
+	{
+		return GetChunk(a_X).GetBlock({ a_X % cChunkDef::Width, a_Y, a_Z });
+	}
+
+	NIBBLETYPE GetMeta(int a_X, int a_Y = CircuitY, int a_Z = CircuitZ)
+	{
+		return GetChunk(a_X).GetMeta({ a_X % cChunkDef::Width, a_Y, a_Z });
+	}
+
+	/** Places the circuit on a stone floor. The lever is off. */
+	void Build()
+	{
+		for (int x = LeverX; x <= LampX; x++)
+		{
+			SetBlock(x, CircuitY - 1, CircuitZ, E_BLOCK_STONE);
+		}
+		SetBlock(LeverX, CircuitY, CircuitZ, E_BLOCK_LEVER, 0x5);
+		for (int x = LeverX + 1; x < RepeaterX; x++)
+		{
+			SetBlock(x, CircuitY, CircuitZ, E_BLOCK_REDSTONE_WIRE);
+		}
+		SetBlock(RepeaterX, CircuitY, CircuitZ, E_BLOCK_REDSTONE_REPEATER_OFF, E_META_REDSTONE_REPEATER_FACING_XP);
+		SetBlock(StoneX, CircuitY, CircuitZ, E_BLOCK_STONE);
+		SetBlock(TorchX, CircuitY, CircuitZ, E_BLOCK_REDSTONE_TORCH_ON, E_META_TORCH_EAST);
+		for (int x = TorchX + 1; x < LampX; x++)
+		{
+			SetBlock(x, CircuitY, CircuitZ, E_BLOCK_REDSTONE_WIRE);
+		}
+		SetBlock(LampX, CircuitY, CircuitZ, E_BLOCK_REDSTONE_LAMP_OFF);
+	}
+
+	/** Ticks both chunks a_NumTicks times, appending a snapshot of the circuit's area after each tick. */
+	void Tick(int a_NumTicks, std::vector<Snapshot> & a_Snapshots)
+	{
+		for (int i = 0; i < a_NumTicks; i++)
+		{
+			m_Chunks[0]->Tick(std::chrono::milliseconds(50));
+			m_Chunks[1]->Tick(std::chrono::milliseconds(50));
+			a_Snapshots.push_back(TakeSnapshot());
+		}
+	}
+
+	/** Returns the chunk's redstone data, for inspecting its compiled components. */
+	const cIncrementalRedstoneSimulatorChunkData & GetData(int a_ChunkX)
+	{
+		return *static_cast<const cIncrementalRedstoneSimulatorChunkData *>(m_Chunks[static_cast<size_t>(a_ChunkX)]->GetRedstoneSimulatorData());
+	}
+
+	/** Returns the compile generation of the component at the absolute X, in the circuit's row, or 0 if it isn't compiled. */
+	UInt64 GetCompiledAt(int a_X)
+	{
+		const auto Compiled = GetData(a_X / cChunkDef::Width).GetCompiledComponent({ a_X % cChunkDef::Width, CircuitY, CircuitZ });
+		return (Compiled == nullptr) ? 0 : Compiled->m_CompiledAt;
+	}
+
+private:
+
+	cChunk & GetChunk(int a_X)
+	{
+		return *m_Chunks[static_cast<size_t>(a_X / cChunkDef::Width)];
+	}
+
+	Snapshot TakeSnapshot()
+	{
+		Snapshot Result;
+		for (int y = CircuitY - 1; y <= CircuitY + 1; y++)
+		{
+			for (int z = CircuitZ - 2; z <= CircuitZ + 2; z++)
+			{
+				for (int x = LeverX - 1; x <= LampX + 1; x++)
+				{
+					Result.emplace_back(GetBlock(x, y, z), GetMeta(x, y, z));
+				}
+			}
+		}
+		return Result;
+	}
+
+	/** The simulator only keeps a reference to its world, which the simulated handlers don't use in this circuit. */
+	alignas(cWorld) std::byte m_WorldStorage[sizeof(cWorld)];
+
+	cIncrementalRedstoneSimulator m_Simulator;
+
+	std::array<std::unique_ptr<cChunk>, 2> m_Chunks;
+};
+
+
+
+
+
+/** Runs the circuit through a series of changes, checking the expected states and appending the snapshots after each tick.
+In the compiled mode, also checks which components keep their compiled inputs. */
+static void RunCircuit(bool a_CompileComponents, std::vector<Snapshot> & a_Snapshots)
+{
+	cCircuit Circuit(a_CompileComponents);
+	Circuit.Build();
+	Circuit.Tick(10, a_Snapshots);
+
+	// The torch powers the wires behind it and the lamp:
+	TEST_EQUAL(Circuit.GetBlock(TorchX), E_BLOCK_REDSTONE_TORCH_ON);
+	TEST_EQUAL(Circuit.GetMeta(TorchX + 1), 15);
+	TEST_EQUAL(Circuit.GetMeta(LampX - 1), 12);
+	TEST_EQUAL(Circuit.GetBlock(LampX), E_BLOCK_REDSTONE_LAMP_ON);
+	TEST_EQUAL(Circuit.GetBlock(RepeaterX), E_BLOCK_REDSTONE_REPEATER_OFF);
+	const auto TorchCompiledAt = Circuit.GetCompiledAt(TorchX);
+	const auto RepeaterCompiledAt = Circuit.GetCompiledAt(RepeaterX);
+	const auto LampCompiledAt = Circuit.GetCompiledAt(LampX);
+	if (a_CompileComponents)
+	{
+		TEST_NOTEQUAL(TorchCompiledAt, 0);
+		TEST_NOTEQUAL(RepeaterCompiledAt, 0);
+		TEST_NOTEQUAL(LampCompiledAt, 0);
+	}
+
+	// Switching the lever on switches the repeater on and the torch off, and the lamp with it:
+	Circuit.SetBlock(LeverX, CircuitY, CircuitZ, E_BLOCK_LEVER, 0x5 | 0x8);
+	Circuit.Tick(10, a_Snapshots);
+	TEST_EQUAL(Circuit.GetMeta(LeverX + 1), 15);
+	TEST_EQUAL(Circuit.GetMeta(RepeaterX - 1), 8);
+	TEST_EQUAL(Circuit.GetBlock(RepeaterX), E_BLOCK_REDSTONE_REPEATER_ON);
+	TEST_EQUAL(Circuit.GetBlock(TorchX), E_BLOCK_REDSTONE_TORCH_OFF);
+	TEST_EQUAL(Circuit.GetMeta(TorchX + 1), 0);
+	TEST_EQUAL(Circuit.GetBlock(LampX), E_BLOCK_REDSTONE_LAMP_OFF);
+	if (a_CompileComponents)
+	{
+		// The components switching by themselves, and the wires changing their power, keep the compiled inputs:
+		TEST_EQUAL(Circuit.GetCompiledAt(TorchX), TorchCompiledAt);
+		TEST_EQUAL(Circuit.GetCompiledAt(RepeaterX), RepeaterCompiledAt);
+		TEST_EQUAL(Circuit.GetCompiledAt(LampX), LampCompiledAt);
+	}
+
+	// A redstone block placed next to a wire powers the wires again, a stone replacing it doesn't:
+	Circuit.SetBlock(TorchX + 2, CircuitY, CircuitZ + 1, E_BLOCK_BLOCK_OF_REDSTONE);
+	Circuit.Tick(5, a_Snapshots);
+	TEST_EQUAL(Circuit.GetMeta(TorchX + 2), 15);
+	TEST_EQUAL(Circuit.GetMeta(TorchX + 1), 14);
+	TEST_EQUAL(Circuit.GetBlock(LampX), E_BLOCK_REDSTONE_LAMP_ON);
+	Circuit.SetBlock(TorchX + 2, CircuitY, CircuitZ + 1, E_BLOCK_STONE);
+	Circuit.Tick(5, a_Snapshots);
+	TEST_EQUAL(Circuit.GetMeta(TorchX + 2), 0);
+	TEST_EQUAL(Circuit.GetBlock(LampX), E_BLOCK_REDSTONE_LAMP_OFF);
+
+	// Switching the lever back off switches the torch back on:
+	Circuit.SetBlock(LeverX, CircuitY, CircuitZ, E_BLOCK_LEVER, 0x5);
+	Circuit.Tick(10, a_Snapshots);
+	TEST_EQUAL(Circuit.GetBlock(RepeaterX), E_BLOCK_REDSTONE_REPEATER_OFF);
+	TEST_EQUAL(Circuit.GetBlock(TorchX), E_BLOCK_REDSTONE_TORCH_ON);
+	TEST_EQUAL(Circuit.GetBlock(LampX), E_BLOCK_REDSTONE_LAMP_ON);
+
+	if (!a_CompileComponents)
+	{
+		TEST_EQUAL(Circuit.GetData(0).GetNumCompiledComponents(), 0);
+		TEST_EQUAL(Circuit.GetData(1).GetNumCompiledComponents(), 0);
+		return;
+	}
+
+	// A block changing in another section doesn't outdate the compiled components:
+	const auto TorchRecompiledAt = Circuit.GetCompiledAt(TorchX);
+	TEST_NOTEQUAL(TorchRecompiledAt, 0);
+	Circuit.SetBlock(TorchX, CircuitY + cChunkDef::SectionHeight * 2, CircuitZ, E_BLOCK_STONE);
+	Circuit.Tick(1, a_Snapshots);
+	TEST_EQUAL(Circuit.GetCompiledAt(TorchX), TorchRecompiledAt);
+
+	// A block changing near the lamp, too far to wake anything up, outdates the compiled components of its section, which are then pruned.
+	// The components in the other chunk are out of its reach and stay:
+	TEST_NOTEQUAL(Circuit.GetData(1).GetNumCompiledComponents(), 0);
+	const auto NumCompiledInChunk0 = Circuit.GetData(0).GetNumCompiledComponents();
+	TEST_NOTEQUAL(NumCompiledInChunk0, 0);
+	Circuit.SetBlock(LampX, CircuitY, CircuitZ + 3, E_BLOCK_STONE);
+	Circuit.Tick(1, a_Snapshots);
+	TEST_EQUAL(Circuit.GetData(1).GetNumCompiledComponents(), 0);
+	TEST_EQUAL(Circuit.GetData(0).GetNumCompiledComponents(), NumCompiledInChunk0);
+}
+
+
+
+
+
+/** Tests that the compiled components drive the circuit through exactly the same states as the scans. */
+static void TestCompiledMatchesScan()
+{
+	std::vector<Snapshot> Scanned, Compiled;
+	RunCircuit(false, Scanned);
+	RunCircuit(true, Compiled);
+
+	// The compiled run has a few extra ticks at the end, for its own checks:
+	TEST_GREATER_THAN_OR_EQUAL(Compiled.size(), Scanned.size());
+	for (size_t i = 0; i < Scanned.size(); i++)
+	{
+		const bool AreSame = (Scanned[i] == Compiled[i]);
+		if (!AreSame)
+		{
+			LOGWARNING("The circuit differs after tick %zu", i + 1);
+		}
+		TEST_TRUE(AreSame);
+	}
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("CompiledRedstone",
+	TestCompiledMatchesScan();
+)
@@ -0,0 +1,502 @@
+// Stubs.cpp
+
+// Implements stubs of various Cuberite methods that are needed for linking but not for runtime
+// This is required so that we don't bring in the entire Cuberite via dependencies
+// cChunk is implemented just enough to hold the test's blocks and to drive the redstone simulator, the way cChunk and cSimulatorManager do
+
+#include "Globals.h"
+#include "BlockInfo.h"
+#include "Chunk.h"
+#include "World.h"
+#include "BlockEntities/CommandBlockEntity.h"
+#include "BlockEntities/DropSpenserEntity.h"
+#include "BlockEntities/HopperEntity.h"
+#include "BlockEntities/NoteEntity.h"
+#include "Blocks/BlockPiston.h"
+#include "Blocks/ChunkInterface.h"
+#include "Entities/Player.h"
+#include "Simulator/RedstoneSimulator.h"
+
+
+
+
+
+cRedstoneSimulator * g_RedstoneSimulator = nullptr;
+
+/** All the existing chunks, for linking the neighbours. */
+static std::vector<cChunk *> g_Chunks;
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cChunk:
+
+std::atomic<UInt64> cChunk::ms_NextDataVersion { 1 };
+
+
+
+
+
+cChunk::cChunk(int a_ChunkX, int a_ChunkZ, cChunkMap * a_ChunkMap, cWorld * a_World):
+	m_Presence(cpPresent),
+	m_IsLightValid(false),
+	m_IsDirty(false),
+	m_IsSaving(false),
+	m_DataVersion(ms_NextDataVersion.fetch_add(1, std::memory_order_relaxed)),
+	m_StayCount(0),
+	m_PosX(a_ChunkX),
+	m_PosZ(a_ChunkZ),
+	m_World(a_World),
+	m_ChunkMap(a_ChunkMap),
+	m_WaterSimulatorData(nullptr),
+	m_LavaSimulatorData(nullptr),
+	m_RedstoneSimulatorData(g_RedstoneSimulator->CreateChunkData()),
+	m_AlwaysTicked(0)
+{
+	m_Neighbors.fill(nullptr);
+	m_Neighbors[GetNeighborIndex(0, 0)] = this;
+	for (const auto Chunk : g_Chunks)
+	{
+		const auto OffsetX = Chunk->m_PosX - a_ChunkX;
+		const auto OffsetZ = Chunk->m_PosZ - a_ChunkZ;
+		if ((std::abs(OffsetX) <= 1) && (std::abs(OffsetZ) <= 1))
+		{
+			m_Neighbors[GetNeighborIndex(OffsetX, OffsetZ)] = Chunk;
+			Chunk->m_Neighbors[GetNeighborIndex(-OffsetX, -OffsetZ)] = this;
+		}
+	}
+	g_Chunks.push_back(this);
+}
+
+
+
+
+
+cChunk::~cChunk()
+{
+	for (size_t Idx = 0; Idx < m_Neighbors.size(); Idx++)
+	{
+		if ((m_Neighbors[Idx] != nullptr) && (m_Neighbors[Idx] != this))
+		{
+			m_Neighbors[Idx]->m_Neighbors[8 - Idx] = nullptr;
+		}
+	}
+	g_Chunks.erase(std::find(g_Chunks.begin(), g_Chunks.end(), this));
+	delete m_RedstoneSimulatorData;
+}
+
+
+
+
+
+void cChunk::Tick(std::chrono::milliseconds a_Dt)
+{
+	static_cast<cSimulator *>(g_RedstoneSimulator)->SimulateChunk(a_Dt, m_PosX, m_PosZ, this);
+}
+
+
+
+
+
+void cChunk::SetBlock(Vector3i a_RelPos, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta)
+{
+	FastSetBlock(a_RelPos, a_BlockType, a_BlockMeta);
+
+	// Wake up the block and its neighbours, as cSimulatorManager::WakeUp() does:
+	auto & Simulator = static_cast<cSimulator &>(*g_RedstoneSimulator);
+	Simulator.WakeUp(*this, a_RelPos, a_BlockType);
+	for (const auto & Offset : cSimulator::AdjacentOffsets)
+	{
+		auto Relative = a_RelPos + Offset;
+		if (!cChunkDef::IsValidHeight(Relative.y))
+		{
+			continue;
+		}
+		const auto Chunk = GetRelNeighborChunkAdjustCoords(Relative);
+		if (Chunk != nullptr)
+		{
+			Simulator.WakeUp(*Chunk, Relative, Offset, Chunk->GetBlock(Relative));
+		}
+	}
+}
+
+
+
+
+
+void cChunk::FastSetBlock(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_BlockType, BLOCKTYPE a_BlockMeta)
+{
+	m_BlockData.SetBlock({ a_RelX, a_RelY, a_RelZ }, a_BlockType);
+	m_BlockData.SetMeta({ a_RelX, a_RelY, a_RelZ }, a_BlockMeta);
+}
+
+
+
+
+
+void cChunk::QueueSendBlock(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta)
+{
+}
+
+
+
+
+
+void cChunk::GetBlockTypeMeta(Vector3i a_RelPos, BLOCKTYPE & a_BlockType, NIBBLETYPE & a_BlockMeta) const
+{
+	a_BlockType = GetBlock(a_RelPos);
+	a_BlockMeta = GetMeta(a_RelPos);
+}
+
+
+
+
+
+bool cChunk::UnboundedRelGetBlock(Vector3i a_RelPos, BLOCKTYPE & a_BlockType, NIBBLETYPE & a_BlockMeta) const
+{
+	const auto Chunk = GetRelNeighborChunkAdjustCoords(a_RelPos);
+	if (!cChunkDef::IsValidHeight(a_RelPos.y) || (Chunk == nullptr))
+	{
+		return false;
+	}
+	Chunk->GetBlockTypeMeta(a_RelPos, a_BlockType, a_BlockMeta);
+	return true;
+}
+
+
+
+
+
+bool cChunk::UnboundedRelGetBlockType(Vector3i a_RelPos, BLOCKTYPE & a_BlockType) const
+{
+	NIBBLETYPE Meta;
+	return UnboundedRelGetBlock(a_RelPos, a_BlockType, Meta);
+}
+
+
+
+
+
+cChunk * cChunk::GetRelNeighborChunk(int a_RelX, int a_RelZ)
+{
+	Vector3i RelPos(a_RelX, 0, a_RelZ);
+	return GetRelNeighborChunkAdjustCoords(RelPos);
+}
+
+
+
+
+
+cChunk * cChunk::GetRelNeighborChunkAdjustCoords(Vector3i & a_RelPos) const
+{
+	const auto AbsX = a_RelPos.x + m_PosX * cChunkDef::Width;
+	const auto AbsZ = a_RelPos.z + m_PosZ * cChunkDef::Width;
+	int ChunkX, ChunkZ;
+	cChunkDef::BlockToChunk(AbsX, AbsZ, ChunkX, ChunkZ);
+	a_RelPos.x = AbsX - ChunkX * cChunkDef::Width;
+	a_RelPos.z = AbsZ - ChunkZ * cChunkDef::Width;
+	for (const auto Chunk : g_Chunks)
+	{
+		if ((Chunk->m_PosX == ChunkX) && (Chunk->m_PosZ == ChunkZ))
+		{
+			return Chunk;
+		}
+	}
+	return nullptr;
+}
+
+
+
+
+
+bool cChunk::DoWithBlockEntityAt(Vector3i a_Position, cBlockEntityCallback a_Callback)
+{
+	return false;
+}
+
+
+
+
+
+bool cChunk::ForEachEntityInBox(const cBoundingBox & a_Box, cEntityCallback a_Callback) const
+{
+	return true;
+}
+
+
+
+
+
+NIBBLETYPE cChunk::GetTimeAlteredLight(NIBBLETYPE a_Skylight) const
+{
+	return a_Skylight;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cWorld:
+
+void cWorld::BroadcastSoundParticleEffect(const EffectID a_EffectID, Vector3i a_SrcPos, int a_Data, const cClientHandle * a_Exclude)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastSoundEffect(const AString & a_SoundName, Vector3d a_Position, float a_Volume, float a_Pitch, const cClientHandle * a_Exclude)
+{
+}
+
+
+
+
+
+bool cWorld::DoWithChunk(int a_ChunkX, int a_ChunkZ, cChunkCallback a_Callback)
+{
+	return false;
+}
+
+
+
+
+
+cTickTime cWorld::GetTimeOfDay(void) const
+{
+	return cTickTime(0);
+}
+
+
+
+
+
+UInt32 cWorld::SpawnPrimedTNT(Vector3d a_Pos, int a_FuseTimeInSec, double a_InitialVelocityCoeff, bool a_ShouldPlayFuseSound)
+{
+	return cEntity::INVALID_ID;
+}
+
+
+
+
+
+void cWorld::WakeUpSimulators(Vector3i a_Block)
+{
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Others:
+
+void cBlockPistonHandler::ExtendPiston(Vector3i a_BlockPos, cWorld & a_World)
+{
+}
+
+
+
+
+
+void cBlockPistonHandler::RetractPiston(Vector3i a_BlockPos, cWorld & a_World)
+{
+}
+
+
+
+
+
+bool cChunkInterface::ForEachChunkInRect(int a_MinChunkX, int a_MaxChunkX, int a_MinChunkZ, int a_MaxChunkZ, cChunkDataCallback & a_Callback)
+{
+	return false;
+}
+
+
+
+
+
+bool cChunkInterface::WriteBlockArea(cBlockArea & a_Area, int a_MinBlockX, int a_MinBlockY, int a_MinBlockZ, int a_DataTypes)
+{
+	return false;
+}
+
+
+
+
+
+BLOCKTYPE cChunkInterface::GetBlock(Vector3i a_Pos)
+{
+	return E_BLOCK_AIR;
+}
+
+
+
+
+
+NIBBLETYPE cChunkInterface::GetBlockMeta(Vector3i a_Pos)
+{
+	return 0;
+}
+
+
+
+
+
+void cChunkInterface::SetBlockMeta(Vector3i a_Pos, NIBBLETYPE a_MetaData)
+{
+}
+
+
+
+
+
+cItems cBlockEntity::ConvertToPickups() const
+{
+	return {};
+}
+
+
+
+
+
+void cBlockEntity::CopyFrom(const cBlockEntity & a_Src)
+{
+}
+
+
+
+
+
+void cBlockEntity::Destroy()
+{
+}
+
+
+
+
+
+void cBlockEntity::OnAddToWorld(cWorld & a_World, cChunk & a_Chunk)
+{
+}
+
+
+
+
+
+void cBlockEntity::OnRemoveFromWorld()
+{
+}
+
+
+
+
+
+bool cBlockEntity::Tick(std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
+{
+	return false;
+}
+
+
+
+
+
+cItems cBlockEntityWithItems::ConvertToPickups() const
+{
+	return {};
+}
+
+
+
+
+
+void cBlockEntityWithItems::CopyFrom(const cBlockEntity & a_Src)
+{
+}
+
+
+
+
+
+void cBlockEntityWithItems::OnSlotChanged(cItemGrid * a_Grid, int a_SlotNum)
+{
+}
+
+
+
+
+
+void cCommandBlockEntity::Activate(void)
+{
+}
+
+
+
+
+
+void cDropSpenserEntity::Activate(void)
+{
+}
+
+
+
+
+
+void cHopperEntity::SetLocked(bool a_Value)
+{
+}
+
+
+
+
+
+void cNoteEntity::MakeSound(void)
+{
+}
+
+
+
+
+
+bool cPlayer::IsGameModeSpectator(void) const
+{
+	return false;
+}
+
+
+
+
+
+cEnchantments::cEnchantments()
+{
+}
+
+
+
+
+
+cItem::cItem()
+{
+}
+
+
+
+
+
+char cItem::GetMaxStackSize(void) const
+{
+	return 64;
+}
+
+
+
+
+
+const cItem & cItemGrid::GetSlot(int a_SlotNum) const
+{
+	return m_Slots.GetAt(a_SlotNum);
+}
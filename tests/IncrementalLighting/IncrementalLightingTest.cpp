@@ -0,0 +1,318 @@
+// IncrementalLightingTest.cpp
+
+// Tests that the light updated by cIncrementalLighting matches the light calculated from scratch
+
+#include "Globals.h"
+#include "../TestHelpers.h"
+#include "BlockInfo.h"
+#include "BlockType.h"
+#include "IncrementalLighting.h"
+
+
+
+
+
+/** A world of two lit chunks next to each other along the X axis, chunk 0 and chunk 1.
+The positions are world coords; everything outside the two chunks is treated as not loaded. */
+class cTestWorld
+{
+public:
+
+	using eChannel = cIncrementalLighting::eChannel;
+
+	static const int SizeX = 2 * cChunkDef::Width;
+	static const int SizeZ = cChunkDef::Width;
+
+
+	cTestWorld(void) :
+		m_BlockTypes(SizeX * SizeZ * cChunkDef::Height, E_BLOCK_AIR),
+		m_BlockLight(m_BlockTypes.size(), 0),
+		m_SkyLight(m_BlockTypes.size(), 0)
+	{
+	}
+
+
+	/** Sets the block without updating the light; used to build the world before the first full relight. */
+	void SetBlock(Vector3i a_Pos, BLOCKTYPE a_BlockType)
+	{
+		m_BlockTypes[Index(a_Pos)] = a_BlockType;
+	}
+
+
+	/** Sets the block and updates the light incrementally, as cChunk does; the positions given to the update are relative to the block's chunk. */
+	void ChangeBlock(Vector3i a_Pos, BLOCKTYPE a_BlockType)
+	{
+		SetBlock(a_Pos, a_BlockType);
+		const int ChunkX = a_Pos.x / cChunkDef::Width;
+		cAccess Access(*this, ChunkX * cChunkDef::Width);
+		cIncrementalLighting::BlockChanged(Access, { a_Pos.x - ChunkX * cChunkDef::Width, a_Pos.y, a_Pos.z });
+	}
+
+
+	/** Calculates the whole light from scratch, with the same rules as the full lighting in cLightingThread:
+	sunlight goes down unchanged from the top of the world through the blocks that let it through, then all light spreads with the falloff. */
+	void FullRelight(void)
+	{
+		std::fill(m_BlockLight.begin(), m_BlockLight.end(), 0);
+		std::fill(m_SkyLight.begin(), m_SkyLight.end(), 0);
+		std::vector<Vector3i> BlockSeeds, SkySeeds;
+		for (int z = 0; z < SizeZ; z++)
+		{
+			for (int x = 0; x < SizeX; x++)
+			{
+				for (int y = cChunkDef::Height - 1; y >= 0; y--)
+				{
+					const auto BlockType = m_BlockTypes[Index({ x, y, z })];
+					if (!cBlockInfo::IsTransparent(BlockType) || cBlockInfo::IsSkylightDispersant(BlockType))
+					{
+						break;
+					}
+					m_SkyLight[Index({ x, y, z })] = 15;
+					SkySeeds.emplace_back(x, y, z);
+				}
+				for (int y = 0; y < cChunkDef::Height; y++)
+				{
+					const auto Light = cBlockInfo::GetLightValue(m_BlockTypes[Index({ x, y, z })]);
+					if (Light > 0)
+					{
+						m_BlockLight[Index({ x, y, z })] = Light;
+						BlockSeeds.emplace_back(x, y, z);
+					}
+				}
+			}
+		}
+		Spread(m_BlockLight, BlockSeeds);
+		Spread(m_SkyLight, SkySeeds);
+	}
+
+
+	/** Returns the number of positions where the light differs from the light in a_Other, in either channel. */
+	size_t CountDifferences(const cTestWorld & a_Other) const
+	{
+		size_t Count = 0;
+		for (size_t i = 0; i < m_BlockTypes.size(); i++)
+		{
+			if ((m_BlockLight[i] != a_Other.m_BlockLight[i]) || (m_SkyLight[i] != a_Other.m_SkyLight[i]))
+			{
+				Count += 1;
+			}
+		}
+		return Count;
+	}
+
+
+	NIBBLETYPE GetBlockLight(Vector3i a_Pos) const { return m_BlockLight[Index(a_Pos)]; }
+	NIBBLETYPE GetSkyLight(Vector3i a_Pos) const { return m_SkyLight[Index(a_Pos)]; }
+
+protected:
+
+	/** Gives cIncrementalLighting access to the world, with positions relative to one of the chunks. */
+	class cAccess :
+		public cIncrementalLighting::cBlockAccess
+	{
+	public:
+
+		cAccess(cTestWorld & a_World, int a_OriginX) :
+			m_World(a_World),
+			m_OriginX(a_OriginX)
+		{
+		}
+
+		virtual bool GetBlock(Vector3i a_RelPos, eChannel a_Channel, BLOCKTYPE & a_BlockType, NIBBLETYPE & a_Light) override
+		{
+			const Vector3i Pos(a_RelPos.x + m_OriginX, a_RelPos.y, a_RelPos.z);
+			if (!IsInside(Pos))
+			{
+				return false;
+			}
+			a_BlockType = m_World.m_BlockTypes[Index(Pos)];
+			a_Light = m_World.GetChannel(a_Channel)[Index(Pos)];
+			return true;
+		}
+
+		virtual void SetLight(Vector3i a_RelPos, eChannel a_Channel, NIBBLETYPE a_Light) override
+		{
+			const Vector3i Pos(a_RelPos.x + m_OriginX, a_RelPos.y, a_RelPos.z);
+			TEST_TRUE(IsInside(Pos));
+			TEST_LESS_THAN_OR_EQUAL(a_Light, 15);
+			m_World.GetChannel(a_Channel)[Index(Pos)] = a_Light;
+		}
+
+	private:
+
+		cTestWorld & m_World;
+		int m_OriginX;
+	} ;
+
+
+	std::vector<BLOCKTYPE> m_BlockTypes;
+	std::vector<NIBBLETYPE> m_BlockLight;
+	std::vector<NIBBLETYPE> m_SkyLight;
+
+
+	static bool IsInside(Vector3i a_Pos)
+	{
+		return (
+			(a_Pos.x >= 0) && (a_Pos.x < SizeX) &&
+			(a_Pos.z >= 0) && (a_Pos.z < SizeZ) &&
+			cChunkDef::IsValidHeight(a_Pos.y)
+		);
+	}
+
+
+	static size_t Index(Vector3i a_Pos)
+	{
+		return static_cast<size_t>(a_Pos.x + (a_Pos.z + a_Pos.y * SizeZ) * SizeX);
+	}
+
+
+	std::vector<NIBBLETYPE> & GetChannel(eChannel a_Channel)
+	{
+		return (a_Channel == eChannel::BlockLight) ? m_BlockLight : m_SkyLight;
+	}
+
+
+	/** Spreads the light from the seeds until it no longer increases anything. */
+	void Spread(std::vector<NIBBLETYPE> & a_Light, std::vector<Vector3i> a_Seeds)
+	{
+		static const Vector3i Offsets[] = { {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1} };
+		for (size_t i = 0; i < a_Seeds.size(); i++)
+		{
+			const auto Src = a_Seeds[i];
+			const auto SrcLight = a_Light[Index(Src)];
+			for (const auto & Offset : Offsets)
+			{
+				const auto Dst = Src + Offset;
+				if (!IsInside(Dst))
+				{
+					continue;
+				}
+				const auto Falloff = cBlockInfo::GetSpreadLightFalloff(m_BlockTypes[Index(Dst)]);
+				if (SrcLight > a_Light[Index(Dst)] + Falloff)
+				{
+					a_Light[Index(Dst)] = static_cast<NIBBLETYPE>(SrcLight - Falloff);
+					a_Seeds.push_back(Dst);
+				}
+			}
+		}
+	}
+} ;
+
+
+
+
+
+/** Changes the block incrementally, then checks that the light matches a full relight of a copy of the world. */
+static void ChangeAndCompare(cTestWorld & a_World, Vector3i a_Pos, BLOCKTYPE a_BlockType)
+{
+	a_World.ChangeBlock(a_Pos, a_BlockType);
+	auto Expected = a_World;
+	Expected.FullRelight();
+	TEST_EQUAL(a_World.CountDifferences(Expected), 0);
+}
+
+
+
+
+
+/** Builds a stone floor at y = 60, with an open sky above it. */
+static void BuildFloor(cTestWorld & a_World)
+{
+	for (int z = 0; z < cTestWorld::SizeZ; z++)
+	{
+		for (int x = 0; x < cTestWorld::SizeX; x++)
+		{
+			a_World.SetBlock({ x, 60, z }, E_BLOCK_STONE);
+		}
+	}
+	a_World.FullRelight();
+}
+
+
+
+
+
+/** Tests placing and removing light sources, within a chunk and next to the chunk border. */
+static void TestLightSource()
+{
+	cTestWorld World;
+	BuildFloor(World);
+
+	// A glowstone in the middle of chunk 0, then removed:
+	ChangeAndCompare(World, { 8, 61, 8 }, E_BLOCK_GLOWSTONE);
+	TEST_EQUAL(World.GetBlockLight({ 8, 61, 8 }), 15);
+	TEST_EQUAL(World.GetBlockLight({ 12, 61, 8 }), 11);
+	ChangeAndCompare(World, { 8, 61, 8 }, E_BLOCK_AIR);
+	TEST_EQUAL(World.GetBlockLight({ 12, 61, 8 }), 0);
+
+	// A torch at the border of chunk 0, lighting chunk 1 as well:
+	ChangeAndCompare(World, { 15, 61, 8 }, E_BLOCK_TORCH);
+	TEST_EQUAL(World.GetBlockLight({ 16, 61, 8 }), 13);
+
+	// A second light source in chunk 1, overlapping the first one; removing the first must keep the light of the second:
+	ChangeAndCompare(World, { 19, 61, 8 }, E_BLOCK_GLOWSTONE);
+	ChangeAndCompare(World, { 15, 61, 8 }, E_BLOCK_AIR);
+	TEST_EQUAL(World.GetBlockLight({ 15, 61, 8 }), 11);
+
+	// Walling the light source off and opening the wall again:
+	ChangeAndCompare(World, { 18, 61, 8 }, E_BLOCK_STONE);
+	ChangeAndCompare(World, { 18, 61, 8 }, E_BLOCK_AIR);
+	ChangeAndCompare(World, { 19, 61, 8 }, E_BLOCK_AIR);
+	TEST_EQUAL(World.GetBlockLight({ 19, 61, 8 }), 0);
+}
+
+
+
+
+
+/** Tests opening and closing a hole in a roof, within a chunk and at the chunk border. */
+static void TestSkyHole()
+{
+	cTestWorld World;
+	BuildFloor(World);
+
+	// A roof at y = 70 over both chunks, leaving a dark room above the floor:
+	for (int z = 0; z < cTestWorld::SizeZ; z++)
+	{
+		for (int x = 0; x < cTestWorld::SizeX; x++)
+		{
+			World.SetBlock({ x, 70, z }, E_BLOCK_STONE);
+		}
+	}
+	World.FullRelight();
+	TEST_EQUAL(World.GetSkyLight({ 8, 65, 8 }), 0);
+	TEST_EQUAL(World.GetSkyLight({ 8, 71, 8 }), 15);
+
+	// A hole in the middle of chunk 0, then closed:
+	ChangeAndCompare(World, { 8, 70, 8 }, E_BLOCK_AIR);
+	TEST_EQUAL(World.GetSkyLight({ 8, 61, 8 }), 15);
+	TEST_EQUAL(World.GetSkyLight({ 10, 61, 8 }), 13);
+	ChangeAndCompare(World, { 8, 70, 8 }, E_BLOCK_STONE);
+	TEST_EQUAL(World.GetSkyLight({ 8, 61, 8 }), 0);
+
+	// A hole at the border of chunk 1, lighting chunk 0 as well:
+	ChangeAndCompare(World, { 16, 70, 4 }, E_BLOCK_AIR);
+	TEST_EQUAL(World.GetSkyLight({ 16, 65, 4 }), 15);
+	TEST_EQUAL(World.GetSkyLight({ 15, 65, 4 }), 14);
+
+	// A second hole next to it, across the border, and leaves dispersing the light below it:
+	ChangeAndCompare(World, { 15, 70, 4 }, E_BLOCK_AIR);
+	ChangeAndCompare(World, { 15, 66, 4 }, E_BLOCK_LEAVES);
+	TEST_EQUAL(World.GetSkyLight({ 15, 65, 4 }), 14);
+
+	// Closing the first hole, then the second:
+	ChangeAndCompare(World, { 16, 70, 4 }, E_BLOCK_STONE);
+	TEST_NOTEQUAL(World.GetSkyLight({ 16, 65, 4 }), 0);
+	ChangeAndCompare(World, { 15, 70, 4 }, E_BLOCK_STONE);
+	TEST_EQUAL(World.GetSkyLight({ 16, 65, 4 }), 0);
+	ChangeAndCompare(World, { 15, 66, 4 }, E_BLOCK_AIR);
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("IncrementalLighting",
+	TestLightSource();
+	TestSkyHole();
+)
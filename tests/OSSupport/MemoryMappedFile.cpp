@@ -0,0 +1,104 @@
+// MemoryMappedFile.cpp
+
+// Tests the cMemoryMappedFile class
+
+#include "Globals.h"
+#include "../TestHelpers.h"
+#include "OSSupport/MemoryMappedFile.h"
+
+
+
+
+
+static const AString TestFileName = "MemoryMappedFileTest.tmp";
+
+
+
+
+
+/** Tests mapping a file and reading views of it. */
+static void MapAndRead()
+{
+	{
+		cFile f(TestFileName, cFile::fmWrite);
+		TEST_TRUE(f.IsOpen());
+		f.Write("0123456789", 10);
+	}
+
+	cMemoryMappedFile Mapping;
+	TEST_TRUE(Mapping.Open(TestFileName));
+	TEST_TRUE(Mapping.IsOpen());
+	TEST_EQUAL(Mapping.GetSize(), 10);
+
+	auto View = Mapping.GetView(2, 3);
+	TEST_EQUAL(View.size(), 3);
+	TEST_EQUAL(std::memcmp(View.data(), "234", 3), 0);
+	TEST_EQUAL(Mapping.GetView(0, 10).size(), 10);
+
+	// Ranges not entirely within the mapping result in empty views:
+	TEST_TRUE(Mapping.GetView(8, 3).empty());
+	TEST_TRUE(Mapping.GetView(11, 0).empty());
+	TEST_TRUE(Mapping.GetView(5, std::numeric_limits<size_t>::max()).empty());
+
+	Mapping.Close();
+	TEST_FALSE(Mapping.IsOpen());
+	TEST_EQUAL(Mapping.GetSize(), 0);
+}
+
+
+
+
+
+/** Tests that the mapping sees in-place writes through another handle, and that re-opening picks up appended data. */
+static void WritesThroughOtherHandle()
+{
+	cFile f(TestFileName, cFile::fmReadWrite);
+	TEST_TRUE(f.IsOpen());
+	cMemoryMappedFile Mapping;
+	TEST_TRUE(Mapping.Open(TestFileName));
+
+	// Overwrite within the mapped range:
+	f.Seek(4);
+	f.Write("ab", 2);
+	f.Flush();
+	TEST_EQUAL(std::memcmp(Mapping.GetView(3, 4).data(), "3ab6", 4), 0);
+
+	// Append past the mapped range, it is visible only after re-mapping:
+	f.Seek(10);
+	f.Write("XYZ", 3);
+	f.Flush();
+	TEST_TRUE(Mapping.GetView(10, 3).empty());
+	TEST_TRUE(Mapping.Open(TestFileName));
+	TEST_EQUAL(Mapping.GetSize(), 13);
+	TEST_EQUAL(std::memcmp(Mapping.GetView(10, 3).data(), "XYZ", 3), 0);
+}
+
+
+
+
+
+/** Tests that the files that cannot be mapped are reported. */
+static void Failures()
+{
+	cMemoryMappedFile Mapping;
+	TEST_FALSE(Mapping.Open("NonExistentMemoryMappedFileTest.tmp"));
+	TEST_FALSE(Mapping.IsOpen());
+
+	// Empty files cannot be mapped:
+	{
+		cFile f(TestFileName, cFile::fmWrite);
+		TEST_TRUE(f.IsOpen());
+	}
+	TEST_FALSE(Mapping.Open(TestFileName));
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("MemoryMappedFile",
+	MapAndRead();
+	WritesThroughOtherHandle();
+	Failures();
+	cFile::DeleteFile(TestFileName);
+)
@@ -0,0 +1,98 @@
+// PendingBlockSendsTest.cpp
+
+// Tests the bookkeeping of the block changes queued for sending, and of the sections to be resent whole
+
+#include "Globals.h"
+#include "../TestHelpers.h"
+#include "BlockType.h"
+#include "PendingBlockSends.h"
+
+
+
+
+
+/** Returns the number of queued block changes in the specified section. */
+static size_t CountInSection(const cPendingBlockSends & a_Sends, int a_Section)
+{
+	const auto & Blocks = a_Sends.GetBlocks();
+	return static_cast<size_t>(std::count_if(Blocks.begin(), Blocks.end(), [a_Section](const sSetBlock & a_Block)
+		{
+			return (a_Block.m_RelY / cChunkDef::SectionHeight == a_Section);
+		}
+	));
+}
+
+
+
+
+
+/** Tests that a section is marked for resending only once it goes over the threshold, and that its single changes are dropped then. */
+static void TestThreshold()
+{
+	const size_t Threshold = 4;
+	cPendingBlockSends Sends;
+	TEST_EQUAL(Sends.GetSectionMask(), 0);
+	TEST_TRUE(Sends.GetBlocks().empty());
+
+	// Changes up to the threshold are queued one by one, both in section 1 and in section 3:
+	for (int i = 0; i < static_cast<int>(Threshold); i++)
+	{
+		Sends.Add(2, -5, i, 16 + i, 0, E_BLOCK_STONE, 0, Threshold);
+	}
+	Sends.Add(2, -5, 0, 50, 0, E_BLOCK_DIRT, 1, Threshold);
+	TEST_EQUAL(Sends.GetSectionMask(), 0);
+	TEST_EQUAL(Sends.GetBlocks().size(), Threshold + 1);
+	TEST_EQUAL(CountInSection(Sends, 1), Threshold);
+	const auto & First = Sends.GetBlocks().front();
+	TEST_EQUAL(First.m_ChunkX, 2);
+	TEST_EQUAL(First.m_ChunkZ, -5);
+	TEST_EQUAL(First.m_RelY, 16);
+	TEST_EQUAL(First.m_BlockType, E_BLOCK_STONE);
+
+	// One more change in section 1 marks it to be resent whole, dropping its single changes but keeping those of section 3:
+	Sends.Add(2, -5, 15, 31, 15, E_BLOCK_STONE, 0, Threshold);
+	TEST_EQUAL(Sends.GetSectionMask(), 1 << 1);
+	TEST_EQUAL(CountInSection(Sends, 1), 0);
+	TEST_EQUAL(CountInSection(Sends, 3), 1);
+	TEST_EQUAL(Sends.GetBlocks().size(), 1);
+
+	// Further changes in the section are covered by the resend and not queued:
+	Sends.Add(2, -5, 1, 20, 1, E_BLOCK_GLASS, 0, Threshold);
+	TEST_EQUAL(Sends.GetBlocks().size(), 1);
+	TEST_EQUAL(Sends.GetSectionMask(), 1 << 1);
+
+	// Clearing starts counting from scratch:
+	Sends.Clear();
+	TEST_EQUAL(Sends.GetSectionMask(), 0);
+	TEST_TRUE(Sends.GetBlocks().empty());
+	for (int i = 0; i < static_cast<int>(Threshold); i++)
+	{
+		Sends.Add(2, -5, i, 16, 0, E_BLOCK_STONE, 0, Threshold);
+	}
+	TEST_EQUAL(Sends.GetSectionMask(), 0);
+	TEST_EQUAL(Sends.GetBlocks().size(), Threshold);
+}
+
+
+
+
+
+/** Tests that a zero threshold resends a section on its first change, and that the topmost section maps to the top bit. */
+static void TestZeroThreshold()
+{
+	cPendingBlockSends Sends;
+	Sends.Add(0, 0, 0, cChunkDef::Height - 1, 0, E_BLOCK_STONE, 0, 0);
+	TEST_EQUAL(Sends.GetSectionMask(), 1 << (cChunkDef::NumSections - 1));
+	TEST_TRUE(Sends.GetBlocks().empty());
+	Sends.Add(0, 0, 0, 0, 0, E_BLOCK_STONE, 0, 0);
+	TEST_EQUAL(Sends.GetSectionMask(), ((1 << (cChunkDef::NumSections - 1)) | 1));
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("PendingBlockSends",
+	TestThreshold();
+	TestZeroThreshold();
+)
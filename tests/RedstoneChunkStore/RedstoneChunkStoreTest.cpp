@@ -0,0 +1,179 @@
+// RedstoneChunkStoreTest.cpp
+
+#include "Globals.h"
+#include "../TestHelpers.h"
+#include "BlockType.h"
+#include "Simulator/IncrementalRedstoneSimulator/RedstoneChunkStore.h"
+
+
+
+
+
+/** Tests that each kind of data is stored for its block only, and that the blocks without any data report none. */
+static void RedstoneChunkStoreData()
+{
+	cRedstoneChunkStore Store;
+	const Vector3i Position(1, 2, 3);
+	TEST_EQUAL(Store.GetPower(Position), 0);
+	TEST_EQUAL(Store.GetDelay(Position), nullptr);
+	TEST_EQUAL(Store.GetWireState(Position), nullptr);
+	TEST_EQUAL(Store.GetObservedBlock(Position), nullptr);
+
+	// Positions outside the chunk have no data:
+	TEST_EQUAL(Store.GetPower({ 0, -1, 0 }), 0);
+	TEST_EQUAL(Store.GetDelay({ 16, 0, 0 }), nullptr);
+
+	Store.SetPower(Position, 7);
+	TEST_EQUAL(Store.ExchangePower(Position, 9), 7);
+	TEST_EQUAL(Store.GetPower(Position), 9);
+	TEST_EQUAL(Store.ExchangePower({ 0, 0, 0 }, 3), 0);
+
+	Store.SetDelay(Position, { 4, true });
+	TEST_NOTEQUAL(Store.GetDelay(Position), nullptr);
+	TEST_EQUAL(Store.GetDelay(Position)->first, 4);
+	TEST_TRUE(Store.GetDelay(Position)->second);
+	Store.GetDelay(Position)->first -= 1;
+	TEST_EQUAL(Store.GetDelay(Position)->first, 3);
+
+	Store.SetWireState(Position, BlockState(42));
+	TEST_EQUAL(Store.GetWireState(Position)->ID, 42);
+	Store.SetObservedBlock(Position, cRedstoneChunkStore::cObservedBlock(E_BLOCK_STONE, 1));
+	TEST_TRUE((*Store.GetObservedBlock(Position) == cRedstoneChunkStore::cObservedBlock(E_BLOCK_STONE, 1)));
+
+	// All the data is in a single record per block:
+	TEST_EQUAL(Store.GetNumRecords(), 2);
+	TEST_EQUAL(Store.GetDelay({ 0, 0, 0 }), nullptr);
+	TEST_EQUAL(Store.GetPower({ 1, 2, 4 }), 0);
+
+	// Removing one kind of data keeps the rest:
+	Store.EraseDelay(Position);
+	TEST_EQUAL(Store.GetDelay(Position), nullptr);
+	TEST_EQUAL(Store.GetPower(Position), 9);
+	TEST_EQUAL(Store.GetWireState(Position)->ID, 42);
+
+	// Erasing removes everything:
+	Store.Erase(Position);
+	TEST_EQUAL(Store.GetPower(Position), 0);
+	TEST_EQUAL(Store.GetWireState(Position), nullptr);
+	TEST_EQUAL(Store.GetObservedBlock(Position), nullptr);
+	TEST_EQUAL(Store.GetNumRecords(), 1);
+
+	// A zero power level alone doesn't need a record:
+	Store.SetPower({ 0, 0, 0 }, 0);
+	TEST_EQUAL(Store.GetNumRecords(), 0);
+	Store.SetPower({ 5, 5, 5 }, 0);
+	TEST_EQUAL(Store.GetNumRecords(), 0);
+}
+
+
+
+
+
+/** Tests that the records stay correct while blocks are added and removed in any order, across sections, compared to a plain map. */
+static void RedstoneChunkStoreChurn()
+{
+	cRedstoneChunkStore Store;
+	std::map<std::tuple<int, int, int>, std::pair<PowerLevel, int>> Expected;
+	std::minstd_rand Random(1);
+	for (int i = 0; i < 20000; i++)
+	{
+		const Vector3i Position(
+			static_cast<int>(Random() % 16),
+			static_cast<int>(Random() % 64),  // Four sections, so that they are emptied and refilled
+			static_cast<int>(Random() % 4)
+		);
+		const auto Key = std::make_tuple(Position.x, Position.y, Position.z);
+		switch (Random() % 4)
+		{
+			case 0:
+			{
+				const auto Power = static_cast<PowerLevel>(Random() % 16);
+				Store.SetPower(Position, Power);
+				Expected[Key].first = Power;
+				break;
+			}
+			case 1:
+			{
+				const auto Delay = static_cast<int>(Random() % 5) + 1;
+				Store.SetDelay(Position, { Delay, false });
+				Expected[Key].second = Delay;
+				break;
+			}
+			case 2:
+			{
+				Store.EraseDelay(Position);
+				Expected[Key].second = 0;
+				break;
+			}
+			case 3:
+			{
+				Store.Erase(Position);
+				Expected.erase(Key);
+				break;
+			}
+		}
+	}
+
+	size_t NumRecords = 0;
+	size_t NumDelays = 0;
+	for (const auto & Entry : Expected)
+	{
+		const Vector3i Position(std::get<0>(Entry.first), std::get<1>(Entry.first), std::get<2>(Entry.first));
+		TEST_EQUAL(Store.GetPower(Position), Entry.second.first);
+		const auto Delay = Store.GetDelay(Position);
+		TEST_EQUAL((Delay == nullptr) ? 0 : Delay->first, Entry.second.second);
+		if ((Entry.second.first != 0) || (Entry.second.second != 0))
+		{
+			NumRecords += 1;
+		}
+		if (Entry.second.second != 0)
+		{
+			NumDelays += 1;
+		}
+	}
+	TEST_EQUAL(Store.GetNumRecords(), NumRecords);
+
+	// Walking the delays visits each of them once, at its own position:
+	size_t NumVisited = 0;
+	Store.ForEachDelay([&](const Vector3i a_Position, cRedstoneChunkStore::cDelayInfo & a_Delay)
+	{
+		const auto & Entry = Expected[std::make_tuple(a_Position.x, a_Position.y, a_Position.z)];
+		TEST_EQUAL(a_Delay.first, Entry.second);
+		NumVisited += 1;
+	});
+	TEST_EQUAL(NumVisited, NumDelays);
+}
+
+
+
+
+
+/** Tests that the always ticked blocks are walked with their positions. */
+static void RedstoneChunkStoreAlwaysTicked()
+{
+	cRedstoneChunkStore Store;
+	Store.SetAlwaysTicked({ 15, 255, 15 });
+	Store.SetAlwaysTicked({ 0, 0, 0 });
+	Store.SetAlwaysTicked({ 3, 100, 7 });
+	Store.SetPower({ 4, 100, 7 }, 5);
+
+	std::vector<Vector3i> Visited;
+	Store.ForEachAlwaysTicked([&Visited](const Vector3i a_Position)
+	{
+		Visited.push_back(a_Position);
+	});
+	TEST_EQUAL(Visited.size(), 3);
+	TEST_TRUE((std::find(Visited.begin(), Visited.end(), Vector3i(15, 255, 15)) != Visited.end()));
+	TEST_TRUE((std::find(Visited.begin(), Visited.end(), Vector3i(0, 0, 0)) != Visited.end()));
+	TEST_TRUE((std::find(Visited.begin(), Visited.end(), Vector3i(3, 100, 7)) != Visited.end()));
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("RedstoneChunkStore",
+	RedstoneChunkStoreData();
+	RedstoneChunkStoreChurn();
+	RedstoneChunkStoreAlwaysTicked();
+)
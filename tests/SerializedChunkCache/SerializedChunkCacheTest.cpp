@@ -0,0 +1,98 @@
+// SerializedChunkCacheTest.cpp
+
+#include "Globals.h"
+#include "../TestHelpers.h"
+#include "SerializedChunkCache.h"
+
+
+
+
+
+/** Returns shared data of the specified size, filled with the specified byte. */
+static cSerializedChunkCache::cData MakeData(size_t a_Size, std::byte a_Fill)
+{
+	return std::make_shared<const ContiguousByteBuffer>(a_Size, a_Fill);
+}
+
+
+
+
+
+/** Tests that entries are only found for their exact chunk, version and data version. */
+static void SerializedChunkCacheFind()
+{
+	cSerializedChunkCache Cache(1 MiB);
+	TEST_EQUAL(Cache.Find({ 0, 0 }, 0, 1), nullptr);
+
+	const auto Data = MakeData(100, std::byte(1));
+	Cache.Insert({ 0, 0 }, 0, 1, Data);
+	Cache.Insert({ 0, 0 }, 1, 1, MakeData(200, std::byte(2)));
+	TEST_EQUAL(Cache.GetNumEntries(), 2);
+	TEST_EQUAL(Cache.GetMemoryUsed(), 300);
+
+	TEST_EQUAL(Cache.Find({ 0, 0 }, 0, 1), Data);
+	TEST_EQUAL(Cache.Find({ 0, 0 }, 1, 1)->size(), 200);
+	TEST_EQUAL(Cache.Find({ 1, 0 }, 0, 1), nullptr);
+	TEST_EQUAL(Cache.Find({ 0, 0 }, 2, 1), nullptr);
+	TEST_EQUAL(Cache.GetNumHits(), 2);
+	TEST_EQUAL(Cache.GetNumMisses(), 3);
+
+	// The chunk has changed, the outdated entry is dropped:
+	TEST_EQUAL(Cache.Find({ 0, 0 }, 0, 2), nullptr);
+	TEST_EQUAL(Cache.GetNumEntries(), 1);
+	TEST_EQUAL(Cache.GetMemoryUsed(), 200);
+	TEST_EQUAL(Cache.Find({ 0, 0 }, 0, 1), nullptr);
+
+	// Inserting replaces the previous entry:
+	Cache.Insert({ 0, 0 }, 1, 3, MakeData(50, std::byte(3)));
+	TEST_EQUAL(Cache.GetNumEntries(), 1);
+	TEST_EQUAL(Cache.GetMemoryUsed(), 50);
+	TEST_EQUAL(Cache.Find({ 0, 0 }, 1, 1), nullptr);
+	Cache.Insert({ 0, 0 }, 1, 3, MakeData(50, std::byte(3)));
+	TEST_EQUAL(Cache.Find({ 0, 0 }, 1, 3)->front(), std::byte(3));
+}
+
+
+
+
+
+/** Tests that the least recently used entries are dropped to keep within the memory limit. */
+static void SerializedChunkCacheEviction()
+{
+	cSerializedChunkCache Cache(1000);
+	for (int i = 0; i < 10; i++)
+	{
+		Cache.Insert({ i, 0 }, 0, 1, MakeData(100, std::byte(i)));
+	}
+	TEST_EQUAL(Cache.GetNumEntries(), 10);
+	TEST_EQUAL(Cache.GetMemoryUsed(), 1000);
+
+	// Use the oldest entry, so that the second oldest one is dropped next:
+	TEST_NOTEQUAL(Cache.Find({ 0, 0 }, 0, 1), nullptr);
+	Cache.Insert({ 10, 0 }, 0, 1, MakeData(100, std::byte(10)));
+	TEST_EQUAL(Cache.GetNumEntries(), 10);
+	TEST_NOTEQUAL(Cache.Find({ 0, 0 }, 0, 1), nullptr);
+	TEST_EQUAL(Cache.Find({ 1, 0 }, 0, 1), nullptr);
+
+	// A large entry drops as many as needed:
+	Cache.Insert({ 11, 0 }, 0, 1, MakeData(450, std::byte(11)));
+	TEST_EQUAL(Cache.GetNumEntries(), 6);
+	TEST_LESS_THAN_OR_EQUAL(Cache.GetMemoryUsed(), 1000);
+	TEST_NOTEQUAL(Cache.Find({ 11, 0 }, 0, 1), nullptr);
+	TEST_NOTEQUAL(Cache.Find({ 0, 0 }, 0, 1), nullptr);
+
+	// An entry larger than the whole cache isn't stored, and doesn't drop anything:
+	const auto NumEntries = Cache.GetNumEntries();
+	Cache.Insert({ 12, 0 }, 0, 1, MakeData(2000, std::byte(12)));
+	TEST_EQUAL(Cache.GetNumEntries(), NumEntries);
+	TEST_EQUAL(Cache.Find({ 12, 0 }, 0, 1), nullptr);
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("SerializedChunkCache",
+	SerializedChunkCacheFind();
+	SerializedChunkCacheEviction();
+)
@@ -0,0 +1,146 @@
+// SpatialGridTest.cpp
+
+#include "Globals.h"
+#include "../TestHelpers.h"
+#include "SpatialGrid.h"
+
+
+
+
+
+/** Returns the items the grid reports for the box, sorted. */
+static std::vector<int> ItemsInBox(const cSpatialGrid<int> & a_Grid, const Vector3d a_Min, const Vector3d a_Max)
+{
+	std::vector<int> Items;
+	a_Grid.ForEachInBox(a_Min, a_Max, [&Items](int a_Item)
+	{
+		Items.push_back(a_Item);
+		return false;
+	});
+	std::sort(Items.begin(), Items.end());
+	return Items;
+}
+
+
+
+
+
+/** Tests that the items are found in their cells as they're added, moved and removed. */
+static void SpatialGridAddMoveRemove()
+{
+	cSpatialGrid<int> Grid(4);
+	Grid.Add(1, { 0.5, 64, 0.5 });
+	Grid.Add(2, { 3.9, 64, 3.9 });  // Same cell as 1
+	Grid.Add(3, { -0.5, 64, 0.5 });  // Negative coords are in their own cell
+	TEST_EQUAL(Grid.GetNumItems(), 3);
+	TEST_EQUAL(ItemsInBox(Grid, { 1, 65, 1 }, { 2, 66, 2 }), std::vector<int>({ 1, 2 }));
+	TEST_EQUAL(ItemsInBox(Grid, { -1, 64, 0 }, { -1, 64, 0 }), std::vector<int>({ 3 }));
+	TEST_EQUAL(ItemsInBox(Grid, { -1, 64, 0 }, { 0, 64, 0 }), std::vector<int>({ 1, 2, 3 }));
+
+	// Moving within the cell, and to another one:
+	Grid.Move(1, { 1, 64, 1 });
+	Grid.Move(2, { 20, 64, 3 });
+	TEST_EQUAL(ItemsInBox(Grid, { 0, 64, 0 }, { 3, 64, 3 }), std::vector<int>({ 1 }));
+	TEST_EQUAL(ItemsInBox(Grid, { 20, 60, 0 }, { 21, 64, 1 }), std::vector<int>({ 2 }));
+
+	TEST_TRUE(Grid.Remove(1));
+	TEST_FALSE(Grid.Remove(1));
+	TEST_EQUAL(Grid.GetNumItems(), 2);
+	TEST_TRUE(ItemsInBox(Grid, { 0, 64, 0 }, { 3, 64, 3 }).empty());
+
+	Grid.Clear();
+	TEST_EQUAL(Grid.GetNumItems(), 0);
+	TEST_TRUE(ItemsInBox(Grid, { -100, 0, -100 }, { 100, 255, 100 }).empty());
+}
+
+
+
+
+
+/** Tests that the boxes, from tiny to huge, report all the items positioned within them, compared to checking each item. */
+static void SpatialGridBoxes()
+{
+	cSpatialGrid<int> Grid(4);
+	std::vector<Vector3d> Positions;
+	std::minstd_rand Random(1);
+	auto RandomCoord = [&Random](double a_Range)
+	{
+		return static_cast<double>(Random() % 10000) / 10000 * a_Range - a_Range / 2;
+	};
+	for (int i = 0; i < 500; i++)
+	{
+		Positions.emplace_back(RandomCoord(32), 64 + RandomCoord(16), RandomCoord(32));
+		Grid.Add(i, Positions.back());
+	}
+
+	// Move some of them around:
+	for (int i = 0; i < 500; i += 3)
+	{
+		Positions[static_cast<size_t>(i)] += Vector3d(RandomCoord(8), RandomCoord(8), RandomCoord(8));
+		Grid.Move(i, Positions[static_cast<size_t>(i)]);
+	}
+
+	for (const double Size : { 0.5, 3.0, 10.0, 1000.0 })
+	{
+		for (int Box = 0; Box < 50; Box++)
+		{
+			const Vector3d Min(RandomCoord(32), 64 + RandomCoord(16), RandomCoord(32));
+			const Vector3d Max = Min + Vector3d(Size, Size, Size);
+			const auto Found = ItemsInBox(Grid, Min, Max);
+			for (size_t i = 0; i < Positions.size(); i++)
+			{
+				const auto & Pos = Positions[i];
+				if (
+					(Pos.x >= Min.x) && (Pos.x <= Max.x) &&
+					(Pos.y >= Min.y) && (Pos.y <= Max.y) &&
+					(Pos.z >= Min.z) && (Pos.z <= Max.z)
+				)
+				{
+					TEST_TRUE(std::binary_search(Found.begin(), Found.end(), static_cast<int>(i)));
+				}
+			}
+		}
+	}
+
+	// A box far from everything reports nothing:
+	TEST_TRUE(ItemsInBox(Grid, { 1000, 64, 1000 }, { 1001, 65, 1001 }).empty());
+}
+
+
+
+
+
+/** Tests that the enumeration stops once the callback returns true. */
+static void SpatialGridAbort()
+{
+	cSpatialGrid<int> Grid(4);
+	for (int i = 0; i < 10; i++)
+	{
+		Grid.Add(i, { static_cast<double>(i), 64, 0 });
+	}
+
+	int NumCalled = 0;
+	TEST_FALSE(Grid.ForEachInBox({ 0, 64, 0 }, { 10, 64, 0 }, [&NumCalled](int a_Item)
+	{
+		UNUSED(a_Item);
+		NumCalled += 1;
+		return (NumCalled == 3);
+	}));
+	TEST_EQUAL(NumCalled, 3);
+
+	TEST_TRUE(Grid.ForEachInBox({ 0, 64, 0 }, { 10, 64, 0 }, [](int a_Item)
+	{
+		UNUSED(a_Item);
+		return false;
+	}));
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("SpatialGrid",
+	SpatialGridAddMoveRemove();
+	SpatialGridBoxes();
+	SpatialGridAbort();
+)